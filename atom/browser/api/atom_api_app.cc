@@ -484,6 +484,8 @@ App::App(v8::Isolate* isolate) {
     brave::BraveContentBrowserClient::Get())->set_delegate(this);
   atom::Browser::Get()->AddObserver(this);
   content::GpuDataManager::GetInstance()->AddObserver(this);
+  memory_pressure_listener_.reset(new base::MemoryPressureListener(
+      base::Bind(&App::OnMemoryPressure, base::Unretained(this))));
   Init(isolate);
   static_cast<MuonBrowserProcessImpl*>(g_browser_process)->set_app(this);
 #if BUILDFLAG(ENABLE_EXTENSIONS)
@@ -679,6 +681,23 @@ void App::OnGpuProcessCrashed(base::TerminationStatus exit_code) {
   Emit("gpu-process-crashed");
 }
 
+void App::OnMemoryPressure(
+    base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level) {
+  if (atom::Browser::Get()->is_shutting_down())
+    return;
+
+  switch (memory_pressure_level) {
+    case base::MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE:
+      Emit("memory-pressure", std::string("moderate"));
+      break;
+    case base::MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL:
+      Emit("memory-pressure", std::string("critical"));
+      break;
+    default:
+      break;
+  }
+}
+
 base::FilePath App::GetPath(mate::Arguments* args, const std::string& name) {
   bool succeed = false;
   base::FilePath path;
@@ -871,8 +890,11 @@ void App::SendMemoryPressureAlert() {
 void App::PostMessage(int worker_id,
                       v8::Local<v8::Value> message,
                       mate::Arguments* args) {
-  if (!brave::WorkerBindings::OnMessage(isolate(), worker_id, message))
-    args->ThrowError("Eror serializing message");
+  v8::Local<v8::Value> transfer_list;
+  args->GetNext(&transfer_list);
+  // the serializer throws if the message can't be cloned or transferred
+  brave::WorkerBindings::OnMessage(
+      isolate(), worker_id, message, transfer_list);
 }
 
 void App::StopWorker(mate::Arguments* args) {
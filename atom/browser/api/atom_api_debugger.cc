@@ -12,6 +12,8 @@
 #include "atom/common/native_mate_converters/value_converter.h"
 #include "base/json/json_reader.h"
 #include "base/json/json_writer.h"
+#include "base/strings/string_util.h"
+#include "base/threading/thread_task_runner_handle.h"
 #include "content/public/browser/devtools_agent_host.h"
 #include "content/public/browser/web_contents.h"
 #include "native_mate/dictionary.h"
@@ -25,9 +27,91 @@ namespace atom {
 
 namespace api {
 
+namespace {
+
+// Returns the position of the brace closing the object which starts at the
+// beginning of |json|, skipping the braces in strings, or npos.
+size_t FindObjectEnd(base::StringPiece json) {
+  if (!json.starts_with("{"))
+    return base::StringPiece::npos;
+
+  int depth = 0;
+  bool in_string = false;
+  for (size_t i = 0; i < json.size(); ++i) {
+    char c = json[i];
+    if (in_string) {
+      if (c == '\\')
+        ++i;
+      else if (c == '"')
+        in_string = false;
+    } else if (c == '"') {
+      in_string = true;
+    } else if (c == '{') {
+      ++depth;
+    } else if (c == '}' && --depth == 0) {
+      return i;
+    }
+  }
+  return base::StringPiece::npos;
+}
+
+// Protocol events are serialized as {"method":"...","params":{...}}, so the
+// method and the params can be found without parsing the message. Returns
+// false for anything else, which is parsed as before.
+bool SplitProtocolEvent(const std::string& message,
+                        base::StringPiece* method,
+                        base::StringPiece* params) {
+  static const char kMethodPrefix[] = "{\"method\":\"";
+  static const char kParamsPrefix[] = ",\"params\":";
+
+  base::StringPiece rest(message);
+  if (!rest.starts_with(kMethodPrefix))
+    return false;
+  rest.remove_prefix(arraysize(kMethodPrefix) - 1);
+
+  size_t end = rest.find('"');
+  if (end == base::StringPiece::npos)
+    return false;
+  *method = rest.substr(0, end);
+  if (method->find('\\') != base::StringPiece::npos)
+    return false;
+  rest.remove_prefix(end + 1);
+
+  if (rest == "}") {
+    *params = "{}";
+    return true;
+  }
+  if (!rest.starts_with(kParamsPrefix))
+    return false;
+  rest.remove_prefix(arraysize(kParamsPrefix) - 1);
+
+  // anything but the end of the message after the params means it isn't laid
+  // out as expected, e.g. there is a sessionId
+  size_t params_end = FindObjectEnd(rest);
+  if (params_end == base::StringPiece::npos ||
+      rest.substr(params_end + 1) != "}")
+    return false;
+  *params = rest.substr(0, params_end + 1);
+  return true;
+}
+
+void GetLazyEventParams(v8::Local<v8::Name> name,
+                        const v8::PropertyCallbackInfo<v8::Value>& info) {
+  v8::Local<v8::Value> params;
+  if (v8::JSON::Parse(info.GetIsolate()->GetCurrentContext(),
+                      info.Data().As<v8::String>()).ToLocal(&params))
+    info.GetReturnValue().Set(params);
+}
+
+}  // namespace
+
 Debugger::Debugger(v8::Isolate* isolate, content::WebContents* web_contents)
     : web_contents_(web_contents),
-      previous_request_id_(0) {
+      previous_request_id_(0),
+      filter_events_(false),
+      event_format_(EventFormat::OBJECT),
+      batch_events_(false),
+      weak_factory_(this) {
   Init(isolate);
 }
 
@@ -35,6 +119,7 @@ Debugger::~Debugger() {
 }
 
 void Debugger::AgentHostClosed(DevToolsAgentHost* agent_host) {
+  FlushEvents();
   Emit("detach", "target closed");
 }
 
@@ -42,8 +127,17 @@ void Debugger::DispatchProtocolMessage(DevToolsAgentHost* agent_host,
                                        const std::string& message) {
   DCHECK(agent_host == agent_host_.get());
 
+  // events which are filtered out are dropped without being parsed
+  base::StringPiece event_method;
+  base::StringPiece event_params;
+  if (SplitProtocolEvent(message, &event_method, &event_params)) {
+    if (IsEventWanted(event_method))
+      EmitEvent(event_method.as_string(), event_params);
+    return;
+  }
+
   std::unique_ptr<base::Value> parsed_message(base::JSONReader::Read(message));
-  if (!parsed_message->is_dict())
+  if (!parsed_message || !parsed_message->is_dict())
     return;
 
   base::DictionaryValue* dict =
@@ -51,14 +145,22 @@ void Debugger::DispatchProtocolMessage(DevToolsAgentHost* agent_host,
   int id;
   if (!dict->GetInteger("id", &id)) {
     std::string method;
-    if (!dict->GetString("method", &method))
+    if (!dict->GetString("method", &method) || !IsEventWanted(method))
       return;
     base::DictionaryValue* params_value = nullptr;
     base::DictionaryValue params;
     if (dict->GetDictionary("params", &params_value))
       params.Swap(params_value);
-    Emit("message", method, params);
+    if (event_format_ == EventFormat::OBJECT && !batch_events_) {
+      Emit("message", method, params);
+    } else {
+      std::string params_json;
+      base::JSONWriter::Write(params, &params_json);
+      EmitEvent(method, params_json);
+    }
   } else {
+    // the events sent before the response are emitted first
+    FlushEvents();
     auto send_command_callback = pending_requests_[id];
     pending_requests_.erase(id);
     if (send_command_callback.is_null())
@@ -138,6 +240,118 @@ void Debugger::SendCommand(mate::Arguments* args) {
   agent_host_->DispatchProtocolMessage(this, json_args);
 }
 
+void Debugger::SetEventFilter(mate::Arguments* args) {
+  filter_events_ = false;
+  event_methods_.clear();
+  event_domains_.clear();
+
+  v8::Local<v8::Value> filter;
+  if (args->GetNext(&filter) && !filter->IsNullOrUndefined()) {
+    std::vector<std::string> methods;
+    if (!mate::ConvertFromV8(isolate(), filter, &methods)) {
+      args->ThrowError("`methods` must be an array of strings");
+      return;
+    }
+    filter_events_ = true;
+    for (const auto& method : methods) {
+      if (base::EndsWith(method, ".*", base::CompareCase::SENSITIVE))
+        event_domains_.insert(method.substr(0, method.size() - 1));
+      else
+        event_methods_.insert(method);
+    }
+  }
+
+  EventFormat event_format = EventFormat::OBJECT;
+  bool batch_events = false;
+  mate::Dictionary options;
+  if (args->GetNext(&options)) {
+    std::string format;
+    if (options.Get("format", &format)) {
+      if (format == "json") {
+        event_format = EventFormat::JSON;
+      } else if (format == "lazy") {
+        event_format = EventFormat::LAZY;
+      } else if (format != "object") {
+        args->ThrowError("`format` must be 'object', 'json' or 'lazy'");
+        return;
+      }
+    }
+    options.Get("batch", &batch_events);
+  }
+
+  // the batched events are delivered the way they were asked for
+  FlushEvents();
+  event_format_ = event_format;
+  batch_events_ = batch_events;
+}
+
+bool Debugger::IsEventWanted(const base::StringPiece& method) const {
+  if (!filter_events_)
+    return true;
+  if (event_methods_.count(method.as_string()))
+    return true;
+
+  size_t dot = method.find('.');
+  return dot != base::StringPiece::npos &&
+      event_domains_.count(method.substr(0, dot + 1).as_string());
+}
+
+void Debugger::EmitEvent(const std::string& method,
+                         const base::StringPiece& params) {
+  if (batch_events_) {
+    if (pending_events_.empty()) {
+      base::ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE,
+          base::Bind(&Debugger::FlushEvents, weak_factory_.GetWeakPtr()));
+    }
+    pending_events_.push_back(std::make_pair(method, params.as_string()));
+    return;
+  }
+
+  v8::Locker locker(isolate());
+  v8::HandleScope handle_scope(isolate());
+  Emit("message", method, ConvertEventParams(params));
+}
+
+v8::Local<v8::Value> Debugger::ConvertEventParams(
+    const base::StringPiece& params) {
+  v8::Local<v8::String> json = mate::StringToV8(isolate(), params);
+  if (event_format_ == EventFormat::JSON)
+    return json;
+
+  v8::Local<v8::Context> context = isolate()->GetCurrentContext();
+  if (event_format_ == EventFormat::LAZY) {
+    v8::Local<v8::Object> event = v8::Object::New(isolate());
+    event->Set(mate::StringToV8(isolate(), "json"), json);
+    ignore_result(event->SetLazyDataProperty(context,
+        mate::StringToV8(isolate(), "params"), &GetLazyEventParams, json));
+    return event;
+  }
+
+  v8::Local<v8::Value> value;
+  if (!v8::JSON::Parse(context, json).ToLocal(&value))
+    return v8::Object::New(isolate());
+  return value;
+}
+
+void Debugger::FlushEvents() {
+  if (pending_events_.empty())
+    return;
+
+  std::vector<std::pair<std::string, std::string>> events;
+  events.swap(pending_events_);
+
+  v8::Locker locker(isolate());
+  v8::HandleScope handle_scope(isolate());
+  v8::Local<v8::Array> messages = v8::Array::New(isolate(), events.size());
+  for (size_t i = 0; i < events.size(); ++i) {
+    mate::Dictionary message = mate::Dictionary::CreateEmpty(isolate());
+    message.Set("method", events[i].first);
+    message.Set("params", ConvertEventParams(events[i].second));
+    messages->Set(i, message.GetHandle());
+  }
+  Emit("messages", messages);
+}
+
 // static
 mate::Handle<Debugger> Debugger::Create(
     v8::Isolate* isolate,
@@ -153,7 +367,8 @@ void Debugger::BuildPrototype(v8::Isolate* isolate,
       .SetMethod("attach", &Debugger::Attach)
       .SetMethod("isAttached", &Debugger::IsAttached)
       .SetMethod("detach", &Debugger::Detach)
-      .SetMethod("sendCommand", &Debugger::SendCommand);
+      .SetMethod("sendCommand", &Debugger::SendCommand)
+      .SetMethod("setEventFilter", &Debugger::SetEventFilter);
 }
 
 }  // namespace api
@@ -6,10 +6,15 @@
 #define ATOM_BROWSER_API_ATOM_API_DEBUGGER_H_
 
 #include <map>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "atom/browser/api/trackable_object.h"
 #include "base/callback.h"
+#include "base/memory/weak_ptr.h"
+#include "base/strings/string_piece.h"
 #include "base/values.h"
 #include "content/public/browser/devtools_agent_host_client.h"
 #include "native_mate/handle.h"
@@ -53,10 +58,26 @@ class Debugger: public mate::TrackableObject<Debugger>,
  private:
   using PendingRequestMap = std::map<int, SendCommandCallback>;
 
+  // How the params of protocol events are delivered.
+  enum class EventFormat {
+    OBJECT,
+    // The JSON string, which isn't parsed at all.
+    JSON,
+    // An object with the JSON string, and params parsed on first access.
+    LAZY,
+  };
+
   void Attach(mate::Arguments* args);
   bool IsAttached();
   void Detach();
   void SendCommand(mate::Arguments* args);
+  void SetEventFilter(mate::Arguments* args);
+
+  bool IsEventWanted(const base::StringPiece& method) const;
+  void EmitEvent(const std::string& method, const base::StringPiece& params);
+  v8::Local<v8::Value> ConvertEventParams(const base::StringPiece& params);
+  // Emit the events batched during this task.
+  void FlushEvents();
 
   content::WebContents* web_contents_;  // Weak Reference.
   scoped_refptr<content::DevToolsAgentHost> agent_host_;
@@ -64,6 +85,19 @@ class Debugger: public mate::TrackableObject<Debugger>,
   PendingRequestMap pending_requests_;
   int previous_request_id_;
 
+  // Only the events in |event_methods_| or in a domain of |event_domains_|
+  // are emitted when |filter_events_| is set.
+  bool filter_events_;
+  std::set<std::string> event_methods_;
+  // With the trailing dot, e.g. "Network.".
+  std::set<std::string> event_domains_;
+  EventFormat event_format_;
+  bool batch_events_;
+  // The method and the params JSON of the batched events.
+  std::vector<std::pair<std::string, std::string>> pending_events_;
+
+  base::WeakPtrFactory<Debugger> weak_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(Debugger);
 };
 
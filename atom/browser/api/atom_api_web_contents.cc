@@ -6,6 +6,7 @@
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "atom/browser/api/atom_api_web_contents.h"
 
@@ -41,6 +42,7 @@
 #include "atom/common/native_mate_converters/string16_converter.h"
 #include "atom/common/native_mate_converters/value_converter.h"
 #include "atom/common/options_switches.h"
+#include "atom/common/v8_serialization.h"
 #include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversions.h"
 #include "brave/browser/brave_browser_context.h"
@@ -399,6 +401,13 @@ struct FrameDispatchHelper {
     web_contents->OnRendererMessageSync(
         render_frame_host, channel, args, message);
   }
+
+  void OnRendererMessageSerializedSync(const base::string16& channel,
+                                       const std::vector<uint8_t>& args,
+                                       IPC::Message* message) {
+    web_contents->OnRendererMessageSerializedSync(
+        render_frame_host, channel, args, message);
+  }
 };
 
 namespace {
@@ -452,6 +461,18 @@ content::ServiceWorkerContext* GetServiceWorkerContext(
   return storage_partition->GetServiceWorkerContext();
 }
 
+// Acknowledge a shared memory segment received from a renderer.
+void SendSharedMemoryReleased(int render_process_id,
+                              int render_frame_id,
+                              uint32_t segment_id) {
+  auto rfh =
+      content::RenderFrameHost::FromID(render_process_id, render_frame_id);
+  if (rfh) {
+    rfh->Send(new AtomViewMsg_SharedMemoryReleased(
+        rfh->GetRoutingID(), segment_id));
+  }
+}
+
 // Called when CapturePage is done.
 void OnCapturePageDone(base::Callback<void(const gfx::Image&)> callback,
                        const SkBitmap& bitmap) {
@@ -1355,6 +1376,12 @@ void WebContents::RenderViewDeleted(content::RenderViewHost* render_view_host) {
   Emit("render-view-deleted", render_view_host->GetProcess()->GetID());
 }
 
+void WebContents::RenderFrameDeleted(
+    content::RenderFrameHost* render_frame_host) {
+  ipc_senders_.erase(std::make_pair(render_frame_host->GetProcess()->GetID(),
+                                    render_frame_host->GetRoutingID()));
+}
+
 void WebContents::RenderProcessGone(base::TerminationStatus status) {
   Emit("crashed");
 }
@@ -1559,7 +1586,16 @@ bool WebContents::OnMessageReceived(const IPC::Message& message,
     IPC_MESSAGE_HANDLER(AtomViewHostMsg_Message, OnRendererMessage)
     IPC_MESSAGE_FORWARD_DELAY_REPLY(AtomViewHostMsg_Message_Sync, &helper,
                                     FrameDispatchHelper::OnRendererMessageSync)
+    IPC_MESSAGE_HANDLER(AtomViewHostMsg_Message_Serialized,
+                        OnRendererMessageSerialized)
+    IPC_MESSAGE_FORWARD_DELAY_REPLY(
+        AtomViewHostMsg_Message_Serialized_Sync, &helper,
+        FrameDispatchHelper::OnRendererMessageSerializedSync)
     IPC_MESSAGE_HANDLER(AtomViewHostMsg_Message_Shared, OnRendererMessageShared)
+    IPC_MESSAGE_HANDLER(AtomViewHostMsg_SharedMemoryReleased,
+                        OnSharedMemoryReleased)
+    IPC_MESSAGE_HANDLER(AtomViewHostMsg_Invoke, OnRendererInvoke)
+    IPC_MESSAGE_HANDLER(AtomViewHostMsg_CancelInvoke, OnRendererCancelInvoke)
     IPC_MESSAGE_HANDLER_CODE(ViewHostMsg_SetCursor, OnCursorChange,
                              handled = false)
     IPC_MESSAGE_UNHANDLED(handled = false)
@@ -1622,6 +1658,7 @@ void WebContents::WebContentsDestroyed() {
     return;
 
   is_being_destroyed_ = true;
+  ipc_senders_.clear();
 
   if (IsRemote()) {
     MarkDestroyed();
@@ -2333,25 +2370,24 @@ bool WebContents::ExecuteScriptInTab(mate::Arguments* args) {
 }
 #endif
 
-bool WebContents::SendIPCSharedMemoryInternal(const base::string16& channel,
-                                      base::SharedMemory* shared_memory) {
+bool WebContents::SendIPCSharedMemoryInternal(
+    const base::string16& channel,
+    brave::SharedMemoryWrapper* shared_memory) {
   auto rfh = web_contents()->GetMainFrame();
   return SendIPCSharedMemory(
       rfh->GetProcess()->GetID(), rfh->GetRoutingID(), channel, shared_memory);
 }
 
 // static
-bool WebContents::SendIPCSharedMemory(int render_process_id,
-                                      int render_frame_id,
-                                      const base::string16& channel,
-                                      base::SharedMemory* shared_memory) {
-  base::SharedMemoryHandle memory_handle =
-      shared_memory->handle().Duplicate();
-
+bool WebContents::SendIPCSharedMemory(
+    int render_process_id,
+    int render_frame_id,
+    const base::string16& channel,
+    brave::SharedMemoryWrapper* shared_memory) {
   auto rfh =
       content::RenderFrameHost::FromID(render_process_id, render_frame_id);
 
-  if (!memory_handle.IsValid() || !rfh)
+  if (!shared_memory->segment() || !rfh)
     return false;
 
   base::ProcessHandle handle = rfh->GetProcess()->GetProcess().Handle();
@@ -2359,12 +2395,22 @@ bool WebContents::SendIPCSharedMemory(int render_process_id,
     return false;
   }
 
+  // segments are never shared between renderer processes
+  uint32_t segment_id = 0;
+  uint32_t segment_size = 0;
+  base::SharedMemoryHandle memory_handle =
+      brave::SharedMemoryPool::GetInstance()->Share(
+          shared_memory->segment(), shared_memory->size(), render_process_id,
+          &segment_id, &segment_size);
+  if (!memory_handle.IsValid())
+    return false;
+
   return rfh->Send(new AtomViewMsg_Message_Shared(
-      rfh->GetRoutingID(), channel, memory_handle));
+      rfh->GetRoutingID(), channel, memory_handle, segment_id, segment_size));
 }
 
 bool WebContents::SendIPCMessageInternal(const base::string16& channel,
-                                         const base::ListValue& args) {
+                                         v8::Local<v8::Value> args) {
   auto rfh = web_contents()->GetMainFrame();
   return SendIPCMessage(
       rfh->GetProcess()->GetID(), rfh->GetRoutingID(), channel, args);
@@ -2374,14 +2420,93 @@ bool WebContents::SendIPCMessageInternal(const base::string16& channel,
 bool WebContents::SendIPCMessage(int render_process_id,
                                  int render_frame_id,
                                  const base::string16& channel,
-                                 const base::ListValue& args) {
+                                 v8::Local<v8::Value> args) {
   auto rfh =
       content::RenderFrameHost::FromID(render_process_id, render_frame_id);
 
   if (!rfh)
     return false;
 
-  return rfh->Send(new AtomViewMsg_Message(rfh->GetRoutingID(), channel, args));
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  std::vector<uint8_t> data;
+  bool serialized;
+  {
+    // arguments which can't be cloned are sent as base::Values
+    v8::TryCatch try_catch(isolate);
+    serialized = SerializeV8Value(isolate->GetCurrentContext(), args, &data);
+  }
+  if (serialized) {
+    return rfh->Send(new AtomViewMsg_Message_Serialized(
+        rfh->GetRoutingID(), channel, data));
+  }
+
+  base::ListValue list;
+  if (!mate::ConvertFromV8(isolate, args, &list))
+    return false;
+  return rfh->Send(new AtomViewMsg_Message(rfh->GetRoutingID(), channel, list));
+}
+
+// static
+bool WebContents::SendInvokeReply(int render_process_id,
+                                  int render_frame_id,
+                                  int request_id,
+                                  bool success,
+                                  v8::Local<v8::Value> result) {
+  auto rfh =
+      content::RenderFrameHost::FromID(render_process_id, render_frame_id);
+
+  if (!rfh)
+    return false;
+
+  v8::Isolate* isolate = v8::Isolate::GetCurrent();
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  std::vector<uint8_t> data;
+  bool serialized;
+  {
+    v8::TryCatch try_catch(isolate);
+    serialized = SerializeV8Value(context, result, &data);
+  }
+  if (!serialized) {
+    success = false;
+    data.clear();
+    SerializeV8Value(context,
+        mate::StringToV8(isolate, "Could not clone the result"), &data);
+  }
+
+  return rfh->Send(new AtomViewMsg_InvokeReply(
+      rfh->GetRoutingID(), request_id, success, data));
+}
+
+// static
+v8::Local<v8::Object> WebContents::GetIPCSender(
+    v8::Isolate* isolate, content::RenderFrameHost* render_frame_host) {
+  auto web_contents =
+      content::WebContents::FromRenderFrameHost(render_frame_host);
+  auto owner = GetFrom(isolate, web_contents);
+  auto key = std::make_pair(render_frame_host->GetProcess()->GetID(),
+                            render_frame_host->GetRoutingID());
+  if (!owner.IsEmpty()) {
+    auto it = owner->ipc_senders_.find(key);
+    if (it != owner->ipc_senders_.end())
+      return v8::Local<v8::Object>::New(isolate, it->second);
+  }
+
+  // create a new wrapper so we can rebind send and sendShared
+  // without affecting other references
+  mate::Handle<WebContents> handle = WebContents::CreateFrom(
+      isolate, web_contents, WebContents::Type::REMOTE);
+
+  mate::Dictionary sender(isolate, handle->GetWrapper());
+  sender.SetMethod("_send",
+      base::Bind(&WebContents::SendIPCMessage, key.first, key.second));
+  sender.SetMethod("_sendShared",
+      base::Bind(&WebContents::SendIPCSharedMemory, key.first, key.second));
+  sender.SetMethod("_invokeReply",
+      base::Bind(&WebContents::SendInvokeReply, key.first, key.second));
+
+  if (!owner.IsEmpty())
+    owner->ipc_senders_[key].Reset(isolate, handle->GetWrapper());
+  return handle->GetWrapper();
 }
 
 void WebContents::SendInputEvent(v8::Isolate* isolate,
@@ -2600,6 +2725,14 @@ bool WebContents::IsBackgroundPage() {
 v8::Local<v8::Value> WebContents::TabValue() {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
+  auto tab_helper = extensions::TabHelper::FromWebContents(web_contents());
+  if (tab_helper) {
+    // the helper keeps the value up to date, but every call still gets its
+    // own object so that callers can't change each other's values
+    return content::V8ValueConverter::Create()->ToV8Value(
+        &tab_helper->GetTabValue(), isolate()->GetCurrentContext());
+  }
+
   std::unique_ptr<base::DictionaryValue> value(
       ExtensionTabUtil::CreateTabObject(
           web_contents(), ExtensionTabUtil::kDontScrubTab,
@@ -2825,19 +2958,121 @@ void WebContents::OnRendererMessageSync(content::RenderFrameHost* sender,
   EmitWithSender(base::UTF16ToUTF8(channel), sender, message, args);
 }
 
+void WebContents::OnRendererMessageSerialized(
+    content::RenderFrameHost* sender,
+    const base::string16& channel,
+    const std::vector<uint8_t>& args) {
+  v8::Locker locker(isolate());
+  v8::HandleScope handle_scope(isolate());
+  v8::Local<v8::Value> value;
+  bool deserialized;
+  {
+    // only the deserialization errors are caught, exceptions thrown by the
+    // listeners reach uncaughtException
+    v8::TryCatch try_catch(isolate());
+    deserialized = DeserializeV8Value(isolate()->GetCurrentContext(), args)
+                       .ToLocal(&value);
+  }
+  if (!deserialized) {
+    LOG(ERROR) << "Could not deserialize ipc message arguments";
+    return;
+  }
+  EmitWithSender(base::UTF16ToUTF8(channel), sender, nullptr, value);
+}
+
+void WebContents::OnRendererMessageSerializedSync(
+    content::RenderFrameHost* sender,
+    const base::string16& channel,
+    const std::vector<uint8_t>& args,
+    IPC::Message* message) {
+  v8::Locker locker(isolate());
+  v8::HandleScope handle_scope(isolate());
+  v8::Local<v8::Value> value;
+  bool deserialized;
+  {
+    // only the deserialization errors are caught, exceptions thrown by the
+    // listeners reach uncaughtException
+    v8::TryCatch try_catch(isolate());
+    deserialized = DeserializeV8Value(isolate()->GetCurrentContext(), args)
+                       .ToLocal(&value);
+  }
+  if (!deserialized) {
+    LOG(ERROR) << "Could not deserialize ipc message arguments";
+    // unblock the renderer with an empty result
+    AtomViewHostMsg_Message_Serialized_Sync::WriteReplyParams(
+        message, std::vector<uint8_t>());
+    sender->Send(message);
+    return;
+  }
+  EmitWithSender(base::UTF16ToUTF8(channel), sender, message, value);
+}
+
 void WebContents::OnRendererMessageShared(
     content::RenderFrameHost* sender,
     const base::string16& channel,
-    const base::SharedMemoryHandle& handle) {
+    const base::SharedMemoryHandle& handle,
+    uint32_t segment_id,
+    uint32_t size) {
+  int render_process_id = sender->GetProcess()->GetID();
+  base::Closure release;
+  if (segment_id) {
+    release = base::Bind(&SendSharedMemoryReleased,
+        render_process_id, sender->GetRoutingID(), segment_id);
+  }
+
+  scoped_refptr<brave::SharedMemorySegment> segment =
+      brave::SharedMemoryPool::GetInstance()->MapReceived(
+          render_process_id, segment_id, handle, size);
+  if (!segment) {
+    LOG(ERROR) << "Could not map shared memory";
+    if (!release.is_null())
+      release.Run();
+    return;
+  }
+
   std::vector<v8::Local<v8::Value>> args = {
     mate::StringToV8(isolate(), channel),
-    brave::SharedMemoryWrapper::CreateFrom(isolate(), handle).ToV8(),
+    brave::SharedMemoryWrapper::CreateFrom(isolate(), segment, release).ToV8(),
   };
 
   // webContents.emit(channel, new Event(), args...);
   Emit("ipc-message", args);
 }
 
+void WebContents::OnRendererInvoke(content::RenderFrameHost* sender,
+                                   int request_id,
+                                   const base::string16& channel,
+                                   const std::vector<uint8_t>& args) {
+  v8::Locker locker(isolate());
+  v8::HandleScope handle_scope(isolate());
+  v8::Local<v8::Value> value;
+  bool deserialized;
+  {
+    // exceptions thrown by the handlers aren't caught here
+    v8::TryCatch try_catch(isolate());
+    deserialized = DeserializeV8Value(isolate()->GetCurrentContext(), args)
+                       .ToLocal(&value);
+  }
+  if (!deserialized) {
+    SendInvokeReply(sender->GetProcess()->GetID(), sender->GetRoutingID(),
+        request_id, false,
+        mate::StringToV8(isolate(), "Could not deserialize the arguments"));
+    return;
+  }
+  EmitWithSender("ipc-invoke", sender, nullptr, request_id, channel, value);
+}
+
+void WebContents::OnRendererCancelInvoke(content::RenderFrameHost* sender,
+                                         int request_id) {
+  EmitWithSender("ipc-invoke-cancel", sender, nullptr, request_id);
+}
+
+void WebContents::OnSharedMemoryReleased(content::RenderFrameHost* sender,
+                                         uint32_t segment_id) {
+  brave::SharedMemoryPool::GetInstance()->OnPeerReleased(
+      sender->GetProcess()->GetID(), segment_id);
+}
+
 // static
 mate::Handle<WebContents> WebContents::FromTabID(v8::Isolate* isolate,
     int tab_id) {
@@ -2845,6 +3080,17 @@ mate::Handle<WebContents> WebContents::FromTabID(v8::Isolate* isolate,
       extensions::TabHelper::GetTabById(tab_id));
 }
 
+// static
+v8::Local<v8::Value> WebContents::GetAllTabValues(v8::Isolate* isolate,
+                                                  int32_t window_id,
+                                                  double since_version) {
+  std::unique_ptr<base::DictionaryValue> values =
+      extensions::TabHelper::GetAllTabValues(
+          window_id, since_version > 0 ? since_version : 0);
+  return content::V8ValueConverter::Create()->ToV8Value(
+      values.get(), isolate->GetCurrentContext());
+}
+
 void WebContents::OnTabCreated(const mate::Dictionary& options,
     base::Callback<void(content::WebContents*)> callback,
     content::WebContents* tab) {
@@ -3092,6 +3338,7 @@ void Initialize(v8::Local<v8::Object> exports, v8::Local<v8::Value> unused,
   dict.SetMethod("create", &WebContents::Create);
   dict.SetMethod("createTab", &WebContents::CreateTab);
   dict.SetMethod("fromTabID", &WebContents::FromTabID);
+  dict.SetMethod("getAllTabValues", &WebContents::GetAllTabValues);
   dict.SetMethod("fromId", &mate::TrackableObject<WebContents>::FromWeakMapID);
   dict.SetMethod("getAllWebContents",
                  &mate::TrackableObject<WebContents>::GetAll);
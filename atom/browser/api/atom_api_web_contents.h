@@ -5,8 +5,10 @@
 #ifndef ATOM_BROWSER_API_ATOM_API_WEB_CONTENTS_H_
 #define ATOM_BROWSER_API_ATOM_API_WEB_CONTENTS_H_
 
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "atom/browser/api/save_page_handler.h"
@@ -41,6 +43,7 @@ class SharedMemoryHandle;
 }
 
 namespace brave {
+class SharedMemoryWrapper;
 class TabViewGuest;
 }
 
@@ -121,6 +124,10 @@ class WebContents : public mate::TrackableObject<WebContents>,
   static mate::Handle<WebContents> FromTabID(
     v8::Isolate* isolate, int tab_id);
 
+  // The changes of the tab values of a window since a version.
+  static v8::Local<v8::Value> GetAllTabValues(
+    v8::Isolate* isolate, int32_t window_id, double since_version);
+
   static void CreateTab(mate::Arguments* args);
 
   static mate::Handle<WebContents> GetFrom(
@@ -263,11 +270,25 @@ class WebContents : public mate::TrackableObject<WebContents>,
   static bool SendIPCMessage(int render_process_id,
                              int render_frame_id,
                              const base::string16& channel,
-                             const base::ListValue& args);
+                             v8::Local<v8::Value> args);
   static bool SendIPCSharedMemory(int render_process_id,
                                   int render_frame_id,
                                   const base::string16& channel,
-                                  base::SharedMemory* shared_memory);
+                                  brave::SharedMemoryWrapper* shared_memory);
+
+  // Answer an ipcRenderer.invoke() call, with the error message as |result|
+  // if it failed.
+  static bool SendInvokeReply(int render_process_id,
+                              int render_frame_id,
+                              int request_id,
+                              bool success,
+                              v8::Local<v8::Value> result);
+
+  // The event.sender for ipc messages of |render_frame_host|, a wrapper whose
+  // send methods target that frame. It is created once per frame and reused
+  // until the frame is deleted.
+  static v8::Local<v8::Object> GetIPCSender(
+      v8::Isolate* isolate, content::RenderFrameHost* render_frame_host);
 
   // Send WebInputEvent to the page.
   void SendInputEvent(v8::Isolate* isolate, v8::Local<v8::Value> input_event);
@@ -476,6 +497,7 @@ class WebContents : public mate::TrackableObject<WebContents>,
   void BeforeUnloadFired(const base::TimeTicks& proceed_time) override;
   void RenderViewReady() override;
   void RenderViewDeleted(content::RenderViewHost*) override;
+  void RenderFrameDeleted(content::RenderFrameHost*) override;
   void RenderProcessGone(base::TerminationStatus status) override;
   void DocumentAvailableInMainFrame() override;
   void DocumentOnLoadCompletedInMainFrame() override;
@@ -536,9 +558,9 @@ class WebContents : public mate::TrackableObject<WebContents>,
   friend struct FrameDispatchHelper;
 
   bool SendIPCSharedMemoryInternal(const base::string16& channel,
-                                   base::SharedMemory* shared_memory);
+                                   brave::SharedMemoryWrapper* shared_memory);
   bool SendIPCMessageInternal(const base::string16& channel,
-                              const base::ListValue& args);
+                              v8::Local<v8::Value> args);
   AtomBrowserContext* GetBrowserContext() const;
 
   uint32_t GetNextRequestId() {
@@ -559,14 +581,41 @@ class WebContents : public mate::TrackableObject<WebContents>,
                              const base::ListValue& args,
                              IPC::Message* message);
 
+  // Called when received a message with serialized arguments.
+  void OnRendererMessageSerialized(content::RenderFrameHost* sender,
+                                   const base::string16& channel,
+                                   const std::vector<uint8_t>& args);
+
+  void OnRendererMessageSerializedSync(
+      content::RenderFrameHost* render_frame_host,
+      const base::string16& channel,
+      const std::vector<uint8_t>& args,
+      IPC::Message* message);
+
   void OnRendererMessageShared(content::RenderFrameHost* sender,
                                const base::string16& channel,
-                               const base::SharedMemoryHandle& shared_memory);
+                               const base::SharedMemoryHandle& shared_memory,
+                               uint32_t segment_id,
+                               uint32_t size);
+
+  void OnRendererInvoke(content::RenderFrameHost* sender,
+                        int request_id,
+                        const base::string16& channel,
+                        const std::vector<uint8_t>& args);
+  void OnRendererCancelInvoke(content::RenderFrameHost* sender,
+                              int request_id);
+
+  // Called when the renderer is done with a shared memory segment.
+  void OnSharedMemoryReleased(content::RenderFrameHost* sender,
+                              uint32_t segment_id);
 
   v8::Global<v8::Value> session_;
   v8::Global<v8::Value> devtools_web_contents_;
   v8::Global<v8::Value> debugger_;
 
+  // The ipc senders of the frames, keyed by (process id, routing id).
+  std::map<std::pair<int, int>, v8::Global<v8::Object>> ipc_senders_;
+
   // The type of current WebContents.
   Type type_;
 
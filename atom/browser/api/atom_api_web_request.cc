@@ -4,12 +4,18 @@
 
 #include "atom/browser/api/atom_api_web_request.h"
 
+#include <string>
+#include <utility>
+
 #include "atom/browser/net/atom_network_delegate.h"
 #include "atom/common/native_mate_converters/callback.h"
 #include "atom/common/native_mate_converters/file_path_converter.h"
 #include "atom/common/native_mate_converters/gurl_converter.h"
 #include "atom/common/native_mate_converters/net_converter.h"
+#include "atom/common/node_includes.h"
+#include "base/bind_helpers.h"
 #include "base/files/file_path.h"
+#include "base/task_runner_util.h"
 #include "base/task_scheduler/post_task.h"
 #include "chrome/browser/profiles/profile.h"
 #include "content/public/browser/browser_thread.h"
@@ -25,8 +31,28 @@
 
 using content::BrowserThread;
 
+namespace atom {
+namespace api {
+
+// The result of serializeRequestFilter, passed to JS as a Buffer.
+struct SerializedRequestFilter {
+  std::string data;
+};
+
+}  // namespace api
+}  // namespace atom
+
 namespace mate {
 
+template<>
+struct Converter<atom::api::SerializedRequestFilter> {
+  static v8::Local<v8::Value> ToV8(
+      v8::Isolate* isolate, const atom::api::SerializedRequestFilter& val) {
+    return node::Buffer::Copy(isolate, val.data.data(), val.data.size())
+        .ToLocalChecked();
+  }
+};
+
 template<>
 struct Converter<URLPattern> {
   static bool FromV8(v8::Isolate* isolate, v8::Local<v8::Value> val,
@@ -65,6 +91,93 @@ namespace atom {
 
 namespace api {
 
+namespace {
+
+AtomNetworkDelegate* GetNetworkDelegate(
+    const scoped_refptr<net::URLRequestContextGetter>& getter) {
+  return static_cast<AtomNetworkDelegate*>(
+      getter->GetURLRequestContext()->network_delegate());
+}
+
+using RequestFilterCallback = base::Callback<void(bool)>;
+using SerializeRequestFilterCallback =
+    base::Callback<void(const SerializedRequestFilter&)>;
+
+// Null when |clear| is true, which still goes through the filter sequence
+// so that it isn't reordered with the filters set before.
+scoped_refptr<RequestFilter> CreateRequestFilter(const std::string& rules,
+                                                 bool serialized,
+                                                 bool clear) {
+  if (clear)
+    return nullptr;
+  if (serialized)
+    return RequestFilter::Deserialize(rules);
+  return RequestFilter::Parse(rules);
+}
+
+SerializedRequestFilter SerializeRules(const std::string& rules) {
+  SerializedRequestFilter serialized;
+  serialized.data = RequestFilter::Parse(rules)->Serialize();
+  return serialized;
+}
+
+void SetRequestFilterOnIOThread(
+    const scoped_refptr<net::URLRequestContextGetter>& getter,
+    scoped_refptr<RequestFilter> filter) {
+  GetNetworkDelegate(getter)->SetRequestFilterInIO(std::move(filter));
+}
+
+void OnRequestFilterCreated(
+    const scoped_refptr<net::URLRequestContextGetter>& getter,
+    bool clear,
+    const RequestFilterCallback& callback,
+    scoped_refptr<RequestFilter> filter) {
+  bool success = clear || filter;
+  // the callback runs once the filter is in use on the IO thread, and
+  // failures are also answered from there to keep the callbacks in order
+  base::OnceClosure set_filter = base::DoNothing();
+  if (success)
+    set_filter = base::BindOnce(&SetRequestFilterOnIOThread, getter, filter);
+  base::OnceClosure reply = base::DoNothing();
+  if (!callback.is_null())
+    reply = base::BindOnce(callback, success);
+  BrowserThread::PostTaskAndReply(BrowserThread::IO, FROM_HERE,
+                                  std::move(set_filter), std::move(reply));
+}
+
+void SetSimpleListenerOnIOThread(
+    const scoped_refptr<net::URLRequestContextGetter>& getter,
+    AtomNetworkDelegate::SimpleEvent type,
+    const URLPatterns& patterns,
+    const AtomNetworkDelegate::SimpleListenerOptions& options,
+    const AtomNetworkDelegate::SimpleListener& listener,
+    const AtomNetworkDelegate::BatchListener& batch_listener) {
+  auto delegate = GetNetworkDelegate(getter);
+  if (!batch_listener.is_null())
+    delegate->SetBatchListenerInIO(type, patterns, options, batch_listener);
+  else
+    delegate->SetSimpleListenerInIO(type, patterns, options, listener);
+}
+
+using StatsCallback = base::Callback<void(const base::DictionaryValue&)>;
+
+std::unique_ptr<base::DictionaryValue> GetStatsOnIOThread(
+    const scoped_refptr<net::URLRequestContextGetter>& getter) {
+  return GetNetworkDelegate(getter)->stats()->GetValue();
+}
+
+void ResetStatsOnIOThread(
+    const scoped_refptr<net::URLRequestContextGetter>& getter) {
+  GetNetworkDelegate(getter)->stats()->Reset();
+}
+
+void RunStatsCallback(const StatsCallback& callback,
+                      std::unique_ptr<base::DictionaryValue> stats) {
+  callback.Run(*stats);
+}
+
+}  // namespace
+
 WebRequest::WebRequest(v8::Isolate* isolate,
                        Profile* profile)
     : profile_(profile) {
@@ -150,8 +263,49 @@ void WebRequest::Fetch(mate::Arguments* args) {
 
 template<AtomNetworkDelegate::SimpleEvent type>
 void WebRequest::SetSimpleListener(mate::Arguments* args) {
-  SetListener<AtomNetworkDelegate::SimpleListener>(
-      &AtomNetworkDelegate::SetSimpleListenerInIO, type, args);
+  // { urls, fields, batchInterval, batchSize }.
+  URLPatterns patterns;
+  AtomNetworkDelegate::SimpleListenerOptions options;
+  bool batch = false;
+  mate::Dictionary dict;
+  if (args->GetNext(&dict)) {
+    dict.Get("urls", &patterns);
+    dict.Get("fields", &options.fields);
+    int batch_interval;
+    if (dict.Get("batchInterval", &batch_interval) && batch_interval >= 0) {
+      options.batch_interval =
+          base::TimeDelta::FromMilliseconds(batch_interval);
+      batch = true;
+    }
+    int batch_size;
+    if (dict.Get("batchSize", &batch_size) && batch_size > 0) {
+      options.batch_size = batch_size;
+      batch = true;
+    }
+  }
+
+  // Function or null.
+  v8::Local<v8::Value> value;
+  if (!args->GetNext(&value) || !(value->IsFunction() || value->IsNull())) {
+    args->ThrowError("Must pass null or a Function");
+    return;
+  }
+
+  // Batched events are passed to the listener as an array.
+  AtomNetworkDelegate::SimpleListener listener;
+  AtomNetworkDelegate::BatchListener batch_listener;
+  if (value->IsFunction()) {
+    if (batch)
+      mate::ConvertFromV8(isolate(), value, &batch_listener);
+    else
+      mate::ConvertFromV8(isolate(), value, &listener);
+  }
+
+  BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
+      base::Bind(&SetSimpleListenerOnIOThread,
+                 scoped_refptr<net::URLRequestContextGetter>(
+                     profile_->GetRequestContext()),
+                 type, patterns, options, listener, batch_listener));
 }
 
 template<AtomNetworkDelegate::ResponseEvent type>
@@ -195,6 +349,73 @@ void WebRequest::SetListener(Method method, Event type, mate::Arguments* args) {
           method, type, patterns, listener));
 }
 
+void WebRequest::SetRequestFilter(mate::Arguments* args) {
+  // Filter list, serialized filter or null.
+  std::string rules;
+  bool serialized = false;
+  v8::Local<v8::Value> value;
+  if (!args->GetNext(&value)) {
+    args->ThrowError("Must pass a String, a Buffer or null");
+    return;
+  }
+  if (node::Buffer::HasInstance(value)) {
+    rules.assign(node::Buffer::Data(value), node::Buffer::Length(value));
+    serialized = true;
+  } else if (!value->IsNull() && !mate::ConvertFromV8(isolate(), value,
+                                                      &rules)) {
+    args->ThrowError("Must pass a String, a Buffer or null");
+    return;
+  }
+
+  RequestFilterCallback callback;
+  args->GetNext(&callback);
+
+  scoped_refptr<net::URLRequestContextGetter> getter(
+      profile_->GetRequestContext());
+  bool clear = value->IsNull();
+  base::PostTaskAndReplyWithResult(
+      GetFilterTaskRunner(), FROM_HERE,
+      base::Bind(&CreateRequestFilter, rules, serialized, clear),
+      base::Bind(&OnRequestFilterCreated, getter, clear, callback));
+}
+
+void WebRequest::SerializeRequestFilter(mate::Arguments* args) {
+  std::string rules;
+  SerializeRequestFilterCallback callback;
+  if (!args->GetNext(&rules) || !args->GetNext(&callback)) {
+    args->ThrowError("Must pass a String and a Function");
+    return;
+  }
+
+  base::PostTaskAndReplyWithResult(
+      GetFilterTaskRunner(), FROM_HERE,
+      base::Bind(&SerializeRules, rules), callback);
+}
+
+base::SequencedTaskRunner* WebRequest::GetFilterTaskRunner() {
+  if (!filter_task_runner_)
+    filter_task_runner_ = base::CreateSequencedTaskRunnerWithTraits(
+        {base::TaskPriority::USER_VISIBLE});
+  return filter_task_runner_.get();
+}
+
+void WebRequest::GetStats(const StatsCallback& callback) {
+  base::PostTaskAndReplyWithResult(
+      BrowserThread::GetTaskRunnerForThread(BrowserThread::IO).get(),
+      FROM_HERE,
+      base::Bind(&GetStatsOnIOThread,
+                 scoped_refptr<net::URLRequestContextGetter>(
+                     profile_->GetRequestContext())),
+      base::Bind(&RunStatsCallback, callback));
+}
+
+void WebRequest::ResetStats() {
+  BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
+      base::Bind(&ResetStatsOnIOThread,
+                 scoped_refptr<net::URLRequestContextGetter>(
+                     profile_->GetRequestContext())));
+}
+
 void WebRequest::HandleBehaviorChanged() {
 #if BUILDFLAG(ENABLE_EXTENSIONS)
   extension_web_request_api_helpers::ClearCacheOnNavigation();
@@ -241,6 +462,14 @@ void WebRequest::BuildPrototype(v8::Isolate* isolate,
                     AtomNetworkDelegate::kOnErrorOccurred>)
       .SetMethod("handleBehaviorChanged",
                  &WebRequest::HandleBehaviorChanged)
+      .SetMethod("setRequestFilter",
+                 &WebRequest::SetRequestFilter)
+      .SetMethod("serializeRequestFilter",
+                 &WebRequest::SerializeRequestFilter)
+      .SetMethod("getStats",
+                 &WebRequest::GetStats)
+      .SetMethod("resetStats",
+                 &WebRequest::ResetStats)
       .SetMethod("fetch",
                  &WebRequest::Fetch);
 }
@@ -13,12 +13,17 @@
 #include "atom/browser/api/trackable_object.h"
 #include "atom/browser/net/atom_network_delegate.h"
 #include "atom/common/native_mate_converters/value_converter.h"
+#include "base/memory/ref_counted.h"
 #include "base/strings/string_util.h"
 #include "native_mate/arguments.h"
 #include "native_mate/handle.h"
 #include "net/url_request/url_fetcher.h"
 #include "net/url_request/url_fetcher_delegate.h"
 
+namespace base {
+class SequencedTaskRunner;
+}
+
 namespace content {
 class BrowserContext;
 }
@@ -51,6 +56,11 @@ class WebRequest : public mate::TrackableObject<WebRequest>,
       const mate::Dictionary&,
       v8::Local<v8::String>)> FetchCallback;
   void HandleBehaviorChanged();
+  void SetRequestFilter(mate::Arguments* args);
+  void SerializeRequestFilter(mate::Arguments* args);
+  void GetStats(
+      const base::Callback<void(const base::DictionaryValue&)>& callback);
+  void ResetStats();
   void Fetch(mate::Arguments* args);
   void OnURLFetchComplete(const net::URLFetcher* source) override;
 
@@ -68,9 +78,14 @@ class WebRequest : public mate::TrackableObject<WebRequest>,
   void SetListener(Method method, Event type, mate::Arguments* args);
 
  private:
+  base::SequencedTaskRunner* GetFilterTaskRunner();
+
   Profile* profile_;
   std::map<const net::URLFetcher*, FetchCallback> fetchers_;
 
+  // Parses the request filters in the order they are set.
+  scoped_refptr<base::SequencedTaskRunner> filter_task_runner_;
+
   DISALLOW_COPY_AND_ASSIGN(WebRequest);
 };
 
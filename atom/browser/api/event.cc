@@ -4,8 +4,12 @@
 
 #include "atom/browser/api/event.h"
 
+#include <vector>
+
 #include "atom/common/api/api_messages.h"
 #include "atom/common/native_mate_converters/string16_converter.h"
+#include "atom/common/v8_serialization.h"
+#include "base/strings/utf_string_conversions.h"
 #include "content/public/browser/render_frame_host.h"
 #include "content/public/browser/web_contents.h"
 #include "native_mate/object_template_builder.h"
@@ -48,11 +52,42 @@ void Event::PreventDefault(v8::Isolate* isolate) {
                            v8::True(isolate));
 }
 
-bool Event::SendReply(const base::string16& json) {
+bool Event::SendReply(v8::Isolate* isolate, v8::Local<v8::Value> value) {
   if (message_ == nullptr || sender_ == nullptr)
     return false;
 
-  AtomViewHostMsg_Message_Sync::WriteReplyParams(message_, json);
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  if (message_->type() == AtomViewHostMsg_Message_Serialized_Sync::ID) {
+    std::vector<uint8_t> data;
+    bool serialized;
+    {
+      v8::TryCatch try_catch(isolate);
+      serialized = atom::SerializeV8Value(context, value, &data);
+      if (!serialized) {
+        // keep what JSON would have kept, e.g. drop the functions
+        v8::Local<v8::String> json;
+        v8::Local<v8::Value> copy;
+        if (v8::JSON::Stringify(context, value).ToLocal(&json) &&
+            json->IsString() &&
+            v8::JSON::Parse(context, json).ToLocal(&copy))
+          serialized = atom::SerializeV8Value(context, copy, &data);
+      }
+    }
+    if (!serialized)
+      atom::SerializeV8Value(context, v8::Null(isolate), &data);
+    AtomViewHostMsg_Message_Serialized_Sync::WriteReplyParams(message_, data);
+  } else {
+    // JSON.stringify() returns undefined for undefined and functions
+    base::string16 json;
+    v8::Local<v8::String> string;
+    if (v8::JSON::Stringify(context, value).ToLocal(&string) &&
+        string->IsString())
+      mate::ConvertFromV8(isolate, string, &json);
+    if (json.empty())
+      json = base::ASCIIToUTF16("null");
+    AtomViewHostMsg_Message_Sync::WriteReplyParams(message_, json);
+  }
+
   bool success = sender_->Send(message_);
   message_ = nullptr;
   sender_ = nullptr;
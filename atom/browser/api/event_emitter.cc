@@ -8,9 +8,7 @@
 #include "atom/browser/api/event.h"
 #include "atom/common/native_mate_converters/string16_converter.h"
 #include "atom/common/native_mate_converters/value_converter.h"
-#include "brave/common/extensions/shared_memory_bindings.h"
 #include "content/public/browser/render_frame_host.h"
-#include "content/public/browser/render_process_host.h"
 #include "native_mate/arguments.h"
 #include "native_mate/dictionary.h"
 #include "native_mate/object_template_builder.h"
@@ -59,30 +57,9 @@ v8::Local<v8::Object> CreateJSEvent(
     native_event->SetSenderAndMessage(render_frame_host, message);
     event = v8::Local<v8::Object>::Cast(native_event.ToV8());
   } else {
+    if (render_frame_host)
+      object = WebContents::GetIPCSender(isolate, render_frame_host);
     event = CreateEventObject(isolate);
-
-    if (render_frame_host) {
-      v8::EscapableHandleScope handle_scope(isolate);
-      auto web_contents =
-          content::WebContents::FromRenderFrameHost(render_frame_host);
-      // create a new wrapper so we can rebind send and sendShared
-      // without affecting other references
-      mate::Handle<WebContents> handle = WebContents::CreateFrom(
-          isolate, web_contents, WebContents::Type::REMOTE);
-
-      int render_process_id = render_frame_host->GetProcess()->GetID();
-      int render_frame_id = render_frame_host->GetRoutingID();
-
-      mate::Dictionary sender(isolate, handle->GetWrapper());
-      sender.SetMethod("_send",
-          base::Bind(&atom::api::WebContents::SendIPCMessage,
-              render_process_id, render_frame_id));
-      sender.SetMethod("_sendShared",
-          base::Bind(&atom::api::WebContents::SendIPCSharedMemory,
-              render_process_id, render_frame_id));
-
-      object = handle_scope.Escape(handle.ToV8());
-    }
   }
   mate::Dictionary(isolate, event).Set("sender", object);
   return event;
@@ -0,0 +1,51 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/content_settings_message_filter.h"
+
+#include "atom/browser/content_settings_publisher.h"
+#include "atom/common/api/api_messages.h"
+#include "content/public/browser/browser_thread.h"
+#include "content/public/browser/render_process_host.h"
+
+namespace atom {
+
+ContentSettingsMessageFilter::ContentSettingsMessageFilter(
+    int render_process_id)
+    : BrowserMessageFilter(ShellMsgStart),
+      render_process_id_(render_process_id) {
+}
+
+ContentSettingsMessageFilter::~ContentSettingsMessageFilter() {
+}
+
+void ContentSettingsMessageFilter::OverrideThreadForMessage(
+    const IPC::Message& message,
+    content::BrowserThread::ID* thread) {
+  if (message.type() == AtomHostMsg_ResyncContentSettings::ID)
+    *thread = content::BrowserThread::UI;
+}
+
+bool ContentSettingsMessageFilter::OnMessageReceived(
+    const IPC::Message& message) {
+  bool handled = true;
+  IPC_BEGIN_MESSAGE_MAP(ContentSettingsMessageFilter, message)
+    IPC_MESSAGE_HANDLER(AtomHostMsg_ResyncContentSettings,
+                        OnResyncContentSettings)
+    IPC_MESSAGE_UNHANDLED(handled = false)
+  IPC_END_MESSAGE_MAP()
+  return handled;
+}
+
+void ContentSettingsMessageFilter::OnResyncContentSettings() {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  auto host = content::RenderProcessHost::FromID(render_process_id_);
+  if (!host)
+    return;
+
+  ContentSettingsPublisher::FromBrowserContext(host->GetBrowserContext())
+      ->SendSnapshot(host);
+}
+
+}  // namespace atom
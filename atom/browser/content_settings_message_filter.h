@@ -0,0 +1,35 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_CONTENT_SETTINGS_MESSAGE_FILTER_H_
+#define ATOM_BROWSER_CONTENT_SETTINGS_MESSAGE_FILTER_H_
+
+#include "base/macros.h"
+#include "content/public/browser/browser_message_filter.h"
+
+namespace atom {
+
+// Handles the content settings requests of a renderer process.
+class ContentSettingsMessageFilter : public content::BrowserMessageFilter {
+ public:
+  explicit ContentSettingsMessageFilter(int render_process_id);
+
+  // content::BrowserMessageFilter:
+  void OverrideThreadForMessage(const IPC::Message& message,
+                                content::BrowserThread::ID* thread) override;
+  bool OnMessageReceived(const IPC::Message& message) override;
+
+ private:
+  ~ContentSettingsMessageFilter() override;
+
+  void OnResyncContentSettings();
+
+  const int render_process_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContentSettingsMessageFilter);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_CONTENT_SETTINGS_MESSAGE_FILTER_H_
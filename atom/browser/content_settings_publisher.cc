@@ -0,0 +1,115 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/content_settings_publisher.h"
+
+#include <string.h>
+
+#include <utility>
+
+#include "atom/common/api/api_messages.h"
+#include "atom/common/content_settings_delta.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/memory/shared_memory.h"
+#include "base/pickle.h"
+#include "base/values.h"
+#include "components/prefs/pref_service.h"
+#include "components/user_prefs/user_prefs.h"
+#include "content/public/browser/browser_context.h"
+#include "content/public/browser/render_process_host.h"
+#include "ipc/ipc_message_utils.h"
+
+namespace atom {
+
+namespace {
+
+const char kContentSettingsPref[] = "content_settings";
+
+// The address is the key of the publisher in the browser context user data.
+const int kContentSettingsPublisherKey = 0;
+
+}  // namespace
+
+ContentSettingsPublisher::ContentSettingsPublisher(
+    content::BrowserContext* browser_context)
+    : browser_context_(browser_context),
+      version_(0),
+      settings_(new base::DictionaryValue),
+      snapshot_size_(0) {
+}
+
+ContentSettingsPublisher::~ContentSettingsPublisher() {
+}
+
+// static
+ContentSettingsPublisher* ContentSettingsPublisher::FromBrowserContext(
+    content::BrowserContext* browser_context) {
+  auto publisher = static_cast<ContentSettingsPublisher*>(
+      browser_context->GetUserData(&kContentSettingsPublisherKey));
+  if (!publisher) {
+    publisher = new ContentSettingsPublisher(browser_context);
+    browser_context->SetUserData(&kContentSettingsPublisherKey,
+                                 base::WrapUnique(publisher));
+    publisher->Update();
+  }
+  return publisher;
+}
+
+bool ContentSettingsPublisher::Update() {
+  const base::DictionaryValue* content_settings =
+      user_prefs::UserPrefs::Get(browser_context_)->GetDictionary(
+          kContentSettingsPref);
+  base::DictionaryValue empty;
+  if (!content_settings)
+    content_settings = &empty;
+
+  if (version_ && settings_->Equals(content_settings))
+    return false;
+
+  delta_ = CreateContentSettingsDelta(*settings_, *content_settings);
+  settings_ = content_settings->CreateDeepCopy();
+  ++version_;
+  snapshot_.reset();
+  return true;
+}
+
+void ContentSettingsPublisher::SendSnapshot(
+    content::RenderProcessHost* host) {
+  if (!snapshot_ && !CreateSnapshot())
+    return;
+
+  base::SharedMemoryHandle handle = snapshot_->GetReadOnlyHandle();
+  if (!handle.IsValid())
+    return;
+
+  host->Send(new AtomMsg_SetContentSettings(handle, snapshot_size_, version_));
+}
+
+void ContentSettingsPublisher::SendDelta(content::RenderProcessHost* host) {
+  host->Send(new AtomMsg_UpdateContentSettings(version_ - 1,
+                                               version_,
+                                               *delta_));
+}
+
+bool ContentSettingsPublisher::CreateSnapshot() {
+  base::Pickle pickle;
+  IPC::WriteParam(&pickle, *settings_);
+
+  base::SharedMemoryCreateOptions options;
+  options.size = pickle.size();
+  options.share_read_only = true;
+  std::unique_ptr<base::SharedMemory> snapshot(new base::SharedMemory);
+  if (!snapshot->Create(options) || !snapshot->Map(pickle.size())) {
+    LOG(ERROR) << "Could not create the content settings snapshot";
+    return false;
+  }
+  memcpy(snapshot->memory(), pickle.data(), pickle.size());
+
+  snapshot_ = std::move(snapshot);
+  snapshot_size_ = pickle.size();
+  return true;
+}
+
+}  // namespace atom
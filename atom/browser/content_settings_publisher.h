@@ -0,0 +1,70 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_CONTENT_SETTINGS_PUBLISHER_H_
+#define ATOM_BROWSER_CONTENT_SETTINGS_PUBLISHER_H_
+
+#include <memory>
+
+#include "base/macros.h"
+#include "base/supports_user_data.h"
+
+namespace base {
+class DictionaryValue;
+class ListValue;
+class SharedMemory;
+}
+
+namespace content {
+class BrowserContext;
+class RenderProcessHost;
+}
+
+namespace atom {
+
+// Sends the "content_settings" pref of a browser context to its renderers.
+// New renderers map a read-only snapshot of the settings shared by all of
+// them, and are then only sent the changes to the rules. Each update bumps
+// the version of the settings, so a renderer which misses one can ask for a
+// new snapshot.
+class ContentSettingsPublisher : public base::SupportsUserData::Data {
+ public:
+  ~ContentSettingsPublisher() override;
+
+  static ContentSettingsPublisher* FromBrowserContext(
+      content::BrowserContext* browser_context);
+
+  // Reads the pref again, returns true if the settings changed. Only called
+  // by the pref observer, which must then send the delta to every renderer
+  // of the browser context.
+  bool Update();
+
+  // Sends the current settings to |host|.
+  void SendSnapshot(content::RenderProcessHost* host);
+
+  // Sends the changes made by the last Update() to |host|.
+  void SendDelta(content::RenderProcessHost* host);
+
+ private:
+  explicit ContentSettingsPublisher(content::BrowserContext* browser_context);
+
+  bool CreateSnapshot();
+
+  content::BrowserContext* browser_context_;  // weak, owns us
+
+  uint64_t version_;
+  std::unique_ptr<base::DictionaryValue> settings_;
+  // The changes from |version_| - 1 to |version_|.
+  std::unique_ptr<base::ListValue> delta_;
+
+  // Created when a renderer needs it, until the next update.
+  std::unique_ptr<base::SharedMemory> snapshot_;
+  uint32_t snapshot_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContentSettingsPublisher);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_CONTENT_SETTINGS_PUBLISHER_H_
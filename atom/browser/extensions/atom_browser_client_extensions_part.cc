@@ -7,6 +7,8 @@
 #include <map>
 #include <set>
 
+#include "atom/browser/content_settings_message_filter.h"
+#include "atom/browser/content_settings_publisher.h"
 #include "atom/common/api/api_messages.h"
 #include "base/command_line.h"
 #include "brave/browser/api/brave_api_extension.h"
@@ -411,6 +413,7 @@ void AtomBrowserClientExtensionsPart::RenderProcessWillLaunch(
   host->AddFilter(new ExtensionMessageFilter(id, context));
   host->AddFilter(new IOThreadExtensionMessageFilter(id, context));
   host->AddFilter(new ExtensionsGuestViewMessageFilter(id, context));
+  host->AddFilter(new atom::ContentSettingsMessageFilter(id));
   if (extensions::ExtensionsClient::Get()
           ->ExtensionAPIEnabledInExtensionServiceWorkers()) {
     host->AddFilter(new ExtensionServiceWorkerMessageFilter(
@@ -422,7 +425,7 @@ void AtomBrowserClientExtensionsPart::RenderProcessWillLaunch(
     user_prefs_registrar->Add(
         "content_settings",
         base::Bind(&AtomBrowserClientExtensionsPart::UpdateContentSettings,
-                   base::Unretained(this)));
+                   base::Unretained(this), base::Unretained(context)));
   }
   UpdateContentSettingsForHost(host->GetID());
 }
@@ -485,20 +488,27 @@ void AtomBrowserClientExtensionsPart::UpdateContentSettingsForHost(
   if (!host)
     return;
 
-  auto context =
-      static_cast<atom::AtomBrowserContext*>(host->GetBrowserContext());
-  auto user_prefs = user_prefs::UserPrefs::Get(context);
-  const base::DictionaryValue* content_settings =
-    user_prefs->GetDictionary("content_settings");
-  host->Send(new AtomMsg_UpdateContentSettings(*content_settings));
+  // the pref observer keeps the publisher up to date, so a new renderer
+  // only needs the current snapshot
+  atom::ContentSettingsPublisher::FromBrowserContext(
+      host->GetBrowserContext())->SendSnapshot(host);
 }
 
-void AtomBrowserClientExtensionsPart::UpdateContentSettings() {
-  for (std::map<int, void*>::iterator
-      it = render_process_hosts_.begin();
-      it != render_process_hosts_.end();
-      ++it) {
-    UpdateContentSettingsForHost(it->first);
+void AtomBrowserClientExtensionsPart::UpdateContentSettings(
+    content::BrowserContext* browser_context) {
+  auto publisher =
+      atom::ContentSettingsPublisher::FromBrowserContext(browser_context);
+  if (!publisher->Update())
+    return;
+
+  // every renderer of the context gets each delta, or it would have to
+  // resync
+  for (content::RenderProcessHost::iterator it =
+           content::RenderProcessHost::AllHostsIterator();
+       !it.IsAtEnd(); it.Advance()) {
+    content::RenderProcessHost* host = it.GetCurrentValue();
+    if (host->GetBrowserContext() == browser_context)
+      publisher->SendDelta(host);
   }
 }
 
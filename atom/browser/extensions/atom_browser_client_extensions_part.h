@@ -94,7 +94,7 @@ class AtomBrowserClientExtensionsPart {
   std::string GetApplicationLocale();
 
  private:
-  void UpdateContentSettings();
+  void UpdateContentSettings(content::BrowserContext* browser_context);
   void UpdateContentSettingsForHost(int render_process_id);
 
 
@@ -38,8 +38,13 @@ void AtomExtensionsNetworkDelegate::SetAcceptAllCookies(bool accept) {
 
 void AtomExtensionsNetworkDelegate::RunCallback(
                                   base::Callback<int(void)> internal_callback,
+                                  const char* event,
+                                  base::TimeTicks started,
                                   const uint64_t request_id,
                                   int previous_result) {
+  stats()->Record(event, atom::WebRequestStats::STAGE_EXTENSIONS,
+                  base::TimeTicks::Now() - started);
+
   if (!ContainsKey(callbacks_, request_id))
     return;
 
@@ -59,10 +64,21 @@ void AtomExtensionsNetworkDelegate::RunCallback(
   callbacks_.erase(request_id);
 }
 
+void AtomExtensionsNetworkDelegate::RecordExtensionsStage(
+    const char* event,
+    base::TimeTicks started,
+    int result) {
+  // the handlers which finish later are recorded by RunCallback
+  if (result != net::ERR_IO_PENDING) {
+    stats()->Record(event, atom::WebRequestStats::STAGE_EXTENSIONS,
+                    base::TimeTicks::Now() - started);
+  }
+}
+
 int AtomExtensionsNetworkDelegate::OnBeforeURLRequestInternal(
     net::URLRequest* request,
     GURL* new_url) {
-  return atom::AtomNetworkDelegate::OnBeforeURLRequest(
+  return HandleBeforeURLRequest(
       request, callbacks_[request->identifier()], new_url);
 }
 
@@ -72,6 +88,10 @@ int AtomExtensionsNetworkDelegate::OnBeforeURLRequest(
     GURL* new_url) {
   extensions_delegate_->ForwardStartRequestStatus(request);
 
+  // Blocked requests are not seen by the extensions either.
+  if (IsBlockedByRequestFilter(request))
+    return net::ERR_BLOCKED_BY_CLIENT;
+
   callbacks_[request->identifier()] = callback;
 
   base::Callback<int(void)> internal_callback = base::Bind(
@@ -80,13 +100,18 @@ int AtomExtensionsNetworkDelegate::OnBeforeURLRequest(
           request,
           new_url);
 
+  const char* event = GetEventName(kOnBeforeRequest);
+  base::TimeTicks started = base::TimeTicks::Now();
   auto wrapped_cb = base::Bind(&AtomExtensionsNetworkDelegate::RunCallback,
                                 base::Unretained(this),
                                 internal_callback,
+                                event,
+                                started,
                                 request->identifier());
 
   int result = extensions_delegate_->OnBeforeURLRequest(
       request, wrapped_cb, new_url);
+  RecordExtensionsStage(event, started, result);
 
   if (result == net::OK)
     return internal_callback.Run();
@@ -116,13 +141,18 @@ int AtomExtensionsNetworkDelegate::OnBeforeStartTransaction(
           request,
           headers);
 
+  const char* event = GetEventName(kOnBeforeSendHeaders);
+  base::TimeTicks started = base::TimeTicks::Now();
   auto wrapped_cb = base::Bind(&AtomExtensionsNetworkDelegate::RunCallback,
                                 base::Unretained(this),
                                 internal_callback,
+                                event,
+                                started,
                                 request->identifier());
 
   int result = extensions_delegate_->OnBeforeStartTransaction(
       request, wrapped_cb, headers);
+  RecordExtensionsStage(event, started, result);
 
   if (result == net::ERR_IO_PENDING)
     return result;
@@ -167,9 +197,13 @@ int AtomExtensionsNetworkDelegate::OnHeadersReceived(
           override_response_headers,
           allowed_unsafe_redirect_url);
 
+  const char* event = GetEventName(kOnHeadersReceived);
+  base::TimeTicks started = base::TimeTicks::Now();
   auto wrapped_cb = base::Bind(&AtomExtensionsNetworkDelegate::RunCallback,
                                 base::Unretained(this),
                                 internal_callback,
+                                event,
+                                started,
                                 request->identifier());
 
   int result = extensions_delegate_->OnHeadersReceived(
@@ -178,6 +212,7 @@ int AtomExtensionsNetworkDelegate::OnHeadersReceived(
       original_response_headers,
       override_response_headers,
       allowed_unsafe_redirect_url);
+  RecordExtensionsStage(event, started, result);
 
   if (result == net::OK)
     return internal_callback.Run();
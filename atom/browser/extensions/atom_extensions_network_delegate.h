@@ -72,9 +72,17 @@ class AtomExtensionsNetworkDelegate : public atom::AtomNetworkDelegate {
       const net::AuthChallengeInfo& auth_info,
       const AuthCallback& callback,
       net::AuthCredentials* credentials) override;
+  // Resumes the request once the extension handlers of |event| have run.
   void RunCallback(base::Callback<int(void)> internal_callback,
+                    const char* event,
+                    base::TimeTicks started,
                     const uint64_t request_id,
                     int previous_result);
+  // Records the time the extension handlers of |event| took if they
+  // returned |result| right away.
+  void RecordExtensionsStage(const char* event,
+                             base::TimeTicks started,
+                             int result);
 
   Profile* profile_;
   std::map<uint64_t, net::CompletionCallback> callbacks_;
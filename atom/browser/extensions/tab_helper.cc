@@ -4,7 +4,10 @@
 
 #include "atom/browser/extensions/tab_helper.h"
 
+#include <algorithm>
+#include <deque>
 #include <map>
+#include <set>
 #include <utility>
 #include "atom/browser/extensions/api/atom_extensions_api_client.h"
 #include "atom/browser/extensions/atom_extension_web_contents_observer.h"
@@ -12,12 +15,14 @@
 #include "atom/common/native_mate_converters/callback.h"
 #include "atom/common/native_mate_converters/gurl_converter.h"
 #include "atom/common/native_mate_converters/value_converter.h"
+#include "base/lazy_instance.h"
 #include "base/strings/utf_string_conversions.h"
 #include "brave/browser/brave_browser_context.h"
 #include "brave/browser/guest_view/tab_view/tab_view_guest.h"
 #include "brave/browser/resource_coordinator/guest_tab_manager.h"
 #include "chrome/browser/browser_process.h"
 #include "chrome/browser/chrome_notification_types.h"
+#include "chrome/browser/extensions/extension_tab_util.h"
 #include "chrome/browser/lifetime/browser_shutdown.h"
 #include "chrome/browser/resource_coordinator/tab_lifecycle_unit_external.h"
 #include "chrome/browser/sessions/session_tab_helper.h"
@@ -45,6 +50,7 @@
 #include "native_mate/dictionary.h"
 #include "net/base/filename_util.h"
 #include "ui/base/resource/resource_bundle.h"
+#include "ui/gfx/geometry/rect.h"
 
 using brave::BraveBrowserContext;
 using guest_view::GuestViewManager;
@@ -79,6 +85,39 @@ TabManager* GetTabManager() {
   return g_browser_process->GetTabManager();
 }
 
+// The removals remembered for GetAllTabValues.
+const size_t kMaxRemovedTabs = 1000;
+
+struct RemovedTab {
+  uint64_t version;
+  int32_t window_id;
+  int32_t tab_id;
+};
+
+struct TabValueChanges {
+  TabValueChanges() : version(0), forgotten_version(0) {}
+
+  // Shared by the tab values and the removals, so that a single number tells
+  // a caller of GetAllTabValues what it has already seen.
+  uint64_t version;
+  // The removals up to this version were dropped from |removed_tabs|.
+  uint64_t forgotten_version;
+  std::deque<RemovedTab> removed_tabs;
+};
+
+base::LazyInstance<TabValueChanges>::Leaky g_tab_value_changes =
+    LAZY_INSTANCE_INITIALIZER;
+
+void RecordRemovedTab(int32_t window_id, int32_t tab_id) {
+  TabValueChanges& changes = g_tab_value_changes.Get();
+  RemovedTab removed_tab = { ++changes.version, window_id, tab_id };
+  changes.removed_tabs.push_back(removed_tab);
+  if (changes.removed_tabs.size() > kMaxRemovedTabs) {
+    changes.forgotten_version = changes.removed_tabs.front().version;
+    changes.removed_tabs.pop_front();
+  }
+}
+
 }  // namespace
 
 TabHelper::TabHelper(content::WebContents* contents)
@@ -94,7 +133,9 @@ TabHelper::TabHelper(content::WebContents* contents)
       is_placeholder_(false),
       window_closing_(false),
       opener_tab_id_(TabStripModel::kNoTab),
-      browser_(nullptr) {
+      browser_(nullptr),
+      tab_value_dirty_(true),
+      tab_value_version_(0) {
   SessionTabHelper::CreateForWebContents(contents);
   SetWindowId(-1);
 
@@ -265,6 +306,9 @@ void TabHelper::OnBrowserRemoved(Browser* browser) {
   MaybeRequestWindowClose();
 
   if (browser_ != nullptr && browser_ == browser) {
+    RecordRemovedTab(browser_->session_id().id(), session_id());
+    InvalidateTabValue();
+
     auto window = static_cast<atom::NativeWindow*>(browser_->window());
     window->RemoveObserver(this);
 
@@ -344,6 +388,8 @@ void TabHelper::TabReplacedAt(TabStripModel* tab_strip_model,
 void TabHelper::TabDetachedAt(content::WebContents* contents,
                               int index,
                               bool was_active) {
+  // the indices of the following tabs change too
+  InvalidateTabValue();
   if (contents != web_contents())
     return;
 
@@ -356,6 +402,7 @@ void TabHelper::TabPinnedStateChanged(TabStripModel* tab_strip_model,
   if (contents != web_contents())
     return;
 
+  InvalidateTabValue();
   MaybeAttachOrCreatePinnedTab();
 }
 
@@ -370,6 +417,22 @@ void TabHelper::ActiveTabChanged(content::WebContents* old_contents,
   if (new_contents == web_contents()) {
     active_ = true;
   }
+
+  if (old_contents == web_contents() || new_contents == web_contents())
+    InvalidateTabValue();
+}
+
+void TabHelper::TabMoved(content::WebContents* contents,
+                         int from_index,
+                         int to_index) {
+  if (get_index() >= std::min(from_index, to_index) &&
+      get_index() <= std::max(from_index, to_index))
+    InvalidateTabValue();
+}
+
+void TabHelper::TabSelectionChanged(TabStripModel* tab_strip_model,
+                                    const ui::ListSelectionModel& old_model) {
+  InvalidateTabValue();
 }
 
 void TabHelper::SetActive(bool active) {
@@ -388,6 +451,7 @@ void TabHelper::SetActive(bool active) {
     active_ = false;
     web_contents()->WasHidden();
   }
+  InvalidateTabValue();
 }
 
 void TabHelper::OnVisibilityChanged(content::Visibility visibility) {
@@ -400,13 +464,48 @@ void TabHelper::OnVisibilityChanged(content::Visibility visibility) {
     }
 
     web_contents()->GetController().Reload(content::ReloadType::NORMAL, true);
+    InvalidateTabValue();
   }
 }
 
+void TabHelper::TitleWasSet(content::NavigationEntry* entry) {
+  InvalidateTabValue();
+}
+
+void TabHelper::DidStartNavigation(
+    content::NavigationHandle* navigation_handle) {
+  InvalidateTabValue();
+}
+
+void TabHelper::DidFinishNavigation(
+    content::NavigationHandle* navigation_handle) {
+  InvalidateTabValue();
+}
+
+void TabHelper::DidStartLoading() {
+  InvalidateTabValue();
+}
+
+void TabHelper::DidStopLoading() {
+  InvalidateTabValue();
+}
+
+void TabHelper::OnAudioStateChanged(bool audible) {
+  InvalidateTabValue();
+}
+
+void TabHelper::DidUpdateAudioMutingState(bool muted) {
+  InvalidateTabValue();
+}
+
 void TabHelper::UpdateBrowser(Browser* browser) {
   browser_ = browser;
   browser_->tab_strip_model()->AddObserver(this);
   SetWindowId(browser_->session_id().id());
+  // the tab may have been listed as removed from this window before, so it
+  // has to get a new version even if its value is the same
+  tab_value_.reset();
+  InvalidateTabValue();
   static_cast<atom::NativeWindow*>(browser_->window())->AddObserver(this);
 
   content::NotificationService::current()->Notify(
@@ -460,6 +559,8 @@ void TabHelper::TabInsertedAt(TabStripModel* tab_strip_model,
                      content::WebContents* contents,
                      int index,
                      bool active) {
+  // the indices of the following tabs change too
+  InvalidateTabValue();
   if (contents != web_contents())
     return;
 
@@ -478,6 +579,7 @@ void TabHelper::SetWindowId(const int32_t& id) {
 
   SessionID session = SessionID::FromSerializedValue(id);
   SessionTabHelper::FromWebContents(web_contents())->SetWindowID(session);
+  InvalidateTabValue();
 }
 
 int32_t TabHelper::window_id() const {
@@ -486,6 +588,7 @@ int32_t TabHelper::window_id() const {
 
 void TabHelper::SetAutoDiscardable(bool auto_discardable) {
   auto_discardable_ = auto_discardable;
+  InvalidateTabValue();
   auto* tab_lifecycle_unit_external =
       resource_coordinator::TabLifecycleUnitExternal::FromWebContents(
           web_contents());
@@ -498,6 +601,8 @@ bool TabHelper::Discard() {
   if (IsDiscarded())
     return false;
 
+  InvalidateTabValue();
+
   if (!resource_coordinator::TabLifecycleUnitExternal::FromWebContents(
       web_contents())) {
     discarded_ = true;
@@ -527,6 +632,7 @@ void TabHelper::SetPinned(bool pinned) {
     return;
 
   pinned_ = pinned;
+  InvalidateTabValue();
   if (browser()) {
     browser()->tab_strip_model()->SetTabPinned(get_index(), pinned);
   }
@@ -567,6 +673,7 @@ bool TabHelper::MoveTo(int index, int window_id, bool foreground) {
 
 void TabHelper::SetTabIndex(int index) {
   index_ = index;
+  InvalidateTabValue();
   if (browser()) {
     browser()->tab_strip_model()->MoveWebContentsAt(
         get_index(), index, false);
@@ -594,6 +701,124 @@ void TabHelper::SetTabValues(const base::DictionaryValue& values) {
 
 void TabHelper::SetOpener(int opener_tab_id) {
   opener_tab_id_ = opener_tab_id;
+  InvalidateTabValue();
+}
+
+const base::DictionaryValue& TabHelper::GetTabValue() {
+  if (!tab_value_dirty_ && tab_value_ && !IsTabValueStale())
+    return *tab_value_;
+
+  std::unique_ptr<base::DictionaryValue> value =
+      ExtensionTabUtil::CreateTabObject(
+          web_contents(), ExtensionTabUtil::kDontScrubTab, nullptr)
+          ->ToValue();
+  // invalidation is coarse, so only real changes get a new version
+  if (!tab_value_ || !tab_value_->Equals(value.get())) {
+    tab_value_ = std::move(value);
+    tab_value_version_ = ++g_tab_value_changes.Get().version;
+  }
+  tab_value_dirty_ = false;
+  return *tab_value_;
+}
+
+void TabHelper::InvalidateTabValue() {
+  tab_value_dirty_ = true;
+}
+
+bool TabHelper::IsTabValueStale() {
+  // api::WebContents observes the web contents before this helper, so the
+  // fields it emits events for are compared, as is the favicon, which is
+  // only announced to the delegate once downloaded
+  content::WebContents* contents = web_contents();
+  std::string url;
+  std::string title;
+  std::string status;
+  tab_value_->GetString("url", &url);
+  tab_value_->GetString("title", &title);
+  tab_value_->GetString("status", &status);
+  if (url != contents->GetURL().spec() ||
+      title != base::UTF16ToUTF8(contents->GetTitle()) ||
+      status != ExtensionTabUtil::GetTabStatusText(contents->IsLoading()))
+    return true;
+
+  std::string fav_icon_url;
+  tab_value_->GetString("favIconUrl", &fav_icon_url);
+  content::NavigationEntry* entry =
+      contents->GetController().GetVisibleEntry();
+  std::string current_fav_icon_url;
+  if (entry && entry->GetFavicon().valid)
+    current_fav_icon_url = entry->GetFavicon().url.spec();
+  if (fav_icon_url != current_fav_icon_url)
+    return true;
+
+  bool audible = false;
+  bool muted = false;
+  tab_value_->GetBoolean("audible", &audible);
+  tab_value_->GetBoolean("mutedInfo.muted", &muted);
+  if (audible != contents->WasRecentlyAudible() ||
+      muted != contents->IsAudioMuted())
+    return true;
+
+  // the lifecycle unit and the size of the view don't notify the helper
+  bool discarded = false;
+  tab_value_->GetBoolean(keys::kDiscardedKey, &discarded);
+  if (discarded != IsDiscarded())
+    return true;
+
+  int width = 0;
+  int height = 0;
+  tab_value_->GetInteger("width", &width);
+  tab_value_->GetInteger("height", &height);
+  gfx::Size size = web_contents()->GetContainerBounds().size();
+  return width != size.width() || height != size.height();
+}
+
+// static
+std::unique_ptr<base::DictionaryValue> TabHelper::GetAllTabValues(
+    int32_t window_id, uint64_t since_version) {
+  TabValueChanges& changes = g_tab_value_changes.Get();
+  bool full = since_version < changes.forgotten_version;
+
+  std::unique_ptr<base::ListValue> tabs(new base::ListValue);
+  std::set<int32_t> tab_ids;
+  for (auto* browser : *BrowserList::GetInstance()) {
+    if (browser->session_id().id() != window_id)
+      continue;
+
+    TabStripModel* tab_strip = browser->tab_strip_model();
+    for (int i = 0; i < tab_strip->count(); ++i) {
+      auto tab_helper = FromWebContents(tab_strip->GetWebContentsAt(i));
+      if (!tab_helper)
+        continue;
+
+      tab_ids.insert(tab_helper->session_id());
+      const base::DictionaryValue& value = tab_helper->GetTabValue();
+      if (full || tab_helper->tab_value_version() > since_version)
+        tabs->Append(value.CreateDeepCopy());
+    }
+    break;
+  }
+
+  std::unique_ptr<base::ListValue> removed(new base::ListValue);
+  if (!full) {
+    std::set<int32_t> removed_ids;
+    for (const auto& removed_tab : changes.removed_tabs) {
+      // tabs which came back to the window are listed in |tabs| instead
+      if (removed_tab.version > since_version &&
+          removed_tab.window_id == window_id &&
+          !tab_ids.count(removed_tab.tab_id) &&
+          removed_ids.insert(removed_tab.tab_id).second)
+        removed->AppendInteger(removed_tab.tab_id);
+    }
+  }
+
+  std::unique_ptr<base::DictionaryValue> result(new base::DictionaryValue);
+  // read after the values are rebuilt, which increments it
+  result->SetDouble("version", changes.version);
+  result->SetBoolean("full", full);
+  result->Set("tabs", std::move(tabs));
+  result->Set("removed", std::move(removed));
+  return result;
 }
 
 void TabHelper::RenderViewCreated(content::RenderViewHost* render_view_host) {
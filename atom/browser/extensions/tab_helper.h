@@ -5,6 +5,8 @@
 #ifndef ATOM_BROWSER_EXTENSIONS_TAB_HELPER_H_
 #define ATOM_BROWSER_EXTENSIONS_TAB_HELPER_H_
 
+#include <stdint.h>
+
 #include <memory>
 #include <string>
 
@@ -31,6 +33,8 @@ class TabViewGuest;
 
 namespace content {
 class BrowserContext;
+class NavigationEntry;
+class NavigationHandle;
 class RenderFrameHost;
 class RenderViewHost;
 }
@@ -130,6 +134,21 @@ class TabHelper : public content::WebContentsObserver,
 
   int opener_tab_id() const { return opener_tab_id_; }
 
+  // The tabs.Tab value of the tab. It is cached and only rebuilt after one of
+  // the observed changes (title, url, loading, audible, muted, favicon,
+  // pinned, active, index, window or discarded state).
+  const base::DictionaryValue& GetTabValue();
+  // Incremented from a global counter each time the value of the tab changes.
+  uint64_t tab_value_version() const { return tab_value_version_; }
+
+  // Returns { version, full, tabs, removed } for the window |window_id|, with
+  // the values of the tabs which changed after |since_version| and the ids of
+  // the tabs removed from the window since then. |full| is true and every tab
+  // is listed if the removals since |since_version| are not all known
+  // anymore. Pass the returned version to get the next changes.
+  static std::unique_ptr<base::DictionaryValue> GetAllTabValues(
+      int32_t window_id, uint64_t since_version);
+
   // If the specified WebContents has a TabHelper (probably because it
   // was used as the contents of a tab), returns a tab id. This value is
   // immutable for a given tab. It will be unique across Chrome within the
@@ -168,7 +187,11 @@ class TabHelper : public content::WebContentsObserver,
                         content::WebContents* new_contents,
                         int index,
                         int reason) override;
-
+  void TabMoved(content::WebContents* contents,
+                int from_index,
+                int to_index) override;
+  void TabSelectionChanged(TabStripModel* tab_strip_model,
+                           const ui::ListSelectionModel& old_model) override;
 
   void OnBrowserRemoved(Browser* browser) override;
   void OnBrowserSetLastActive(Browser* browser) override;
@@ -199,6 +222,22 @@ class TabHelper : public content::WebContentsObserver,
       content::WebContents* old_web_contents,
       content::WebContents* new_web_contents) override;
   void OnVisibilityChanged(content::Visibility visibility) override;
+  void TitleWasSet(content::NavigationEntry* entry) override;
+  void DidStartNavigation(
+      content::NavigationHandle* navigation_handle) override;
+  void DidFinishNavigation(
+      content::NavigationHandle* navigation_handle) override;
+  void DidStartLoading() override;
+  void DidStopLoading() override;
+  void OnAudioStateChanged(bool audible) override;
+  void DidUpdateAudioMutingState(bool muted) override;
+
+  // Rebuild the tab value the next time it is read.
+  void InvalidateTabValue();
+  // Whether the parts of the tab value which aren't observed, or which
+  // api::WebContents announces before this helper is notified, are out of
+  // date.
+  bool IsTabValueStale();
 
   // Our content script observers. Declare at top so that it will outlive all
   // other members, since they might add themselves as observers.
@@ -219,6 +258,10 @@ class TabHelper : public content::WebContentsObserver,
 
   Browser* browser_;
 
+  std::unique_ptr<base::DictionaryValue> tab_value_;
+  bool tab_value_dirty_;
+  uint64_t tab_value_version_;
+
   DISALLOW_COPY_AND_ASSIGN(TabHelper);
 };
 
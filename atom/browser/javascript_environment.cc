@@ -23,6 +23,7 @@
 #include "brave/common/extensions/path_bindings.h"
 #include "brave/common/extensions/shared_memory_bindings.h"
 #include "brave/common/extensions/url_bindings.h"
+#include "brave/common/workers/worker_message.h"
 #include "content/public/common/content_switches.h"
 #include "extensions/common/features/feature.h"
 #include "extensions/renderer/logging_native_handler.h"
@@ -183,6 +184,8 @@ JavascriptEnvironment::~JavascriptEnvironment() {
   if (script_context_.get() && script_context_->is_valid()) {
     script_context_->Invalidate();
   }
+  // the weak callbacks of the shared buffers don't run on dispose
+  brave::WorkerMessage::ReleaseIsolate(isolate_);
 }
 
 void JavascriptEnvironment::OnMessageLoopCreated() {
@@ -4,6 +4,8 @@
 
 #include "atom/browser/net/asar/url_request_asar_job.h"
 
+#include <string.h>
+
 #include <string>
 #include <utility>
 #include <vector>
@@ -13,15 +15,18 @@
 #include "atom/common/atom_constants.h"
 #include "base/bind.h"
 #include "base/files/file_util.h"
+#include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
 #include "base/synchronization/lock.h"
 #include "base/task_runner.h"
+#include "base/task_runner_util.h"
 #include "net/base/file_stream.h"
 #include "net/base/filename_util.h"
 #include "net/base/io_buffer.h"
 #include "net/base/load_flags.h"
 #include "net/base/mime_util.h"
 #include "net/base/net_errors.h"
+#include "net/filter/brotli_source_stream.h"
 #include "net/filter/gzip_source_stream.h"
 #include "net/filter/source_stream.h"
 #include "net/http/http_util.h"
@@ -35,11 +40,17 @@ namespace asar {
 
 namespace {
 
+// Files up to this size are read in full while the job is initialized and
+// then served from memory, larger files are read on demand.
+const uint32_t kMaxPreloadSize = 64 * 1024;
+
 void Initialize(
     const base::FilePath& full_path,
     std::shared_ptr<Archive>& archive,  // NOLINT
     base::FilePath* file_path,
     Archive::FileInfo* file_info,
+    std::string* contents,
+    base::StringPiece* data,
     URLRequestAsarJob::JobType* type) {
   // Determine whether it is an asar file.
   base::FilePath asar_path, relative_path;
@@ -62,10 +73,37 @@ void Initialize(
     return;
   }
 
+  // Small files of a mapped archive are served straight from the mapping,
+  // the others are copied out of the archive once.
+  if (file_info->stored_size() <= kMaxPreloadSize &&
+      !archive->GetMappedData(file_info->offset, file_info->stored_size(),
+                              data)) {
+    contents->resize(file_info->stored_size());
+    if (archive->Read(file_info->offset, &(*contents)[0], contents->size()) !=
+        static_cast<int>(contents->size())) {
+      *type = URLRequestAsarJob::TYPE_ERROR;
+      return;
+    }
+    *data = *contents;
+  }
+
   *file_path = relative_path;
   *type = URLRequestAsarJob::TYPE_ASAR;
 }
 
+// Reads from the archive's own descriptor at an absolute offset, so requests
+// never open the archive again and can read from it concurrently.
+int ReadFromArchive(std::shared_ptr<Archive> archive,
+                    uint64_t offset,
+                    scoped_refptr<net::IOBuffer> buf,
+                    int size) {
+  // |size| is never 0, so reading nothing means that the archive is shorter
+  // than its header says, which must not end the response as if it were
+  // complete.
+  int rv = archive->Read(offset, buf->data(), size);
+  return rv <= 0 ? net::ERR_FAILED : rv;
+}
+
 }  // namespace
 
 URLRequestAsarJob::FileMetaInfo::FileMetaInfo()
@@ -91,10 +129,6 @@ URLRequestAsarJob::URLRequestAsarJob(
 
 URLRequestAsarJob::~URLRequestAsarJob() {}
 
-void URLRequestAsarJob::InitializeAsarJob() {
-  stream_.reset(new net::FileStream(file_task_runner_));
-}
-
 void URLRequestAsarJob::InitializeFileJob() {
   stream_.reset(new net::FileStream(file_task_runner_));
 }
@@ -103,22 +137,16 @@ void URLRequestAsarJob::Start() {
   file_task_runner_->PostTaskAndReply(
       FROM_HERE,
       base::Bind(&Initialize,
-          full_path_, std::ref(archive_), &file_path_, &file_info_, &type_),
+          full_path_, std::ref(archive_), &file_path_, &file_info_,
+          &contents_, &data_, &type_),
       base::Bind(&URLRequestAsarJob::DidInitialize,
           weak_ptr_factory_.GetWeakPtr()));
 }
 
 void URLRequestAsarJob::DidInitialize() {
   if (type_ == TYPE_ASAR) {
-    InitializeAsarJob();
-    int flags = base::File::FLAG_OPEN |
-                base::File::FLAG_READ |
-                base::File::FLAG_ASYNC;
-    int rv = stream_->Open(archive_->path(), flags,
-                           base::Bind(&URLRequestAsarJob::DidOpen,
-                                      weak_ptr_factory_.GetWeakPtr()));
-    if (rv != net::ERR_IO_PENDING)
-      DidOpen(rv);
+    // Reads go through the archive's descriptor, there is nothing to open.
+    DidOpen(net::OK);
   } else if (type_ == TYPE_FILE) {
     InitializeFileJob();
     auto* meta_info = new FileMetaInfo();
@@ -151,6 +179,9 @@ int URLRequestAsarJob::ReadRawData(net::IOBuffer* dest, int dest_size) {
   if (!dest_size)
     return 0;
 
+  if (type_ == TYPE_ASAR)
+    return ReadAsarData(dest, dest_size);
+
   int rv = stream_->Read(dest,
                          dest_size,
                          base::Bind(&URLRequestAsarJob::DidRead,
@@ -164,6 +195,25 @@ int URLRequestAsarJob::ReadRawData(net::IOBuffer* dest, int dest_size) {
   return rv;
 }
 
+int URLRequestAsarJob::ReadAsarData(net::IOBuffer* dest, int dest_size) {
+  if (data_.size() == file_info_.stored_size()) {
+    memcpy(dest->data(), data_.data() + seek_offset_ - file_info_.offset,
+           dest_size);
+    seek_offset_ += dest_size;
+    remaining_bytes_ -= dest_size;
+    return dest_size;
+  }
+
+  base::PostTaskAndReplyWithResult(
+      file_task_runner_.get(), FROM_HERE,
+      base::Bind(&ReadFromArchive, archive_, seek_offset_,
+                 base::WrapRefCounted(dest), dest_size),
+      base::Bind(&URLRequestAsarJob::DidRead,
+                 weak_ptr_factory_.GetWeakPtr(),
+                 base::WrapRefCounted(dest)));
+  return net::ERR_IO_PENDING;
+}
+
 bool URLRequestAsarJob::IsRedirectResponse(GURL* location,
                                            int* http_status_code) {
   if (type_ != TYPE_FILE)
@@ -193,7 +243,22 @@ bool URLRequestAsarJob::IsRedirectResponse(GURL* location,
 std::unique_ptr<net::SourceStream> URLRequestAsarJob::SetUpSourceStream() {
   std::unique_ptr<net::SourceStream> source =
     URLRequestJob::SetUpSourceStream();
-  if (!base::LowerCaseEqualsASCII(file_path_.Extension(), ".svgz"))
+  // Compressed asar files are inflated as they are read from the archive.
+  if (type_ == TYPE_ASAR) {
+    switch (file_info_.compression) {
+      case Archive::COMPRESSION_DEFLATE:
+        source = net::GzipSourceStream::Create(std::move(source),
+                                               net::SourceStream::TYPE_DEFLATE);
+        break;
+      case Archive::COMPRESSION_BROTLI:
+        source = net::CreateBrotliSourceStream(std::move(source));
+        break;
+      case Archive::COMPRESSION_NONE:
+        break;
+    }
+  }
+
+  if (!source || !base::LowerCaseEqualsASCII(file_path_.Extension(), ".svgz"))
     return source;
 
   return net::GzipSourceStream::Create(std::move(source),
@@ -289,8 +354,16 @@ void URLRequestAsarJob::DidOpen(int result) {
 
   int64_t file_size, read_offset;
   if (type_ == TYPE_ASAR) {
-    file_size = file_info_.size;
+    file_size = file_info_.stored_size();
     read_offset = file_info_.offset;
+    // Ranges of a compressed file can't be mapped to the stored data.
+    if (file_info_.compression != Archive::COMPRESSION_NONE &&
+        byte_range_.IsValid()) {
+      NotifyStartError(
+          net::URLRequestStatus(net::URLRequestStatus::FAILED,
+                                net::ERR_REQUEST_RANGE_NOT_SATISFIABLE));
+      return;
+    }
   } else {
     file_size = meta_info_.file_size;
     read_offset = 0;
@@ -307,6 +380,12 @@ void URLRequestAsarJob::DidOpen(int result) {
                      byte_range_.first_byte_position() + 1;
   seek_offset_ = byte_range_.first_byte_position() + read_offset;
 
+  // Archive reads are positional, so |seek_offset_| is the read position.
+  if (type_ == TYPE_ASAR) {
+    DidSeek(seek_offset_);
+    return;
+  }
+
   if (remaining_bytes_ > 0 && seek_offset_ != 0) {
     int rv = stream_->Seek(seek_offset_,
                            base::Bind(&URLRequestAsarJob::DidSeek,
@@ -339,6 +418,8 @@ void URLRequestAsarJob::DidRead(scoped_refptr<net::IOBuffer> buf, int result) {
   if (result >= 0) {
     remaining_bytes_ -= result;
     DCHECK_GE(remaining_bytes_, 0);
+    if (type_ == TYPE_ASAR)
+      seek_offset_ += result;
   }
 
   buf = nullptr;
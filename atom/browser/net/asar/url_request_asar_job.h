@@ -13,6 +13,7 @@
 #include "base/files/file_path.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
+#include "base/strings/string_piece.h"
 #include "net/http/http_byte_range.h"
 #include "net/url_request/url_request_job.h"
 
@@ -50,7 +51,6 @@ class URLRequestAsarJob : public net::URLRequestJob {
   virtual ~URLRequestAsarJob();
 
   void DidInitialize();
-  void InitializeAsarJob();
   void InitializeFileJob();
 
   // net::URLRequestJob:
@@ -100,6 +100,10 @@ class URLRequestAsarJob : public net::URLRequestJob {
   // on a background thread.
   void DidSeek(int64_t result);
 
+  // Reads the asar file at |seek_offset_|, either from the preloaded |data_|
+  // or from the archive on the file task runner.
+  int ReadAsarData(net::IOBuffer* dest, int dest_size);
+
   // Callback after data is asynchronously read from the file into |buf|.
   void DidRead(scoped_refptr<net::IOBuffer> buf, int result);
 
@@ -108,6 +112,10 @@ class URLRequestAsarJob : public net::URLRequestJob {
   std::shared_ptr<Archive> archive_;
   base::FilePath file_path_;
   Archive::FileInfo file_info_;
+  // The whole data of small asar files, a view of the archive mapping or of
+  // |contents_| when the archive isn't mapped.
+  base::StringPiece data_;
+  std::string contents_;
 
   std::unique_ptr<net::FileStream> stream_;
   FileMetaInfo meta_info_;
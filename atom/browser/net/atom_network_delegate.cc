@@ -5,12 +5,16 @@
 #include "atom/browser/net/atom_network_delegate.h"
 
 #include <memory>
+#include <set>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "atom/browser/extensions/tab_helper.h"
 #include "atom/common/native_mate_converters/net_converter.h"
 #include "base/stl_util.h"
 #include "base/strings/string_util.h"
+#include "base/trace_event/trace_event.h"
 #include "chrome/browser/extensions/api/tabs/tabs_constants.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/browser/render_frame_host.h"
@@ -77,37 +81,84 @@ int GetTabId(int frame_tree_node_id,
   return extensions::TabHelper::IdForTab(web_contents);
 }
 
+// Whether a listener asked for the |key| field of the details, listeners
+// get all of them when they don't select any.
+bool WantsField(const std::set<std::string>& fields, const char* key) {
+  return fields.empty() || base::ContainsKey(fields, key);
+}
+
 void RunSimpleListener(const AtomNetworkDelegate::SimpleListener& listener,
                        std::unique_ptr<base::DictionaryValue> details,
+                       bool wants_tab_id,
                        int frame_tree_node_id,
                        int render_frame_id,
-                       int render_process_id) {
-  details->SetInteger(extensions::tabs_constants::kTabIdKey,
-      GetTabId(frame_tree_node_id, render_frame_id, render_process_id));
-  return listener.Run(*(details.get()));
+                       int render_process_id,
+                       scoped_refptr<WebRequestStats> stats,
+                       const char* event,
+                       base::TimeTicks dispatched) {
+  TRACE_EVENT0("browser", event);
+  base::TimeTicks started = base::TimeTicks::Now();
+  stats->Record(event, WebRequestStats::STAGE_DISPATCH, started - dispatched);
+
+  if (wants_tab_id)
+    details->SetInteger(extensions::tabs_constants::kTabIdKey,
+        GetTabId(frame_tree_node_id, render_frame_id, render_process_id));
+  listener.Run(*(details.get()));
+
+  stats->Record(event, WebRequestStats::STAGE_LISTENER,
+                base::TimeTicks::Now() - started);
+}
+
+void RunBatchListener(const AtomNetworkDelegate::BatchListener& listener,
+                      bool wants_tab_id,
+                      std::vector<AtomNetworkDelegate::BatchedEvent> events,
+                      scoped_refptr<WebRequestStats> stats,
+                      const char* event) {
+  TRACE_EVENT1("browser", event, "count", static_cast<int>(events.size()));
+  base::TimeTicks started = base::TimeTicks::Now();
+
+  base::ListValue list;
+  list.GetList().reserve(events.size());
+  for (auto& batched_event : events) {
+    // Includes the time spent waiting for the batch to be delivered.
+    stats->Record(event, WebRequestStats::STAGE_DISPATCH,
+                  started - batched_event.time);
+    if (wants_tab_id)
+      batched_event.details->SetInteger(extensions::tabs_constants::kTabIdKey,
+          GetTabId(batched_event.frame_tree_node_id,
+                   batched_event.render_frame_id,
+                   batched_event.render_process_id));
+    list.Append(std::move(batched_event.details));
+  }
+  listener.Run(list);
+
+  stats->Record(event, WebRequestStats::STAGE_LISTENER,
+                base::TimeTicks::Now() - started);
 }
 
 void RunResponseListener(
     const AtomNetworkDelegate::ResponseListener& listener,
     std::unique_ptr<base::DictionaryValue> details,
     int frame_tree_node_id, int render_frame_id, int render_process_id,
-    const AtomNetworkDelegate::ResponseCallback& callback) {
+    scoped_refptr<WebRequestStats> stats,
+    const char* event,
+    base::TimeTicks dispatched,
+    const base::Callback<void(base::TimeTicks,
+                              const base::DictionaryValue&)>& callback) {
+  TRACE_EVENT0("browser", event);
+  base::TimeTicks started = base::TimeTicks::Now();
+  stats->Record(event, WebRequestStats::STAGE_DISPATCH, started - dispatched);
+
   details->SetInteger(extensions::tabs_constants::kTabIdKey,
       GetTabId(frame_tree_node_id, render_frame_id, render_process_id));
-  return listener.Run(*(details.get()), callback);
+  // The listener stage lasts until the listener calls back.
+  return listener.Run(*(details.get()), base::Bind(callback, started));
 }
 
 // Test whether the URL of |request| matches |patterns|.
 bool MatchesFilterCondition(net::URLRequest* request,
-                            const URLPatterns& patterns) {
-  if (patterns.empty())
-    return true;
-
-  for (const auto& pattern : patterns) {
-    if (pattern.MatchesURL(request->url()))
-      return true;
-  }
-  return false;
+                            const URLPatternMatcher& patterns) {
+  return patterns.MatchesURL(request->url());
 }
 
 void GetRenderFrameIdAndProcessId(net::URLRequest* request,
@@ -136,26 +187,55 @@ void GetFrameTreeNodeId(net::URLRequest* request, int* frame_tree_node_id) {
     *frame_tree_node_id = request_info->GetFrameTreeNodeId();
 }
 
-// Overloaded by multiple types to fill the |details| object.
-void ToDictionary(base::DictionaryValue* details, net::URLRequest* request) {
-  FillRequestDetails(details, request);
-  details->SetInteger("id", request->identifier());
-  details->SetDouble("timestamp", base::Time::Now().ToDoubleT() * 1000);
-  details->SetString("firstPartyUrl", request->site_for_cookies().spec());
-  auto info = content::ResourceRequestInfo::ForRequest(request);
-  details->SetString("resourceType",
-                     info ? ResourceTypeToString(info->GetResourceType())
-                          : "other");
-  net::IPEndPoint request_ip_endpoint;
-  bool was_successful = request->GetRemoteEndpoint(&request_ip_endpoint);
-  if (was_successful) {
-    details->SetString("ip", request_ip_endpoint.ToStringWithoutPort());
-    details->SetInteger("port", request_ip_endpoint.port());
+// Overloaded by multiple types to fill the |fields| of the |details| object.
+void ToDictionary(base::DictionaryValue* details,
+                  const std::set<std::string>& fields,
+                  net::URLRequest* request) {
+  if (fields.empty()) {
+    FillRequestDetails(details, request);
+  } else {
+    if (WantsField(fields, "method"))
+      details->SetString("method", request->method());
+    if (WantsField(fields, "url"))
+      details->SetString("url", request->url_chain().empty()
+                                    ? std::string() : request->url().spec());
+    if (WantsField(fields, "referrer"))
+      details->SetString("referrer", request->referrer());
+    if (WantsField(fields, "uploadData")) {
+      std::unique_ptr<base::ListValue> list(new base::ListValue);
+      GetUploadData(list.get(), request);
+      if (!list->empty())
+        details->Set("uploadData", std::move(list));
+    }
+  }
+  if (WantsField(fields, "id"))
+    details->SetInteger("id", request->identifier());
+  if (WantsField(fields, "timestamp"))
+    details->SetDouble("timestamp", base::Time::Now().ToDoubleT() * 1000);
+  if (WantsField(fields, "firstPartyUrl"))
+    details->SetString("firstPartyUrl", request->site_for_cookies().spec());
+  if (WantsField(fields, "resourceType")) {
+    auto info = content::ResourceRequestInfo::ForRequest(request);
+    details->SetString("resourceType",
+                       info ? ResourceTypeToString(info->GetResourceType())
+                            : "other");
+  }
+  if (WantsField(fields, "ip") || WantsField(fields, "port")) {
+    net::IPEndPoint request_ip_endpoint;
+    bool was_successful = request->GetRemoteEndpoint(&request_ip_endpoint);
+    if (was_successful) {
+      details->SetString("ip", request_ip_endpoint.ToStringWithoutPort());
+      details->SetInteger("port", request_ip_endpoint.port());
+    }
   }
 }
 
 void ToDictionary(base::DictionaryValue* details,
+                  const std::set<std::string>& fields,
                   const net::HttpRequestHeaders& headers) {
+  if (!WantsField(fields, "requestHeaders"))
+    return;
+
   std::unique_ptr<base::DictionaryValue> dict(new base::DictionaryValue);
   net::HttpRequestHeaders::Iterator it(headers);
   while (it.GetNext())
@@ -164,10 +244,19 @@ void ToDictionary(base::DictionaryValue* details,
 }
 
 void ToDictionary(base::DictionaryValue* details,
+                  const std::set<std::string>& fields,
                   const net::HttpResponseHeaders* headers) {
   if (!headers)
     return;
 
+  if (!WantsField(fields, "responseHeaders")) {
+    if (WantsField(fields, "statusLine"))
+      details->SetString("statusLine", headers->GetStatusLine());
+    if (WantsField(fields, "statusCode"))
+      details->SetInteger("statusCode", headers->response_code());
+    return;
+  }
+
   std::unique_ptr<base::DictionaryValue> dict(new base::DictionaryValue);
   size_t iter = 0;
   std::string key;
@@ -188,35 +277,49 @@ void ToDictionary(base::DictionaryValue* details,
   details->SetInteger("statusCode", headers->response_code());
 }
 
-void ToDictionary(base::DictionaryValue* details, const GURL& location) {
-  details->SetString("redirectURL", location.spec());
+void ToDictionary(base::DictionaryValue* details,
+                  const std::set<std::string>& fields,
+                  const GURL& location) {
+  if (WantsField(fields, "redirectURL"))
+    details->SetString("redirectURL", location.spec());
 }
 
 void ToDictionary(base::DictionaryValue* details,
+                  const std::set<std::string>& fields,
                   const net::HostPortPair& host_port) {
-  if (host_port.host().empty())
+  if (host_port.host().empty() && WantsField(fields, "ip"))
     details->SetString("ip", host_port.host());
 }
 
-void ToDictionary(base::DictionaryValue* details, bool from_cache) {
-  details->SetBoolean("fromCache", from_cache);
+void ToDictionary(base::DictionaryValue* details,
+                  const std::set<std::string>& fields,
+                  bool from_cache) {
+  if (WantsField(fields, "fromCache"))
+    details->SetBoolean("fromCache", from_cache);
 }
 
 void ToDictionary(base::DictionaryValue* details,
+                  const std::set<std::string>& fields,
                   const net::URLRequestStatus& status) {
-  details->SetString("error", net::ErrorToString(status.error()));
+  if (WantsField(fields, "error"))
+    details->SetString("error", net::ErrorToString(status.error()));
 }
 
 // Helper function to fill |details| with arbitrary |args|.
 template<typename Arg>
-void FillDetailsObject(base::DictionaryValue* details, Arg arg) {
-  ToDictionary(details, arg);
+void FillDetailsObject(base::DictionaryValue* details,
+                       const std::set<std::string>& fields,
+                       Arg arg) {
+  ToDictionary(details, fields, arg);
 }
 
 template<typename Arg, typename... Args>
-void FillDetailsObject(base::DictionaryValue* details, Arg arg, Args... args) {
-  ToDictionary(details, arg);
-  FillDetailsObject(details, args...);
+void FillDetailsObject(base::DictionaryValue* details,
+                       const std::set<std::string>& fields,
+                       Arg arg,
+                       Args... args) {
+  ToDictionary(details, fields, arg);
+  FillDetailsObject(details, fields, args...);
 }
 
 // Fill the native types with the result from the response object.
@@ -273,7 +376,29 @@ void ReadFromResponseObject(const base::DictionaryValue& response,
 
 }  // namespace
 
-AtomNetworkDelegate::AtomNetworkDelegate() : weak_factory_(this) {
+AtomNetworkDelegate::SimpleListenerOptions::SimpleListenerOptions()
+    : batch_interval(base::TimeDelta::FromMilliseconds(100)),
+      batch_size(100) {}
+
+AtomNetworkDelegate::SimpleListenerOptions::SimpleListenerOptions(
+    const SimpleListenerOptions& other) = default;
+
+AtomNetworkDelegate::SimpleListenerOptions::~SimpleListenerOptions() {}
+
+AtomNetworkDelegate::BatchedEvent::BatchedEvent()
+    : frame_tree_node_id(-1), render_frame_id(-1), render_process_id(-1) {}
+
+AtomNetworkDelegate::BatchedEvent::BatchedEvent(BatchedEvent&& other) =
+    default;
+
+AtomNetworkDelegate::BatchedEvent::~BatchedEvent() {}
+
+AtomNetworkDelegate::EventBatch::EventBatch() {}
+
+AtomNetworkDelegate::EventBatch::~EventBatch() {}
+
+AtomNetworkDelegate::AtomNetworkDelegate()
+    : stats_(new WebRequestStats), weak_factory_(this) {
 }
 
 AtomNetworkDelegate::~AtomNetworkDelegate() {
@@ -282,11 +407,30 @@ AtomNetworkDelegate::~AtomNetworkDelegate() {
 void AtomNetworkDelegate::SetSimpleListenerInIO(
     SimpleEvent type,
     const URLPatterns& patterns,
+    const SimpleListenerOptions& options,
     const SimpleListener& callback) {
+  // Deliver the events batched for the previous listener.
+  FlushBatch(type);
+
   if (callback.is_null())
     simple_listeners_.erase(type);
   else
-    simple_listeners_[type] = { patterns, callback };
+    simple_listeners_[type] = {
+        URLPatternMatcher(patterns), options, callback, BatchListener() };
+}
+
+void AtomNetworkDelegate::SetBatchListenerInIO(
+    SimpleEvent type,
+    const URLPatterns& patterns,
+    const SimpleListenerOptions& options,
+    const BatchListener& callback) {
+  FlushBatch(type);
+
+  if (callback.is_null())
+    simple_listeners_.erase(type);
+  else
+    simple_listeners_[type] = {
+        URLPatternMatcher(patterns), options, SimpleListener(), callback };
 }
 
 void AtomNetworkDelegate::SetResponseListenerInIO(
@@ -296,7 +440,44 @@ void AtomNetworkDelegate::SetResponseListenerInIO(
   if (callback.is_null())
     response_listeners_.erase(type);
   else
-    response_listeners_[type] = { patterns, callback };
+    response_listeners_[type] = { URLPatternMatcher(patterns), callback };
+}
+
+// static
+const char* AtomNetworkDelegate::GetEventName(SimpleEvent type) {
+  switch (type) {
+    case kOnSendHeaders:
+      return "onSendHeaders";
+    case kOnBeforeRedirect:
+      return "onBeforeRedirect";
+    case kOnResponseStarted:
+      return "onResponseStarted";
+    case kOnCompleted:
+      return "onCompleted";
+    case kOnErrorOccurred:
+      return "onErrorOccurred";
+  }
+  NOTREACHED();
+  return "";
+}
+
+// static
+const char* AtomNetworkDelegate::GetEventName(ResponseEvent type) {
+  switch (type) {
+    case kOnBeforeRequest:
+      return "onBeforeRequest";
+    case kOnBeforeSendHeaders:
+      return "onBeforeSendHeaders";
+    case kOnHeadersReceived:
+      return "onHeadersReceived";
+  }
+  NOTREACHED();
+  return "";
+}
+
+void AtomNetworkDelegate::SetRequestFilterInIO(
+    scoped_refptr<RequestFilter> filter) {
+  request_filter_ = std::move(filter);
 }
 
 void AtomNetworkDelegate::SetDevToolsNetworkEmulationClientId(
@@ -305,10 +486,31 @@ void AtomNetworkDelegate::SetDevToolsNetworkEmulationClientId(
   client_id_ = client_id;
 }
 
+bool AtomNetworkDelegate::IsBlockedByRequestFilter(
+    net::URLRequest* request) const {
+  if (!request_filter_)
+    return false;
+
+  auto info = content::ResourceRequestInfo::ForRequest(request);
+  return request_filter_->ShouldBlock(
+      request->url(), request->site_for_cookies(),
+      info ? info->GetResourceType() : content::RESOURCE_TYPE_SUB_RESOURCE);
+}
+
 int AtomNetworkDelegate::OnBeforeURLRequest(
     net::URLRequest* request,
     const net::CompletionCallback& callback,
     GURL* new_url) {
+  if (IsBlockedByRequestFilter(request))
+    return net::ERR_BLOCKED_BY_CLIENT;
+
+  return HandleBeforeURLRequest(request, callback, new_url);
+}
+
+int AtomNetworkDelegate::HandleBeforeURLRequest(
+    net::URLRequest* request,
+    const net::CompletionCallback& callback,
+    GURL* new_url) {
   if (!base::ContainsKey(response_listeners_, kOnBeforeRequest))
     return brightray::NetworkDelegate::OnBeforeURLRequest(
         request, callback, new_url);
@@ -444,7 +646,7 @@ int AtomNetworkDelegate::HandleResponseEvent(
     return net::OK;
 
   std::unique_ptr<base::DictionaryValue> details(new base::DictionaryValue);
-  FillDetailsObject(details.get(), request, args...);
+  FillDetailsObject(details.get(), std::set<std::string>(), request, args...);
 
   // The |request| could be destroyed before the |callback| is called.
   callbacks_[request->identifier()] = callback;
@@ -456,14 +658,20 @@ int AtomNetworkDelegate::HandleResponseEvent(
   int render_process_id = -1;
   GetRenderFrameIdAndProcessId(request, &render_frame_id, &render_process_id);
 
-  ResponseCallback response =
+  const char* event = GetEventName(type);
+  base::TimeTicks dispatched = base::TimeTicks::Now();
+  TRACE_EVENT_ASYNC_BEGIN1("browser", event, request->identifier(),
+                           "url", request->url().possibly_invalid_spec());
+
+  auto response =
       base::Bind(&AtomNetworkDelegate::OnListenerResultInUI<Out>,
-                 weak_factory_.GetWeakPtr(), request->identifier(), out);
+                 weak_factory_.GetWeakPtr(), request->identifier(), out,
+                 event, dispatched);
   BrowserThread::PostTask(
       BrowserThread::UI, FROM_HERE,
       base::Bind(RunResponseListener, info.listener, base::Passed(&details),
                  frame_tree_node_id, render_frame_id, render_process_id,
-                 response));
+                 stats_, event, dispatched, response));
   return net::ERR_IO_PENDING;
 }
 
@@ -475,7 +683,7 @@ void AtomNetworkDelegate::HandleSimpleEvent(
     return;
 
   std::unique_ptr<base::DictionaryValue> details(new base::DictionaryValue);
-  FillDetailsObject(details.get(), request, args...);
+  FillDetailsObject(details.get(), info.options.fields, request, args...);
 
   int frame_tree_node_id = -1;
   GetFrameTreeNodeId(request, &frame_tree_node_id);
@@ -484,15 +692,76 @@ void AtomNetworkDelegate::HandleSimpleEvent(
   int render_process_id = -1;
   GetRenderFrameIdAndProcessId(request, &render_frame_id, &render_process_id);
 
+  if (!info.batch_listener.is_null()) {
+    BatchedEvent event;
+    event.details = std::move(details);
+    event.frame_tree_node_id = frame_tree_node_id;
+    event.render_frame_id = render_frame_id;
+    event.render_process_id = render_process_id;
+    event.time = base::TimeTicks::Now();
+    AddToBatch(type, std::move(event));
+    return;
+  }
+
+  bool wants_tab_id = WantsField(info.options.fields,
+                                 extensions::tabs_constants::kTabIdKey);
   BrowserThread::PostTask(
       BrowserThread::UI, FROM_HERE,
       base::Bind(RunSimpleListener, info.listener, base::Passed(&details),
-          frame_tree_node_id, render_frame_id, render_process_id));
+          wants_tab_id, frame_tree_node_id, render_frame_id,
+          render_process_id, stats_, GetEventName(type),
+          base::TimeTicks::Now()));
+}
+
+void AtomNetworkDelegate::AddToBatch(SimpleEvent type, BatchedEvent event) {
+  const auto& options = simple_listeners_[type].options;
+  std::unique_ptr<EventBatch>& batch = batches_[type];
+  if (!batch)
+    batch.reset(new EventBatch);
+
+  batch->events.push_back(std::move(event));
+  if (batch->events.size() >= options.batch_size) {
+    FlushBatch(type);
+  } else if (!batch->timer.IsRunning()) {
+    batch->timer.Start(FROM_HERE, options.batch_interval,
+                       base::Bind(&AtomNetworkDelegate::FlushBatch,
+                                  base::Unretained(this), type));
+  }
+}
+
+void AtomNetworkDelegate::FlushBatch(SimpleEvent type) {
+  auto batch = batches_.find(type);
+  if (batch == batches_.end() || batch->second->events.empty())
+    return;
+
+  batch->second->timer.Stop();
+  std::vector<BatchedEvent> events;
+  events.swap(batch->second->events);
+
+  auto listener = simple_listeners_.find(type);
+  if (listener == simple_listeners_.end() ||
+      listener->second.batch_listener.is_null())
+    return;
+
+  const auto& info = listener->second;
+  bool wants_tab_id = WantsField(info.options.fields,
+                                 extensions::tabs_constants::kTabIdKey);
+  BrowserThread::PostTask(
+      BrowserThread::UI, FROM_HERE,
+      base::Bind(RunBatchListener, info.batch_listener, wants_tab_id,
+                 base::Passed(&events), stats_, GetEventName(type)));
 }
 
 template<typename T>
 void AtomNetworkDelegate::OnListenerResultInIO(
-    uint64_t id, T out, std::unique_ptr<base::DictionaryValue> response) {
+    uint64_t id, T out, const char* event,
+    base::TimeTicks dispatched, base::TimeTicks responded,
+    std::unique_ptr<base::DictionaryValue> response) {
+  base::TimeTicks now = base::TimeTicks::Now();
+  stats_->Record(event, WebRequestStats::STAGE_RETURN, now - responded);
+  stats_->Record(event, WebRequestStats::STAGE_TOTAL, now - dispatched);
+  TRACE_EVENT_ASYNC_END0("browser", event, id);
+
   // The request has been destroyed.
   if (!base::ContainsKey(callbacks_, id))
     return;
@@ -507,12 +776,17 @@ void AtomNetworkDelegate::OnListenerResultInIO(
 template<typename T>
 void AtomNetworkDelegate::OnListenerResultInUI(
     uint64_t id,
-    T out, const base::DictionaryValue& response) {
+    T out, const char* event, base::TimeTicks dispatched,
+    base::TimeTicks started, const base::DictionaryValue& response) {
+  base::TimeTicks responded = base::TimeTicks::Now();
+  stats_->Record(event, WebRequestStats::STAGE_LISTENER, responded - started);
+
   std::unique_ptr<base::DictionaryValue> copy = response.CreateDeepCopy();
   BrowserThread::PostTask(
       BrowserThread::IO, FROM_HERE,
       base::Bind(&AtomNetworkDelegate::OnListenerResultInIO<T>,
-                 weak_factory_.GetWeakPtr(), id, out, base::Passed(&copy)));
+                 weak_factory_.GetWeakPtr(), id, out, event, dispatched,
+                 responded, base::Passed(&copy)));
 }
 
 }  // namespace atom
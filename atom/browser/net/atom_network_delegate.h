@@ -9,28 +9,32 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
+#include "atom/browser/net/request_filter.h"
+#include "atom/browser/net/url_pattern_matcher.h"
+#include "atom/browser/net/web_request_stats.h"
 #include "base/callback.h"
 #include "base/memory/weak_ptr.h"
 #include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
 #include "base/values.h"
 #include "brightray/browser/network_delegate.h"
 #include "content/public/browser/resource_request_info.h"
-#include "extensions/common/url_pattern.h"
 #include "net/base/net_errors.h"
 #include "net/http/http_request_headers.h"
 #include "net/http/http_response_headers.h"
 
 namespace atom {
 
-using URLPatterns = std::set<URLPattern>;
-
 const char* ResourceTypeToString(content::ResourceType type);
 
 class AtomNetworkDelegate : public brightray::NetworkDelegate {
  public:
   using ResponseCallback = base::Callback<void(const base::DictionaryValue&)>;
   using SimpleListener = base::Callback<void(const base::DictionaryValue&)>;
+  using BatchListener = base::Callback<void(const base::ListValue&)>;
   using ResponseListener = base::Callback<void(const base::DictionaryValue&,
                                                const ResponseCallback&)>;
 
@@ -48,29 +52,84 @@ class AtomNetworkDelegate : public brightray::NetworkDelegate {
     kOnHeadersReceived,
   };
 
+  struct SimpleListenerOptions {
+    SimpleListenerOptions();
+    SimpleListenerOptions(const SimpleListenerOptions& other);
+    ~SimpleListenerOptions();
+
+    // The fields of the details the listener uses, all of them when empty.
+    std::set<std::string> fields;
+    // Batched events are delivered |batch_interval| after the first of them
+    // at the latest, or as soon as |batch_size| of them are pending.
+    base::TimeDelta batch_interval;
+    size_t batch_size;
+  };
+
   struct SimpleListenerInfo {
-    URLPatterns url_patterns;
+    URLPatternMatcher url_patterns;
+    SimpleListenerOptions options;
     SimpleListener listener;
+    // Set instead of |listener| when the events are delivered in batches.
+    BatchListener batch_listener;
+  };
+
+  // An event waiting on the IO thread to be delivered in a batch, with the
+  // ids needed to find its tab on the UI thread.
+  struct BatchedEvent {
+    BatchedEvent();
+    BatchedEvent(BatchedEvent&& other);
+    ~BatchedEvent();
+
+    std::unique_ptr<base::DictionaryValue> details;
+    int frame_tree_node_id;
+    int render_frame_id;
+    int render_process_id;
+    // When the event happened.
+    base::TimeTicks time;
   };
 
   struct ResponseListenerInfo {
-    URLPatterns url_patterns;
+    URLPatternMatcher url_patterns;
     ResponseListener listener;
   };
 
   AtomNetworkDelegate();
   ~AtomNetworkDelegate() override;
 
+  static const char* GetEventName(SimpleEvent type);
+  static const char* GetEventName(ResponseEvent type);
+
   void SetSimpleListenerInIO(SimpleEvent type,
                              const URLPatterns& patterns,
+                             const SimpleListenerOptions& options,
                              const SimpleListener& callback);
+  void SetBatchListenerInIO(SimpleEvent type,
+                            const URLPatterns& patterns,
+                            const SimpleListenerOptions& options,
+                            const BatchListener& callback);
   void SetResponseListenerInIO(ResponseEvent type,
                                const URLPatterns& patterns,
                                const ResponseListener& callback);
 
+  // Replace the rules deciding which requests are blocked before reaching
+  // the onBeforeRequest listener, null removes them.
+  void SetRequestFilterInIO(scoped_refptr<RequestFilter> filter);
+
   void SetDevToolsNetworkEmulationClientId(const std::string& client_id);
 
+  // The latency added to requests by the listeners, can be used on any
+  // thread.
+  WebRequestStats* stats() const { return stats_.get(); }
+
  protected:
+  // Whether |request| is blocked by the request filter.
+  bool IsBlockedByRequestFilter(net::URLRequest* request) const;
+
+  // Run the onBeforeRequest listener for a request the filter didn't block.
+  int HandleBeforeURLRequest(net::URLRequest* request,
+                             const net::CompletionCallback& callback,
+                             GURL* new_url);
+
   // net::NetworkDelegate:
   int OnBeforeURLRequest(net::URLRequest* request,
                          const net::CompletionCallback& callback,
@@ -95,8 +154,20 @@ class AtomNetworkDelegate : public brightray::NetworkDelegate {
   void OnURLRequestDestroyed(net::URLRequest* request) override;
 
  private:
+  struct EventBatch {
+    EventBatch();
+    ~EventBatch();
+
+    std::vector<BatchedEvent> events;
+    base::OneShotTimer timer;
+  };
+
   void OnErrorOccurred(net::URLRequest* request, bool started, int net_error);
 
+  void AddToBatch(SimpleEvent type, BatchedEvent event);
+  // Deliver the batched events of |type| to the listener.
+  void FlushBatch(SimpleEvent type);
+
   template<typename...Args>
   void HandleSimpleEvent(SimpleEvent type,
                          net::URLRequest* request,
@@ -111,15 +182,21 @@ class AtomNetworkDelegate : public brightray::NetworkDelegate {
   // Deal with the results of Listener.
   template<typename T>
   void OnListenerResultInIO(
-      uint64_t id, T out, std::unique_ptr<base::DictionaryValue> response);
+      uint64_t id, T out, const char* event,
+      base::TimeTicks dispatched, base::TimeTicks responded,
+      std::unique_ptr<base::DictionaryValue> response);
   template<typename T>
   void OnListenerResultInUI(
       uint64_t id,
-      T out, const base::DictionaryValue& response);
+      T out, const char* event, base::TimeTicks dispatched,
+      base::TimeTicks started, const base::DictionaryValue& response);
 
   std::map<SimpleEvent, SimpleListenerInfo> simple_listeners_;
   std::map<ResponseEvent, ResponseListenerInfo> response_listeners_;
+  std::map<SimpleEvent, std::unique_ptr<EventBatch>> batches_;
   std::map<uint64_t, net::CompletionCallback> callbacks_;
+  scoped_refptr<RequestFilter> request_filter_;
+  scoped_refptr<WebRequestStats> stats_;
 
   base::Lock lock_;
 
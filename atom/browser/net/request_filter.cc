@@ -0,0 +1,639 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/request_filter.h"
+
+#include <utility>
+
+#include "base/pickle.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
+#include "url/gurl.h"
+
+namespace atom {
+
+namespace {
+
+const char kSerializationMagic[] = "muon-request-filter";
+const int kSerializationVersion = 2;
+
+// Keywords shorter than this match too many URLs to be worth indexing.
+const size_t kMinKeywordLength = 2;
+
+enum RuleFlags {
+  RULE_EXCEPTION = 1 << 0,
+  // "||", the pattern starts at the beginning of the host or of a subdomain.
+  RULE_HOST_ANCHORED = 1 << 1,
+  // "|" at the beginning or at the end of the pattern.
+  RULE_START_ANCHORED = 1 << 2,
+  RULE_END_ANCHORED = 1 << 3,
+  RULE_MATCH_CASE = 1 << 4,
+  RULE_THIRD_PARTY = 1 << 5,
+  RULE_FIRST_PARTY = 1 << 6,
+  // Blocks the request even if an exception rule matches it.
+  RULE_IMPORTANT = 1 << 7,
+};
+
+enum ResourceTypeMasks {
+  TYPE_SCRIPT = 1 << 0,
+  TYPE_IMAGE = 1 << 1,
+  TYPE_STYLESHEET = 1 << 2,
+  TYPE_OBJECT = 1 << 3,
+  TYPE_XMLHTTPREQUEST = 1 << 4,
+  TYPE_SUBDOCUMENT = 1 << 5,
+  TYPE_MEDIA = 1 << 6,
+  TYPE_FONT = 1 << 7,
+  TYPE_PING = 1 << 8,
+  TYPE_OTHER = 1 << 9,
+  TYPE_WEBSOCKET = 1 << 10,
+  TYPE_ALL = (1 << 11) - 1,
+  // Exceptions decided from the URL of the page rather than the request:
+  // "$document" allows every request of the page and "$genericblock" the
+  // ones only blocked by rules without a "domain=" option.
+  TYPE_DOCUMENT = 1 << 11,
+  TYPE_GENERICBLOCK = 1 << 12,
+  TYPE_PAGE = TYPE_DOCUMENT | TYPE_GENERICBLOCK,
+};
+
+const struct {
+  const char* name;
+  uint32_t mask;
+} kResourceTypeOptions[] = {
+  { "script", TYPE_SCRIPT },
+  { "image", TYPE_IMAGE },
+  { "stylesheet", TYPE_STYLESHEET },
+  { "object", TYPE_OBJECT },
+  { "object-subrequest", TYPE_OBJECT },
+  { "xmlhttprequest", TYPE_XMLHTTPREQUEST },
+  { "subdocument", TYPE_SUBDOCUMENT },
+  { "media", TYPE_MEDIA },
+  { "font", TYPE_FONT },
+  { "ping", TYPE_PING },
+  { "websocket", TYPE_WEBSOCKET },
+  { "other", TYPE_OTHER },
+  { "document", TYPE_DOCUMENT },
+  { "genericblock", TYPE_GENERICBLOCK },
+  // Element hiding and popups, which aren't requests of the page, so the
+  // rules restricted to them apply to nothing here.
+  { "elemhide", 0 },
+  { "generichide", 0 },
+  { "popup", 0 },
+};
+
+uint32_t ResourceTypeToMask(content::ResourceType type) {
+  switch (type) {
+    case content::RESOURCE_TYPE_SCRIPT:
+    case content::RESOURCE_TYPE_WORKER:
+    case content::RESOURCE_TYPE_SHARED_WORKER:
+    case content::RESOURCE_TYPE_SERVICE_WORKER:
+      return TYPE_SCRIPT;
+    case content::RESOURCE_TYPE_IMAGE:
+    case content::RESOURCE_TYPE_FAVICON:
+      return TYPE_IMAGE;
+    case content::RESOURCE_TYPE_STYLESHEET:
+      return TYPE_STYLESHEET;
+    case content::RESOURCE_TYPE_OBJECT:
+    case content::RESOURCE_TYPE_PLUGIN_RESOURCE:
+      return TYPE_OBJECT;
+    case content::RESOURCE_TYPE_XHR:
+      return TYPE_XMLHTTPREQUEST;
+    case content::RESOURCE_TYPE_SUB_FRAME:
+      return TYPE_SUBDOCUMENT;
+    case content::RESOURCE_TYPE_MEDIA:
+      return TYPE_MEDIA;
+    case content::RESOURCE_TYPE_FONT_RESOURCE:
+      return TYPE_FONT;
+    case content::RESOURCE_TYPE_PING:
+    case content::RESOURCE_TYPE_CSP_REPORT:
+      return TYPE_PING;
+    default:
+      return TYPE_OTHER;
+  }
+}
+
+bool IsKeywordChar(char c) {
+  return base::IsAsciiAlpha(c) || base::IsAsciiDigit(c) || c == '%';
+}
+
+// What "^" matches, anything but a letter, a digit or one of "_-.%".
+bool IsSeparator(char c) {
+  return !base::IsAsciiAlpha(c) && !base::IsAsciiDigit(c) &&
+         c != '_' && c != '-' && c != '.' && c != '%';
+}
+
+// Match |segment|, which has no "*", at |pos| of |url|. Returns the end of
+// the match or npos.
+size_t MatchSegmentAt(base::StringPiece segment,
+                      base::StringPiece url,
+                      size_t pos) {
+  for (char c : segment) {
+    if (pos == url.size()) {
+      // "^" also matches the end of the URL.
+      if (c != '^')
+        return base::StringPiece::npos;
+      continue;
+    }
+    if (c == '^' ? !IsSeparator(url[pos]) : c != url[pos])
+      return base::StringPiece::npos;
+    ++pos;
+  }
+  return pos;
+}
+
+// Find the first match of |segment| at or after |pos| of |url|. Returns its
+// position and sets |end| to its end, or returns npos.
+size_t FindSegment(base::StringPiece segment,
+                   base::StringPiece url,
+                   size_t pos,
+                   size_t* end) {
+  if (segment.empty()) {
+    *end = pos;
+    return pos;
+  }
+  for (; pos <= url.size(); ++pos) {
+    if (segment[0] != '^') {
+      pos = url.find(segment[0], pos);
+      if (pos == base::StringPiece::npos)
+        return pos;
+    }
+    size_t match_end = MatchSegmentAt(segment, url, pos);
+    if (match_end != base::StringPiece::npos) {
+      *end = match_end;
+      return pos;
+    }
+  }
+  return base::StringPiece::npos;
+}
+
+// Match |pattern| against |url| from |pos|. The "*" wildcards are matched
+// lazily, which finds a match whenever there is one since only the last
+// segment can be anchored.
+bool MatchPattern(base::StringPiece pattern,
+                  base::StringPiece url,
+                  size_t pos,
+                  bool start_anchored,
+                  bool end_anchored) {
+  // Rules that only restrict the first party or the type of the request.
+  if (pattern.empty())
+    return true;
+
+  bool first = true;
+  while (true) {
+    size_t star = pattern.find('*');
+    base::StringPiece segment = pattern.substr(0, star);
+    bool last = star == base::StringPiece::npos;
+
+    if (first && start_anchored) {
+      pos = MatchSegmentAt(segment, url, pos);
+      if (pos == base::StringPiece::npos)
+        return false;
+      if (last && end_anchored)
+        return pos == url.size();
+    } else if (last && end_anchored) {
+      size_t end = 0;
+      for (size_t begin = FindSegment(segment, url, pos, &end);
+           begin != base::StringPiece::npos;
+           begin = FindSegment(segment, url, begin + 1, &end)) {
+        if (end == url.size())
+          return true;
+      }
+      return false;
+    } else {
+      size_t end = 0;
+      if (FindSegment(segment, url, pos, &end) == base::StringPiece::npos)
+        return false;
+      pos = end;
+    }
+
+    if (last)
+      return true;
+    pattern = pattern.substr(star + 1);
+    first = false;
+  }
+}
+
+// Whether |host| is one of |domains| or one of their subdomains.
+bool MatchesDomain(base::StringPiece host,
+                   const std::vector<std::string>& domains) {
+  for (const auto& domain : domains) {
+    if (host.ends_with(domain) &&
+        (host.size() == domain.size() ||
+         host[host.size() - domain.size() - 1] == '.'))
+      return true;
+  }
+  return false;
+}
+
+bool ParseOptions(base::StringPiece options,
+                  uint32_t* flags,
+                  uint32_t* resource_types,
+                  std::vector<std::string>* domains,
+                  std::vector<std::string>* excluded_domains) {
+  bool has_included_types = false;
+  uint32_t included_types = 0;
+  uint32_t excluded_types = 0;
+  for (base::StringPiece option : base::SplitStringPiece(
+           options, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    bool negated = option.starts_with("~");
+    if (negated)
+      option.remove_prefix(1);
+
+    if (!negated && option.starts_with("domain=")) {
+      for (base::StringPiece domain : base::SplitStringPiece(
+               option.substr(7), "|", base::TRIM_WHITESPACE,
+               base::SPLIT_WANT_NONEMPTY)) {
+        if (domain.starts_with("~"))
+          excluded_domains->push_back(base::ToLowerASCII(domain.substr(1)));
+        else
+          domains->push_back(base::ToLowerASCII(domain));
+      }
+      continue;
+    }
+    if (option == "third-party") {
+      *flags |= negated ? RULE_FIRST_PARTY : RULE_THIRD_PARTY;
+      continue;
+    }
+    if (!negated && option == "match-case") {
+      *flags |= RULE_MATCH_CASE;
+      continue;
+    }
+    if (!negated && option == "important") {
+      *flags |= RULE_IMPORTANT;
+      continue;
+    }
+    // Only changes how the blocked element is displayed.
+    if (option == "collapse")
+      continue;
+
+    bool found = false;
+    for (const auto& type : kResourceTypeOptions) {
+      if (option == type.name) {
+        if (negated) {
+          excluded_types |= type.mask;
+        } else {
+          included_types |= type.mask;
+          has_included_types = true;
+        }
+        found = true;
+        break;
+      }
+    }
+    // The rule can't be applied without understanding all its options. This
+    // includes "csp=" and "rewrite=", whose rules change the response rather
+    // than block the request.
+    if (!found)
+      return false;
+  }
+
+  *resource_types = (has_included_types ? included_types : TYPE_ALL) &
+                    ~excluded_types;
+  // The pages themselves are never blocked.
+  if (!(*flags & RULE_EXCEPTION))
+    *resource_types &= TYPE_ALL;
+  return *resource_types != 0;
+}
+
+}  // namespace
+
+struct RequestFilter::Request {
+  base::StringPiece spec;
+  std::string lower_spec;
+  size_t host_begin;
+  size_t host_end;
+  std::string first_party_host;
+  bool third_party;
+  uint32_t resource_type;
+  // Only applies the rules with a "domain=" option.
+  bool specific_only;
+
+  Request(const GURL& url,
+          const GURL& first_party_url,
+          uint32_t resource_type);
+};
+
+RequestFilter::Request::Request(const GURL& url,
+                                const GURL& first_party_url,
+                                uint32_t resource_type)
+    : spec(url.spec()),
+      lower_spec(base::ToLowerASCII(spec)),
+      first_party_host(first_party_url.host()),
+      third_party(first_party_url.is_valid() &&
+          !net::registry_controlled_domains::SameDomainOrHost(
+              url, first_party_url,
+              net::registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES)),
+      resource_type(resource_type),
+      specific_only(false) {
+  const url::Component& host = url.parsed_for_possibly_invalid_spec().host;
+  host_begin = host.begin;
+  host_end = host.end();
+}
+
+RequestFilter::Rule::Rule() : flags(0), resource_types(TYPE_ALL) {}
+
+RequestFilter::Rule::Rule(const Rule& other) = default;
+
+RequestFilter::Rule::~Rule() {}
+
+RequestFilter::RuleIndex::RuleIndex() {}
+
+RequestFilter::RuleIndex::~RuleIndex() {}
+
+RequestFilter::RequestFilter() {}
+
+RequestFilter::~RequestFilter() {}
+
+// static
+scoped_refptr<RequestFilter> RequestFilter::Parse(base::StringPiece list) {
+  scoped_refptr<RequestFilter> filter(new RequestFilter);
+  for (base::StringPiece line : base::SplitStringPiece(
+           list, "\r\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY))
+    filter->AddRule(line);
+  filter->BuildIndex();
+  return filter;
+}
+
+// static
+scoped_refptr<RequestFilter> RequestFilter::Deserialize(
+    base::StringPiece data) {
+  base::Pickle pickle(data.data(), static_cast<int>(data.size()));
+  base::PickleIterator iter(pickle);
+
+  std::string magic;
+  int version;
+  uint32_t count;
+  if (!iter.ReadString(&magic) || magic != kSerializationMagic ||
+      !iter.ReadInt(&version) || version != kSerializationVersion ||
+      !iter.ReadUInt32(&count))
+    return nullptr;
+
+  scoped_refptr<RequestFilter> filter(new RequestFilter);
+  for (uint32_t i = 0; i < count; ++i) {
+    Rule rule;
+    uint32_t domain_count;
+    if (!iter.ReadString(&rule.pattern) ||
+        !iter.ReadUInt32(&rule.flags) ||
+        !iter.ReadUInt32(&rule.resource_types) ||
+        !iter.ReadUInt32(&domain_count))
+      return nullptr;
+    for (uint32_t j = 0; j < domain_count; ++j) {
+      std::string domain;
+      if (!iter.ReadString(&domain))
+        return nullptr;
+      rule.domains.push_back(std::move(domain));
+    }
+    if (!iter.ReadUInt32(&domain_count))
+      return nullptr;
+    for (uint32_t j = 0; j < domain_count; ++j) {
+      std::string domain;
+      if (!iter.ReadString(&domain))
+        return nullptr;
+      rule.excluded_domains.push_back(std::move(domain));
+    }
+    filter->rules_.push_back(std::move(rule));
+  }
+
+  filter->BuildIndex();
+  return filter;
+}
+
+std::string RequestFilter::Serialize() const {
+  base::Pickle pickle;
+  pickle.WriteString(kSerializationMagic);
+  pickle.WriteInt(kSerializationVersion);
+  pickle.WriteUInt32(static_cast<uint32_t>(rules_.size()));
+  for (const auto& rule : rules_) {
+    pickle.WriteString(rule.pattern);
+    pickle.WriteUInt32(rule.flags);
+    pickle.WriteUInt32(rule.resource_types);
+    pickle.WriteUInt32(static_cast<uint32_t>(rule.domains.size()));
+    for (const auto& domain : rule.domains)
+      pickle.WriteString(domain);
+    pickle.WriteUInt32(
+        static_cast<uint32_t>(rule.excluded_domains.size()));
+    for (const auto& domain : rule.excluded_domains)
+      pickle.WriteString(domain);
+  }
+  return std::string(static_cast<const char*>(pickle.data()), pickle.size());
+}
+
+bool RequestFilter::AddRule(base::StringPiece line) {
+  // Comments and the "[Adblock Plus 2.0]" header.
+  if (line.starts_with("!") || line.starts_with("["))
+    return false;
+  // Element hiding rules.
+  if (line.find("##") != base::StringPiece::npos ||
+      line.find("#@#") != base::StringPiece::npos ||
+      line.find("#?#") != base::StringPiece::npos)
+    return false;
+
+  Rule rule;
+  if (line.starts_with("@@")) {
+    rule.flags |= RULE_EXCEPTION;
+    line.remove_prefix(2);
+  }
+
+  size_t dollar = line.rfind('$');
+  if (dollar != base::StringPiece::npos) {
+    if (!ParseOptions(line.substr(dollar + 1), &rule.flags,
+                      &rule.resource_types, &rule.domains,
+                      &rule.excluded_domains))
+      return false;
+    line = line.substr(0, dollar);
+  }
+
+  // Regular expressions.
+  if (line.size() > 1 && line.starts_with("/") && line.ends_with("/"))
+    return false;
+
+  if (line.starts_with("||")) {
+    rule.flags |= RULE_HOST_ANCHORED;
+    line.remove_prefix(2);
+  } else if (line.starts_with("|")) {
+    rule.flags |= RULE_START_ANCHORED;
+    line.remove_prefix(1);
+  }
+  if (line.ends_with("|")) {
+    rule.flags |= RULE_END_ANCHORED;
+    line.remove_suffix(1);
+  }
+
+  // Wildcards at the ends of the pattern make the anchors meaningless.
+  if (line.starts_with("*"))
+    rule.flags &= ~(RULE_HOST_ANCHORED | RULE_START_ANCHORED);
+  if (line.ends_with("*"))
+    rule.flags &= ~RULE_END_ANCHORED;
+  base::StringPiece trimmed = base::TrimString(line, "*", base::TRIM_ALL);
+
+  // A rule matching every URL of every site is certainly a mistake.
+  if (trimmed.empty() && rule.domains.empty())
+    return false;
+
+  rule.pattern.reserve(trimmed.size());
+  for (char c : trimmed) {
+    if (c != '*' || rule.pattern.empty() || rule.pattern.back() != '*')
+      rule.pattern.push_back(c);
+  }
+  if (!(rule.flags & RULE_MATCH_CASE))
+    rule.pattern = base::ToLowerASCII(rule.pattern);
+
+  rules_.push_back(std::move(rule));
+  return true;
+}
+
+base::StringPiece RequestFilter::GetKeyword(const Rule& rule,
+                                            const RuleIndex& index) const {
+  // A keyword must be a whole token of every URL the rule matches, so it
+  // can't touch a wildcard or an unanchored end of the pattern.
+  base::StringPiece pattern(rule.pattern);
+  base::StringPiece best;
+  size_t best_count = 0;
+  size_t begin = 0;
+  while (begin < pattern.size()) {
+    if (!IsKeywordChar(pattern[begin])) {
+      ++begin;
+      continue;
+    }
+    size_t end = begin;
+    while (end < pattern.size() && IsKeywordChar(pattern[end]))
+      ++end;
+
+    bool anchored_begin = begin > 0 ? pattern[begin - 1] != '*'
+        : (rule.flags & (RULE_HOST_ANCHORED | RULE_START_ANCHORED)) != 0;
+    bool anchored_end = end < pattern.size() ? pattern[end] != '*'
+        : (rule.flags & RULE_END_ANCHORED) != 0;
+    base::StringPiece keyword = pattern.substr(begin, end - begin);
+    if (anchored_begin && anchored_end &&
+        keyword.size() >= kMinKeywordLength &&
+        keyword == base::ToLowerASCII(keyword)) {
+      // Prefer the keywords shared by fewer rules.
+      auto it = index.keywords.find(keyword);
+      size_t count = it == index.keywords.end() ? 0 : it->second.size();
+      if (best.empty() || count < best_count ||
+          (count == best_count && keyword.size() > best.size())) {
+        best = keyword;
+        best_count = count;
+      }
+    }
+    begin = end;
+  }
+  return best;
+}
+
+void RequestFilter::BuildIndex() {
+  for (size_t i = 0; i < rules_.size(); ++i) {
+    const Rule& rule = rules_[i];
+    if (rule.resource_types & TYPE_PAGE)
+      AddToIndex(i, &page_exception_index_);
+    if (rule.resource_types & TYPE_ALL) {
+      AddToIndex(i, (rule.flags & RULE_EXCEPTION) ? &exception_index_
+          : (rule.flags & RULE_IMPORTANT) ? &important_index_ : &block_index_);
+    }
+  }
+}
+
+void RequestFilter::AddToIndex(size_t rule, RuleIndex* index) {
+  base::StringPiece keyword = GetKeyword(rules_[rule], *index);
+  if (keyword.empty())
+    index->generic.push_back(rule);
+  else
+    index->keywords[keyword].push_back(rule);
+}
+
+bool RequestFilter::RuleMatches(const Rule& rule,
+                                const Request& request) const {
+  if (!(rule.resource_types & request.resource_type))
+    return false;
+  if (request.specific_only && rule.domains.empty())
+    return false;
+  if ((rule.flags & RULE_THIRD_PARTY) && !request.third_party)
+    return false;
+  if ((rule.flags & RULE_FIRST_PARTY) && request.third_party)
+    return false;
+  if (!rule.domains.empty() &&
+      !MatchesDomain(request.first_party_host, rule.domains))
+    return false;
+  if (MatchesDomain(request.first_party_host, rule.excluded_domains))
+    return false;
+
+  base::StringPiece url = (rule.flags & RULE_MATCH_CASE)
+      ? request.spec : base::StringPiece(request.lower_spec);
+  bool end_anchored = (rule.flags & RULE_END_ANCHORED) != 0;
+
+  if (rule.flags & RULE_HOST_ANCHORED) {
+    for (size_t pos = request.host_begin; pos < request.host_end; ++pos) {
+      if ((pos == request.host_begin || url[pos - 1] == '.') &&
+          MatchPattern(rule.pattern, url, pos, true, end_anchored))
+        return true;
+    }
+    return false;
+  }
+
+  return MatchPattern(rule.pattern, url, 0,
+                      (rule.flags & RULE_START_ANCHORED) != 0, end_anchored);
+}
+
+const RequestFilter::Rule* RequestFilter::FindMatch(
+    const RuleIndex& index, const Request& request) const {
+  const std::string& url = request.lower_spec;
+  size_t begin = 0;
+  while (begin < url.size()) {
+    if (!IsKeywordChar(url[begin])) {
+      ++begin;
+      continue;
+    }
+    size_t end = begin;
+    while (end < url.size() && IsKeywordChar(url[end]))
+      ++end;
+
+    if (end - begin >= kMinKeywordLength) {
+      auto it = index.keywords.find(
+          base::StringPiece(url).substr(begin, end - begin));
+      if (it != index.keywords.end()) {
+        for (size_t i : it->second) {
+          if (RuleMatches(rules_[i], request))
+            return &rules_[i];
+        }
+      }
+    }
+    begin = end;
+  }
+
+  for (size_t i : index.generic) {
+    if (RuleMatches(rules_[i], request))
+      return &rules_[i];
+  }
+  return nullptr;
+}
+
+bool RequestFilter::ShouldBlock(const GURL& url,
+                                const GURL& first_party_url,
+                                content::ResourceType type) const {
+  // Like in Adblock Plus the rules don't apply to the pages themselves.
+  if (rules_.empty() || type == content::RESOURCE_TYPE_MAIN_FRAME ||
+      !(url.SchemeIsHTTPOrHTTPS() || url.SchemeIsWSOrWSS()))
+    return false;
+
+  Request request(url, first_party_url,
+                  url.SchemeIsWSOrWSS() ? TYPE_WEBSOCKET
+                                        : ResourceTypeToMask(type));
+
+  // The page exceptions are matched against the URL of the page.
+  if (first_party_url.is_valid() &&
+      (!page_exception_index_.generic.empty() ||
+       !page_exception_index_.keywords.empty())) {
+    Request page(first_party_url, first_party_url, TYPE_DOCUMENT);
+    if (FindMatch(page_exception_index_, page))
+      return false;
+    page.resource_type = TYPE_GENERICBLOCK;
+    request.specific_only = FindMatch(page_exception_index_, page) != nullptr;
+  }
+
+  if (FindMatch(important_index_, request))
+    return true;
+  return FindMatch(block_index_, request) &&
+         !FindMatch(exception_index_, request);
+}
+
+}  // namespace atom
@@ -0,0 +1,123 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_REQUEST_FILTER_H_
+#define ATOM_BROWSER_NET_REQUEST_FILTER_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/strings/string_piece.h"
+#include "content/public/common/resource_type.h"
+
+class GURL;
+
+namespace atom {
+
+// Decides on the IO thread whether a request should be blocked, from a list
+// of rules in the Adblock Plus filter syntax used by EasyList:
+//
+//   ||ads.example.com^$third-party
+//   /banner/*/img^$image,domain=example.org|~shop.example.org
+//   @@||example.com/ads.js$script
+//
+// Element hiding rules and regular expressions are skipped, as are the rules
+// which change the response instead of blocking it (csp, rewrite...). The
+// "$document" and "$genericblock" exceptions are matched against the URL of
+// the page, and the element hiding and popup options restrict a rule to
+// nothing the filter sees.
+//
+// Filters are immutable, so they can be shared with the IO thread and
+// replaced as a whole when the list is updated.
+class RequestFilter : public base::RefCountedThreadSafe<RequestFilter> {
+ public:
+  // Parse a filter list.
+  static scoped_refptr<RequestFilter> Parse(base::StringPiece list);
+
+  // Load a filter saved with Serialize(), returns null if |data| is not a
+  // valid filter.
+  static scoped_refptr<RequestFilter> Deserialize(base::StringPiece data);
+
+  // Save the parsed rules in a compact binary form, which is much faster to
+  // load than the original list.
+  std::string Serialize() const;
+
+  // Whether a request for |url| of type |type| made by a document of
+  // |first_party_url| is blocked.
+  bool ShouldBlock(const GURL& url,
+                   const GURL& first_party_url,
+                   content::ResourceType type) const;
+
+  size_t rule_count() const { return rules_.size(); }
+
+ private:
+  friend class base::RefCountedThreadSafe<RequestFilter>;
+
+  struct Rule {
+    Rule();
+    Rule(const Rule& other);
+    ~Rule();
+
+    // The URL pattern, lowercased unless the rule is case sensitive. "*"
+    // matches any string and "^" a separator or the end of the URL.
+    std::string pattern;
+    // Combination of the RuleFlags in request_filter.cc.
+    uint32_t flags;
+    // Combination of the ResourceTypeMasks in request_filter.cc.
+    uint32_t resource_types;
+    // The first party domains the rule is restricted to, and the ones it
+    // doesn't apply to.
+    std::vector<std::string> domains;
+    std::vector<std::string> excluded_domains;
+  };
+
+  // The rules indexed by a keyword of their pattern, which a URL must
+  // contain as a whole token to match them.
+  struct RuleIndex {
+    RuleIndex();
+    ~RuleIndex();
+
+    std::unordered_map<base::StringPiece, std::vector<size_t>,
+                       base::StringPieceHash> keywords;
+    // Rules without a usable keyword, tested against every URL.
+    std::vector<size_t> generic;
+  };
+
+  // The request being tested, with the lowercased URL and the values shared
+  // by all the rules.
+  struct Request;
+
+  RequestFilter();
+  ~RequestFilter();
+
+  // Add a line of a filter list, returns false if it isn't a supported
+  // blocking or exception rule.
+  bool AddRule(base::StringPiece line);
+  // Index the rules once they are all added.
+  void BuildIndex();
+  void AddToIndex(size_t rule, RuleIndex* index);
+  base::StringPiece GetKeyword(const Rule& rule,
+                               const RuleIndex& index) const;
+
+  const Rule* FindMatch(const RuleIndex& index, const Request& request) const;
+  bool RuleMatches(const Rule& rule, const Request& request) const;
+
+  std::vector<Rule> rules_;
+  // The "$important" blocking rules, which exceptions can't override, are
+  // kept apart from the others.
+  RuleIndex important_index_;
+  RuleIndex block_index_;
+  RuleIndex exception_index_;
+  // The "$document" and "$genericblock" exceptions.
+  RuleIndex page_exception_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(RequestFilter);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_REQUEST_FILTER_H_
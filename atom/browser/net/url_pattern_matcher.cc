@@ -0,0 +1,142 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/url_pattern_matcher.h"
+
+#include "base/strings/string_util.h"
+#include "url/gurl.h"
+
+namespace atom {
+
+namespace {
+
+// URLPattern ignores the trailing dot of fully qualified hosts.
+base::StringPiece TrimTrailingDot(base::StringPiece host) {
+  if (!host.empty() && host.back() == '.')
+    host.remove_suffix(1);
+  return host;
+}
+
+}  // namespace
+
+URLPatternMatcher::HostNode::HostNode() {}
+
+URLPatternMatcher::HostNode::HostNode(const HostNode& other) = default;
+
+URLPatternMatcher::HostNode::~HostNode() {}
+
+URLPatternMatcher::URLPatternMatcher() : nodes_(1) {}
+
+URLPatternMatcher::URLPatternMatcher(const URLPatterns& patterns)
+    : nodes_(1) {
+  for (const auto& pattern : patterns)
+    AddPattern(pattern);
+}
+
+URLPatternMatcher::URLPatternMatcher(const URLPatternMatcher& other) = default;
+
+URLPatternMatcher::~URLPatternMatcher() {}
+
+URLPatternMatcher& URLPatternMatcher::operator=(
+    const URLPatternMatcher& other) = default;
+
+void URLPatternMatcher::AddPattern(const URLPattern& pattern) {
+  CompiledPattern compiled = { pattern, std::string(), std::string() };
+  if (pattern.scheme() != "*")
+    compiled.scheme = pattern.scheme();
+
+  const std::string& path = pattern.path();
+  compiled.path_prefix = path.substr(0, path.find('*'));
+  // "/foo/*" also matches "/foo".
+  if (!compiled.path_prefix.empty() && compiled.path_prefix.back() == '/')
+    compiled.path_prefix.pop_back();
+
+  size_t index = patterns_.size();
+  patterns_.push_back(compiled);
+
+  if (pattern.match_all_urls()) {
+    nodes_[0].subdomains.push_back(index);
+    return;
+  }
+
+  std::string host = base::ToLowerASCII(TrimTrailingDot(pattern.host()));
+  size_t node = 0;
+  size_t end = host.size();
+  while (end > 0) {
+    size_t dot = host.rfind('.', end - 1);
+    size_t begin = dot == std::string::npos ? 0 : dot + 1;
+    std::string label = host.substr(begin, end - begin);
+    auto it = nodes_[node].children.find(label);
+    if (it == nodes_[node].children.end()) {
+      nodes_.push_back(HostNode());
+      it = nodes_[node].children.emplace(label, nodes_.size() - 1).first;
+    }
+    node = it->second;
+    end = dot == std::string::npos ? 0 : dot;
+  }
+
+  if (pattern.match_subdomains())
+    nodes_[node].subdomains.push_back(index);
+  else
+    nodes_[node].exact.push_back(index);
+}
+
+bool URLPatternMatcher::MatchesAny(const std::vector<size_t>& candidates,
+                                   const GURL& url,
+                                   base::StringPiece path) const {
+  for (size_t index : candidates) {
+    const CompiledPattern& compiled = patterns_[index];
+    if (!compiled.scheme.empty() && url.scheme_piece() != compiled.scheme)
+      continue;
+    if (!path.starts_with(compiled.path_prefix))
+      continue;
+    if (compiled.pattern.MatchesURL(url))
+      return true;
+  }
+  return false;
+}
+
+bool URLPatternMatcher::MatchesURL(const GURL& url) const {
+  if (patterns_.empty())
+    return true;
+
+  // Filesystem URLs are matched against their inner URL, which the index
+  // doesn't know about.
+  if (url.inner_url()) {
+    for (const auto& compiled : patterns_) {
+      if (compiled.pattern.MatchesURL(url))
+        return true;
+    }
+    return false;
+  }
+
+  const std::string path = url.PathForRequest();
+  if (MatchesAny(nodes_[0].subdomains, url, path))
+    return true;
+
+  std::string host = base::ToLowerASCII(TrimTrailingDot(url.host_piece()));
+  if (host.empty())
+    return MatchesAny(nodes_[0].exact, url, path);
+
+  size_t node = 0;
+  size_t end = host.size();
+  std::string label;
+  while (end > 0) {
+    size_t dot = host.rfind('.', end - 1);
+    size_t begin = dot == std::string::npos ? 0 : dot + 1;
+    label.assign(host, begin, end - begin);
+    auto it = nodes_[node].children.find(label);
+    if (it == nodes_[node].children.end())
+      return false;
+    node = it->second;
+    end = dot == std::string::npos ? 0 : dot;
+
+    if (MatchesAny(nodes_[node].subdomains, url, path))
+      return true;
+  }
+
+  return MatchesAny(nodes_[node].exact, url, path);
+}
+
+}  // namespace atom
@@ -0,0 +1,76 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_URL_PATTERN_MATCHER_H_
+#define ATOM_BROWSER_NET_URL_PATTERN_MATCHER_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/strings/string_piece.h"
+#include "extensions/common/url_pattern.h"
+
+class GURL;
+
+namespace atom {
+
+using URLPatterns = std::set<URLPattern>;
+
+// Matches URLs against a set of URLPatterns without testing every pattern.
+// The patterns are indexed by their host in a trie of reversed host labels,
+// so a URL is only tested against the patterns of its host and of the
+// domains above it, after a quick check of their scheme and path prefix.
+class URLPatternMatcher {
+ public:
+  URLPatternMatcher();
+  explicit URLPatternMatcher(const URLPatterns& patterns);
+  URLPatternMatcher(const URLPatternMatcher& other);
+  ~URLPatternMatcher();
+
+  URLPatternMatcher& operator=(const URLPatternMatcher& other);
+
+  // Returns true if |url| matches any of the patterns, or if there are none.
+  bool MatchesURL(const GURL& url) const;
+
+  bool empty() const { return patterns_.empty(); }
+
+ private:
+  struct CompiledPattern {
+    URLPattern pattern;
+    // The scheme the URL must have, empty when any valid scheme matches.
+    std::string scheme;
+    // Literal beginning of the path pattern, every matching path starts
+    // with it.
+    std::string path_prefix;
+  };
+
+  struct HostNode {
+    HostNode();
+    HostNode(const HostNode& other);
+    ~HostNode();
+
+    // Indices in |nodes_| keyed by the next host label, from the right.
+    std::map<std::string, size_t> children;
+    // Indices in |patterns_| of the patterns for exactly this host, and of
+    // the ones that also match all its subdomains.
+    std::vector<size_t> exact;
+    std::vector<size_t> subdomains;
+  };
+
+  void AddPattern(const URLPattern& pattern);
+  bool MatchesAny(const std::vector<size_t>& candidates,
+                  const GURL& url,
+                  base::StringPiece path) const;
+
+  std::vector<CompiledPattern> patterns_;
+  // |nodes_[0]| is the empty host, which holds the patterns matching any
+  // host.
+  std::vector<HostNode> nodes_;
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_URL_PATTERN_MATCHER_H_
@@ -0,0 +1,96 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/browser/net/web_request_stats.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "base/metrics/histogram.h"
+#include "base/strings/stringprintf.h"
+#include "base/values.h"
+
+namespace atom {
+
+namespace {
+
+const char* kStageNames[] = {
+  "dispatch",
+  "listener",
+  "return",
+  "extensions",
+  "total",
+};
+
+static_assert(arraysize(kStageNames) == WebRequestStats::STAGE_COUNT,
+              "kStageNames must name every stage");
+
+}  // namespace
+
+WebRequestStats::EventStats::EventStats() {
+  std::fill(std::begin(histograms), std::end(histograms), nullptr);
+}
+
+WebRequestStats::WebRequestStats() {}
+
+WebRequestStats::~WebRequestStats() {}
+
+void WebRequestStats::Record(const char* event,
+                             Stage stage,
+                             base::TimeDelta time) {
+  base::HistogramBase* histogram;
+  {
+    base::AutoLock auto_lock(lock_);
+    auto it = events_.find(event);
+    if (it == events_.end())
+      it = events_.emplace(event, EventStats()).first;
+    EventStats& event_stats = it->second;
+
+    StageStats& stats = event_stats.stages[stage];
+    ++stats.count;
+    stats.total += time;
+    stats.max = std::max(stats.max, time);
+
+    // the same parameters as UmaHistogramTimes
+    histogram = event_stats.histograms[stage];
+    if (!histogram) {
+      histogram = base::Histogram::FactoryTimeGet(
+          base::StringPrintf("WebRequest.%s.%s", event, kStageNames[stage]),
+          base::TimeDelta::FromMilliseconds(1),
+          base::TimeDelta::FromSeconds(10), 50,
+          base::HistogramBase::kUmaTargetedHistogramFlag);
+      event_stats.histograms[stage] = histogram;
+    }
+  }
+
+  histogram->AddTime(time);
+}
+
+std::unique_ptr<base::DictionaryValue> WebRequestStats::GetValue() const {
+  std::unique_ptr<base::DictionaryValue> value(new base::DictionaryValue);
+  base::AutoLock auto_lock(lock_);
+  for (const auto& event : events_) {
+    std::unique_ptr<base::DictionaryValue> stages(new base::DictionaryValue);
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+      const StageStats& stats = event.second.stages[i];
+      if (!stats.count)
+        continue;
+      std::unique_ptr<base::DictionaryValue> stage(new base::DictionaryValue);
+      stage->SetDouble("count", stats.count);
+      stage->SetDouble("average", stats.total.InMillisecondsF() / stats.count);
+      stage->SetDouble("max", stats.max.InMillisecondsF());
+      stages->Set(kStageNames[i], std::move(stage));
+    }
+    value->Set(event.first, std::move(stages));
+  }
+  return value;
+}
+
+void WebRequestStats::Reset() {
+  base::AutoLock auto_lock(lock_);
+  events_.clear();
+}
+
+}  // namespace atom
@@ -0,0 +1,82 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_BROWSER_NET_WEB_REQUEST_STATS_H_
+#define ATOM_BROWSER_NET_WEB_REQUEST_STATS_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+
+namespace base {
+class DictionaryValue;
+class HistogramBase;
+}
+
+namespace atom {
+
+// Latency added to requests by the webRequest listeners, for each event and
+// each stage of the delivery of an event. Stages can be recorded from any
+// thread, and are also reported to UMA as "WebRequest.<event>.<stage>".
+class WebRequestStats : public base::RefCountedThreadSafe<WebRequestStats> {
+ public:
+  enum Stage {
+    // From the IO thread to the UI thread.
+    STAGE_DISPATCH,
+    // The JS listener, until it calls back for the events that wait for it.
+    STAGE_LISTENER,
+    // From the UI thread back to the IO thread.
+    STAGE_RETURN,
+    // The extension handlers that run before the listener.
+    STAGE_EXTENSIONS,
+    // From the event to the request being resumed.
+    STAGE_TOTAL,
+    STAGE_COUNT,
+  };
+
+  WebRequestStats();
+
+  void Record(const char* event, Stage stage, base::TimeDelta time);
+
+  // Returns { <event>: { <stage>: { count, average, max } } }, with the times
+  // in milliseconds.
+  std::unique_ptr<base::DictionaryValue> GetValue() const;
+
+  void Reset();
+
+ private:
+  friend class base::RefCountedThreadSafe<WebRequestStats>;
+
+  struct StageStats {
+    StageStats() : count(0) {}
+    uint64_t count;
+    base::TimeDelta total;
+    base::TimeDelta max;
+  };
+
+  struct EventStats {
+    EventStats();
+    StageStats stages[STAGE_COUNT];
+    // The UMA histograms, looked up on the first record of each stage.
+    base::HistogramBase* histograms[STAGE_COUNT];
+  };
+
+  ~WebRequestStats();
+
+  mutable base::Lock lock_;
+  // Looked up by the event name without copying it.
+  std::map<std::string, EventStats, std::less<>> events_;
+
+  DISALLOW_COPY_AND_ASSIGN(WebRequestStats);
+};
+
+}  // namespace atom
+
+#endif  // ATOM_BROWSER_NET_WEB_REQUEST_STATS_H_
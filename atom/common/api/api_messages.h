@@ -4,6 +4,10 @@
 
 // Multiply-included file, no traditional include guard.
 
+#include <stdint.h>
+
+#include <vector>
+
 #include "base/strings/string16.h"
 #include "base/memory/shared_memory.h"
 #include "base/values.h"
@@ -25,23 +29,85 @@ IPC_SYNC_MESSAGE_ROUTED2_1(AtomViewHostMsg_Message_Sync,
                            base::ListValue /* arguments */,
                            base::string16 /* result (in JSON) */)
 
-IPC_MESSAGE_ROUTED2(AtomViewHostMsg_Message_Shared,
+// The arguments of the *_Shared messages are in a segment of |size| bytes
+// of a brave::SharedMemoryPool. Pooled segments have a non zero id, and are
+// acknowledged with a *_SharedMemoryReleased message once the receiver is
+// done with them.
+IPC_MESSAGE_ROUTED4(AtomViewHostMsg_Message_Shared,
+                    base::string16 /* channel */,
+                    base::SharedMemoryHandle /* arguments */,
+                    uint32_t /* segment id */,
+                    uint32_t /* size */)
+
+IPC_MESSAGE_ROUTED1(AtomViewHostMsg_SharedMemoryReleased,
+                    uint32_t /* segment id */)
+
+// The arguments (an array) and the result of the *_Serialized messages are
+// written by v8::ValueSerializer, see atom/common/v8_serialization.h. The
+// base::Value messages are still used for arguments which can't be cloned.
+IPC_MESSAGE_ROUTED2(AtomViewHostMsg_Message_Serialized,
+                    base::string16 /* channel */,
+                    std::vector<uint8_t> /* arguments */)
+
+IPC_SYNC_MESSAGE_ROUTED2_1(AtomViewHostMsg_Message_Serialized_Sync,
+                           base::string16 /* channel */,
+                           std::vector<uint8_t> /* arguments */,
+                           std::vector<uint8_t> /* result */)
+
+// Invoke the ipcMain handler of |channel|, which is answered with an
+// AtomViewMsg_InvokeReply of the same |request_id| unless it's cancelled
+// first. The arguments and the result are written by v8::ValueSerializer,
+// a failed invocation has its error message as the result.
+IPC_MESSAGE_ROUTED3(AtomViewHostMsg_Invoke,
+                    int /* request_id */,
                     base::string16 /* channel */,
-                    base::SharedMemoryHandle /* arguments */)
+                    std::vector<uint8_t> /* arguments */)
+
+IPC_MESSAGE_ROUTED1(AtomViewHostMsg_CancelInvoke,
+                    int /* request_id */)
+
+IPC_MESSAGE_ROUTED3(AtomViewMsg_InvokeReply,
+                    int /* request_id */,
+                    bool /* success */,
+                    std::vector<uint8_t> /* result */)
 
 IPC_MESSAGE_ROUTED2(AtomViewMsg_Message,
                     base::string16 /* channel */,
                     base::ListValue /* arguments */)
 
-IPC_MESSAGE_ROUTED2(AtomViewMsg_Message_Shared,
+IPC_MESSAGE_ROUTED2(AtomViewMsg_Message_Serialized,
+                    base::string16 /* channel */,
+                    std::vector<uint8_t> /* arguments */)
+
+IPC_MESSAGE_ROUTED4(AtomViewMsg_Message_Shared,
                     base::string16 /* channel */,
-                    base::SharedMemoryHandle /* arguments */)
+                    base::SharedMemoryHandle /* arguments */,
+                    uint32_t /* segment id */,
+                    uint32_t /* size */)
+
+IPC_MESSAGE_ROUTED1(AtomViewMsg_SharedMemoryReleased,
+                    uint32_t /* segment id */)
 
 // Update renderer process preferences.
 IPC_MESSAGE_CONTROL1(AtomMsg_UpdatePreferences, base::ListValue)
 
-// Update renderer content settings
-IPC_MESSAGE_CONTROL1(AtomMsg_UpdateContentSettings, base::DictionaryValue)
+// Replace renderer content settings with a snapshot, a pickled
+// base::DictionaryValue of |size| bytes in read-only shared memory.
+IPC_MESSAGE_CONTROL3(AtomMsg_SetContentSettings,
+                     base::SharedMemoryHandle /* snapshot */,
+                     uint32_t /* size */,
+                     uint64_t /* version */)
+
+// Update renderer content settings from |base_version| to |version|, see
+// atom/common/content_settings_delta.h
+IPC_MESSAGE_CONTROL3(AtomMsg_UpdateContentSettings,
+                     uint64_t /* base_version */,
+                     uint64_t /* version */,
+                     base::ListValue /* delta */)
+
+// Sent by a renderer which missed a content settings update to get a new
+// snapshot.
+IPC_MESSAGE_CONTROL0(AtomHostMsg_ResyncContentSettings)
 
 // Update renderer content settings
 IPC_MESSAGE_CONTROL1(AtomMsg_UpdateWebKitPrefs, content::WebPreferences)
@@ -4,11 +4,14 @@
 
 #include <stddef.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "atom_natives.h"  // NOLINT: This file is generated with coffee2c.
 
 #include "atom/common/asar/archive.h"
+#include "atom/common/asar/asar_util.h"
 #include "atom/common/native_mate_converters/callback.h"
 #include "atom/common/native_mate_converters/file_path_converter.h"
 #include "atom/common/node_includes.h"
@@ -19,14 +22,53 @@
 
 namespace {
 
+typedef base::Callback<void(v8::Local<v8::Value>)> ReadFileCallback;
+
+// A file read and decompressed on the libuv threadpool, which fs.readFile
+// also uses, so that it works in every process node runs in.
+struct ReadFileRequest {
+  uv_work_t req;
+  v8::Isolate* isolate;
+  v8::Global<v8::Context> context;
+  std::shared_ptr<asar::Archive> archive;
+  asar::Archive::FileInfo info;
+  std::string contents;
+  bool success;
+  ReadFileCallback callback;
+};
+
+void ReadFileWork(uv_work_t* req) {
+  ReadFileRequest* request = static_cast<ReadFileRequest*>(req->data);
+  request->success =
+      request->archive->ReadFile(request->info, &request->contents);
+}
+
+void ReadFileDone(uv_work_t* req, int status) {
+  std::unique_ptr<ReadFileRequest> request(
+      static_cast<ReadFileRequest*>(req->data));
+  v8::Isolate* isolate = request->isolate;
+  v8::HandleScope handle_scope(isolate);
+  v8::Context::Scope context_scope(request->context.Get(isolate));
+  if (!request->success) {
+    request->callback.Run(v8::False(isolate));
+    return;
+  }
+  request->callback.Run(node::Buffer::Copy(isolate, request->contents.data(),
+                                           request->contents.size())
+                            .ToLocalChecked());
+}
+
 class Archive : public mate::Wrappable<Archive> {
  public:
   static v8::Local<v8::Value> Create(v8::Isolate* isolate,
                                       const base::FilePath& path) {
-    std::unique_ptr<asar::Archive> archive(new asar::Archive(path));
-    if (!archive->Init())
+    // Share the archive with the native readers, so the header is only
+    // loaded once per process and extracted files are reused.
+    std::shared_ptr<asar::Archive> archive =
+        asar::GetOrCreateAsarArchive(path);
+    if (!archive)
       return v8::False(isolate);
-    return (new Archive(isolate, std::move(archive)))->GetWrapper();
+    return (new Archive(isolate, archive))->GetWrapper();
   }
 
   static void BuildPrototype(
@@ -38,14 +80,15 @@ class Archive : public mate::Wrappable<Archive> {
         .SetMethod("stat", &Archive::Stat)
         .SetMethod("readdir", &Archive::Readdir)
         .SetMethod("realpath", &Archive::Realpath)
+        .SetMethod("readFile", &Archive::ReadFile)
         .SetMethod("copyFileOut", &Archive::CopyFileOut)
         .SetMethod("getFd", &Archive::GetFD)
         .SetMethod("destroy", &Archive::Destroy);
   }
 
  protected:
-  Archive(v8::Isolate* isolate, std::unique_ptr<asar::Archive> archive)
-      : archive_(std::move(archive)) {
+  Archive(v8::Isolate* isolate, std::shared_ptr<asar::Archive> archive)
+      : archive_(archive) {
     Init(isolate);
   }
 
@@ -64,6 +107,7 @@ class Archive : public mate::Wrappable<Archive> {
     dict.Set("size", info.size);
     dict.Set("unpacked", info.unpacked);
     dict.Set("offset", info.offset);
+    dict.Set("compressed", info.compression != asar::Archive::COMPRESSION_NONE);
     return dict.GetHandle();
   }
 
@@ -100,6 +144,42 @@ class Archive : public mate::Wrappable<Archive> {
     return mate::ConvertToV8(isolate, realpath);
   }
 
+  // Reads the whole file into a Buffer, decompressing it if needed. With a
+  // callback the file is read on the threadpool and the Buffer, or false, is
+  // passed to the callback.
+  v8::Local<v8::Value> ReadFile(v8::Isolate* isolate,
+                                const base::FilePath& path,
+                                mate::Arguments* args) {
+    asar::Archive::FileInfo info;
+    bool found = archive_ && archive_->GetFileInfo(path, &info);
+
+    ReadFileCallback callback;
+    if (args->GetNext(&callback)) {
+      if (!found) {
+        callback.Run(v8::False(isolate));
+        return v8::Undefined(isolate);
+      }
+      ReadFileRequest* request = new ReadFileRequest;
+      request->req.data = request;
+      request->isolate = isolate;
+      request->context.Reset(isolate, isolate->GetCurrentContext());
+      request->archive = archive_;
+      request->info = info;
+      request->success = false;
+      request->callback = callback;
+      node::Environment* env = node::Environment::GetCurrent(isolate);
+      uv_queue_work(env->event_loop(), &request->req,
+                    &ReadFileWork, &ReadFileDone);
+      return v8::Undefined(isolate);
+    }
+
+    std::string contents;
+    if (!found || !archive_->ReadFile(info, &contents))
+      return v8::False(isolate);
+    return node::Buffer::Copy(isolate, contents.data(), contents.size())
+        .ToLocalChecked();
+  }
+
   // Copy the file out into a temporary file and returns the new path.
   v8::Local<v8::Value> CopyFileOut(v8::Isolate* isolate,
                                     const base::FilePath& path) {
@@ -122,11 +202,29 @@ class Archive : public mate::Wrappable<Archive> {
   }
 
  private:
-  std::unique_ptr<asar::Archive> archive_;
+  std::shared_ptr<asar::Archive> archive_;
 
   DISALLOW_COPY_AND_ASSIGN(Archive);
 };
 
+// Returns the counters of the archive shared by all readers in the process,
+// or false when the archive isn't open.
+v8::Local<v8::Value> GetArchiveMetrics(v8::Isolate* isolate,
+                                       const base::FilePath& path) {
+  std::shared_ptr<asar::Archive> archive = asar::GetOpenAsarArchive(path);
+  if (!archive)
+    return v8::False(isolate);
+  asar::Archive::Metrics metrics = archive->GetMetrics();
+  mate::Dictionary dict(isolate, v8::Object::New(isolate));
+  dict.Set("reads", metrics.reads);
+  dict.Set("bytesRead", metrics.bytes_read);
+  dict.Set("mappedReads", metrics.mapped_reads);
+  dict.Set("extractions", metrics.extractions);
+  dict.Set("extractionCacheHits", metrics.extraction_cache_hits);
+  dict.Set("extractionBytesSaved", metrics.extraction_bytes_saved);
+  return dict.GetHandle();
+}
+
 void InitAsarSupport(v8::Isolate* isolate,
                      v8::Local<v8::Value> process,
                      v8::Local<v8::Value> require) {
@@ -157,6 +255,7 @@ void Initialize(v8::Local<v8::Object> exports, v8::Local<v8::Value> unused,
                 v8::Local<v8::Context> context, void* priv) {
   mate::Dictionary dict(context->GetIsolate(), exports);
   dict.SetMethod("createArchive", &Archive::Create);
+  dict.SetMethod("getArchiveMetrics", &GetArchiveMetrics);
   dict.SetMethod("initAsarSupport", &InitAsarSupport);
 }
 
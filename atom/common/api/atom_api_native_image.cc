@@ -13,13 +13,15 @@
 #include "atom/common/native_mate_converters/file_path_converter.h"
 #include "atom/common/native_mate_converters/gfx_converter.h"
 #include "atom/common/native_mate_converters/gurl_converter.h"
-#include "base/base64.h"
 #include "base/files/file_util.h"
 #include "base/strings/pattern.h"
 #include "base/strings/string_util.h"
+#include "base/task_scheduler/post_task.h"
+#include "base/threading/thread_task_runner_handle.h"
 #include "native_mate/dictionary.h"
 #include "native_mate/object_template_builder.h"
 #include "net/base/data_url.h"
+#include "third_party/modp_b64/modp_b64.h"
 #include "third_party/skia/include/core/SkPixelRef.h"
 #include "ui/base/layout.h"
 #include "ui/gfx/codec/jpeg_codec.h"
@@ -180,19 +182,70 @@ bool ReadImageSkiaFromICO(gfx::ImageSkia* image, HICON icon) {
 }
 #endif
 
-void Noop(char*, void*) {
+void ReleasePixelRef(char*, void* hint) {
+  static_cast<SkPixelRef*>(hint)->unref();
 }
 
+void ReleaseMemory(char*, void* hint) {
+  static_cast<base::RefCountedMemory*>(hint)->Release();
+}
+
+SkBitmap Get1xBitmap(const gfx::Image& image) {
+  if (image.IsEmpty())
+    return SkBitmap();
+  return *image.ToSkBitmap();
+}
+
+scoped_refptr<base::RefCountedMemory> EncodePNG(const SkBitmap& bitmap) {
+  std::vector<unsigned char> output;
+  if (!bitmap.isNull())
+    gfx::PNGCodec::EncodeBGRASkBitmap(bitmap, false, &output);
+  return base::RefCountedBytes::TakeVector(&output);
+}
+
+scoped_refptr<base::RefCountedMemory> EncodeJPEG(const SkBitmap& bitmap,
+                                                 int quality) {
+  std::vector<unsigned char> output;
+  if (!bitmap.isNull())
+    gfx::JPEGCodec::Encode(bitmap, quality, &output);
+  return base::RefCountedBytes::TakeVector(&output);
+}
+
+std::string PNGToDataURL(const base::RefCountedMemory& png) {
+  static const char kPrefix[] = "data:image/png;base64,";
+  const size_t prefix_length = arraysize(kPrefix) - 1;
+
+  // base64 encode straight after the prefix
+  std::string data_url(kPrefix);
+  data_url.resize(prefix_length + modp_b64_encode_len(png.size()));
+  size_t length = modp_b64_encode(&data_url[prefix_length],
+                                  png.front_as<char>(), png.size());
+  data_url.resize(prefix_length + length);
+  return data_url;
+}
+
+std::string EncodeDataURL(const SkBitmap& bitmap) {
+  return PNGToDataURL(*EncodePNG(bitmap));
+}
+
+std::string PNGBytesToDataURL(scoped_refptr<base::RefCountedMemory> png) {
+  return PNGToDataURL(*png);
+}
+
+const base::TaskTraits kEncodeTaskTraits = {
+    base::TaskPriority::USER_VISIBLE,
+    base::TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN};
+
 }  // namespace
 
 NativeImage::NativeImage(v8::Isolate* isolate, const gfx::Image& image)
-    : image_(image) {
+    : image_(image), pixels_shared_(false) {
   Init(isolate);
 }
 
 #if defined(OS_WIN)
 NativeImage::NativeImage(v8::Isolate* isolate, const base::FilePath& hicon_path)
-    : hicon_path_(hicon_path) {
+    : hicon_path_(hicon_path), pixels_shared_(false) {
   // Use the 256x256 icon as fallback icon.
   gfx::ImageSkia image_skia;
   ReadImageSkiaFromICO(&image_skia, GetHICON(256));
@@ -224,10 +277,14 @@ HICON NativeImage::GetHICON(int size) {
 #endif
 
 v8::Local<v8::Value> NativeImage::ToPNG(v8::Isolate* isolate) {
-  scoped_refptr<base::RefCountedMemory> png = image_.As1xPNGBytes();
-  return node::Buffer::Copy(isolate,
-                            reinterpret_cast<const char*>(png->front()),
-                            static_cast<size_t>(png->size())).ToLocalChecked();
+  // the encoded representation of the image can't be handed out
+  if (image_.HasRepresentation(gfx::Image::kImageRepPNG)) {
+    scoped_refptr<base::RefCountedMemory> png = image_.As1xPNGBytes();
+    return node::Buffer::Copy(isolate,
+                              png->front_as<char>(),
+                              png->size()).ToLocalChecked();
+  }
+  return mate::ConvertToV8(isolate, EncodePNG(Get1xBitmap(image_)));
 }
 
 v8::Local<v8::Value> NativeImage::ToBitmap(v8::Isolate* isolate) {
@@ -241,29 +298,76 @@ v8::Local<v8::Value> NativeImage::ToBitmap(v8::Isolate* isolate) {
 v8::Local<v8::Value> NativeImage::ToJPEG(v8::Isolate* isolate, int quality) {
   std::vector<unsigned char> output;
   gfx::JPEG1xEncodedDataFromImage(image_, quality, &output);
-  return node::Buffer::Copy(
-      isolate,
-      reinterpret_cast<const char*>(&output.front()),
-      static_cast<size_t>(output.size())).ToLocalChecked();
+  return mate::ConvertToV8(isolate,
+      scoped_refptr<base::RefCountedMemory>(
+          base::RefCountedBytes::TakeVector(&output)));
 }
 
 std::string NativeImage::ToDataURL() {
-  scoped_refptr<base::RefCountedMemory> png = image_.As1xPNGBytes();
-  std::string data_url;
-  data_url.insert(data_url.end(), png->front(), png->front() + png->size());
-  base::Base64Encode(data_url, &data_url);
-  data_url.insert(0, "data:image/png;base64,");
-  return data_url;
+  return PNGToDataURL(*image_.As1xPNGBytes());
 }
 
 v8::Local<v8::Value> NativeImage::GetBitmap(v8::Isolate* isolate) {
   const SkBitmap* bitmap = image_.ToSkBitmap();
   SkPixelRef* ref = bitmap->pixelRef();
+  if (!ref)
+    return node::Buffer::New(isolate, 0).ToLocalChecked();
+
+  // the buffer keeps the pixels alive after the image is gone, and may be
+  // written to while they are encoded on another thread
+  pixels_shared_ = true;
+  ref->ref();
   return node::Buffer::New(isolate,
                            reinterpret_cast<char*>(ref->pixels()),
                            bitmap->computeByteSize(),
-                           &Noop,
-                           nullptr).ToLocalChecked();
+                           &ReleasePixelRef,
+                           ref).ToLocalChecked();
+}
+
+SkBitmap NativeImage::GetBitmapToEncode() const {
+  SkBitmap bitmap = Get1xBitmap(image_);
+  if (!pixels_shared_ || bitmap.isNull())
+    return bitmap;
+
+  SkBitmap copy;
+  if (!copy.tryAllocPixels(bitmap.info()) ||
+      !bitmap.readPixels(copy.info(), copy.getPixels(), copy.rowBytes(), 0, 0))
+    return SkBitmap();
+  return copy;
+}
+
+void NativeImage::ToPNGAsync(const EncodeCallback& callback) {
+  // the PNG the image was created from is copied rather than encoded again,
+  // like by toPNG(), as the encoded representation can't be handed out
+  if (image_.HasRepresentation(gfx::Image::kImageRepPNG)) {
+    scoped_refptr<base::RefCountedMemory> png = image_.As1xPNGBytes();
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE,
+        base::Bind(callback, base::MakeRefCounted<base::RefCountedBytes>(
+                                 png->front(), png->size())));
+    return;
+  }
+  base::PostTaskWithTraitsAndReplyWithResult(
+      FROM_HERE, kEncodeTaskTraits,
+      base::Bind(&EncodePNG, GetBitmapToEncode()), callback);
+}
+
+void NativeImage::ToJPEGAsync(int quality, const EncodeCallback& callback) {
+  base::PostTaskWithTraitsAndReplyWithResult(
+      FROM_HERE, kEncodeTaskTraits,
+      base::Bind(&EncodeJPEG, GetBitmapToEncode(), quality), callback);
+}
+
+void NativeImage::ToDataURLAsync(const DataURLCallback& callback) {
+  if (image_.HasRepresentation(gfx::Image::kImageRepPNG)) {
+    base::PostTaskWithTraitsAndReplyWithResult(
+        FROM_HERE, kEncodeTaskTraits,
+        base::Bind(&PNGBytesToDataURL, image_.As1xPNGBytes()), callback);
+    return;
+  }
+  base::PostTaskWithTraitsAndReplyWithResult(
+      FROM_HERE, kEncodeTaskTraits,
+      base::Bind(&EncodeDataURL, GetBitmapToEncode()), callback);
 }
 
 v8::Local<v8::Value> NativeImage::GetNativeHandle(v8::Isolate* isolate,
@@ -384,6 +488,9 @@ void NativeImage::BuildPrototype(
       .SetMethod("getBitmap", &NativeImage::GetBitmap)
       .SetMethod("getNativeHandle", &NativeImage::GetNativeHandle)
       .SetMethod("toDataURL", &NativeImage::ToDataURL)
+      .SetMethod("toPNGAsync", &NativeImage::ToPNGAsync)
+      .SetMethod("toJPEGAsync", &NativeImage::ToJPEGAsync)
+      .SetMethod("toDataURLAsync", &NativeImage::ToDataURLAsync)
       .SetMethod("isEmpty", &NativeImage::IsEmpty)
       .SetMethod("getSize", &NativeImage::GetSize)
       .SetMethod("setTemplateImage", &NativeImage::SetTemplateImage)
@@ -399,6 +506,23 @@ void NativeImage::BuildPrototype(
 
 namespace mate {
 
+// static
+v8::Local<v8::Value> Converter<scoped_refptr<base::RefCountedMemory>>::ToV8(
+    v8::Isolate* isolate,
+    const scoped_refptr<base::RefCountedMemory>& val) {
+  if (!val || !val->size())
+    return node::Buffer::New(isolate, 0).ToLocalChecked();
+
+  // released by the buffer when it is collected
+  base::RefCountedMemory* memory = val.get();
+  memory->AddRef();
+  return node::Buffer::New(isolate,
+                           const_cast<char*>(memory->front_as<char>()),
+                           memory->size(),
+                           &atom::api::ReleaseMemory,
+                           memory).ToLocalChecked();
+}
+
 v8::Local<v8::Value> Converter<mate::Handle<atom::api::NativeImage>>::ToV8(
     v8::Isolate* isolate,
     const mate::Handle<atom::api::NativeImage>& val) {
@@ -8,6 +8,8 @@
 #include <map>
 #include <string>
 
+#include "base/callback_forward.h"
+#include "base/memory/ref_counted_memory.h"
 #include "native_mate/handle.h"
 #include "native_mate/wrappable.h"
 #include "ui/gfx/image/image.h"
@@ -18,6 +20,7 @@
 #endif
 
 class GURL;
+class SkBitmap;
 
 namespace base {
 class FilePath;
@@ -37,6 +40,10 @@ namespace api {
 
 class NativeImage : public mate::Wrappable<NativeImage> {
  public:
+  using EncodeCallback =
+      base::Callback<void(scoped_refptr<base::RefCountedMemory>)>;
+  using DataURLCallback = base::Callback<void(const std::string&)>;
+
   static mate::Handle<NativeImage> CreateEmpty(v8::Isolate* isolate);
   static mate::Handle<NativeImage> Create(
       v8::Isolate* isolate, const gfx::Image& image);
@@ -72,6 +79,10 @@ class NativeImage : public mate::Wrappable<NativeImage> {
   v8::Local<v8::Value> ToJPEG(v8::Isolate* isolate, int quality);
   v8::Local<v8::Value> ToBitmap(v8::Isolate* isolate);
   v8::Local<v8::Value> GetBitmap(v8::Isolate* isolate);
+  // Encode a copy of the 1x bitmap on the task scheduler.
+  void ToPNGAsync(const EncodeCallback& callback);
+  void ToJPEGAsync(int quality, const EncodeCallback& callback);
+  void ToDataURLAsync(const DataURLCallback& callback);
   v8::Local<v8::Value> GetNativeHandle(
     v8::Isolate* isolate,
     mate::Arguments* args);
@@ -89,7 +100,13 @@ class NativeImage : public mate::Wrappable<NativeImage> {
   std::map<int, base::win::ScopedHICON> hicons_;
 #endif
 
+  // Returns the 1x bitmap to encode on another thread, which is a copy of
+  // the pixels once getBitmap() has handed them out to JS.
+  SkBitmap GetBitmapToEncode() const;
+
   gfx::Image image_;
+  // Set once getBitmap() returned a Buffer over the pixels.
+  bool pixels_shared_;
 
   DISALLOW_COPY_AND_ASSIGN(NativeImage);
 };
@@ -100,6 +117,15 @@ class NativeImage : public mate::Wrappable<NativeImage> {
 
 namespace mate {
 
+// Wraps the memory in a Buffer which keeps a reference to it instead of
+// copying it, so it must not be modified by anyone else.
+template<>
+struct Converter<scoped_refptr<base::RefCountedMemory>> {
+  static v8::Local<v8::Value> ToV8(
+      v8::Isolate* isolate,
+      const scoped_refptr<base::RefCountedMemory>& val);
+};
+
 // A custom converter that allows converting path to NativeImage.
 template<>
 struct Converter<mate::Handle<atom::api::NativeImage>> {
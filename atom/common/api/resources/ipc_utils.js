@@ -19,7 +19,22 @@ if (!ipcRenderer) {
   ipcRenderer.sendSync = function () {
     var args
     args = 1 <= arguments.length ? $Array.slice(arguments, 0) : []
-    return $JSON.parse(ipc.sendSync('ipc-message-sync', $Array.slice(args)))
+    return ipc.sendSync('ipc-message-sync', $Array.slice(args))
+  }
+
+  // Resolves with the result of the ipcMain handler of the channel. The
+  // promise has a cancel() method, which rejects it.
+  ipcRenderer.invoke = function () {
+    var args
+    args = 1 <= arguments.length ? $Array.slice(arguments, 0) : []
+    return invoke(args, 0)
+  }
+
+  // Like invoke, but rejects if there is no result after |timeout| ms.
+  ipcRenderer.invokeWithTimeout = function (timeout) {
+    var args
+    args = 2 <= arguments.length ? $Array.slice(arguments, 1) : []
+    return invoke(args, timeout)
   }
 
   ipcRenderer.sendToHost = function () {
@@ -37,6 +52,32 @@ if (!ipcRenderer) {
   atom.v8.setHiddenValue('ipc', ipcRenderer)
 }
 
+// The callbacks of the pending invocations, by request id.
+var pendingInvokes = {}
+
+function invoke(args, timeout) {
+  var requestId = 0
+  var promise = new Promise(function (resolve, reject) {
+    requestId = ipc.invoke(args[0], $Array.slice(args, 1), timeout)
+    pendingInvokes[requestId] = { resolve: resolve, reject: reject }
+  })
+  promise.cancel = function () {
+    ipc.cancelInvoke(requestId)
+  }
+  return promise
+}
+
+function settleInvoke(requestId, success, value) {
+  var pending = pendingInvokes[requestId]
+  if (!pending)
+    return
+  delete pendingInvokes[requestId]
+  if (success)
+    pending.resolve(value)
+  else
+    pending.reject(value)
+}
+
 function guid() {
   function s4() {
     return Math.floor((1 + Math.random()) * 0x10000)
@@ -56,6 +97,9 @@ exports.$set('once', ipcRenderer.once.bind(ipcRenderer))
 exports.$set('send', ipcRenderer.send.bind(ipcRenderer))
 exports.$set('sendSync', ipcRenderer.sendSync.bind(ipcRenderer))
 exports.$set('sendShared', ipcRenderer.sendShared.bind(ipcRenderer))
+exports.$set('invoke', ipcRenderer.invoke.bind(ipcRenderer))
+exports.$set('invokeWithTimeout', ipcRenderer.invokeWithTimeout.bind(ipcRenderer))
 exports.$set('sendToHost', ipcRenderer.sendToHost.bind(ipcRenderer))
 exports.$set('emit', ipcRenderer.emit.bind(ipcRenderer))
+exports.$set('settleInvoke', settleInvoke)
 
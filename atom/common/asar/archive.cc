@@ -4,19 +4,29 @@
 
 #include "atom/common/asar/archive.h"
 
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "atom/common/asar/extraction_cache.h"
 #include "atom/common/asar/scoped_temporary_file.h"
 #include "base/files/file.h"
 #include "base/files/file_util.h"
+#include "base/files/memory_mapped_file.h"
 #include "base/json/json_reader.h"
 #include "base/logging.h"
 #include "base/pickle.h"
+#include "base/sha1.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/task_scheduler/post_task.h"
 #include "base/values.h"
+#include "build/build_config.h"
+#include "third_party/brotli/include/brotli/decode.h"
+#include "third_party/zlib/zlib.h"
 
 #if defined(OS_WIN)
 #include <io.h>
@@ -34,84 +44,113 @@ const char kSeparators[] = "\\/";
 const char kSeparators[] = "/";
 #endif
 
-bool GetNodeFromPath(std::string path,
-                     const base::DictionaryValue* root,
-                     const base::DictionaryValue** out);
-
-// Gets the "files" from "dir".
-bool GetFilesNode(const base::DictionaryValue* root,
-                  const base::DictionaryValue* dir,
-                  const base::DictionaryValue** out) {
-  // Test for symbol linked directory.
-  std::string link;
-  if (dir->GetStringWithoutPathExpansion("link", &link)) {
-    const base::DictionaryValue* linked_node = nullptr;
-    if (!GetNodeFromPath(link, root, &linked_node))
-      return false;
-    dir = linked_node;
-  }
-
-  return dir->GetDictionaryWithoutPathExpansion("files", out);
+// Links are resolved at most this many times for a single lookup, which
+// protects against cycles in malformed headers.
+const int kMaxLinkDepth = 32;
+
+// Values are shared with tools/asar_index.py.
+enum EntryFlags {
+  ENTRY_DIRECTORY = 1 << 0,
+  ENTRY_LINK = 1 << 1,
+  ENTRY_UNPACKED = 1 << 2,
+  ENTRY_EXECUTABLE = 1 << 3,
+  // The header has no valid size or offset for the file.
+  ENTRY_INVALID = 1 << 4,
+  ENTRY_DEFLATE = 1 << 5,
+  ENTRY_BROTLI = 1 << 6,
+};
+
+// The precompiled index generated by tools/asar_index.py is stored next to the
+// archive, all integers are little-endian:
+//   char     magic[8]        "ASARIDX3"
+//   uint32_t header_size     size of the archive header including its prefix
+//   uint8_t  hash[20]        SHA-1 of the archive header pickle
+//   uint32_t entry_count
+//   uint32_t names_size
+//   Entry    entries[entry_count]
+//   char     names[names_size]
+const base::FilePath::CharType kIndexExtension[] = FILE_PATH_LITERAL(".index");
+const char kIndexMagic[] = "ASARIDX3";
+const size_t kIndexMagicSize = sizeof(kIndexMagic) - 1;
+const size_t kIndexHashOffset = kIndexMagicSize + sizeof(uint32_t);
+const size_t kIndexEntryCountOffset = kIndexHashOffset + base::kSHA1Length;
+const size_t kIndexNamesSizeOffset = kIndexEntryCountOffset + sizeof(uint32_t);
+const size_t kIndexPrefixSize = kIndexNamesSizeOffset + sizeof(uint32_t);
+
+uint32_t ReadIndexUInt32(const std::string& data, size_t offset) {
+  uint32_t value;
+  memcpy(&value, data.data() + offset, sizeof(value));
+  return value;
 }
 
-// Gets sub-file "name" from "dir".
-bool GetChildNode(const base::DictionaryValue* root,
-                  const std::string& name,
-                  const base::DictionaryValue* dir,
-                  const base::DictionaryValue** out) {
-  if (name == "") {
-    *out = root;
-    return true;
-  }
+bool InflateZlib(const char* data, size_t size, std::string* contents) {
+  z_stream stream = {};
+  if (inflateInit(&stream) != Z_OK)
+    return false;
 
-  const base::DictionaryValue* files = nullptr;
-  return GetFilesNode(root, dir, &files) &&
-         files->GetDictionaryWithoutPathExpansion(name, out);
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef*>(&(*contents)[0]);
+  stream.avail_out = contents->size();
+  int rv = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  return rv == Z_STREAM_END && stream.total_out == contents->size();
 }
 
-// Gets the node of "path" from "root".
-bool GetNodeFromPath(std::string path,
-                     const base::DictionaryValue* root,
-                     const base::DictionaryValue** out) {
-  if (path == "") {
-    *out = root;
-    return true;
-  }
-
-  const base::DictionaryValue* dir = root;
-  for (size_t delimiter_position = path.find_first_of(kSeparators);
-       delimiter_position != std::string::npos;
-       delimiter_position = path.find_first_of(kSeparators)) {
-    const base::DictionaryValue* child = nullptr;
-    if (!GetChildNode(root, path.substr(0, delimiter_position), dir, &child))
-      return false;
-
-    dir = child;
-    path.erase(0, delimiter_position + 1);
-  }
-
-  return GetChildNode(root, path, dir, out);
+bool DecompressBrotli(const char* data, size_t size, std::string* contents) {
+  size_t decoded_size = contents->size();
+  BrotliDecoderResult rv = BrotliDecoderDecompress(
+      size, reinterpret_cast<const uint8_t*>(data), &decoded_size,
+      reinterpret_cast<uint8_t*>(&(*contents)[0]));
+  return rv == BROTLI_DECODER_RESULT_SUCCESS &&
+      decoded_size == contents->size();
 }
 
-bool FillFileInfoWithNode(Archive::FileInfo* info,
-                          uint32_t header_size,
-                          const base::DictionaryValue* node) {
-  int size;
-  if (!node->GetInteger("size", &size))
+// Reads the size, offset and flags of a file node.
+bool ReadFileNode(const base::DictionaryValue& node,
+                  uint32_t header_size,
+                  uint32_t* flags,
+                  uint32_t* size,
+                  uint64_t* offset,
+                  uint32_t* compressed_size) {
+  int size_value;
+  if (!node.GetInteger("size", &size_value) || size_value < 0)
     return false;
-  info->size = static_cast<uint32_t>(size);
+  *size = static_cast<uint32_t>(size_value);
 
-  if (node->GetBoolean("unpacked", &info->unpacked) && info->unpacked)
+  bool unpacked = false;
+  if (node.GetBoolean("unpacked", &unpacked) && unpacked) {
+    *flags |= ENTRY_UNPACKED;
     return true;
+  }
 
-  std::string offset;
-  if (!node->GetString("offset", &offset))
+  std::string offset_value;
+  if (!node.GetString("offset", &offset_value))
     return false;
-  if (!base::StringToUint64(offset, &info->offset))
+  if (!base::StringToUint64(offset_value, offset) ||
+      *offset > std::numeric_limits<uint64_t>::max() - header_size)
     return false;
-  info->offset += header_size;
+  *offset += header_size;
+
+  bool executable = false;
+  if (node.GetBoolean("executable", &executable) && executable)
+    *flags |= ENTRY_EXECUTABLE;
+
+  std::string compression;
+  if (node.GetString("compression", &compression)) {
+    if (compression == "deflate")
+      *flags |= ENTRY_DEFLATE;
+    else if (compression == "brotli")
+      *flags |= ENTRY_BROTLI;
+    else
+      return false;
 
-  node->GetBoolean("executable", &info->executable);
+    int compressed_size_value;
+    if (!node.GetInteger("compressedSize", &compressed_size_value) ||
+        compressed_size_value < 0)
+      return false;
+    *compressed_size = static_cast<uint32_t>(compressed_size_value);
+  }
 
   return true;
 }
@@ -119,7 +158,15 @@ bool FillFileInfoWithNode(Archive::FileInfo* info,
 }  // namespace
 
 Archive::Archive(const base::FilePath& path)
-    : path_(path), file_(base::File::FILE_OK), header_size_(0) {
+    : path_(path),
+      file_(base::File::FILE_OK),
+      header_size_(0),
+      reads_(0),
+      bytes_read_(0),
+      mapped_reads_(0),
+      extractions_(0),
+      extraction_cache_hits_(0),
+      extraction_bytes_saved_(0) {
   base::ThreadRestrictions::ScopedAllowIO allow_io;
   file_.Initialize(path_, base::File::FLAG_OPEN | base::File::FLAG_READ);
 #if defined(OS_WIN)
@@ -183,6 +230,23 @@ bool Archive::Init() {
     return false;
   }
 
+  header_size_ = 8 + size;
+
+  std::string header_hash(base::kSHA1Length, '\0');
+  base::SHA1HashBytes(reinterpret_cast<const unsigned char*>(buf.data()),
+                      buf.size(),
+                      reinterpret_cast<unsigned char*>(&header_hash[0]));
+  base::File::Info file_info;
+  {
+    base::ThreadRestrictions::ScopedAllowIO allow_io;
+    file_.GetInfo(&file_info);
+  }
+  archive_key_ = base::HexEncode(header_hash.data(), header_hash.size()) +
+      "-" + base::Int64ToString(file_info.last_modified.ToJavaTime());
+
+  if (LoadIndex(header_hash))
+    return true;
+
   std::string header;
   if (!base::PickleIterator(base::Pickle(buf.data(), buf.size())).ReadString(
         &header)) {
@@ -198,92 +262,211 @@ bool Archive::Init() {
     return false;
   }
 
-  header_size_ = 8 + size;
-  header_.reset(static_cast<base::DictionaryValue*>(value.release()));
+  BuildIndex(*static_cast<base::DictionaryValue*>(value.get()));
   return true;
 }
 
-bool Archive::GetFileInfo(const base::FilePath& path, FileInfo* info) {
-  if (!header_)
+bool Archive::MapFile() {
+  if (mapped_file_)
+    return true;
+  if (entries_.empty())
     return false;
 
-  const base::DictionaryValue* node;
-  if (!GetNodeFromPath(path.AsUTF8Unsafe(), header_.get(), &node))
+  base::ThreadRestrictions::ScopedAllowIO allow_io;
+  // map the file the header was read from, the path may point to another
+  // archive by now
+  base::File file = file_.Duplicate();
+  std::unique_ptr<base::MemoryMappedFile> mapped_file(
+      new base::MemoryMappedFile);
+  if (!file.IsValid() || !mapped_file->Initialize(std::move(file))) {
+    LOG(WARNING) << "Failed to map " << path_.value();
     return false;
+  }
 
-  std::string link;
-  if (node->GetString("link", &link))
-    return GetFileInfo(base::FilePath::FromUTF8Unsafe(link), info);
+  // reading the mapping past the end of the file raises SIGBUS instead of
+  // failing, so a truncated archive is read from the file
+  if (mapped_file->length() < GetDataEnd()) {
+    LOG(WARNING) << "Not mapping truncated archive " << path_.value();
+    return false;
+  }
 
-  return FillFileInfoWithNode(info, header_size_, node);
+  mapped_file_ = std::move(mapped_file);
+  return true;
 }
 
-bool Archive::Stat(const base::FilePath& path, Stats* stats) {
-  if (!header_)
+uint64_t Archive::GetDataEnd() const {
+  uint64_t end = header_size_;
+  for (const Entry& entry : entries_) {
+    if (entry.flags & (ENTRY_DIRECTORY | ENTRY_LINK | ENTRY_UNPACKED |
+                       ENTRY_INVALID))
+      continue;
+    uint32_t stored_size = (entry.flags & (ENTRY_DEFLATE | ENTRY_BROTLI)) ?
+        entry.compressed_size : entry.size;
+    end = std::max(end, entry.offset + stored_size);
+  }
+  return end;
+}
+
+bool Archive::IsMappedRangeValid(uint64_t offset, uint64_t size) {
+  if (!mapped_file_ || offset > mapped_file_->length() ||
+      size > mapped_file_->length() - offset)
+    return false;
+
+  // the archive may have been truncated in place since it was mapped
+  base::ThreadRestrictions::ScopedAllowIO allow_io;
+  int64_t length = file_.GetLength();
+  return length >= 0 && offset + size <= static_cast<uint64_t>(length);
+}
+
+bool Archive::GetFileInfo(const base::FilePath& path, FileInfo* info) {
+  const Entry* entry = ResolveLinks(GetEntryFromPath(path));
+  if (!entry)
     return false;
 
-  const base::DictionaryValue* node;
-  if (!GetNodeFromPath(path.AsUTF8Unsafe(), header_.get(), &node))
+  return FillFileInfo(*entry, info);
+}
+
+bool Archive::Stat(const base::FilePath& path, Stats* stats) {
+  const Entry* entry = GetEntryFromPath(path);
+  if (!entry)
     return false;
 
-  if (node->HasKey("link")) {
+  if (entry->flags & ENTRY_LINK) {
     stats->is_file = false;
     stats->is_link = true;
     return true;
   }
 
-  if (node->HasKey("files")) {
+  if (entry->flags & ENTRY_DIRECTORY) {
     stats->is_file = false;
     stats->is_directory = true;
     return true;
   }
 
-  return FillFileInfoWithNode(stats, header_size_, node);
+  return FillFileInfo(*entry, stats);
 }
 
 bool Archive::Readdir(const base::FilePath& path,
                       std::vector<base::FilePath>* list) {
-  if (!header_)
+  const Entry* entry = GetEntryFromPath(path);
+  if (entry && (entry->flags & ENTRY_LINK))
+    entry = GetEntryFromPath(GetLink(*entry), 0);
+  if (!entry || !(entry->flags & ENTRY_DIRECTORY))
     return false;
 
-  const base::DictionaryValue* node;
-  if (!GetNodeFromPath(path.AsUTF8Unsafe(), header_.get(), &node))
-    return false;
+  for (uint32_t i = 0; i < entry->count; ++i) {
+    const Entry& child = entries_[entry->first + i];
+    list->push_back(base::FilePath::FromUTF8Unsafe(GetName(child)));
+  }
+  return true;
+}
 
-  const base::DictionaryValue* files;
-  if (!GetFilesNode(header_.get(), node, &files))
+bool Archive::Realpath(const base::FilePath& path, base::FilePath* realpath) {
+  const Entry* entry = GetEntryFromPath(path);
+  if (!entry)
     return false;
 
-  base::DictionaryValue::Iterator iter(*files);
-  while (!iter.IsAtEnd()) {
-    list->push_back(base::FilePath::FromUTF8Unsafe(iter.key()));
-    iter.Advance();
+  if (entry->flags & ENTRY_LINK) {
+    *realpath = base::FilePath::FromUTF8Unsafe(GetLink(*entry));
+    return true;
   }
+
+  *realpath = path;
   return true;
 }
 
-bool Archive::Realpath(const base::FilePath& path, base::FilePath* realpath) {
-  if (!header_)
+bool Archive::GetFileContents(const base::FilePath& path,
+                              base::StringPiece* contents) {
+  if (!mapped_file_)
     return false;
 
-  const base::DictionaryValue* node;
-  if (!GetNodeFromPath(path.AsUTF8Unsafe(), header_.get(), &node))
+  FileInfo info;
+  if (!GetFileInfo(path, &info) || info.unpacked ||
+      info.compression != COMPRESSION_NONE)
     return false;
 
-  std::string link;
-  if (node->GetString("link", &link)) {
-    *realpath = base::FilePath::FromUTF8Unsafe(link);
-    return true;
+  if (!IsMappedRangeValid(info.offset, info.size))
+    return false;
+
+  *contents = base::StringPiece(
+      reinterpret_cast<const char*>(mapped_file_->data()) + info.offset,
+      info.size);
+  return true;
+}
+
+int Archive::Read(uint64_t offset, char* data, int size) {
+  if (size < 0)
+    return -1;
+
+  reads_++;
+  if (mapped_file_) {
+    if (!IsMappedRangeValid(offset, size))
+      return -1;
+    memcpy(data, mapped_file_->data() + offset, size);
+    mapped_reads_++;
+    bytes_read_ += size;
+    return size;
   }
 
-  *realpath = path;
+  base::ThreadRestrictions::ScopedAllowIO allow_io;
+  int len = file_.Read(offset, data, size);
+  if (len > 0)
+    bytes_read_ += len;
+  return len;
+}
+
+bool Archive::GetMappedData(uint64_t offset,
+                            uint32_t size,
+                            base::StringPiece* data) {
+  if (!IsMappedRangeValid(offset, size))
+    return false;
+
+  reads_++;
+  mapped_reads_++;
+  bytes_read_ += size;
+  *data = base::StringPiece(
+      reinterpret_cast<const char*>(mapped_file_->data()) + offset, size);
   return true;
 }
 
+bool Archive::ReadFile(const FileInfo& info, std::string* contents) {
+  if (info.unpacked)
+    return false;
+
+  if (info.compression == COMPRESSION_NONE) {
+    contents->resize(info.size);
+    return Read(info.offset, &(*contents)[0], info.size) ==
+        static_cast<int>(info.size);
+  }
+
+  std::string compressed;
+  compressed.resize(info.compressed_size);
+  if (Read(info.offset, &compressed[0], info.compressed_size) !=
+      static_cast<int>(info.compressed_size))
+    return false;
+
+  contents->resize(info.size);
+  if (info.compression == COMPRESSION_DEFLATE)
+    return InflateZlib(compressed.data(), compressed.size(), contents);
+  return DecompressBrotli(compressed.data(), compressed.size(), contents);
+}
+
+Archive::Metrics Archive::GetMetrics() const {
+  Metrics metrics;
+  metrics.reads = reads_;
+  metrics.bytes_read = bytes_read_;
+  metrics.mapped_reads = mapped_reads_;
+  metrics.extractions = extractions_;
+  metrics.extraction_cache_hits = extraction_cache_hits_;
+  metrics.extraction_bytes_saved = extraction_bytes_saved_;
+  return metrics;
+}
+
 bool Archive::CopyFileOut(const base::FilePath& path, base::FilePath* out) {
-  auto it = external_files_.find(path.value());
-  if (it != external_files_.end()) {
-    *out = it->second->path();
+  base::AutoLock auto_lock(extraction_lock_);
+  auto it = extracted_files_.find(path.value());
+  if (it != extracted_files_.end()) {
+    *out = it->second;
     return true;
   }
 
@@ -296,20 +479,45 @@ bool Archive::CopyFileOut(const base::FilePath& path, base::FilePath* out) {
     return true;
   }
 
-  std::unique_ptr<ScopedTemporaryFile> temp_file(new ScopedTemporaryFile);
+  std::string contents;
+  if (!ReadFile(info, &contents))
+    return false;
+
   base::FilePath::StringType ext = path.Extension();
-  if (!temp_file->InitFromFile(&file_, ext, info.offset, info.size))
+  ExtractionCache cache(path_, archive_key_);
+  if (cache.Lookup(info.offset, ext, info.executable, contents, out)) {
+    extraction_cache_hits_++;
+    extraction_bytes_saved_ += contents.size();
+    extracted_files_[path.value()] = *out;
+    return true;
+  }
+
+  extractions_++;
+  if (!cache.Store(info.offset, ext, info.executable, contents, out) &&
+      !ExtractToTemporaryFile(ext, info.executable, contents, out))
+    return false;
+
+  extracted_files_[path.value()] = *out;
+  return true;
+}
+
+bool Archive::ExtractToTemporaryFile(const base::FilePath::StringType& ext,
+                                     bool executable,
+                                     const std::string& contents,
+                                     base::FilePath* out) {
+  std::unique_ptr<ScopedTemporaryFile> temp_file(new ScopedTemporaryFile);
+  if (!temp_file->InitFromData(ext, contents.data(), contents.size()))
     return false;
 
 #if defined(OS_POSIX)
-  if (info.executable) {
+  if (executable) {
     // chmod a+x temp_file;
     base::SetPosixFilePermissions(temp_file->path(), 0755);
   }
 #endif
 
   *out = temp_file->path();
-  external_files_[path.value()] = std::move(temp_file);
+  external_files_.push_back(std::move(temp_file));
   return true;
 }
 
@@ -317,4 +525,226 @@ int Archive::GetFD() const {
   return fd_;
 }
 
+void Archive::BuildIndex(const base::DictionaryValue& root) {
+  std::unordered_map<std::string, uint32_t> interned;
+  // The header nodes of |entries_|, which are filled breadth first so the
+  // children of each directory end up next to each other.
+  std::vector<const base::DictionaryValue*> nodes(1, &root);
+  entries_.assign(1, Entry());
+  names_.clear();
+
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const base::DictionaryValue* node = nodes[i];
+    Entry entry = entries_[i];
+
+    std::string link;
+    const base::DictionaryValue* files = nullptr;
+    if (node->GetStringWithoutPathExpansion("link", &link)) {
+      entry.flags |= ENTRY_LINK;
+      entry.first = InternName(link, &interned);
+      entry.count = static_cast<uint32_t>(link.size());
+    } else if (node->GetDictionaryWithoutPathExpansion("files", &files)) {
+      std::vector<std::pair<std::string, const base::DictionaryValue*>>
+          children;
+      for (base::DictionaryValue::Iterator it(*files); !it.IsAtEnd();
+           it.Advance()) {
+        const base::DictionaryValue* child = nullptr;
+        if (it.value().GetAsDictionary(&child))
+          children.push_back(std::make_pair(it.key(), child));
+      }
+      std::sort(children.begin(), children.end(),
+                [](const std::pair<std::string,
+                                   const base::DictionaryValue*>& a,
+                   const std::pair<std::string,
+                                   const base::DictionaryValue*>& b) {
+                  return base::StringPiece(a.first) <
+                      base::StringPiece(b.first);
+                });
+
+      entry.flags |= ENTRY_DIRECTORY;
+      entry.first = static_cast<uint32_t>(entries_.size());
+      entry.count = static_cast<uint32_t>(children.size());
+      for (const auto& child : children) {
+        Entry child_entry = Entry();
+        child_entry.name_offset = InternName(child.first, &interned);
+        child_entry.name_length = static_cast<uint32_t>(child.first.size());
+        entries_.push_back(child_entry);
+        nodes.push_back(child.second);
+      }
+    } else if (!ReadFileNode(*node, header_size_, &entry.flags, &entry.size,
+                             &entry.offset, &entry.compressed_size)) {
+      entry.flags |= ENTRY_INVALID;
+    }
+
+    entries_[i] = entry;
+  }
+}
+
+bool Archive::LoadIndex(const std::string& header_hash) {
+#if defined(ARCH_CPU_LITTLE_ENDIAN)
+  static_assert(sizeof(Entry) == 40, "Entry must match tools/asar_index.py");
+
+  std::string data;
+  {
+    base::ThreadRestrictions::ScopedAllowIO allow_io;
+    if (!base::ReadFileToString(path_.AddExtension(kIndexExtension), &data))
+      return false;
+  }
+
+  if (data.size() < kIndexPrefixSize ||
+      data.compare(0, kIndexMagicSize, kIndexMagic) != 0 ||
+      ReadIndexUInt32(data, kIndexMagicSize) != header_size_) {
+    LOG(WARNING) << "Ignoring invalid index of " << path_.value();
+    return false;
+  }
+
+  if (data.compare(kIndexHashOffset, base::kSHA1Length, header_hash) != 0) {
+    LOG(WARNING) << "Ignoring outdated index of " << path_.value();
+    return false;
+  }
+
+  uint64_t entry_count = ReadIndexUInt32(data, kIndexEntryCountOffset);
+  uint64_t names_size = ReadIndexUInt32(data, kIndexNamesSizeOffset);
+  if (entry_count == 0 ||
+      data.size() != kIndexPrefixSize + entry_count * sizeof(Entry) +
+                     names_size) {
+    LOG(WARNING) << "Ignoring invalid index of " << path_.value();
+    return false;
+  }
+
+  std::vector<Entry> entries(entry_count);
+  memcpy(entries.data(), data.data() + kIndexPrefixSize,
+         entry_count * sizeof(Entry));
+
+  // The hash only proves the index was generated for this archive, still make
+  // sure a broken generator can't make lookups read out of bounds.
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const Entry& entry = entries[i];
+    if (static_cast<uint64_t>(entry.name_offset) + entry.name_length >
+        names_size)
+      return false;
+    if ((entry.flags & ENTRY_DIRECTORY) &&
+        (entry.first <= i ||
+         static_cast<uint64_t>(entry.first) + entry.count > entry_count))
+      return false;
+    if ((entry.flags & ENTRY_LINK) &&
+        static_cast<uint64_t>(entry.first) + entry.count > names_size)
+      return false;
+  }
+
+  entries_.swap(entries);
+  names_.assign(data, kIndexPrefixSize + entry_count * sizeof(Entry),
+                names_size);
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint32_t Archive::InternName(
+    const std::string& name,
+    std::unordered_map<std::string, uint32_t>* interned) {
+  auto it = interned->find(name);
+  if (it != interned->end())
+    return it->second;
+
+  uint32_t offset = static_cast<uint32_t>(names_.size());
+  names_.append(name);
+  (*interned)[name] = offset;
+  return offset;
+}
+
+base::StringPiece Archive::GetName(const Entry& entry) const {
+  return base::StringPiece(names_.data() + entry.name_offset,
+                           entry.name_length);
+}
+
+base::StringPiece Archive::GetLink(const Entry& entry) const {
+  DCHECK(entry.flags & ENTRY_LINK);
+  return base::StringPiece(names_.data() + entry.first, entry.count);
+}
+
+const Archive::Entry* Archive::GetChildEntry(const Entry* dir,
+                                             base::StringPiece name,
+                                             int depth) const {
+  if (name.empty())
+    return &entries_[0];
+
+  // Test for symbol linked directory.
+  if (dir->flags & ENTRY_LINK) {
+    dir = GetEntryFromPath(GetLink(*dir), depth + 1);
+    if (!dir)
+      return nullptr;
+  }
+
+  if (!(dir->flags & ENTRY_DIRECTORY))
+    return nullptr;
+
+  const Entry* begin = entries_.data() + dir->first;
+  const Entry* end = begin + dir->count;
+  const Entry* child = std::lower_bound(
+      begin, end, name,
+      [this](const Entry& entry, base::StringPiece value) {
+        return GetName(entry) < value;
+      });
+  if (child == end || GetName(*child) != name)
+    return nullptr;
+  return child;
+}
+
+const Archive::Entry* Archive::GetEntryFromPath(base::StringPiece path,
+                                                int depth) const {
+  if (entries_.empty() || depth > kMaxLinkDepth)
+    return nullptr;
+
+  const Entry* entry = &entries_[0];
+  if (path.empty())
+    return entry;
+
+  size_t begin = 0;
+  while (entry) {
+    size_t end = path.find_first_of(kSeparators, begin);
+    if (end == base::StringPiece::npos)
+      return GetChildEntry(entry, path.substr(begin), depth);
+
+    entry = GetChildEntry(entry, path.substr(begin, end - begin), depth);
+    begin = end + 1;
+  }
+  return nullptr;
+}
+
+const Archive::Entry* Archive::GetEntryFromPath(
+    const base::FilePath& path) const {
+  return GetEntryFromPath(path.AsUTF8Unsafe(), 0);
+}
+
+const Archive::Entry* Archive::ResolveLinks(const Entry* entry) const {
+  for (int depth = 0; entry && (entry->flags & ENTRY_LINK); ++depth) {
+    if (depth > kMaxLinkDepth)
+      return nullptr;
+    entry = GetEntryFromPath(GetLink(*entry), 0);
+  }
+  return entry;
+}
+
+bool Archive::FillFileInfo(const Entry& entry, FileInfo* info) const {
+  if (entry.flags & (ENTRY_DIRECTORY | ENTRY_LINK | ENTRY_INVALID))
+    return false;
+
+  info->size = entry.size;
+  if (entry.flags & ENTRY_UNPACKED) {
+    info->unpacked = true;
+    return true;
+  }
+
+  info->offset = entry.offset;
+  info->executable = !!(entry.flags & ENTRY_EXECUTABLE);
+  if (entry.flags & ENTRY_DEFLATE)
+    info->compression = COMPRESSION_DEFLATE;
+  else if (entry.flags & ENTRY_BROTLI)
+    info->compression = COMPRESSION_BROTLI;
+  info->compressed_size = entry.compressed_size;
+  return true;
+}
+
 }  // namespace asar
@@ -5,15 +5,20 @@
 #ifndef ATOM_COMMON_ASAR_ARCHIVE_H_
 #define ATOM_COMMON_ASAR_ARCHIVE_H_
 
+#include <atomic>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "base/files/file.h"
 #include "base/files/file_path.h"
+#include "base/strings/string_piece.h"
+#include "base/synchronization/lock.h"
 
 namespace base {
 class DictionaryValue;
+class MemoryMappedFile;
 }
 
 namespace asar {
@@ -24,12 +29,35 @@ class ScopedTemporaryFile;
 // information from it.
 class Archive {
  public:
+  // How a packed file is stored in the archive.
+  enum Compression {
+    COMPRESSION_NONE,
+    // A zlib stream, the "deflate" content coding of HTTP.
+    COMPRESSION_DEFLATE,
+    COMPRESSION_BROTLI,
+  };
+
   struct FileInfo {
-    FileInfo() : unpacked(false), executable(false), size(0), offset(0) {}
+    FileInfo()
+        : unpacked(false),
+          executable(false),
+          size(0),
+          offset(0),
+          compression(COMPRESSION_NONE),
+          compressed_size(0) {}
+
+    // Number of bytes the file occupies in the archive.
+    uint32_t stored_size() const {
+      return compression == COMPRESSION_NONE ? size : compressed_size;
+    }
+
     bool unpacked;
     bool executable;
+    // Size of the file's contents, after decompression.
     uint32_t size;
     uint64_t offset;
+    Compression compression;
+    uint32_t compressed_size;
   };
 
   struct Stats : public FileInfo {
@@ -39,12 +67,42 @@ class Archive {
     bool is_link;
   };
 
+  // Counters of the reads served by the archive, used for tuning.
+  struct Metrics {
+    Metrics()
+        : reads(0),
+          bytes_read(0),
+          mapped_reads(0),
+          extractions(0),
+          extraction_cache_hits(0),
+          extraction_bytes_saved(0) {}
+    uint64_t reads;
+    uint64_t bytes_read;
+    // Reads served from the memory mapping instead of the file.
+    uint64_t mapped_reads;
+    // Files written out by CopyFileOut.
+    uint64_t extractions;
+    // Files CopyFileOut found already extracted by an earlier launch or
+    // another process, and the bytes that didn't have to be written for them.
+    uint64_t extraction_cache_hits;
+    uint64_t extraction_bytes_saved;
+  };
+
   explicit Archive(const base::FilePath& path);
   virtual ~Archive();
 
-  // Read and parse the header.
+  // Read the header, and load its precompiled index when there is an up to
+  // date one next to the archive or parse it otherwise.
   bool Init();
 
+  // Map the whole archive into memory so the contents of packed files can be
+  // read with GetFileContents() without copying. Must be called after Init().
+  // An archive too short for the files of its header isn't mapped. Archives
+  // must be replaced atomically, by renaming a new file over them: the views
+  // of a mapped archive which is truncated or rewritten in place crash when
+  // read.
+  bool MapFile();
+
   // Get the info of a file.
   bool GetFileInfo(const base::FilePath& path, FileInfo* info);
 
@@ -57,27 +115,115 @@ class Archive {
   // Fs.realpath(path).
   bool Realpath(const base::FilePath& path, base::FilePath* realpath);
 
-  // Copy the file into a temporary file, and return the new path.
+  // Get a view of the contents of an uncompressed packed file in the mapped
+  // archive, the view is valid as long as the archive is alive.
+  bool GetFileContents(const base::FilePath& path, base::StringPiece* contents);
+
+  // Read |size| bytes at |offset| of the archive without moving the file
+  // position, so it can be called concurrently from any thread. Returns the
+  // number of bytes read or -1 on error.
+  int Read(uint64_t offset, char* data, int size);
+
+  // Get a view of |size| bytes at |offset| of the mapped archive, which is
+  // counted as a read. The view is valid as long as the archive is alive.
+  bool GetMappedData(uint64_t offset, uint32_t size, base::StringPiece* data);
+
+  // Read the whole contents of a packed file, decompressing it if needed.
+  bool ReadFile(const FileInfo& info, std::string* contents);
+
+  // Copy the file out of the archive, and return the new path. Files are
+  // extracted into a persistent cache shared with other processes, falling
+  // back to a temporary file when the cache can't be used. The path must be
+  // usable by child processes, so it is always a real file.
   // For unpacked file, this method will return its real path.
   bool CopyFileOut(const base::FilePath& path, base::FilePath* out);
 
   // Returns the file's fd.
   int GetFD() const;
 
+  Metrics GetMetrics() const;
+
   base::FilePath path() const { return path_; }
-  base::DictionaryValue* header() const { return header_.get(); }
+  bool is_mapped() const { return !!mapped_file_; }
 
  private:
+  // A node of the header in the flat index. The children of a directory are
+  // stored next to each other in |entries_| and sorted by name, so lookups
+  // are a binary search per path component.
+  struct Entry {
+    // Position of the name in |names_|.
+    uint32_t name_offset;
+    uint32_t name_length;
+    // Combination of the EntryFlags in archive.cc.
+    uint32_t flags;
+    uint32_t size;
+    // Offset of the file from the beginning of the archive.
+    uint64_t offset;
+    // For directories the index of the first child and the number of
+    // children, for links the position of the target path in |names_|.
+    uint32_t first;
+    uint32_t count;
+    // Size of the data in the archive for compressed files.
+    uint32_t compressed_size;
+  };
+
+  // Load |entries_| and |names_| from the precompiled index next to the
+  // archive, which must have been generated from the header with the SHA-1
+  // |header_hash|.
+  bool LoadIndex(const std::string& header_hash);
+
+  // Flatten the parsed JSON header into |entries_| and |names_|.
+  void BuildIndex(const base::DictionaryValue& root);
+  uint32_t InternName(const std::string& name,
+                      std::unordered_map<std::string, uint32_t>* interned);
+
+  base::StringPiece GetName(const Entry& entry) const;
+  base::StringPiece GetLink(const Entry& entry) const;
+  const Entry* GetChildEntry(const Entry* dir,
+                             base::StringPiece name,
+                             int depth) const;
+  const Entry* GetEntryFromPath(base::StringPiece path, int depth) const;
+  const Entry* GetEntryFromPath(const base::FilePath& path) const;
+  // Follow the links until a file or directory is found.
+  const Entry* ResolveLinks(const Entry* entry) const;
+  bool FillFileInfo(const Entry& entry, FileInfo* info) const;
+  // The end of the data of the packed files.
+  uint64_t GetDataEnd() const;
+  // Whether |size| bytes at |offset| are both mapped and still in the file.
+  bool IsMappedRangeValid(uint64_t offset, uint64_t size);
+
+  // Fallback of CopyFileOut when the extraction cache can't be written.
+  bool ExtractToTemporaryFile(const base::FilePath::StringType& ext,
+                              bool executable,
+                              const std::string& contents,
+                              base::FilePath* out);
+
   base::FilePath path_;
   base::File file_;
   int fd_;
   uint32_t header_size_;
-  std::unique_ptr<base::DictionaryValue> header_;
+  // Identifies this version of the archive in the extraction cache.
+  std::string archive_key_;
+
+  std::vector<Entry> entries_;
+  std::string names_;
+
+  std::unique_ptr<base::MemoryMappedFile> mapped_file_;
+
+  std::atomic<uint64_t> reads_;
+  std::atomic<uint64_t> bytes_read_;
+  std::atomic<uint64_t> mapped_reads_;
+  std::atomic<uint64_t> extractions_;
+  std::atomic<uint64_t> extraction_cache_hits_;
+  std::atomic<uint64_t> extraction_bytes_saved_;
+
+  // Guards the extracted files, CopyFileOut can be called from any thread.
+  base::Lock extraction_lock_;
+  std::unordered_map<base::FilePath::StringType, base::FilePath>
+      extracted_files_;
 
-  // Cached external temporary files.
-  std::unordered_map
-    <base::FilePath::StringType, std::unique_ptr<ScopedTemporaryFile>>
-      external_files_;
+  // Temporary files extracted when the extraction cache is unavailable.
+  std::vector<std::unique_ptr<ScopedTemporaryFile>> external_files_;
 
   DISALLOW_COPY_AND_ASSIGN(Archive);
 };
@@ -4,6 +4,9 @@
 
 #include "atom/common/asar/asar_util.h"
 
+#include <atomic>
+#include <functional>
+#include <limits>
 #include <map>
 #include <string>
 
@@ -11,30 +14,185 @@
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
 #include "base/lazy_instance.h"
-#include "base/stl_util.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+#include "base/synchronization/lock.h"
 
 namespace asar {
 
 namespace {
 
-// The global instance of ArchiveMap, will be destroyed on exit.
-typedef std::map<base::FilePath, std::shared_ptr<Archive>> ArchiveMap;
-static base::LazyInstance<ArchiveMap>::DestructorAtExit g_archive_map =
-    LAZY_INSTANCE_INITIALIZER;
+// The registry keeps at most this many archives open, the least recently
+// used one is released when another archive is opened. Released archives stay
+// alive as long as callers still hold them, and are handed out again if they
+// are opened meanwhile so that there is never more than one per path.
+const size_t kMaxOpenArchives = 32;
+
+// Lookups only contend on the lock of the shard of their path.
+const size_t kShardCount = 8;
+
+struct ArchiveSlot {
+  ArchiveSlot() : last_used(0) {}
+
+  // Null once the archive was released by the registry.
+  std::shared_ptr<Archive> archive;
+  // Still set after the release while a caller holds the archive.
+  std::weak_ptr<Archive> live_archive;
+  uint64_t last_used;
+};
+
+typedef std::map<base::FilePath, ArchiveSlot> ArchiveMap;
+
+class ArchiveRegistry {
+ public:
+  ArchiveRegistry() : clock_(0), size_(0) {}
+
+  std::shared_ptr<Archive> GetOrCreate(const base::FilePath& path) {
+    Shard& shard = GetShard(path);
+    std::shared_ptr<Archive> archive = Find(&shard, path);
+    if (archive)
+      return archive;
+
+    // Reading the header and mapping the file can block, so they happen
+    // outside the lock, and the archive opened first wins if another thread
+    // opens the same path meanwhile.
+    std::shared_ptr<Archive> opened(new Archive(path));
+    if (!opened->Init())
+      return nullptr;
+    // Reading from the mapping is only an optimization, reads fall back to
+    // the file when the archive can't be mapped.
+    opened->MapFile();
+
+    {
+      base::AutoLock auto_lock(shard.lock);
+      ArchiveSlot& slot = shard.archives[path];
+      slot.last_used = ++clock_;
+      if (slot.archive)
+        return slot.archive;
+
+      archive = slot.live_archive.lock();
+      if (!archive) {
+        archive = opened;
+        slot.live_archive = archive;
+      }
+      slot.archive = archive;
+    }
+
+    if (++size_ > kMaxOpenArchives)
+      EvictLeastRecentlyUsed();
+    return archive;
+  }
+
+  // Returns the archive opened for |path| if there is one, without opening
+  // it or changing its place in the eviction order.
+  std::shared_ptr<Archive> Get(const base::FilePath& path) {
+    Shard& shard = GetShard(path);
+    base::AutoLock auto_lock(shard.lock);
+    auto it = shard.archives.find(path);
+    if (it == shard.archives.end())
+      return nullptr;
+    if (it->second.archive)
+      return it->second.archive;
+    return it->second.live_archive.lock();
+  }
+
+ private:
+  struct Shard {
+    base::Lock lock;
+    ArchiveMap archives;
+  };
+
+  // Returns the archive registered for |path|, taking back a released one
+  // which is still alive, and marks it as used.
+  std::shared_ptr<Archive> Find(Shard* shard, const base::FilePath& path) {
+    std::shared_ptr<Archive> archive;
+    {
+      base::AutoLock auto_lock(shard->lock);
+      auto it = shard->archives.find(path);
+      if (it == shard->archives.end())
+        return nullptr;
+      ArchiveSlot& slot = it->second;
+      slot.last_used = ++clock_;
+      if (slot.archive)
+        return slot.archive;
+      archive = slot.live_archive.lock();
+      if (!archive)
+        return nullptr;
+      slot.archive = archive;
+    }
+
+    if (++size_ > kMaxOpenArchives)
+      EvictLeastRecentlyUsed();
+    return archive;
+  }
+
+  Shard& GetShard(const base::FilePath& path) {
+    return shards_[std::hash<base::FilePath::StringType>()(path.value()) %
+                   kShardCount];
+  }
+
+  void EvictLeastRecentlyUsed() {
+    base::AutoLock eviction_lock(eviction_lock_);
+    while (size_ > kMaxOpenArchives) {
+      Shard* oldest_shard = nullptr;
+      base::FilePath oldest_path;
+      uint64_t oldest_use = std::numeric_limits<uint64_t>::max();
+      for (Shard& shard : shards_) {
+        base::AutoLock auto_lock(shard.lock);
+        for (auto it = shard.archives.begin(); it != shard.archives.end();) {
+          const ArchiveSlot& slot = it->second;
+          if (!slot.archive && slot.live_archive.expired()) {
+            it = shard.archives.erase(it);
+            continue;
+          }
+          if (slot.archive && slot.last_used < oldest_use) {
+            oldest_shard = &shard;
+            oldest_path = it->first;
+            oldest_use = slot.last_used;
+          }
+          ++it;
+        }
+      }
+      if (!oldest_shard)
+        return;
+
+      // The archive may have been used since, in which case the next
+      // iteration picks another one.
+      base::AutoLock auto_lock(oldest_shard->lock);
+      auto it = oldest_shard->archives.find(oldest_path);
+      if (it == oldest_shard->archives.end() || !it->second.archive ||
+          it->second.last_used != oldest_use)
+        continue;
+      it->second.archive.reset();
+      --size_;
+    }
+  }
+
+  Shard shards_[kShardCount];
+  // Incremented on every lookup to order the archives by their last use.
+  std::atomic<uint64_t> clock_;
+  // The number of archives held by the registry.
+  std::atomic<size_t> size_;
+  // Serializes evictions, so only one thread trims the registry at a time.
+  base::Lock eviction_lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArchiveRegistry);
+};
+
+// The global instance of ArchiveRegistry, will be destroyed on exit.
+static base::LazyInstance<ArchiveRegistry>::DestructorAtExit
+    g_archive_registry = LAZY_INSTANCE_INITIALIZER;
 
 const base::FilePath::CharType kAsarExtension[] = FILE_PATH_LITERAL(".asar");
 
 }  // namespace
 
 std::shared_ptr<Archive> GetOrCreateAsarArchive(const base::FilePath& path) {
-  ArchiveMap& archive_map = *g_archive_map.Pointer();
-  if (!ContainsKey(archive_map, path)) {
-    std::shared_ptr<Archive> archive(new Archive(path));
-    if (!archive->Init())
-      return nullptr;
-    archive_map[path] = archive;
-  }
-  return archive_map[path];
+  return g_archive_registry.Get().GetOrCreate(path);
+}
+
+std::shared_ptr<Archive> GetOpenAsarArchive(const base::FilePath& path) {
+  return g_archive_registry.Get().Get(path);
 }
 
 bool GetAsarArchivePath(const base::FilePath& full_path,
@@ -59,6 +217,21 @@ bool GetAsarArchivePath(const base::FilePath& full_path,
   return true;
 }
 
+bool GetFileContents(const base::FilePath& path,
+                     std::shared_ptr<Archive>* archive,
+                     base::StringPiece* contents) {
+  base::FilePath asar_path, relative_path;
+  if (!GetAsarArchivePath(path, &asar_path, &relative_path))
+    return false;
+
+  std::shared_ptr<Archive> result = GetOrCreateAsarArchive(asar_path);
+  if (!result || !result->GetFileContents(relative_path, contents))
+    return false;
+
+  *archive = result;
+  return true;
+}
+
 bool ReadFileToString(const base::FilePath& path, std::string* contents) {
   base::FilePath asar_path, relative_path;
   if (!GetAsarArchivePath(path, &asar_path, &relative_path))
@@ -79,13 +252,7 @@ bool ReadFileToString(const base::FilePath& path, std::string* contents) {
     return base::ReadFileToString(real_path, contents);
   }
 
-  base::File src(asar_path, base::File::FLAG_OPEN | base::File::FLAG_READ);
-  if (!src.IsValid())
-    return false;
-
-  contents->resize(info.size);
-  return static_cast<int>(info.size) == src.Read(
-      info.offset, const_cast<char*>(contents->data()), contents->size());
+  return archive->ReadFile(info, contents);
 }
 
 }  // namespace asar
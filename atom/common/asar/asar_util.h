@@ -8,6 +8,8 @@
 #include <memory>
 #include <string>
 
+#include "base/strings/string_piece.h"
+
 namespace base {
 class FilePath;
 }
@@ -16,14 +18,26 @@ namespace asar {
 
 class Archive;
 
-// Gets or creates a new Archive from the path.
+// Gets or creates a new Archive from the path, can be called from any thread.
+// Open archives are shared by all callers, and the least recently used ones
+// are released by the registry when too many archives are open. An archive
+// which is still in use is never opened a second time.
 std::shared_ptr<Archive> GetOrCreateAsarArchive(const base::FilePath& path);
 
+// Gets the Archive of the path if it is already open, or null.
+std::shared_ptr<Archive> GetOpenAsarArchive(const base::FilePath& path);
+
 // Separates the path to Archive out.
 bool GetAsarArchivePath(const base::FilePath& full_path,
                         base::FilePath* asar_path,
                         base::FilePath* relative_path);
 
+// Gets a view of a packed file in a memory-mapped archive without copying,
+// |archive| keeps the mapping alive while |contents| is in use.
+bool GetFileContents(const base::FilePath& path,
+                     std::shared_ptr<Archive>* archive,
+                     base::StringPiece* contents);
+
 // Same with base::ReadFileToString but supports asar Archive.
 bool ReadFileToString(const base::FilePath& path, std::string* contents);
 
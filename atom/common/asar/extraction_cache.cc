@@ -0,0 +1,145 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/common/asar/extraction_cache.h"
+
+#include "base/files/file_enumerator.h"
+#include "base/files/file_util.h"
+#include "base/hash.h"
+#include "base/path_service.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/threading/thread_restrictions.h"
+#include "build/build_config.h"
+
+namespace asar {
+
+namespace {
+
+const base::FilePath::CharType kCacheDirName[] =
+    FILE_PATH_LITERAL("muon-asar-cache");
+
+bool GetCacheRoot(base::FilePath* dir) {
+#if defined(OS_WIN)
+  return base::PathService::Get(base::DIR_LOCAL_APP_DATA, dir);
+#else
+  return base::PathService::Get(base::DIR_CACHE, dir);
+#endif
+}
+
+// Removes the extracted files of other versions of the archive.
+void DeleteOtherVersions(const base::FilePath& dir) {
+  base::FileEnumerator versions(dir.DirName(), false,
+                                base::FileEnumerator::DIRECTORIES);
+  for (base::FilePath version = versions.Next(); !version.empty();
+       version = versions.Next()) {
+    // Files still loaded by a running process of an older version can't be
+    // deleted on Windows, they are retried when the next version is stored.
+    if (version != dir)
+      base::DeleteFile(version, true);
+  }
+}
+
+}  // namespace
+
+ExtractionCache::ExtractionCache(const base::FilePath& archive_path,
+                                 const std::string& archive_key) {
+  base::FilePath root;
+  if (!GetCacheRoot(&root))
+    return;
+
+  uint32_t path_hash = base::PersistentHash(archive_path.AsUTF8Unsafe());
+  dir_ = root.Append(kCacheDirName)
+      .AppendASCII(base::HexEncode(&path_hash, sizeof(path_hash)))
+      .AppendASCII(archive_key);
+}
+
+ExtractionCache::~ExtractionCache() {
+}
+
+bool ExtractionCache::Lookup(uint64_t offset,
+                             const base::FilePath::StringType& ext,
+                             bool executable,
+                             const std::string& data,
+                             base::FilePath* path) {
+  if (dir_.empty())
+    return false;
+
+  base::ThreadRestrictions::ScopedAllowIO allow_io;
+  base::FilePath cached_path = GetPath(offset, ext);
+  int64_t cached_size;
+  if (!base::GetFileSize(cached_path, &cached_size) ||
+      cached_size != static_cast<int64_t>(data.size()))
+    return false;
+
+#if defined(OS_POSIX)
+  int mode;
+  if (executable && (!base::GetPosixFilePermissions(cached_path, &mode) ||
+                     (mode & base::FILE_PERMISSION_EXECUTE_BY_USER) == 0))
+    return false;
+#endif
+
+  // Reading the file back is much cheaper than writing it, and a file of the
+  // same size may still have been modified or only partly written.
+  std::string cached_data;
+  if (!base::ReadFileToString(cached_path, &cached_data) ||
+      cached_data != data)
+    return false;
+
+  *path = cached_path;
+  return true;
+}
+
+bool ExtractionCache::Store(uint64_t offset,
+                            const base::FilePath::StringType& ext,
+                            bool executable,
+                            const std::string& data,
+                            base::FilePath* path) {
+  if (dir_.empty())
+    return false;
+
+  base::ThreadRestrictions::ScopedAllowIO allow_io;
+  if (!base::DirectoryExists(dir_)) {
+    // The cache is per user, CreateDirectory makes it accessible to the
+    // owner only.
+    if (!base::CreateDirectory(dir_))
+      return false;
+    DeleteOtherVersions(dir_);
+  }
+
+  base::FilePath temp_path;
+  if (!base::CreateTemporaryFileInDir(dir_, &temp_path))
+    return false;
+
+  if (base::WriteFile(temp_path, data.data(), data.size()) !=
+      static_cast<int>(data.size())) {
+    base::DeleteFile(temp_path, false);
+    return false;
+  }
+
+#if defined(OS_POSIX)
+  if (executable) {
+    // chmod a+x temp_path;
+    base::SetPosixFilePermissions(temp_path, 0755);
+  }
+#endif
+
+  // Another process may have extracted the same file in the meantime, which
+  // is fine since both have the same contents.
+  base::FilePath cached_path = GetPath(offset, ext);
+  if (!base::ReplaceFile(temp_path, cached_path, nullptr)) {
+    base::DeleteFile(temp_path, false);
+    return Lookup(offset, ext, executable, data, path);
+  }
+
+  *path = cached_path;
+  return true;
+}
+
+base::FilePath ExtractionCache::GetPath(
+    uint64_t offset,
+    const base::FilePath::StringType& ext) const {
+  return dir_.AppendASCII(base::Uint64ToString(offset)).AddExtension(ext);
+}
+
+}  // namespace asar
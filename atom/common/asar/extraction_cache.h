@@ -0,0 +1,55 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_COMMON_ASAR_EXTRACTION_CACHE_H_
+#define ATOM_COMMON_ASAR_EXTRACTION_CACHE_H_
+
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/macros.h"
+
+namespace asar {
+
+// Persistent, per-user cache of files extracted from archives, shared by all
+// processes and kept across launches. Files are addressed by the identity of
+// the archive and their offset in it, so every file of an archive version is
+// extracted at most once.
+class ExtractionCache {
+ public:
+  // |archive_key| identifies the contents of the archive at |archive_path|.
+  ExtractionCache(const base::FilePath& archive_path,
+                  const std::string& archive_key);
+  ~ExtractionCache();
+
+  // Returns the path of the cached file if it has already been extracted with
+  // the same |data| and is executable when it should be. Files left damaged
+  // or changed by an earlier launch are not used.
+  bool Lookup(uint64_t offset,
+              const base::FilePath::StringType& ext,
+              bool executable,
+              const std::string& data,
+              base::FilePath* path);
+
+  // Writes |data| to the cache atomically and returns its path. Files of
+  // older versions of the archive are removed when the first file of a new
+  // version is stored.
+  bool Store(uint64_t offset,
+             const base::FilePath::StringType& ext,
+             bool executable,
+             const std::string& data,
+             base::FilePath* path);
+
+ private:
+  base::FilePath GetPath(uint64_t offset,
+                         const base::FilePath::StringType& ext) const;
+
+  base::FilePath dir_;
+
+  DISALLOW_COPY_AND_ASSIGN(ExtractionCache);
+};
+
+}  // namespace asar
+
+#endif  // ATOM_COMMON_ASAR_EXTRACTION_CACHE_H_
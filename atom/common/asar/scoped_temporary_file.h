@@ -30,6 +30,10 @@ class ScopedTemporaryFile {
                     const base::FilePath::StringType& ext,
                     uint64_t offset, uint64_t size);
 
+  // Init an temporary file and fill it with |data|.
+  bool InitFromData(const base::FilePath::StringType& ext,
+                    const char* data, size_t size);
+
   base::FilePath path() const { return path_; }
 
  private:
@@ -0,0 +1,131 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/common/content_settings_delta.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include "base/numerics/safe_conversions.h"
+#include "base/values.h"
+
+namespace atom {
+
+namespace {
+
+const char kType[] = "type";
+const char kStart[] = "start";
+const char kDeleteCount[] = "deleteCount";
+const char kRules[] = "rules";
+const char kRemove[] = "remove";
+
+const base::Value::ListStorage& GetRules(const base::Value* value) {
+  static const base::Value::ListStorage empty;
+  return value && value->is_list() ? value->GetList() : empty;
+}
+
+}  // namespace
+
+std::unique_ptr<base::ListValue> CreateContentSettingsDelta(
+    const base::DictionaryValue& from,
+    const base::DictionaryValue& to) {
+  std::unique_ptr<base::ListValue> delta(new base::ListValue);
+
+  for (base::DictionaryValue::Iterator it(from); !it.IsAtEnd(); it.Advance()) {
+    if (to.HasKey(it.key()))
+      continue;
+    std::unique_ptr<base::DictionaryValue> change(new base::DictionaryValue);
+    change->SetString(kType, it.key());
+    change->SetBoolean(kRemove, true);
+    delta->Append(std::move(change));
+  }
+
+  for (base::DictionaryValue::Iterator it(to); !it.IsAtEnd(); it.Advance()) {
+    const base::Value* old_value = nullptr;
+    if (from.GetWithoutPathExpansion(it.key(), &old_value) &&
+        *old_value == it.value())
+      continue;
+
+    const base::Value::ListStorage& old_rules = GetRules(old_value);
+    const base::Value::ListStorage& new_rules = GetRules(&it.value());
+
+    // only send the rules between the common prefix and suffix, which covers
+    // the usual single rule addition, removal or update
+    size_t prefix = 0;
+    size_t max_prefix = std::min(old_rules.size(), new_rules.size());
+    while (prefix < max_prefix && old_rules[prefix] == new_rules[prefix])
+      ++prefix;
+    size_t suffix = 0;
+    size_t max_suffix = max_prefix - prefix;
+    while (suffix < max_suffix &&
+           old_rules[old_rules.size() - suffix - 1] ==
+               new_rules[new_rules.size() - suffix - 1])
+      ++suffix;
+
+    std::unique_ptr<base::ListValue> rules(new base::ListValue);
+    for (size_t i = prefix; i < new_rules.size() - suffix; ++i)
+      rules->GetList().push_back(new_rules[i].Clone());
+
+    std::unique_ptr<base::DictionaryValue> change(new base::DictionaryValue);
+    change->SetString(kType, it.key());
+    change->SetInteger(kStart, base::checked_cast<int>(prefix));
+    change->SetInteger(kDeleteCount,
+        base::checked_cast<int>(old_rules.size() - prefix - suffix));
+    change->Set(kRules, std::move(rules));
+    delta->Append(std::move(change));
+  }
+
+  return delta;
+}
+
+bool ApplyContentSettingsDelta(const base::ListValue& delta,
+                               base::DictionaryValue* settings,
+                               std::vector<std::string>* changed_types) {
+  for (const auto& value : delta) {
+    const base::DictionaryValue* change = nullptr;
+    std::string type;
+    if (!value.GetAsDictionary(&change) || !change->GetString(kType, &type))
+      return false;
+    changed_types->push_back(type);
+
+    bool remove = false;
+    if (change->GetBoolean(kRemove, &remove) && remove) {
+      settings->RemoveWithoutPathExpansion(type, nullptr);
+      continue;
+    }
+
+    int start = 0;
+    int delete_count = 0;
+    const base::ListValue* rules = nullptr;
+    if (!change->GetInteger(kStart, &start) ||
+        !change->GetInteger(kDeleteCount, &delete_count) ||
+        !change->GetList(kRules, &rules))
+      return false;
+
+    base::ListValue* list = nullptr;
+    if (!settings->GetListWithoutPathExpansion(type, &list)) {
+      list = settings->SetListWithoutPathExpansion(
+          type, std::make_unique<base::ListValue>());
+    }
+
+    base::Value::ListStorage& storage = list->GetList();
+    if (start < 0 || delete_count < 0 ||
+        static_cast<size_t>(start) + delete_count > storage.size())
+      return false;
+
+    base::Value::ListStorage inserted;
+    for (const auto& rule : rules->GetList())
+      inserted.push_back(rule.Clone());
+    auto position = storage.erase(storage.begin() + start,
+                                  storage.begin() + start + delete_count);
+    storage.insert(position,
+                   std::make_move_iterator(inserted.begin()),
+                   std::make_move_iterator(inserted.end()));
+  }
+  return true;
+}
+
+}  // namespace atom
@@ -0,0 +1,44 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_COMMON_CONTENT_SETTINGS_DELTA_H_
+#define ATOM_COMMON_CONTENT_SETTINGS_DELTA_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace base {
+class DictionaryValue;
+class ListValue;
+}
+
+namespace atom {
+
+// The content settings are a dictionary of rule lists keyed by content type.
+// A delta between two versions is a list of changes, one per content type
+// that changed:
+//
+//   { type: 'cookies', start: 4, deleteCount: 1, rules: [ ... ] }
+//   { type: 'autoplay', remove: true }
+//
+// The first form replaces |deleteCount| rules at |start| with |rules|, adding
+// the content type if needed. The order of the rules is kept since the last
+// matching rule wins.
+
+// Returns the changes that turn |from| into |to|.
+std::unique_ptr<base::ListValue> CreateContentSettingsDelta(
+    const base::DictionaryValue& from,
+    const base::DictionaryValue& to);
+
+// Applies |delta| to |settings| and adds the content types it changed to
+// |changed_types|. Returns false if the delta doesn't apply to |settings|, in
+// which case |settings| may have been partially updated.
+bool ApplyContentSettingsDelta(const base::ListValue& delta,
+                               base::DictionaryValue* settings,
+                               std::vector<std::string>* changed_types);
+
+}  // namespace atom
+
+#endif  // ATOM_COMMON_CONTENT_SETTINGS_DELTA_H_
@@ -4,6 +4,9 @@
 
 #include "atom/common/javascript_bindings.h"
 
+#include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 #include "atom/common/api/api_messages.h"
 #include "atom/common/api/atom_api_key_weak_map.h"
@@ -11,10 +14,13 @@
 #include "atom/common/native_mate_converters/content_converter.h"
 #include "atom/common/native_mate_converters/string16_converter.h"
 #include "atom/common/native_mate_converters/value_converter.h"
+#include "atom/common/v8_serialization.h"
+#include "base/logging.h"
 #include "base/memory/shared_memory.h"
 #include "base/memory/shared_memory_handle.h"
 #include "brave/common/extensions/shared_memory_bindings.h"
 #include "content/public/renderer/render_frame.h"
+#include "content/public/renderer/render_thread.h"
 #include "extensions/renderer/console.h"
 #include "native_mate/dictionary.h"
 #include "third_party/blink/public/web/web_local_frame.h"
@@ -26,6 +32,19 @@ namespace atom {
 
 namespace {
 
+// Request ids of ipc.invoke, unique in the renderer so that a reply can't be
+// taken by another context of the frame.
+int g_next_invoke_id = 0;
+
+// Acknowledge a shared memory segment received from the browser, the frame
+// may be gone by the time the wrapper is released.
+void SendSharedMemoryReleased(int routing_id, uint32_t segment_id) {
+  if (content::RenderThread::Get()) {
+    content::RenderThread::Get()->Send(
+        new AtomViewHostMsg_SharedMemoryReleased(routing_id, segment_id));
+  }
+}
+
 std::vector<v8::Local<v8::Value>> ListValueToVector(v8::Isolate* isolate,
                                                 const base::ListValue& list) {
   v8::Local<v8::Value> array = mate::ConvertToV8(isolate, list);
@@ -34,6 +53,15 @@ std::vector<v8::Local<v8::Value>> ListValueToVector(v8::Isolate* isolate,
   return result;
 }
 
+// Serializes the arguments of a message, returns false without throwing if
+// they can't be cloned.
+bool SerializeArguments(v8::Local<v8::Context> context,
+                        v8::Local<v8::Value> arguments,
+                        std::vector<uint8_t>* data) {
+  v8::TryCatch try_catch(context->GetIsolate());
+  return SerializeV8Value(context, arguments, data);
+}
+
 }  // namespace
 
 JavascriptBindings::JavascriptBindings(content::RenderFrame* render_frame,
@@ -41,7 +69,11 @@ JavascriptBindings::JavascriptBindings(content::RenderFrame* render_frame,
     : content::RenderFrameObserver(render_frame),
       extensions::ObjectBackedNativeHandler(context) {}
 
-JavascriptBindings::~JavascriptBindings() {}
+JavascriptBindings::~JavascriptBindings() {
+  // the browser handlers may still be running
+  for (const auto& it : pending_invokes_)
+    Send(new AtomViewHostMsg_CancelInvoke(routing_id(), it.first));
+}
 
 void JavascriptBindings::AddRoutes() {
   RouteHandlerFunction(
@@ -130,12 +162,23 @@ void JavascriptBindings::DeleteHiddenValue(v8::Isolate* isolate,
 
 void JavascriptBindings::IPCSend(mate::Arguments* args,
           const base::string16& channel,
-          const base::ListValue& arguments) {
+          v8::Local<v8::Value> arguments) {
   if (!is_valid() || !render_frame())
     return;
 
-  bool success = Send(new AtomViewHostMsg_Message(
-      routing_id(), channel, arguments));
+  bool success;
+  std::vector<uint8_t> data;
+  if (SerializeArguments(context()->v8_context(), arguments, &data)) {
+    success = Send(new AtomViewHostMsg_Message_Serialized(
+        routing_id(), channel, data));
+  } else {
+    base::ListValue list;
+    if (!mate::ConvertFromV8(args->isolate(), arguments, &list)) {
+      args->ThrowError("Invalid arguments");
+      return;
+    }
+    success = Send(new AtomViewHostMsg_Message(routing_id(), channel, list));
+  }
 
   if (!success)
     args->ThrowError("Unable to send AtomViewHostMsg_Message");
@@ -143,42 +186,120 @@ void JavascriptBindings::IPCSend(mate::Arguments* args,
 
 void JavascriptBindings::IPCSendShared(mate::Arguments* args,
             const base::string16& channel,
-            base::SharedMemory* shared_memory) {
+            brave::SharedMemoryWrapper* shared_memory) {
   if (!is_valid() || !render_frame())
     return;
 
+  if (!shared_memory->segment()) {
+    args->ThrowError("Shared memory is closed");
+    return;
+  }
+
+  // the browser is the only peer of the renderer
+  uint32_t segment_id = 0;
+  uint32_t segment_size = 0;
   base::SharedMemoryHandle memory_handle =
-      base::SharedMemory::DuplicateHandle(shared_memory->handle());
+      brave::SharedMemoryPool::GetInstance()->Share(
+          shared_memory->segment(), shared_memory->size(), 0, &segment_id,
+          &segment_size);
   if (!memory_handle.IsValid()) {
-    base::SharedMemory::CloseHandle(memory_handle);
     args->ThrowError("Could not create shared memory handle");
     return;
   }
 
   bool success = Send(new AtomViewHostMsg_Message_Shared(
-      routing_id(), channel, memory_handle));
+      routing_id(), channel, memory_handle, segment_id, segment_size));
 
   if (!success)
     args->ThrowError("Unable to send AtomViewHostMsg_Message_Shared");
 }
 
-base::string16 JavascriptBindings::IPCSendSync(mate::Arguments* args,
+int JavascriptBindings::IPCInvoke(mate::Arguments* args,
+                                  const base::string16& channel,
+                                  v8::Local<v8::Value> arguments,
+                                  int timeout) {
+  if (!is_valid() || !render_frame()) {
+    args->ThrowError("Invalid context");
+    return 0;
+  }
+
+  // unlike send, invoke has no base::Value fallback, so the DataCloneError
+  // is thrown to the caller
+  std::vector<uint8_t> data;
+  if (!SerializeV8Value(context()->v8_context(), arguments, &data))
+    return 0;
+
+  int request_id = ++g_next_invoke_id;
+  if (!Send(new AtomViewHostMsg_Invoke(
+          routing_id(), request_id, channel, data))) {
+    args->ThrowError("Unable to send AtomViewHostMsg_Invoke");
+    return 0;
+  }
+
+  std::unique_ptr<base::OneShotTimer> timer;
+  if (timeout > 0) {
+    timer.reset(new base::OneShotTimer);
+    timer->Start(FROM_HERE, base::TimeDelta::FromMilliseconds(timeout),
+        base::Bind(&JavascriptBindings::OnInvokeTimeout,
+                   base::Unretained(this), request_id));
+  }
+  pending_invokes_[request_id] = std::move(timer);
+  return request_id;
+}
+
+void JavascriptBindings::IPCCancelInvoke(int request_id) {
+  if (!pending_invokes_.count(request_id))
+    return;
+
+  Send(new AtomViewHostMsg_CancelInvoke(routing_id(), request_id));
+  RejectInvoke(request_id, "Invocation was cancelled");
+}
+
+v8::Local<v8::Value> JavascriptBindings::IPCSendSync(mate::Arguments* args,
                         const base::string16& channel,
-                        const base::ListValue& arguments) {
-  base::string16 json;
+                        v8::Local<v8::Value> arguments) {
+  v8::Isolate* isolate = args->isolate();
+  if (!is_valid() || !render_frame())
+    return v8::Undefined(isolate);
 
-  if (!is_valid() || !render_frame()) {
-    return json;
+  v8::Local<v8::Context> v8_context = context()->v8_context();
+  std::vector<uint8_t> data;
+  if (SerializeArguments(v8_context, arguments, &data)) {
+    std::vector<uint8_t> result;
+    if (!Send(new AtomViewHostMsg_Message_Serialized_Sync(
+            routing_id(), channel, data, &result))) {
+      args->ThrowError("Unable to send AtomViewHostMsg_Message_Sync");
+      return v8::Undefined(isolate);
+    }
+
+    // an empty result means the browser didn't reply
+    if (result.empty())
+      return v8::Undefined(isolate);
+
+    v8::Local<v8::Value> value;
+    if (!DeserializeV8Value(v8_context, result).ToLocal(&value))
+      return v8::Local<v8::Value>();
+    return value;
   }
 
-  IPC::SyncMessage* message = new AtomViewHostMsg_Message_Sync(
-      routing_id(), channel, arguments, &json);
-  bool success = Send(message);
+  base::ListValue list;
+  if (!mate::ConvertFromV8(isolate, arguments, &list)) {
+    args->ThrowError("Invalid arguments");
+    return v8::Undefined(isolate);
+  }
 
-  if (!success)
+  base::string16 json;
+  if (!Send(new AtomViewHostMsg_Message_Sync(
+          routing_id(), channel, list, &json))) {
     args->ThrowError("Unable to send AtomViewHostMsg_Message_Sync");
+    return v8::Undefined(isolate);
+  }
 
-  return json;
+  v8::Local<v8::Value> value;
+  if (!v8::JSON::Parse(v8_context, mate::StringToV8(isolate, json))
+          .ToLocal(&value))
+    return v8::Local<v8::Value>();
+  return value;
 }
 
 void JavascriptBindings::GetBinding(
@@ -196,6 +317,10 @@ void JavascriptBindings::GetBinding(
       base::Unretained(this)));
   ipc.SetMethod("sendShared", base::Bind(&JavascriptBindings::IPCSendShared,
       base::Unretained(this)));
+  ipc.SetMethod("invoke", base::Bind(&JavascriptBindings::IPCInvoke,
+      base::Unretained(this)));
+  ipc.SetMethod("cancelInvoke", base::Bind(&JavascriptBindings::IPCCancelInvoke,
+      base::Unretained(this)));
   binding.Set("ipc", ipc.GetHandle());
 
   mate::Dictionary v8(isolate, v8::Object::New(isolate));
@@ -224,6 +349,9 @@ bool JavascriptBindings::OnMessageReceived(const IPC::Message& message) {
   if (!is_valid())
     return false;
 
+  if (message.type() == AtomViewMsg_InvokeReply::ID)
+    return OnInvokeReply(message);
+
   auto context_type = context()->effective_context_type();
 
   // never handle ipc messages in a web page context
@@ -239,6 +367,8 @@ bool JavascriptBindings::OnMessageReceived(const IPC::Message& message) {
       context_type == Feature::BLESSED_EXTENSION_CONTEXT) {
     IPC_BEGIN_MESSAGE_MAP(JavascriptBindings, message)
       IPC_MESSAGE_HANDLER(AtomViewMsg_Message_Shared, OnSharedBrowserMessage)
+      IPC_MESSAGE_HANDLER(AtomViewMsg_SharedMemoryReleased,
+                          OnSharedMemoryReleased)
       IPC_MESSAGE_UNHANDLED(handled = false)
     IPC_END_MESSAGE_MAP()
   }
@@ -246,6 +376,8 @@ bool JavascriptBindings::OnMessageReceived(const IPC::Message& message) {
 
   IPC_BEGIN_MESSAGE_MAP(JavascriptBindings, message)
     IPC_MESSAGE_HANDLER(AtomViewMsg_Message, OnBrowserMessage)
+    IPC_MESSAGE_HANDLER(AtomViewMsg_Message_Serialized,
+                        OnSerializedBrowserMessage)
     IPC_MESSAGE_UNHANDLED(handled = false)
   IPC_END_MESSAGE_MAP()
 
@@ -253,14 +385,35 @@ bool JavascriptBindings::OnMessageReceived(const IPC::Message& message) {
 }
 
 void JavascriptBindings::OnSharedBrowserMessage(const base::string16& channel,
-                                      const base::SharedMemoryHandle& handle) {
+                                      const base::SharedMemoryHandle& handle,
+                                      uint32_t segment_id,
+                                      uint32_t size) {
   if (!base::SharedMemory::IsHandleValid(handle)) {
     NOTREACHED() << "Bad handle";
     return;
   }
 
-  if (!is_valid())
+  base::Closure release;
+  if (segment_id)
+    release = base::Bind(&SendSharedMemoryReleased, routing_id(), segment_id);
+
+  if (!is_valid()) {
+    base::SharedMemory::CloseHandle(handle);
+    if (!release.is_null())
+      release.Run();
     return;
+  }
+
+  // the browser is the only peer of the renderer
+  scoped_refptr<brave::SharedMemorySegment> segment =
+      brave::SharedMemoryPool::GetInstance()->MapReceived(
+          0, segment_id, handle, size);
+  if (!segment) {
+    LOG(ERROR) << "Could not map shared memory";
+    if (!release.is_null())
+      release.Run();
+    return;
+  }
 
   v8::Isolate* isolate = context()->isolate();
   v8::HandleScope handle_scope(isolate);
@@ -268,7 +421,7 @@ void JavascriptBindings::OnSharedBrowserMessage(const base::string16& channel,
 
   std::vector<v8::Local<v8::Value>> args_vector;
   args_vector.insert(args_vector.begin(),
-      brave::SharedMemoryWrapper::CreateFrom(isolate, handle).ToV8());
+      brave::SharedMemoryWrapper::CreateFrom(isolate, segment, release).ToV8());
 
   // Insert the Event object, event.sender is ipc
   mate::Dictionary event = mate::Dictionary::CreateEmpty(isolate);
@@ -286,6 +439,77 @@ void JavascriptBindings::OnSharedBrowserMessage(const base::string16& channel,
                                   &concatenated_args.front());
 }
 
+void JavascriptBindings::OnSharedMemoryReleased(uint32_t segment_id) {
+  brave::SharedMemoryPool::GetInstance()->OnPeerReleased(0, segment_id);
+}
+
+bool JavascriptBindings::OnInvokeReply(const IPC::Message& message) {
+  AtomViewMsg_InvokeReply::Param param;
+  if (!AtomViewMsg_InvokeReply::Read(&message, &param))
+    return false;
+
+  int request_id = std::get<0>(param);
+  if (!pending_invokes_.count(request_id))
+    return false;
+
+  v8::Isolate* isolate = context()->isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Local<v8::Context> v8_context = context()->v8_context();
+  v8::Context::Scope context_scope(v8_context);
+
+  v8::TryCatch try_catch(isolate);
+  v8::Local<v8::Value> value;
+  if (!DeserializeV8Value(v8_context, std::get<2>(param)).ToLocal(&value)) {
+    RejectInvoke(request_id, "Could not deserialize the result");
+    return true;
+  }
+
+  if (std::get<1>(param)) {
+    SettleInvoke(request_id, true, value);
+  } else {
+    // failures are sent as the error message
+    SettleInvoke(request_id, false, v8::Exception::Error(
+        value->ToString(v8_context).FromMaybe(v8::String::Empty(isolate))));
+  }
+  return true;
+}
+
+void JavascriptBindings::OnInvokeTimeout(int request_id) {
+  Send(new AtomViewHostMsg_CancelInvoke(routing_id(), request_id));
+  RejectInvoke(request_id, "Invocation timed out");
+}
+
+void JavascriptBindings::RejectInvoke(int request_id,
+                                      const std::string& message) {
+  if (!is_valid()) {
+    pending_invokes_.erase(request_id);
+    return;
+  }
+
+  v8::Isolate* isolate = context()->isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Context::Scope context_scope(context()->v8_context());
+  SettleInvoke(request_id, false,
+      v8::Exception::Error(mate::StringToV8(isolate, message)));
+}
+
+void JavascriptBindings::SettleInvoke(int request_id,
+                                      bool success,
+                                      v8::Local<v8::Value> value) {
+  pending_invokes_.erase(request_id);
+
+  v8::Isolate* isolate = context()->isolate();
+  v8::Local<v8::Value> args[] = {
+    mate::ConvertToV8(isolate, request_id),
+    mate::ConvertToV8(isolate, success),
+    value,
+  };
+  context()->module_system()->CallModuleMethodSafe("ipc_utils",
+                                                   "settleInvoke",
+                                                   arraysize(args),
+                                                   args);
+}
+
 void JavascriptBindings::OnBrowserMessage(const base::string16& channel,
                                           const base::ListValue& args) {
   if (!context()->is_valid())
@@ -299,7 +523,40 @@ void JavascriptBindings::OnBrowserMessage(const base::string16& channel,
   v8::HandleScope handle_scope(isolate);
   v8::Context::Scope context_scope(context()->v8_context());
 
-  auto args_vector = ListValueToVector(isolate, args);
+  EmitBrowserMessage(channel, ListValueToVector(isolate, args));
+}
+
+void JavascriptBindings::OnSerializedBrowserMessage(
+    const base::string16& channel,
+    const std::vector<uint8_t>& args) {
+  if (!context()->is_valid())
+    return;
+
+  auto context_type = context()->effective_context_type();
+  if (context_type == Feature::WEB_PAGE_CONTEXT)
+    return;
+
+  v8::Isolate* isolate = context()->isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Local<v8::Context> v8_context = context()->v8_context();
+  v8::Context::Scope context_scope(v8_context);
+
+  v8::TryCatch try_catch(isolate);
+  v8::Local<v8::Value> array;
+  std::vector<v8::Local<v8::Value>> args_vector;
+  if (!DeserializeV8Value(v8_context, args).ToLocal(&array) ||
+      !mate::ConvertFromV8(isolate, array, &args_vector)) {
+    LOG(ERROR) << "Could not deserialize ipc message arguments";
+    return;
+  }
+
+  EmitBrowserMessage(channel, std::move(args_vector));
+}
+
+void JavascriptBindings::EmitBrowserMessage(
+    const base::string16& channel,
+    std::vector<v8::Local<v8::Value>> args_vector) {
+  v8::Isolate* isolate = context()->isolate();
 
   // Insert the Event object, event.sender is ipc
   mate::Dictionary event = mate::Dictionary::CreateEmpty(isolate);
@@ -5,6 +5,14 @@
 #ifndef ATOM_COMMON_JAVASCRIPT_BINDINGS_H_
 #define ATOM_COMMON_JAVASCRIPT_BINDINGS_H_
 
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/timer/timer.h"
 #include "content/public/renderer/render_frame_observer.h"
 #include "extensions/renderer/object_backed_native_handler.h"
 #include "extensions/renderer/script_context.h"
@@ -15,6 +23,10 @@ class SharedMemory;
 class SharedMemoryHandle;
 }
 
+namespace brave {
+class SharedMemoryWrapper;
+}
+
 namespace mate {
 class Arguments;
 }
@@ -35,13 +47,21 @@ class JavascriptBindings : public content::RenderFrameObserver,
  private:
   void IPCSendShared(mate::Arguments* args,
             const base::string16& channel,
-            base::SharedMemory* shared_memory);
-  base::string16 IPCSendSync(mate::Arguments* args,
+            brave::SharedMemoryWrapper* shared_memory);
+  v8::Local<v8::Value> IPCSendSync(mate::Arguments* args,
                         const base::string16& channel,
-                        const base::ListValue& arguments);
+                        v8::Local<v8::Value> arguments);
   void IPCSend(mate::Arguments* args,
                         const base::string16& channel,
-                        const base::ListValue& arguments);
+                        v8::Local<v8::Value> arguments);
+  // Invoke the ipcMain handler of |channel|, returns the request id which
+  // ipc_utils.settleInvoke is called with when the invocation completes,
+  // fails, times out after |timeout| ms (if not 0) or is cancelled.
+  int IPCInvoke(mate::Arguments* args,
+                const base::string16& channel,
+                v8::Local<v8::Value> arguments,
+                int timeout);
+  void IPCCancelInvoke(int request_id);
   v8::Local<v8::Value> GetHiddenValue(v8::Isolate* isolate,
                                     v8::Local<v8::String> key);
   void SetHiddenValue(v8::Isolate* isolate,
@@ -66,8 +86,23 @@ class JavascriptBindings : public content::RenderFrameObserver,
   bool OnMessageReceived(const IPC::Message& message) override;
   void OnBrowserMessage(const base::string16& channel,
                         const base::ListValue& args);
+  void OnSerializedBrowserMessage(const base::string16& channel,
+                                  const std::vector<uint8_t>& args);
+  void EmitBrowserMessage(const base::string16& channel,
+                          std::vector<v8::Local<v8::Value>> args);
   void OnSharedBrowserMessage(const base::string16& channel,
-                              const base::SharedMemoryHandle& handle);
+                              const base::SharedMemoryHandle& handle,
+                              uint32_t segment_id,
+                              uint32_t size);
+  void OnSharedMemoryReleased(uint32_t segment_id);
+  // Returns false if the reply is for another context of the frame.
+  bool OnInvokeReply(const IPC::Message& message);
+  void OnInvokeTimeout(int request_id);
+  void SettleInvoke(int request_id, bool success, v8::Local<v8::Value> value);
+  void RejectInvoke(int request_id, const std::string& message);
+
+  // The invocations waiting for a reply, with their timeout.
+  std::map<int, std::unique_ptr<base::OneShotTimer>> pending_invokes_;
 
   DISALLOW_COPY_AND_ASSIGN(JavascriptBindings);
 };
@@ -0,0 +1,226 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "atom/common/v8_serialization.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <utility>
+
+#include "base/macros.h"
+
+namespace atom {
+
+namespace {
+
+// The kind of an ArrayBufferView, written before its contents.
+enum ArrayBufferViewTag : uint32_t {
+  kBufferTag = 0,
+  kInt8ArrayTag,
+  kUint8ArrayTag,
+  kUint8ClampedArrayTag,
+  kInt16ArrayTag,
+  kUint16ArrayTag,
+  kInt32ArrayTag,
+  kUint32ArrayTag,
+  kFloat32ArrayTag,
+  kFloat64ArrayTag,
+  kDataViewTag,
+};
+
+// Buffer.prototype in |context|, if node is loaded in it.
+v8::MaybeLocal<v8::Object> GetBufferPrototype(v8::Local<v8::Context> context) {
+  v8::Isolate* isolate = context->GetIsolate();
+  v8::Local<v8::Value> buffer;
+  v8::Local<v8::Value> prototype;
+  if (!context->Global()->Get(context, v8::String::NewFromUtf8(
+          isolate, "Buffer", v8::NewStringType::kInternalized)
+          .ToLocalChecked()).ToLocal(&buffer) ||
+      !buffer->IsFunction() ||
+      !buffer.As<v8::Object>()->Get(context, v8::String::NewFromUtf8(
+          isolate, "prototype", v8::NewStringType::kInternalized)
+          .ToLocalChecked()).ToLocal(&prototype) ||
+      !prototype->IsObject())
+    return v8::MaybeLocal<v8::Object>();
+  return prototype.As<v8::Object>();
+}
+
+bool GetArrayBufferViewTag(v8::Local<v8::Context> context,
+                           v8::Local<v8::ArrayBufferView> view,
+                           uint32_t* tag) {
+  if (view->IsUint8Array()) {
+    v8::Local<v8::Object> buffer_prototype;
+    bool is_buffer = GetBufferPrototype(context).ToLocal(&buffer_prototype) &&
+        view->GetPrototype() == buffer_prototype;
+    *tag = is_buffer ? kBufferTag : kUint8ArrayTag;
+  } else if (view->IsInt8Array()) {
+    *tag = kInt8ArrayTag;
+  } else if (view->IsUint8ClampedArray()) {
+    *tag = kUint8ClampedArrayTag;
+  } else if (view->IsInt16Array()) {
+    *tag = kInt16ArrayTag;
+  } else if (view->IsUint16Array()) {
+    *tag = kUint16ArrayTag;
+  } else if (view->IsInt32Array()) {
+    *tag = kInt32ArrayTag;
+  } else if (view->IsUint32Array()) {
+    *tag = kUint32ArrayTag;
+  } else if (view->IsFloat32Array()) {
+    *tag = kFloat32ArrayTag;
+  } else if (view->IsFloat64Array()) {
+    *tag = kFloat64ArrayTag;
+  } else if (view->IsDataView()) {
+    *tag = kDataViewTag;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+v8::MaybeLocal<v8::Object> NewArrayBufferView(
+    v8::Local<v8::Context> context,
+    uint32_t tag,
+    v8::Local<v8::ArrayBuffer> buffer) {
+  size_t length = buffer->ByteLength();
+  switch (tag) {
+    case kBufferTag: {
+      // Buffer.from gives a Uint8Array with the prototype of Buffer
+      v8::Local<v8::Uint8Array> array =
+          v8::Uint8Array::New(buffer, 0, length);
+      v8::Local<v8::Object> buffer_prototype;
+      if (GetBufferPrototype(context).ToLocal(&buffer_prototype) &&
+          !array->SetPrototype(context, buffer_prototype).FromMaybe(false))
+        return v8::MaybeLocal<v8::Object>();
+      return array;
+    }
+    case kInt8ArrayTag:
+      return v8::Int8Array::New(buffer, 0, length);
+    case kUint8ArrayTag:
+      return v8::Uint8Array::New(buffer, 0, length);
+    case kUint8ClampedArrayTag:
+      return v8::Uint8ClampedArray::New(buffer, 0, length);
+    case kInt16ArrayTag:
+      return v8::Int16Array::New(buffer, 0, length / sizeof(int16_t));
+    case kUint16ArrayTag:
+      return v8::Uint16Array::New(buffer, 0, length / sizeof(uint16_t));
+    case kInt32ArrayTag:
+      return v8::Int32Array::New(buffer, 0, length / sizeof(int32_t));
+    case kUint32ArrayTag:
+      return v8::Uint32Array::New(buffer, 0, length / sizeof(uint32_t));
+    case kFloat32ArrayTag:
+      return v8::Float32Array::New(buffer, 0, length / sizeof(float));
+    case kFloat64ArrayTag:
+      return v8::Float64Array::New(buffer, 0, length / sizeof(double));
+    case kDataViewTag:
+      return v8::DataView::New(buffer, 0, length);
+  }
+  return v8::MaybeLocal<v8::Object>();
+}
+
+// Writes the ArrayBufferViews as host objects, so that node Buffers are
+// still Buffers once deserialized rather than plain Uint8Arrays.
+class SerializerDelegate : public v8::ValueSerializer::Delegate {
+ public:
+  explicit SerializerDelegate(v8::Local<v8::Context> context)
+      : context_(context), serializer_(nullptr) {}
+
+  void set_serializer(v8::ValueSerializer* serializer) {
+    serializer_ = serializer;
+  }
+
+  void ThrowDataCloneError(v8::Local<v8::String> message) override {
+    context_->GetIsolate()->ThrowException(v8::Exception::Error(message));
+  }
+
+  v8::Maybe<bool> WriteHostObject(v8::Isolate* isolate,
+                                  v8::Local<v8::Object> object) override {
+    uint32_t tag;
+    if (!object->IsArrayBufferView() ||
+        !GetArrayBufferViewTag(
+            context_, object.As<v8::ArrayBufferView>(), &tag))
+      return v8::ValueSerializer::Delegate::WriteHostObject(isolate, object);
+
+    // only the viewed part of the ArrayBuffer is copied
+    v8::Local<v8::ArrayBufferView> view = object.As<v8::ArrayBufferView>();
+    size_t length = view->ByteLength();
+    std::unique_ptr<uint8_t[]> contents(new uint8_t[length]);
+    view->CopyContents(contents.get(), length);
+    serializer_->WriteUint32(tag);
+    serializer_->WriteUint32(static_cast<uint32_t>(length));
+    serializer_->WriteRawBytes(contents.get(), length);
+    return v8::Just(true);
+  }
+
+ private:
+  v8::Local<v8::Context> context_;
+  v8::ValueSerializer* serializer_;
+
+  DISALLOW_COPY_AND_ASSIGN(SerializerDelegate);
+};
+
+class DeserializerDelegate : public v8::ValueDeserializer::Delegate {
+ public:
+  explicit DeserializerDelegate(v8::Local<v8::Context> context)
+      : context_(context), deserializer_(nullptr) {}
+
+  void set_deserializer(v8::ValueDeserializer* deserializer) {
+    deserializer_ = deserializer;
+  }
+
+  v8::MaybeLocal<v8::Object> ReadHostObject(v8::Isolate* isolate) override {
+    uint32_t tag;
+    uint32_t length;
+    const void* contents;
+    if (!deserializer_->ReadUint32(&tag) ||
+        !deserializer_->ReadUint32(&length) ||
+        !deserializer_->ReadRawBytes(length, &contents)) {
+      return v8::ValueDeserializer::Delegate::ReadHostObject(isolate);
+    }
+
+    v8::Local<v8::ArrayBuffer> buffer = v8::ArrayBuffer::New(isolate, length);
+    memcpy(buffer->GetContents().Data(), contents, length);
+    return NewArrayBufferView(context_, tag, buffer);
+  }
+
+ private:
+  v8::Local<v8::Context> context_;
+  v8::ValueDeserializer* deserializer_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeserializerDelegate);
+};
+
+}  // namespace
+
+bool SerializeV8Value(v8::Local<v8::Context> context,
+                      v8::Local<v8::Value> value,
+                      std::vector<uint8_t>* data) {
+  SerializerDelegate delegate(context);
+  v8::ValueSerializer serializer(context->GetIsolate(), &delegate);
+  delegate.set_serializer(&serializer);
+  serializer.SetTreatArrayBufferViewsAsHostObjects(true);
+  serializer.WriteHeader();
+  if (!serializer.WriteValue(context, value).FromMaybe(false))
+    return false;
+
+  std::pair<uint8_t*, size_t> buffer = serializer.Release();
+  data->assign(buffer.first, buffer.first + buffer.second);
+  free(buffer.first);
+  return true;
+}
+
+v8::MaybeLocal<v8::Value> DeserializeV8Value(
+    v8::Local<v8::Context> context,
+    const std::vector<uint8_t>& data) {
+  DeserializerDelegate delegate(context);
+  v8::ValueDeserializer deserializer(
+      context->GetIsolate(), data.data(), data.size(), &delegate);
+  delegate.set_deserializer(&deserializer);
+  if (!deserializer.ReadHeader(context).FromMaybe(false))
+    return v8::MaybeLocal<v8::Value>();
+  return deserializer.ReadValue(context);
+}
+
+}  // namespace atom
@@ -0,0 +1,32 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ATOM_COMMON_V8_SERIALIZATION_H_
+#define ATOM_COMMON_V8_SERIALIZATION_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "v8/include/v8.h"
+
+namespace atom {
+
+// Serializes |value| with the structured clone format of v8::ValueSerializer,
+// which keeps typed arrays, Maps, Sets and Dates. Node Buffers are written
+// apart from other Uint8Arrays, and are Buffers again once deserialized in a
+// context where node is loaded. Returns false and throws a DataCloneError if
+// |value| can't be cloned.
+bool SerializeV8Value(v8::Local<v8::Context> context,
+                      v8::Local<v8::Value> value,
+                      std::vector<uint8_t>* data);
+
+// Reads a value written by SerializeV8Value(), returns an empty handle and
+// throws if |data| is invalid.
+v8::MaybeLocal<v8::Value> DeserializeV8Value(v8::Local<v8::Context> context,
+                                             const std::vector<uint8_t>& data);
+
+}  // namespace atom
+
+#endif  // ATOM_COMMON_V8_SERIALIZATION_H_
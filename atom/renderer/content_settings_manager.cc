@@ -5,12 +5,19 @@
 #include "atom/renderer/content_settings_manager.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 #include "atom/common/api/api_messages.h"
+#include "atom/common/content_settings_delta.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/memory/shared_memory.h"
+#include "base/pickle.h"
+#include "base/strings/string_util.h"
 #include "base/values.h"
-#include "components/content_settings/core/common/content_settings_pattern.h"
 #include "content/public/common/url_constants.h"
 #include "content/public/renderer/render_thread.h"
+#include "ipc/ipc_message_utils.h"
 #include "third_party/blink/public/web/web_document.h"
 #include "third_party/blink/public/web/web_local_frame.h"
 #include "url/gurl.h"
@@ -18,7 +25,52 @@
 
 namespace atom {
 
-ContentSettingsManager::ContentSettingsManager() {
+namespace {
+
+const char kFirstPartyPattern[] = "[firstParty]";
+
+const char* kContentTypeNames[] = {
+  "cookies",
+  "images",
+  "javascript",
+  "runInsecureContent",
+  "mutation",
+  "autoplay",
+};
+
+static_assert(arraysize(kContentTypeNames) ==
+                  ContentSettingsManager::CONTENT_TYPE_COUNT,
+              "kContentTypeNames must name every content type");
+
+// The host used to look up the rules for |url|, matching what
+// ContentSettingsPattern::Matches() compares.
+base::StringPiece GetLookupHost(const GURL& url) {
+  const GURL& local_url =
+      url.SchemeIsFileSystem() && url.inner_url() ? *url.inner_url() : url;
+  return base::TrimString(local_url.host_piece(), ".", base::TRIM_TRAILING);
+}
+
+}  // namespace
+
+ContentSettingsManager::CompiledRule::CompiledRule()
+    : any_secondary(false),
+      first_party(false),
+      setting(CONTENT_SETTING_DEFAULT) {}
+
+ContentSettingsManager::CompiledRule::CompiledRule(
+    const CompiledRule& other) = default;
+
+ContentSettingsManager::CompiledRule::~CompiledRule() {}
+
+ContentSettingsManager::CompiledRules::CompiledRules() {}
+
+ContentSettingsManager::CompiledRules::~CompiledRules() {}
+
+ContentSettingsManager::ContentSettingsManager()
+    : content_type_rules_(),
+      version_(0),
+      generation_(0),
+      resync_pending_(false) {
   content::RenderThread::Get()->AddObserver(this);
 }
 
@@ -51,6 +103,7 @@ bool ContentSettingsManager::OnControlMessageReceived(
     const IPC::Message& message) {
   bool handled = true;
   IPC_BEGIN_MESSAGE_MAP(ContentSettingsManager, message)
+    IPC_MESSAGE_HANDLER(AtomMsg_SetContentSettings, OnSetContentSettings)
     IPC_MESSAGE_HANDLER(AtomMsg_UpdateContentSettings, OnUpdateContentSettings)
     IPC_MESSAGE_HANDLER(AtomMsg_UpdateWebKitPrefs, OnUpdateWebKitPrefs)
     IPC_MESSAGE_UNHANDLED(handled = false)
@@ -61,32 +114,215 @@ bool ContentSettingsManager::OnControlMessageReceived(
 void ContentSettingsManager::OnUpdateWebKitPrefs(
     const content::WebPreferences& web_preferences) {
   web_preferences_ = content::WebPreferences(web_preferences);
+  ++generation_;
+}
+
+void ContentSettingsManager::OnSetContentSettings(
+    const base::SharedMemoryHandle& snapshot,
+    uint32_t size,
+    uint64_t version) {
+  resync_pending_ = false;
+
+  // the snapshot is shared by all the renderers of the browser context
+  base::SharedMemory memory(snapshot, true);
+  if (!memory.Map(size)) {
+    LOG(ERROR) << "Could not map the content settings snapshot";
+    return;
+  }
+
+  // The pickle reads the mapping in place. The settings are still parsed into
+  // a dictionary of our own, since the deltas splice its rule lists by index
+  // and the mapping is read-only and shared with the other renderers. The
+  // mapping isn't needed once the rules are compiled from the dictionary.
+  base::Pickle pickle(static_cast<const char*>(memory.memory()), size);
+  base::PickleIterator iter(pickle);
+  std::unique_ptr<base::DictionaryValue> content_settings(
+      new base::DictionaryValue);
+  if (!IPC::ReadParam(&pickle, &iter, content_settings.get())) {
+    LOG(ERROR) << "Invalid content settings snapshot";
+    return;
+  }
+
+  content_settings_ = std::move(content_settings);
+  version_ = version;
+
+  compiled_rules_.clear();
+  for (base::DictionaryValue::Iterator it(*content_settings_);
+       !it.IsAtEnd(); it.Advance()) {
+    const base::ListValue* rules = nullptr;
+    if (it.value().GetAsList(&rules))
+      CompileRules(*rules, &compiled_rules_[it.key()]);
+  }
+  OnContentSettingsChanged();
 }
 
 void ContentSettingsManager::OnUpdateContentSettings(
-    const base::DictionaryValue& content_settings) {
-  content_settings_ = content_settings.CreateDeepCopy();
+    uint64_t base_version,
+    uint64_t version,
+    const base::ListValue& delta) {
+  if (!content_settings_ || base_version != version_) {
+    Resync();
+    return;
+  }
+
+  std::vector<std::string> changed_types;
+  if (!ApplyContentSettingsDelta(delta,
+                                 content_settings_.get(),
+                                 &changed_types)) {
+    // the settings may be partially updated, the next snapshot will replace
+    // them
+    version_ = 0;
+    Resync();
+    return;
+  }
+  version_ = version;
+
+  // only compile the rules of the content types that changed
+  for (const auto& type : changed_types) {
+    compiled_rules_.erase(type);
+    const base::ListValue* rules = nullptr;
+    if (content_settings_->GetListWithoutPathExpansion(type, &rules))
+      CompileRules(*rules, &compiled_rules_[type]);
+  }
+  OnContentSettingsChanged();
 }
 
-ContentSetting ContentSettingsManager::GetSetting(
-    GURL primary_url,
-    GURL secondary_url,
-    std::string content_type,
-    bool incognito) {
-  bool default_value = true;
-  if (content_type == "cookies")
-    default_value = web_preferences_.cookie_enabled;
-  else if (content_type == "images")
-    default_value = web_preferences_.images_enabled;
-  else if (content_type == "javascript")
-    default_value = web_preferences_.javascript_enabled;
-  else if (content_type == "runInsecureContent")
-    default_value = web_preferences_.allow_running_insecure_content;
+void ContentSettingsManager::OnContentSettingsChanged() {
+  for (int i = 0; i < CONTENT_TYPE_COUNT; ++i) {
+    auto it = compiled_rules_.find(kContentTypeNames[i]);
+    content_type_rules_[i] =
+        it == compiled_rules_.end() ? nullptr : &it->second;
+  }
+  ++generation_;
+}
 
+void ContentSettingsManager::Resync() {
+  if (resync_pending_)
+    return;
+  resync_pending_ = true;
+  content::RenderThread::Get()->Send(new AtomHostMsg_ResyncContentSettings);
+}
+
+// static
+void ContentSettingsManager::CompileRules(const base::ListValue& list,
+                                          CompiledRules* compiled) {
+  for (const auto& value : list) {
+    const base::DictionaryValue* rule = nullptr;
+    std::string pattern_string;
+    std::string setting_string;
+    if (!value.GetAsDictionary(&rule) ||
+        !rule->GetString("primaryPattern", &pattern_string) ||
+        !rule->GetString("setting", &setting_string)) {
+      // skip invalid entries
+      // TODO(bridiver) should also send an ipc error message
+      continue;
+    }
+
+    CompiledRule compiled_rule;
+    compiled_rule.primary_pattern =
+        ContentSettingsPattern::FromString(pattern_string);
+    // an invalid pattern never matches
+    if (!compiled_rule.primary_pattern.IsValid())
+      continue;
+
+    std::string secondary_pattern_string;
+    rule->GetString("secondaryPattern", &secondary_pattern_string);
+    if (secondary_pattern_string.empty()) {
+      compiled_rule.any_secondary = true;
+    } else if (secondary_pattern_string == kFirstPartyPattern) {
+      compiled_rule.first_party = true;
+    } else {
+      compiled_rule.secondary_pattern =
+          ContentSettingsPattern::FromString(secondary_pattern_string);
+      if (!compiled_rule.secondary_pattern.IsValid())
+        continue;
+    }
+
+    if (setting_string != "block" && setting_string != "deny")
+      compiled_rule.setting = CONTENT_SETTING_ALLOW;
+    else
+      compiled_rule.setting = CONTENT_SETTING_BLOCK;
+
+    compiled->hosts[compiled_rule.primary_pattern.GetHost()].push_back(
+        compiled->rules.size());
+    compiled->rules.push_back(compiled_rule);
+  }
+}
+
+// static
+bool ContentSettingsManager::RuleMatches(const CompiledRule& rule,
+                                         const GURL& primary_url,
+                                         const GURL& secondary_url) {
+  if (!rule.primary_pattern.Matches(primary_url))
+    return false;
+
+  // if there is a secondary resource pattern it has to match as well
+  if (rule.any_secondary)
+    return true;
+
+  if (rule.first_party) {
+    // same as matching "[*.]<primary host>"
+    base::StringPiece primary_host = GetLookupHost(primary_url);
+    base::StringPiece secondary_host = GetLookupHost(secondary_url);
+    if (primary_host.empty() || !secondary_url.is_valid())
+      return false;
+    if (secondary_host == primary_host)
+      return true;
+    return secondary_host.size() > primary_host.size() &&
+        secondary_host.ends_with(primary_host) &&
+        secondary_host[secondary_host.size() - primary_host.size() - 1] == '.';
+  }
+
+  return rule.secondary_pattern.Matches(secondary_url);
+}
+
+ContentSetting ContentSettingsManager::GetSetting(
+    const GURL& primary_url,
+    const GURL& secondary_url,
+    ContentType content_type) {
   return GetContentSettingFromRules(primary_url,
                                     secondary_url,
-                                    content_type,
-                                    default_value);
+                                    content_type_rules_[content_type],
+                                    GetDefaultValue(content_type));
+}
+
+ContentSetting ContentSettingsManager::GetSetting(
+    const GURL& primary_url,
+    const GURL& secondary_url,
+    const std::string& content_type,
+    bool incognito) {
+  for (int i = 0; i < CONTENT_TYPE_COUNT; ++i) {
+    if (content_type == kContentTypeNames[i]) {
+      return GetSetting(primary_url,
+                        secondary_url,
+                        static_cast<ContentType>(i));
+    }
+  }
+
+  auto compiled = compiled_rules_.find(content_type);
+  return GetContentSettingFromRules(
+      primary_url,
+      secondary_url,
+      compiled == compiled_rules_.end() ? nullptr : &compiled->second,
+      true);
+}
+
+bool ContentSettingsManager::GetDefaultValue(ContentType content_type) const {
+  switch (content_type) {
+    case CONTENT_TYPE_COOKIES:
+      return web_preferences_.cookie_enabled;
+    case CONTENT_TYPE_IMAGES:
+      return web_preferences_.images_enabled;
+    case CONTENT_TYPE_JAVASCRIPT:
+      return web_preferences_.javascript_enabled;
+    case CONTENT_TYPE_RUN_INSECURE_CONTENT:
+      return web_preferences_.allow_running_insecure_content;
+    case CONTENT_TYPE_MUTATION:
+    case CONTENT_TYPE_AUTOPLAY:
+    case CONTENT_TYPE_COUNT:
+      break;
+  }
+  return true;
 }
 
 std::vector<std::string> ContentSettingsManager::GetContentTypes() {
@@ -104,53 +340,44 @@ std::vector<std::string> ContentSettingsManager::GetContentTypes() {
 ContentSetting ContentSettingsManager::GetContentSettingFromRules(
     const GURL& primary_url,
     const GURL& secondary_url,
-    const std::string& content_type,
-    const bool& default_value) {
+    const CompiledRules* compiled_rules,
+    bool default_value) {
   ContentSetting result = default_value
     ? ContentSetting::CONTENT_SETTING_ALLOW
     : ContentSetting::CONTENT_SETTING_BLOCK;
 
-  base::ListValue* rules = nullptr;
-  if (!content_settings_->GetList(content_type, &rules))
+  if (!compiled_rules)
     return result;
+  const CompiledRules& rules = *compiled_rules;
 
-  // all rules are evaluated in order and the
-  // most specific matching rule will apply
-  for (base::ListValue::iterator it = rules->begin();
-       it != rules->end(); ++it) {
-    base::DictionaryValue* rule;
-    std::string pattern_string;
-    std::string setting_string;
-    if (!it->GetAsDictionary(&rule) ||
-        !rule->GetString("primaryPattern", &pattern_string) ||
-        !rule->GetString("setting", &setting_string)) {
-      // skip invalid entries
-      // TODO(bridiver) should also send an ipc error message
-      ++it;
-    } else {
-      std::string secondary_pattern_string;
-      rule->GetString("secondaryPattern", &secondary_pattern_string);
-
-      ContentSetting setting = result;
-      if (setting_string != "block" && setting_string != "deny") {
-        setting = ContentSetting::CONTENT_SETTING_ALLOW;
-      } else {
-        setting = ContentSetting::CONTENT_SETTING_BLOCK;
+  // all rules are evaluated in order and the last matching rule applies, so
+  // look for the matching rule with the highest index among the rules for
+  // each suffix of the primary host, down to the rules without a host
+  const CompiledRule* match = nullptr;
+  size_t match_index = 0;
+  base::StringPiece host = GetLookupHost(primary_url);
+  while (true) {
+    auto entry = rules.hosts.find(host);
+    if (entry != rules.hosts.end()) {
+      for (auto it = entry->second.rbegin();
+           it != entry->second.rend() && (!match || *it > match_index);
+           ++it) {
+        const CompiledRule& rule = rules.rules[*it];
+        if (RuleMatches(rule, primary_url, secondary_url)) {
+          match = &rule;
+          match_index = *it;
+          break;
+        }
       }
-
-      if (secondary_pattern_string == "[firstParty]") {
-        secondary_pattern_string = "[*.]" + primary_url.HostNoBrackets();
-      }
-
-      if (ContentSettingsPattern::FromString(
-            pattern_string).Matches(primary_url) &&
-          // if there is a secondary resource pattern it has to match as well
-          (secondary_pattern_string.empty() ||
-            ContentSettingsPattern::FromString(
-              secondary_pattern_string).Matches(secondary_url)))
-        result = setting;
     }
+
+    if (host.empty())
+      break;
+    size_t dot = host.find('.');
+    host = dot == base::StringPiece::npos ?
+        base::StringPiece() : host.substr(dot + 1);
   }
-  return result;
+
+  return match ? match->setting : result;
 }
 }  // namespace atom
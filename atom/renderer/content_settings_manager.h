@@ -5,12 +5,17 @@
 #ifndef ATOM_RENDERER_CONTENT_SETTINGS_MANAGER_H_
 #define ATOM_RENDERER_CONTENT_SETTINGS_MANAGER_H_
 
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 #include "base/lazy_instance.h"
+#include "base/memory/shared_memory_handle.h"
+#include "base/strings/string_piece.h"
 #include "base/values.h"
 #include "components/content_settings/core/common/content_settings.h"
+#include "components/content_settings/core/common/content_settings_pattern.h"
 #include "content/public/common/web_preferences.h"
 #include "content/public/renderer/render_thread_observer.h"
 
@@ -29,6 +34,18 @@ namespace atom {
 
 class ContentSettingsManager : public content::RenderThreadObserver {
  public:
+  // The content types checked by the renderer, which are looked up without
+  // going through their names.
+  enum ContentType {
+    CONTENT_TYPE_COOKIES,
+    CONTENT_TYPE_IMAGES,
+    CONTENT_TYPE_JAVASCRIPT,
+    CONTENT_TYPE_RUN_INSECURE_CONTENT,
+    CONTENT_TYPE_MUTATION,
+    CONTENT_TYPE_AUTOPLAY,
+    CONTENT_TYPE_COUNT,
+  };
+
   ContentSettingsManager();
   ~ContentSettingsManager() override;
 
@@ -38,32 +55,95 @@ class ContentSettingsManager : public content::RenderThreadObserver {
   const base::DictionaryValue* content_settings() const
     { return content_settings_.get(); };
 
+  // Incremented with every update of the content settings, 0 until the
+  // settings are received.
+  uint64_t version() const { return version_; }
+
+  // Changes whenever the content settings or the preferences change, and so
+  // may the result of GetSetting().
+  uint64_t generation() const { return generation_; }
+
   ContentSetting GetSetting(
-      GURL primary_url,
-      GURL secondary_url,
-      std::string resource_id,
+      const GURL& primary_url,
+      const GURL& secondary_url,
+      ContentType content_type);
+  ContentSetting GetSetting(
+      const GURL& primary_url,
+      const GURL& secondary_url,
+      const std::string& content_type,
       bool incognito);
 
   std::vector<std::string> GetContentTypes();
 
  private:
+  // A rule parsed once when the settings are received.
+  struct CompiledRule {
+    CompiledRule();
+    CompiledRule(const CompiledRule& other);
+    ~CompiledRule();
+
+    ContentSettingsPattern primary_pattern;
+    ContentSettingsPattern secondary_pattern;
+    // The rule has no secondary pattern and applies to any resource.
+    bool any_secondary;
+    // "[firstParty]": the resource must be on the primary host or one of its
+    // subdomains.
+    bool first_party;
+    ContentSetting setting;
+  };
+
+  // The rules of one content type in list order, indexed by the host of their
+  // primary pattern. Patterns without a host (wildcards, file URLs...) are
+  // kept under the empty host. The last matching rule wins, so each host
+  // entry is walked backward and the lookup stops at its first match.
+  struct CompiledRules {
+    CompiledRules();
+    ~CompiledRules();
+
+    std::vector<CompiledRule> rules;
+    std::map<std::string, std::vector<size_t>, std::less<>> hosts;
+  };
+
+  static void CompileRules(const base::ListValue& list,
+                           CompiledRules* compiled);
+  static bool RuleMatches(const CompiledRule& rule,
+                          const GURL& primary_url,
+                          const GURL& secondary_url);
+
+  // Points |content_type_rules_| to the compiled rules after an update.
+  void OnContentSettingsChanged();
+  bool GetDefaultValue(ContentType content_type) const;
+
   ContentSetting GetContentSettingFromRules(
     const GURL& primary_url,
     const GURL& secondary_url,
-    const std::string& content_type,
-    const bool& enabled_per_settings);
+    const CompiledRules* compiled_rules,
+    bool default_value);
 
   // content::RenderThreadObserver:
   bool OnControlMessageReceived(const IPC::Message& message) override;
 
   void OnUpdateWebKitPrefs(
       const content::WebPreferences& web_preferences);
+  void OnSetContentSettings(
+      const base::SharedMemoryHandle& snapshot,
+      uint32_t size,
+      uint64_t version);
   void OnUpdateContentSettings(
-      const base::DictionaryValue& content_settings);
-
+      uint64_t base_version,
+      uint64_t version,
+      const base::ListValue& delta);
+  // Asks the browser for a new snapshot after missing an update.
+  void Resync();
 
   content::WebPreferences web_preferences_;
   std::unique_ptr<base::DictionaryValue> content_settings_;
+  std::map<std::string, CompiledRules> compiled_rules_;
+  // The rules of each ContentType in |compiled_rules_|, if any.
+  const CompiledRules* content_type_rules_[CONTENT_TYPE_COUNT];
+  uint64_t version_;
+  uint64_t generation_;
+  bool resync_pending_;
 
   DISALLOW_COPY_AND_ASSIGN(ContentSettingsManager);
 };
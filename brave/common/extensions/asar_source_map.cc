@@ -4,11 +4,18 @@
 
 #include "brave/common/extensions/asar_source_map.h"
 
+#include <memory>
+
+#include "atom/common/asar/archive.h"
 #include "atom/common/asar/asar_util.h"
 #include "base/callback.h"
 #include "base/bind.h"
 #include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
 #include "base/strings/string_split.h"
+#include "brave/common/extensions/module_code_cache.h"
 #include "gin/converter.h"
 
 namespace brave {
@@ -23,11 +30,8 @@ bool IsAsarPath(const base::FilePath& path) {
   return asar::GetAsarArchivePath(path, &archive, &relative);
 }
 
-bool ReadFromPath(
-    base::Callback<bool(const base::FilePath& path, std::string* contents)>,
-    const base::FilePath& file,
-    const base::FilePath& path,
-    std::string* source) {
+std::vector<base::FilePath> GetModulePaths(const base::FilePath& file,
+                                           const base::FilePath& path) {
   base::FilePath file_path = path.Append(file);
   if (!file_path.MatchesExtension(FILE_PATH_LITERAL(".js")))
     file_path = file_path.AddExtension(FILE_PATH_LITERAL("js"));
@@ -42,9 +46,19 @@ bool ReadFromPath(
       .Append(file)
       .AddExtension(FILE_PATH_LITERAL("js"));
 
-  return asar::ReadFileToString(file_path, source) ||
-      asar::ReadFileToString(module_path1, source) ||
-      asar::ReadFileToString(module_path2, source);
+  return { file_path, module_path1, module_path2 };
+}
+
+bool ReadFromPath(
+    base::Callback<bool(const base::FilePath& path, std::string* contents)>,
+    const base::FilePath& file,
+    const base::FilePath& path,
+    std::string* source) {
+  for (const base::FilePath& module_path : GetModulePaths(file, path)) {
+    if (asar::ReadFileToString(module_path, source))
+      return true;
+  }
+  return false;
 }
 
 bool ReadFromSearchPaths(const std::vector<base::FilePath>& search_paths,
@@ -65,6 +79,32 @@ bool ReadFromSearchPaths(const std::vector<base::FilePath>& search_paths,
   return false;
 }
 
+// Same as ReadFromSearchPaths, but sources packed in a mapped asar archive are
+// returned as a view of the mapping in |source| instead of being copied.
+// |archive| keeps the mapping alive and |contents| holds sources that had to
+// be read.
+bool MapFromSearchPaths(const std::vector<base::FilePath>& search_paths,
+                        const base::FilePath& file_path,
+                        std::shared_ptr<asar::Archive>* archive,
+                        std::string* contents,
+                        base::StringPiece* source) {
+  for (size_t i = 0; i < search_paths.size(); ++i) {
+    if (IsAsarPath(search_paths[i])) {
+      for (const base::FilePath& module_path :
+           GetModulePaths(file_path, search_paths[i])) {
+        if (asar::GetFileContents(module_path, archive, source))
+          return true;
+      }
+    }
+
+    if (ReadFromSearchPaths({ search_paths[i] }, file_path, contents)) {
+      *source = *contents;
+      return true;
+    }
+  }
+  return false;
+}
+
 const base::FilePath GetFilePath(const std::string& name) {
   std::vector<std::string> components = base::SplitString(
       name,
@@ -112,23 +152,44 @@ AsarSourceMap::~AsarSourceMap() {
 v8::Local<v8::String> AsarSourceMap::GetSource(
     v8::Isolate* isolate,
     const std::string& name) const {
-  std::string source;
-  if (ReadFromSearchPaths(search_paths_, GetFilePath(name), &source)) {
-    if (name != commonjs) {
-      source =
-          "const fn = function (require, module, console) { " + source + " };"
-          "require('" +
-            commonjs +
-          "').require(fn, exports, '" +
-          GetFilePath(name).AsUTF8Unsafe() +
-          "', this);";
-    }
-
-    return gin::StringToV8(isolate, source);
+  if (name == commonjs) {
+    std::shared_ptr<asar::Archive> archive;
+    std::string contents;
+    base::StringPiece source;
+    if (GetModuleSource(name, &archive, &contents, &source))
+      return gin::StringToV8(isolate, source);
+
+    NOTREACHED() << "No module is registered with name \"" << name << "\"";
+    return v8::Local<v8::String>();
   }
 
-  NOTREACHED() << "No module is registered with name \"" << name << "\"";
-  return v8::Local<v8::String>();
+  // The module itself is read and compiled by commonjs through
+  // ModuleCodeCache, so that other isolates can reuse the compiled code. It
+  // still gets the names of this wrapper scope.
+  std::string wrapper;
+#if DCHECK_IS_ON()
+  // kModuleScopeNames copies the parameters of the wrapper in
+  // ModuleSystem::WrapSource, which passes one argument per parameter, so a
+  // parameter added there changes the argument count
+  // besides require and console
+  size_t param_count = base::SplitStringPiece(kModuleScopeNames, ",",
+      base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY).size() + 2;
+  wrapper = "if (arguments.length !== " + base::SizeTToString(param_count) +
+      ") throw new Error('kModuleScopeNames does not match the module "
+      "system wrapper');";
+#endif
+  return gin::StringToV8(isolate, wrapper +
+      "require('" + std::string(commonjs) + "').require(exports, '" +
+      GetFilePath(name).AsUTF8Unsafe() + "', this, [" + kModuleScopeNames +
+      "]);");
+}
+
+bool AsarSourceMap::GetModuleSource(const std::string& name,
+                                    std::shared_ptr<asar::Archive>* archive,
+                                    std::string* contents,
+                                    base::StringPiece* source) const {
+  return MapFromSearchPaths(search_paths_, GetFilePath(name),
+                            archive, contents, source);
 }
 
 bool AsarSourceMap::Contains(const std::string& name) const {
@@ -5,14 +5,20 @@
 #ifndef BRAVE_COMMON_EXTENSIONS_ASAR_SOURCE_MAP_H_
 #define BRAVE_COMMON_EXTENSIONS_ASAR_SOURCE_MAP_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "base/compiler_specific.h"
 #include "base/files/file_path.h"
+#include "base/strings/string_piece.h"
 #include "extensions/renderer/source_map.h"
 #include "v8/include/v8.h"
 
+namespace asar {
+class Archive;
+}
+
 namespace brave {
 
 class AsarSourceMap : public extensions::SourceMap {
@@ -24,6 +30,15 @@ class AsarSourceMap : public extensions::SourceMap {
                                  const std::string& name) const override;
   bool Contains(const std::string& name) const override;
 
+  // Get the source of the module |name| without the commonjs wrapper. Sources
+  // packed in a mapped asar archive are a view of the mapping, which
+  // |archive| keeps alive, and |contents| holds the sources that had to be
+  // read.
+  bool GetModuleSource(const std::string& name,
+                       std::shared_ptr<asar::Archive>* archive,
+                       std::string* contents,
+                       base::StringPiece* source) const;
+
  private:
   std::vector<base::FilePath> search_paths_;
 
@@ -4,10 +4,18 @@
 
 #include "brave/common/extensions/crypto_bindings.h"
 
+#include <string.h>
+
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/base64.h"
+#include "base/sequenced_task_runner.h"
+#include "base/task_runner_util.h"
+#include "base/task_scheduler/post_task.h"
+#include "base/time/time.h"
 #include "components/os_crypt/os_crypt.h"
 #include "extensions/renderer/script_context.h"
 #include "extensions/renderer/v8_helpers.h"
@@ -16,9 +24,76 @@
 
 namespace brave {
 
+// The strings encrypted or decrypted by one call of encryptStrings or
+// decryptStrings.
+struct CryptoBatch {
+  CryptoBatch() : encrypt(false), binary(false), failed(0), bytes(0) {}
+
+  bool encrypt;
+  // Return ArrayBuffers instead of strings.
+  bool binary;
+  std::vector<std::string> inputs;
+  // base64 encoded ciphertexts, decoded on the crypto sequence.
+  std::vector<bool> encoded;
+  std::vector<std::string> outputs;
+  std::vector<bool> succeeded;
+  size_t failed;
+  size_t bytes;
+  base::TimeDelta duration;
+};
+
+namespace {
+
+std::unique_ptr<CryptoBatch> RunCryptoBatch(
+    std::unique_ptr<CryptoBatch> batch) {
+  base::TimeTicks start = base::TimeTicks::Now();
+  size_t count = batch->inputs.size();
+  batch->outputs.resize(count);
+  batch->succeeded.resize(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    std::string& input = batch->inputs[i];
+    batch->bytes += input.size();
+
+    bool success;
+    if (batch->encrypt) {
+      success = OSCrypt::EncryptString(input, &batch->outputs[i]);
+      if (success && !batch->binary) {
+        std::string encoded;
+        base::Base64Encode(batch->outputs[i], &encoded);
+        batch->outputs[i].swap(encoded);
+      }
+    } else {
+      std::string ciphertext;
+      if (batch->encoded[i]) {
+        success = base::Base64Decode(input, &ciphertext);
+      } else {
+        ciphertext.swap(input);
+        success = true;
+      }
+      success = success &&
+          OSCrypt::DecryptString(ciphertext, &batch->outputs[i]);
+    }
+
+    batch->succeeded[i] = success;
+    if (!success) {
+      batch->outputs[i].clear();
+      ++batch->failed;
+    }
+  }
+
+  batch->inputs.clear();
+  batch->duration = base::TimeTicks::Now() - start;
+  return batch;
+}
+
+}  // namespace
+
 CryptoBindings::CryptoBindings(
         extensions::ScriptContext* context)
-    : extensions::ObjectBackedNativeHandler(context) {}
+    : extensions::ObjectBackedNativeHandler(context),
+      crypto_task_runner_(base::CreateSequencedTaskRunnerWithTraits(
+          {base::MayBlock(), base::TaskPriority::USER_VISIBLE})) {}
 
 CryptoBindings::~CryptoBindings() {}
 
@@ -29,6 +104,12 @@ void CryptoBindings::AddRoutes() {
   RouteHandlerFunction(
       "DecryptString",
       base::Bind(&CryptoBindings::DecryptString, base::Unretained(this)));
+  RouteHandlerFunction(
+      "EncryptStrings",
+      base::Bind(&CryptoBindings::EncryptStrings, base::Unretained(this)));
+  RouteHandlerFunction(
+      "DecryptStrings",
+      base::Bind(&CryptoBindings::DecryptStrings, base::Unretained(this)));
 }
 
 // static
@@ -45,6 +126,12 @@ v8::Local<v8::Object> CryptoBindings::API(
   context->module_system()->SetNativeLazyField(
       crypto,
       "decryptString", "muon_crypto", "DecryptString");
+  context->module_system()->SetNativeLazyField(
+      crypto,
+      "encryptStrings", "muon_crypto", "EncryptStrings");
+  context->module_system()->SetNativeLazyField(
+      crypto,
+      "decryptStrings", "muon_crypto", "DecryptStrings");
   return crypto;
 }
 
@@ -93,4 +180,122 @@ void CryptoBindings::DecryptString(
   }
 }
 
+void CryptoBindings::EncryptStrings(
+    const v8::FunctionCallbackInfo<v8::Value>& args) {
+  RunBatch(args, true);
+}
+
+void CryptoBindings::DecryptStrings(
+    const v8::FunctionCallbackInfo<v8::Value>& args) {
+  RunBatch(args, false);
+}
+
+void CryptoBindings::RunBatch(
+    const v8::FunctionCallbackInfo<v8::Value>& args,
+    bool encrypt) {
+  auto isolate = context()->isolate();
+  v8::Local<v8::Context> v8_context = context()->v8_context();
+  if (args.Length() < 2 || !args[0]->IsArray() ||
+      !args[args.Length() - 1]->IsFunction()) {
+    isolate->ThrowException(v8::String::NewFromUtf8(isolate,
+        encrypt ? "Usage: encryptStrings(plaintexts[, options], callback)" :
+                  "Usage: decryptStrings(ciphertexts[, options], callback)"));
+    return;
+  }
+
+  std::unique_ptr<CryptoBatch> batch(new CryptoBatch);
+  batch->encrypt = encrypt;
+  if (args.Length() > 2 && args[1]->IsObject()) {
+    v8::Local<v8::Value> binary;
+    if (!args[1].As<v8::Object>()->Get(v8_context,
+            gin::StringToV8(isolate, "binary")).ToLocal(&binary))
+      return;
+    batch->binary = binary->BooleanValue();
+  }
+
+  // strings are plaintext to encrypt or base64 ciphertext to decrypt, and
+  // buffers hold raw bytes
+  v8::Local<v8::Array> inputs = args[0].As<v8::Array>();
+  for (uint32_t i = 0; i < inputs->Length(); ++i) {
+    v8::Local<v8::Value> input;
+    if (!inputs->Get(v8_context, i).ToLocal(&input))
+      return;
+
+    if (input->IsString()) {
+      batch->inputs.push_back(*v8::String::Utf8Value(input));
+      batch->encoded.push_back(true);
+    } else if (input->IsArrayBufferView()) {
+      v8::Local<v8::ArrayBufferView> view = input.As<v8::ArrayBufferView>();
+      std::string bytes(view->ByteLength(), '\0');
+      view->CopyContents(&bytes[0], bytes.size());
+      batch->inputs.push_back(std::move(bytes));
+      batch->encoded.push_back(false);
+    } else if (input->IsArrayBuffer()) {
+      v8::ArrayBuffer::Contents contents =
+          input.As<v8::ArrayBuffer>()->GetContents();
+      batch->inputs.push_back(std::string(
+          static_cast<const char*>(contents.Data()), contents.ByteLength()));
+      batch->encoded.push_back(false);
+    } else {
+      isolate->ThrowException(v8::String::NewFromUtf8(isolate,
+          "Each item must be a string, an ArrayBuffer or a view"));
+      return;
+    }
+  }
+
+  std::unique_ptr<v8::Global<v8::Function>> callback(
+      new v8::Global<v8::Function>(isolate,
+          args[args.Length() - 1].As<v8::Function>()));
+  base::PostTaskAndReplyWithResult(crypto_task_runner_.get(), FROM_HERE,
+      base::Bind(&RunCryptoBatch, base::Passed(&batch)),
+      base::Bind(&CryptoBindings::OnBatchDone, AsWeakPtr(),
+          base::Passed(&callback)));
+}
+
+void CryptoBindings::OnBatchDone(
+    std::unique_ptr<v8::Global<v8::Function>> callback,
+    std::unique_ptr<CryptoBatch> batch) {
+  if (!context()->is_valid())
+    return;
+
+  auto isolate = context()->isolate();
+  v8::HandleScope handle_scope(isolate);
+  v8::Local<v8::Context> v8_context = context()->v8_context();
+
+  // failed items are null
+  v8::Local<v8::Array> results =
+      v8::Array::New(isolate, batch->outputs.size());
+  for (size_t i = 0; i < batch->outputs.size(); ++i) {
+    const std::string& output = batch->outputs[i];
+    v8::Local<v8::Value> result = v8::Null(isolate);
+    if (batch->succeeded[i] && batch->binary) {
+      v8::Local<v8::ArrayBuffer> buffer =
+          v8::ArrayBuffer::New(isolate, output.size());
+      memcpy(buffer->GetContents().Data(), output.data(), output.size());
+      result = buffer;
+    } else if (batch->succeeded[i]) {
+      result = v8::String::NewFromUtf8(isolate, output.data(),
+          v8::NewStringType::kNormal, output.size()).ToLocalChecked();
+    }
+    results->Set(v8_context, i, result).FromJust();
+  }
+
+  double seconds = batch->duration.InSecondsF();
+  v8::Local<v8::Object> stats = v8::Object::New(isolate);
+  stats->Set(gin::StringToV8(isolate, "count"),
+      v8::Number::New(isolate, batch->outputs.size()));
+  stats->Set(gin::StringToV8(isolate, "failed"),
+      v8::Number::New(isolate, batch->failed));
+  stats->Set(gin::StringToV8(isolate, "bytes"),
+      v8::Number::New(isolate, batch->bytes));
+  stats->Set(gin::StringToV8(isolate, "duration"),
+      v8::Number::New(isolate, batch->duration.InMillisecondsF()));
+  stats->Set(gin::StringToV8(isolate, "bytesPerSecond"),
+      v8::Number::New(isolate, seconds > 0 ? batch->bytes / seconds : 0));
+
+  v8::Local<v8::Value> callback_args[] = { results, stats };
+  context()->SafeCallFunction(
+      v8::Local<v8::Function>::New(isolate, *callback), 2, callback_args);
+}
+
 }  // namespace brave
@@ -5,15 +5,26 @@
 #ifndef BRAVE_COMMON_EXTENSIONS_CRYPTO_BINDINGS_H_
 #define BRAVE_COMMON_EXTENSIONS_CRYPTO_BINDINGS_H_
 
+#include <memory>
+
 #include "base/compiler_specific.h"
 #include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
 #include "extensions/renderer/module_system.h"
 #include "extensions/renderer/object_backed_native_handler.h"
 #include "v8/include/v8.h"
 
+namespace base {
+class SequencedTaskRunner;
+}
+
 namespace brave {
 
-class CryptoBindings : public extensions::ObjectBackedNativeHandler {
+struct CryptoBatch;
+
+class CryptoBindings : public extensions::ObjectBackedNativeHandler,
+                       public base::SupportsWeakPtr<CryptoBindings> {
  public:
   explicit CryptoBindings(extensions::ScriptContext* context);
   ~CryptoBindings() override;
@@ -25,6 +36,15 @@ class CryptoBindings : public extensions::ObjectBackedNativeHandler {
  private:
   void EncryptString(const v8::FunctionCallbackInfo<v8::Value>& args);
   void DecryptString(const v8::FunctionCallbackInfo<v8::Value>& args);
+  void EncryptStrings(const v8::FunctionCallbackInfo<v8::Value>& args);
+  void DecryptStrings(const v8::FunctionCallbackInfo<v8::Value>& args);
+  // Post the strings or buffers of args[0] to |crypto_task_runner_|.
+  void RunBatch(const v8::FunctionCallbackInfo<v8::Value>& args,
+                bool encrypt);
+  void OnBatchDone(std::unique_ptr<v8::Global<v8::Function>> callback,
+                   std::unique_ptr<CryptoBatch> batch);
+
+  const scoped_refptr<base::SequencedTaskRunner> crypto_task_runner_;
 
   DISALLOW_COPY_AND_ASSIGN(CryptoBindings);
 };
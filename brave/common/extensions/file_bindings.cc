@@ -10,9 +10,11 @@
 #include "base/files/file_util.h"
 #include "base/files/important_file_writer.h"
 #include "base/sequenced_task_runner.h"
+#include "base/task_runner_util.h"
 #include "base/task_scheduler/post_task.h"
 #include "base/threading/sequenced_task_runner_handle.h"
 #include "brave/common/converters/string16_converter.h"
+#include "brave/common/extensions/journaled_store.h"
 #include "content/public/browser/browser_thread.h"
 #include "extensions/renderer/script_context.h"
 #include "extensions/renderer/v8_helpers.h"
@@ -24,6 +26,9 @@ namespace brave {
 
 namespace {
 
+// Journal records are written together when they come in quick succession.
+const int kJournalCommitDelayMs = 500;
+
 void PostWriteCallback(
     const base::Callback<void(bool success)>& callback,
     scoped_refptr<base::SequencedTaskRunner> reply_task_runner,
@@ -42,12 +47,34 @@ FileBindings::FileBindings(extensions::ScriptContext* context)
           {base::MayBlock(), base::TaskPriority::BACKGROUND,
            base::TaskShutdownBehavior::BLOCK_SHUTDOWN})) {}
 
-FileBindings::~FileBindings() {}
+FileBindings::Journal::Journal() : store(nullptr) {}
+
+FileBindings::Journal::~Journal() {}
+
+FileBindings::~FileBindings() {
+  // the stores are deleted once the pending records are written
+  for (const auto& it : journals_) {
+    CommitJournal(it.first, nullptr);
+    file_task_runner_->DeleteSoon(FROM_HERE, it.second->store);
+  }
+}
 
 void FileBindings::AddRoutes() {
   RouteHandlerFunction(
       "WriteImportantFile",
       base::Bind(&FileBindings::WriteImportantFile, base::Unretained(this)));
+  RouteHandlerFunction(
+      "OpenJournal",
+      base::Bind(&FileBindings::OpenJournal, base::Unretained(this)));
+  RouteHandlerFunction(
+      "AppendJournal",
+      base::Bind(&FileBindings::AppendJournal, base::Unretained(this)));
+  RouteHandlerFunction(
+      "FlushJournal",
+      base::Bind(&FileBindings::FlushJournal, base::Unretained(this)));
+  RouteHandlerFunction(
+      "CloseJournal",
+      base::Bind(&FileBindings::CloseJournal, base::Unretained(this)));
 }
 
 // static
@@ -60,6 +87,14 @@ v8::Local<v8::Object> FileBindings::API(
   v8::Local<v8::Object> file_api = v8::Object::New(context->isolate());
   context->module_system()->SetNativeLazyField(
         file_api, "writeImportant", "muon_file", "WriteImportantFile");
+  context->module_system()->SetNativeLazyField(
+        file_api, "openJournal", "muon_file", "OpenJournal");
+  context->module_system()->SetNativeLazyField(
+        file_api, "appendJournal", "muon_file", "AppendJournal");
+  context->module_system()->SetNativeLazyField(
+        file_api, "flushJournal", "muon_file", "FlushJournal");
+  context->module_system()->SetNativeLazyField(
+        file_api, "closeJournal", "muon_file", "CloseJournal");
 
   return file_api;
 }
@@ -115,6 +150,202 @@ void FileBindings::WriteImportantFile(
   writer.WriteNow(std::make_unique<std::string>(data));
 }
 
+bool FileBindings::GetJournalPath(
+    const v8::FunctionCallbackInfo<v8::Value>& args,
+    base::FilePath* path) {
+  auto isolate = args.GetIsolate();
+
+  base::FilePath::StringType path_name;
+  if (args.Length() < 1 || !args[0]->IsString() ||
+      !gin::Converter<base::FilePath::StringType>::FromV8(
+          isolate, args[0], &path_name)) {
+    isolate->ThrowException(v8::String::NewFromUtf8(
+        isolate, "`path` must be a string"));
+    return false;
+  }
+  *path = base::FilePath(path_name);
+  if (!path->IsAbsolute()) {
+    isolate->ThrowException(v8::String::NewFromUtf8(
+        isolate, "`path` must be absolute"));
+    return false;
+  }
+  return true;
+}
+
+void FileBindings::OpenJournal(
+    const v8::FunctionCallbackInfo<v8::Value>& args) {
+  auto isolate = args.GetIsolate();
+
+  base::FilePath path;
+  if (!GetJournalPath(args, &path))
+    return;
+
+  if (journals_.count(path)) {
+    isolate->ThrowException(v8::String::NewFromUtf8(
+        isolate, "The journal is already open"));
+    return;
+  }
+
+  if (args.Length() < 2 || !args[1]->IsFunction()) {
+    isolate->ThrowException(v8::String::NewFromUtf8(
+        isolate, "`callback` must be a function"));
+    return;
+  }
+  std::unique_ptr<v8::Global<v8::Function>> callback(
+      new v8::Global<v8::Function>(isolate, args[1].As<v8::Function>()));
+
+  std::unique_ptr<Journal> journal(new Journal);
+  journal->store = new JournaledStore(path);
+  base::PostTaskAndReplyWithResult(file_task_runner_.get(), FROM_HERE,
+      base::Bind(&JournaledStore::Load, base::Unretained(journal->store)),
+      base::Bind(&FileBindings::RunLoadCallback, AsWeakPtr(),
+          base::Passed(&callback)));
+  journals_[path] = std::move(journal);
+}
+
+void FileBindings::AppendJournal(
+    const v8::FunctionCallbackInfo<v8::Value>& args) {
+  auto isolate = args.GetIsolate();
+
+  base::FilePath path;
+  if (!GetJournalPath(args, &path))
+    return;
+
+  auto it = journals_.find(path);
+  if (it == journals_.end()) {
+    isolate->ThrowException(v8::String::NewFromUtf8(
+        isolate, "The journal is not open"));
+    return;
+  }
+
+  if (args.Length() < 2 || !args[1]->IsString()) {
+    isolate->ThrowException(v8::String::NewFromUtf8(
+        isolate, "`operations` must be a string"));
+    return;
+  }
+
+  std::string record;
+  if (!JournaledStore::ParseRecord(*v8::String::Utf8Value(args[1]),
+                                   &record)) {
+    isolate->ThrowException(v8::String::NewFromUtf8(
+        isolate, "`operations` must be a JSON array of operations"));
+    return;
+  }
+
+  Journal* journal = it->second.get();
+  journal->pending_records.append(record);
+  journal->pending_records.push_back('\n');
+  if (!journal->commit_timer.IsRunning()) {
+    journal->commit_timer.Start(FROM_HERE,
+        base::TimeDelta::FromMilliseconds(kJournalCommitDelayMs),
+        base::Bind(&FileBindings::CommitPendingRecords,
+            base::Unretained(this), path));
+  }
+}
+
+void FileBindings::FlushJournal(
+    const v8::FunctionCallbackInfo<v8::Value>& args) {
+  auto isolate = args.GetIsolate();
+
+  base::FilePath path;
+  if (!GetJournalPath(args, &path))
+    return;
+
+  if (!journals_.count(path)) {
+    isolate->ThrowException(v8::String::NewFromUtf8(
+        isolate, "The journal is not open"));
+    return;
+  }
+
+  std::unique_ptr<v8::Global<v8::Function>> callback;
+  if (args.Length() > 1 && args[1]->IsFunction()) {
+    callback.reset(
+        new v8::Global<v8::Function>(isolate, args[1].As<v8::Function>()));
+  }
+  CommitJournal(path, std::move(callback));
+}
+
+void FileBindings::CloseJournal(
+    const v8::FunctionCallbackInfo<v8::Value>& args) {
+  auto isolate = args.GetIsolate();
+
+  base::FilePath path;
+  if (!GetJournalPath(args, &path))
+    return;
+
+  auto it = journals_.find(path);
+  if (it == journals_.end()) {
+    isolate->ThrowException(v8::String::NewFromUtf8(
+        isolate, "The journal is not open"));
+    return;
+  }
+
+  std::unique_ptr<v8::Global<v8::Function>> callback;
+  if (args.Length() > 1 && args[1]->IsFunction()) {
+    callback.reset(
+        new v8::Global<v8::Function>(isolate, args[1].As<v8::Function>()));
+  }
+
+  // leave a plain snapshot behind, which is the fastest to load
+  JournaledStore* store = it->second->store;
+  CommitJournal(path, nullptr);
+  base::PostTaskAndReplyWithResult(file_task_runner_.get(), FROM_HERE,
+      base::Bind(&JournaledStore::Compact, base::Unretained(store)),
+      base::Bind(&FileBindings::RunCallback, AsWeakPtr(),
+          base::Passed(&callback)));
+  file_task_runner_->DeleteSoon(FROM_HERE, store);
+  journals_.erase(it);
+}
+
+void FileBindings::CommitJournal(
+    const base::FilePath& path,
+    std::unique_ptr<v8::Global<v8::Function>> callback) {
+  auto it = journals_.find(path);
+  if (it == journals_.end())
+    return;
+
+  Journal* journal = it->second.get();
+  journal->commit_timer.Stop();
+  std::string records;
+  records.swap(journal->pending_records);
+
+  // the callback runs once the records written before are on disk, even if
+  // there are none left
+  if (callback) {
+    base::PostTaskAndReplyWithResult(file_task_runner_.get(), FROM_HERE,
+        base::Bind(&JournaledStore::Append, base::Unretained(journal->store),
+            records),
+        base::Bind(&FileBindings::RunCallback, AsWeakPtr(),
+            base::Passed(&callback)));
+  } else if (!records.empty()) {
+    file_task_runner_->PostTask(FROM_HERE,
+        base::Bind(base::IgnoreResult(&JournaledStore::Append),
+            base::Unretained(journal->store), records));
+  }
+}
+
+void FileBindings::CommitPendingRecords(const base::FilePath& path) {
+  CommitJournal(path, nullptr);
+}
+
+void FileBindings::RunLoadCallback(
+    std::unique_ptr<v8::Global<v8::Function>> callback,
+    std::unique_ptr<std::string> json) {
+  if (!context()->is_valid())
+    return;
+
+  auto isolate = context()->isolate();
+  v8::HandleScope handle_scope(isolate);
+
+  v8::Local<v8::Value> callback_args[] = {
+      json ? v8::String::NewFromUtf8(isolate, json->data(),
+                                     v8::NewStringType::kNormal,
+                                     json->size()).ToLocalChecked()
+           : v8::Local<v8::Value>(v8::Null(isolate)) };
+  context()->SafeCallFunction(
+      v8::Local<v8::Function>::New(isolate, *callback), 1, callback_args);
+}
+
 void FileBindings::RunCallback(
     std::unique_ptr<v8::Global<v8::Function>> callback, bool success) {
   if (!context()->is_valid() || !callback.get() || callback->IsEmpty())
@@ -5,21 +5,26 @@
 #ifndef BRAVE_COMMON_EXTENSIONS_FILE_BINDINGS_H_
 #define BRAVE_COMMON_EXTENSIONS_FILE_BINDINGS_H_
 
+#include <map>
 #include <memory>
+#include <string>
 
 #include "base/compiler_specific.h"
+#include "base/files/file_path.h"
 #include "base/macros.h"
 #include "base/memory/weak_ptr.h"
+#include "base/timer/timer.h"
 #include "extensions/renderer/object_backed_native_handler.h"
 #include "v8/include/v8.h"
 
 namespace base {
-class FilePath;
 class SequencedTaskRunner;
 }
 
 namespace brave {
 
+class JournaledStore;
+
 class FileBindings : public extensions::ObjectBackedNativeHandler,
                      public base::SupportsWeakPtr<FileBindings> {
  public:
@@ -32,11 +37,37 @@ class FileBindings : public extensions::ObjectBackedNativeHandler,
   static v8::Local<v8::Object> API(extensions::ScriptContext* context);
 
  private:
+  // An open JournaledStore, which lives on |file_task_runner_|.
+  struct Journal {
+    Journal();
+    ~Journal();
+
+    JournaledStore* store;
+    // Records not written yet, so that changes made in quick succession are
+    // written together.
+    std::string pending_records;
+    base::OneShotTimer commit_timer;
+  };
+
   void WriteImportantFile(const v8::FunctionCallbackInfo<v8::Value>& args);
+  void OpenJournal(const v8::FunctionCallbackInfo<v8::Value>& args);
+  void AppendJournal(const v8::FunctionCallbackInfo<v8::Value>& args);
+  void FlushJournal(const v8::FunctionCallbackInfo<v8::Value>& args);
+  void CloseJournal(const v8::FunctionCallbackInfo<v8::Value>& args);
+  bool GetJournalPath(const v8::FunctionCallbackInfo<v8::Value>& args,
+                      base::FilePath* path);
+  // Post the pending records of the journal at |path|, and then |callback|
+  // if there is one.
+  void CommitJournal(const base::FilePath& path,
+                     std::unique_ptr<v8::Global<v8::Function>> callback);
+  void CommitPendingRecords(const base::FilePath& path);
   void RunCallback(
       std::unique_ptr<v8::Global<v8::Function>> holder, bool success);
+  void RunLoadCallback(std::unique_ptr<v8::Global<v8::Function>> callback,
+                       std::unique_ptr<std::string> json);
 
   const scoped_refptr<base::SequencedTaskRunner> file_task_runner_;
+  std::map<base::FilePath, std::unique_ptr<Journal>> journals_;
 
   DISALLOW_COPY_AND_ASSIGN(FileBindings);
 };
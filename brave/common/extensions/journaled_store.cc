@@ -0,0 +1,325 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/extensions/journaled_store.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/json/json_reader.h"
+#include "base/json/json_writer.h"
+#include "base/logging.h"
+#include "base/sha1.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/values.h"
+
+namespace brave {
+
+namespace {
+
+// The journal is folded into the snapshot once it is larger than both this
+// and the snapshot, so that replaying it never costs much more than reading
+// the snapshot.
+const int64_t kMinCompactionSize = 256 * 1024;
+
+// The first line of the journal, which ties it to the snapshot it applies to.
+std::string JournalHeader(const std::string& snapshot) {
+  const std::string hash = base::SHA1HashString(snapshot);
+  return "{\"snapshot\":\"" + base::HexEncode(hash.data(), hash.size()) +
+      "\"}\n";
+}
+
+struct Operation {
+  bool remove;
+  std::vector<std::string> path;
+  std::unique_ptr<base::Value> value;
+};
+
+// Split a JSON pointer into its reference tokens.
+bool ParsePointer(const std::string& pointer,
+                  std::vector<std::string>* tokens) {
+  if (pointer.empty())
+    return true;
+  if (pointer[0] != '/')
+    return false;
+
+  for (std::string token : base::SplitString(pointer.substr(1), "/",
+           base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL)) {
+    base::ReplaceSubstringsAfterOffset(&token, 0, "~1", "/");
+    base::ReplaceSubstringsAfterOffset(&token, 0, "~0", "~");
+    tokens->push_back(token);
+  }
+  return true;
+}
+
+bool ParseOperation(base::Value* value, Operation* operation) {
+  base::DictionaryValue* dict;
+  std::string op;
+  std::string pointer;
+  if (!value->GetAsDictionary(&dict) ||
+      !dict->GetString("op", &op) ||
+      !dict->GetString("path", &pointer) ||
+      !ParsePointer(pointer, &operation->path))
+    return false;
+
+  operation->remove = op == "remove";
+  if (operation->remove)
+    return true;
+  if (op != "add" && op != "replace")
+    return false;
+  // the root can only be replaced by another object
+  return dict->Remove("value", &operation->value) &&
+      (!operation->path.empty() || operation->value->is_dict());
+}
+
+// The values are moved out of |list| into the operations.
+bool ParseOperations(base::ListValue* list,
+                     std::vector<Operation>* operations) {
+  operations->resize(list->GetSize());
+  for (size_t i = 0; i < operations->size(); ++i) {
+    base::Value* value;
+    if (!list->Get(i, &value) || !ParseOperation(value, &(*operations)[i]))
+      return false;
+  }
+  return true;
+}
+
+// Whether the members along the path of |operations[index]| are objects, or
+// missing, once the operations before it are applied to |document|. A path
+// through an array or another value is rejected rather than replacing it.
+bool HasValidParents(const std::vector<Operation>& operations,
+                     size_t index,
+                     const base::DictionaryValue& document) {
+  const std::vector<std::string>& path = operations[index].path;
+  if (path.empty())
+    return true;
+  size_t depth = path.size() - 1;
+
+  // the parent is inside the value of the last operation on its path, if any
+  const base::Value* value = &document;
+  size_t start = 0;
+  for (size_t i = index; i-- > 0;) {
+    const Operation& previous = operations[i];
+    if (previous.path.size() <= depth &&
+        std::equal(previous.path.begin(), previous.path.end(),
+                   path.begin())) {
+      if (previous.remove)
+        return true;
+      value = previous.value.get();
+      start = previous.path.size();
+      break;
+    }
+  }
+
+  for (size_t i = start;; ++i) {
+    if (!value->is_dict())
+      return false;
+    if (i == depth)
+      return true;
+    value = value->FindKey(path[i]);
+    if (!value)
+      return true;
+  }
+}
+
+// Missing objects along the path are created when setting a value. The
+// path must have been checked with HasValidParents.
+void ApplyOperation(Operation* operation,
+                    std::unique_ptr<base::DictionaryValue>* document) {
+  if (operation->path.empty()) {
+    *document = operation->remove ?
+        std::make_unique<base::DictionaryValue>() :
+        base::DictionaryValue::From(std::move(operation->value));
+    return;
+  }
+
+  base::DictionaryValue* parent = document->get();
+  for (size_t i = 0; i + 1 < operation->path.size(); ++i) {
+    base::Value* child = parent->FindKey(operation->path[i]);
+    if (!child) {
+      if (operation->remove)
+        return;
+      child = parent->SetDictionaryWithoutPathExpansion(operation->path[i],
+          std::make_unique<base::DictionaryValue>());
+    }
+    DCHECK(child->is_dict());
+    parent = static_cast<base::DictionaryValue*>(child);
+  }
+
+  if (operation->remove) {
+    parent->RemoveWithoutPathExpansion(operation->path.back(), nullptr);
+  } else {
+    parent->SetWithoutPathExpansion(operation->path.back(),
+                                    std::move(operation->value));
+  }
+}
+
+}  // namespace
+
+// static
+bool JournaledStore::ParseRecord(const std::string& json, std::string* record) {
+  std::unique_ptr<base::ListValue> list =
+      base::ListValue::From(base::JSONReader::Read(json));
+  std::vector<Operation> operations;
+  // written on a single line, as the records are separated by newlines
+  return list && base::JSONWriter::Write(*list, record) &&
+      ParseOperations(list.get(), &operations);
+}
+
+JournaledStore::JournaledStore(const base::FilePath& path)
+    : path_(path),
+      journal_path_(path.AddExtension(FILE_PATH_LITERAL("journal"))),
+      journal_size_(0),
+      snapshot_size_(0) {
+  DETACH_FROM_SEQUENCE(sequence_checker_);
+}
+
+JournaledStore::~JournaledStore() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+}
+
+std::unique_ptr<std::string> JournaledStore::Load() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK(!document_);
+
+  std::unique_ptr<base::DictionaryValue> document(new base::DictionaryValue);
+  // a missing snapshot is hashed as an empty one
+  std::string snapshot;
+  if (base::ReadFileToString(path_, &snapshot)) {
+    document = base::DictionaryValue::From(base::JSONReader::Read(snapshot));
+    if (!document) {
+      LOG(ERROR) << "Could not parse " << path_.value();
+      return nullptr;
+    }
+    snapshot_size_ = snapshot.size();
+  } else if (base::PathExists(path_)) {
+    LOG(ERROR) << "Could not read " << path_.value();
+    return nullptr;
+  }
+  document_ = std::move(document);
+  journal_header_ = JournalHeader(snapshot);
+
+  // replay the journal up to the first incomplete record, unless it was
+  // written against another snapshot, in which case it is emptied
+  std::string journal;
+  if (base::ReadFileToString(journal_path_, &journal) &&
+      base::StartsWith(journal, journal_header_,
+                       base::CompareCase::SENSITIVE)) {
+    size_t start = journal_header_.size();
+    size_t end;
+    while ((end = journal.find('\n', start)) != std::string::npos) {
+      std::unique_ptr<base::ListValue> record = base::ListValue::From(
+          base::JSONReader::Read(journal.substr(start, end - start)));
+      if (!record)
+        break;
+      if (!ApplyRecord(record.get()))
+        LOG(ERROR) << "Skipped a journal record for " << path_.value();
+      start = end + 1;
+    }
+    journal_size_ = start;
+  }
+
+  journal_.Initialize(journal_path_,
+                      base::File::FLAG_OPEN_ALWAYS | base::File::FLAG_WRITE);
+  if (!journal_.IsValid() ||
+      !journal_.SetLength(journal_size_) ||
+      journal_.Seek(base::File::FROM_BEGIN, journal_size_) != journal_size_) {
+    LOG(ERROR) << "Could not open " << journal_path_.value();
+    document_.reset();
+    return nullptr;
+  }
+
+  if (journal_size_ > std::max(kMinCompactionSize, snapshot_size_))
+    Compact();
+
+  std::unique_ptr<std::string> json(new std::string);
+  base::JSONWriter::Write(*document_, json.get());
+  return json;
+}
+
+bool JournaledStore::Append(const std::string& records) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (!document_)
+    return false;
+
+  bool success = true;
+  std::string valid_records;
+  for (const auto& record : base::SplitStringPiece(records, "\n",
+           base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    std::unique_ptr<base::ListValue> list =
+        base::ListValue::From(base::JSONReader::Read(record));
+    if (list && ApplyRecord(list.get())) {
+      record.AppendToString(&valid_records);
+      valid_records.push_back('\n');
+    } else {
+      LOG(ERROR) << "Invalid journal record for " << path_.value();
+      success = false;
+    }
+  }
+  if (valid_records.empty())
+    return success;
+  if (journal_size_ == 0)
+    valid_records.insert(0, journal_header_);
+
+  int written = journal_.IsValid() ?
+      journal_.WriteAtCurrentPos(valid_records.data(), valid_records.size()) :
+      -1;
+  if (written != static_cast<int>(valid_records.size()) || !journal_.Flush()) {
+    // the document is ahead of the journal, so write all of it
+    LOG(ERROR) << "Could not write " << journal_path_.value();
+    return Compact() && success;
+  }
+  journal_size_ += written;
+
+  if (journal_size_ > std::max(kMinCompactionSize, snapshot_size_))
+    return Compact() && success;
+  return success;
+}
+
+bool JournaledStore::Compact() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (!document_)
+    return false;
+
+  std::string snapshot;
+  if (!base::JSONWriter::Write(*document_, &snapshot) ||
+      !base::ImportantFileWriter::WriteFileAtomically(path_, snapshot))
+    return false;
+  snapshot_size_ = snapshot.size();
+  journal_header_ = JournalHeader(snapshot);
+
+  // the old journal no longer matches the snapshot, so it is ignored on load
+  // even if it can't be emptied; the changes are then written to the
+  // snapshot until the journal can be opened again
+  if (!journal_.IsValid() || !journal_.SetLength(0) ||
+      journal_.Seek(base::File::FROM_BEGIN, 0) != 0) {
+    journal_.Close();
+    journal_.Initialize(journal_path_,
+                        base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  }
+  journal_size_ = 0;
+  return true;
+}
+
+bool JournaledStore::ApplyRecord(base::ListValue* record) {
+  // check the whole record first so that it is applied entirely or not at all
+  std::vector<Operation> operations;
+  if (!ParseOperations(record, &operations))
+    return false;
+  for (size_t i = 0; i < operations.size(); ++i) {
+    if (!HasValidParents(operations, i, *document_))
+      return false;
+  }
+
+  for (auto& operation : operations)
+    ApplyOperation(&operation, &document_);
+  return true;
+}
+
+}  // namespace brave
@@ -0,0 +1,88 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_EXTENSIONS_JOURNALED_STORE_H_
+#define BRAVE_COMMON_EXTENSIONS_JOURNALED_STORE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/sequence_checker.h"
+
+namespace base {
+class DictionaryValue;
+class ListValue;
+}
+
+namespace brave {
+
+// A JSON document saved as a snapshot at |path| and a journal of the changes
+// made since, at |path|.journal. Each line of the journal is a JSON array of
+// patch operations: { "op": "add" | "replace" | "remove", "path": pointer,
+// "value": value }, where the pointer is a JSON pointer to an object member.
+// Objects missing along the pointer are created, but a pointer through an
+// array or any other value is rejected.
+// Changing a part of the document only appends its operations to the
+// journal, which is folded back into the snapshot once it grows larger than
+// the snapshot itself.
+//
+// The journal starts with a header holding the hash of the snapshot it
+// applies to, so a journal which was already folded into the snapshot, if
+// the process died before emptying it, is ignored on load. Replay stops at
+// a record cut short by a crash, and skips records which don't apply.
+//
+// The snapshot is a plain JSON file, so a file written with writeImportant
+// can be opened as a store.
+//
+// Must be used on a sequence which allows blocking.
+class JournaledStore {
+ public:
+  explicit JournaledStore(const base::FilePath& path);
+  ~JournaledStore();
+
+  // Check that |json| is an array of valid operations, and write it to
+  // |record| on a single line.
+  static bool ParseRecord(const std::string& json, std::string* record);
+
+  // Read the snapshot and replay the journal. Returns the document as JSON,
+  // or null if the store can't be read, in which case it can't be written
+  // either so that a damaged snapshot isn't overwritten.
+  std::unique_ptr<std::string> Load();
+
+  // Apply and journal |records|, newline separated arrays of operations.
+  // Records which don't apply to the document, such as the ones with a path
+  // through an array, are dropped. Returns false if a record was dropped or
+  // the records could not be written.
+  bool Append(const std::string& records);
+
+  // Write the document to the snapshot and empty the journal.
+  bool Compact();
+
+ private:
+  // The values are moved out of |record|.
+  bool ApplyRecord(base::ListValue* record);
+
+  const base::FilePath path_;
+  const base::FilePath journal_path_;
+  base::File journal_;
+  // Written before the first record of an empty journal.
+  std::string journal_header_;
+  // Null until the store is loaded.
+  std::unique_ptr<base::DictionaryValue> document_;
+  int64_t journal_size_;
+  int64_t snapshot_size_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  DISALLOW_COPY_AND_ASSIGN(JournaledStore);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_EXTENSIONS_JOURNALED_STORE_H_
@@ -0,0 +1,128 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/extensions/module_code_cache.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "base/hash.h"
+#include "gin/converter.h"
+
+namespace brave {
+
+namespace {
+
+// Strict mode, like the wrapper of the module system.
+const char kModulePrefix[] = "(function (require, module, console, ";
+const char kModuleScopeSuffix[] = ") {'use strict';";
+const char kModuleSuffix[] = "\n})";
+
+base::LazyInstance<ModuleCodeCache>::Leaky g_module_code_cache =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+const char kModuleScopeNames[] =
+    "define, requireNative, requireAsync, exports, privates, apiBridge, "
+    "bindingUtil, getInternalApi, $Array, $Function, $JSON, $Object, "
+    "$RegExp, $String, $Error, $Promise";
+
+ModuleCodeCache::Entry::Entry() : source_hash(0) {}
+
+ModuleCodeCache::Entry::Entry(const Entry& other) = default;
+
+ModuleCodeCache::Entry::~Entry() {}
+
+ModuleCodeCache::ModuleCodeCache() {}
+
+ModuleCodeCache::~ModuleCodeCache() {}
+
+// static
+ModuleCodeCache* ModuleCodeCache::GetInstance() {
+  return g_module_code_cache.Pointer();
+}
+
+v8::MaybeLocal<v8::Value> ModuleCodeCache::RunModule(
+    v8::Local<v8::Context> context,
+    const std::string& name,
+    const base::StringPiece& source,
+    v8::Local<v8::Value> receiver,
+    int argc,
+    v8::Local<v8::Value> argv[]) {
+  v8::Isolate* isolate = context->GetIsolate();
+  uint32_t source_hash = base::PersistentHash(source.data(), source.size());
+
+  // the wrapped source is assembled into a single string, so that V8 gets a
+  // flat string to compile instead of a concatenation it would copy again
+  // to flatten it
+  std::string wrapped(kModulePrefix);
+  wrapped.reserve(wrapped.size() + strlen(kModuleScopeNames) +
+                  strlen(kModuleScopeSuffix) + source.size() +
+                  strlen(kModuleSuffix));
+  wrapped.append(kModuleScopeNames);
+  wrapped.append(kModuleScopeSuffix);
+  source.AppendToString(&wrapped);
+  wrapped.append(kModuleSuffix);
+  v8::Local<v8::String> code = gin::StringToV8(isolate, wrapped);
+
+  v8::ScriptCompiler::CachedData* cached_data = Get(name, source_hash);
+  v8::ScriptCompiler::CompileOptions options = cached_data ?
+      v8::ScriptCompiler::kConsumeCodeCache :
+      v8::ScriptCompiler::kNoCompileOptions;
+  // |script_source| owns |cached_data|
+  v8::ScriptCompiler::Source script_source(
+      code, v8::ScriptOrigin(gin::StringToV8(isolate, name)), cached_data);
+
+  v8::Local<v8::Script> script;
+  if (!v8::ScriptCompiler::Compile(context, &script_source, options)
+          .ToLocal(&script))
+    return v8::MaybeLocal<v8::Value>();
+
+  v8::Local<v8::Value> fn;
+  if (!script->Run(context).ToLocal(&fn) || !fn->IsFunction())
+    return v8::MaybeLocal<v8::Value>();
+
+  v8::Local<v8::Value> result;
+  if (!fn.As<v8::Function>()->Call(context, receiver, argc, argv)
+          .ToLocal(&result))
+    return v8::MaybeLocal<v8::Value>();
+
+  // the cache is also replaced when V8 rejected it, e.g. after a flag change
+  if (!cached_data || script_source.GetCachedData()->rejected) {
+    std::unique_ptr<v8::ScriptCompiler::CachedData> new_data(
+        v8::ScriptCompiler::CreateCodeCache(script->GetUnboundScript()));
+    if (new_data)
+      Put(name, source_hash, *new_data);
+  }
+  return result;
+}
+
+v8::ScriptCompiler::CachedData* ModuleCodeCache::Get(const std::string& name,
+                                                     uint32_t source_hash) {
+  base::AutoLock auto_lock(lock_);
+  auto it = entries_.find(name);
+  if (it == entries_.end() || it->second.source_hash != source_hash)
+    return nullptr;
+
+  // V8 may keep using the data after the entry is replaced by another thread
+  const std::vector<uint8_t>& data = it->second.data;
+  uint8_t* copy = new uint8_t[data.size()];
+  std::copy(data.begin(), data.end(), copy);
+  return new v8::ScriptCompiler::CachedData(
+      copy, data.size(), v8::ScriptCompiler::CachedData::BufferOwned);
+}
+
+void ModuleCodeCache::Put(const std::string& name,
+                          uint32_t source_hash,
+                          const v8::ScriptCompiler::CachedData& cached_data) {
+  base::AutoLock auto_lock(lock_);
+  Entry& entry = entries_[name];
+  entry.source_hash = source_hash;
+  entry.data.assign(cached_data.data, cached_data.data + cached_data.length);
+}
+
+}  // namespace brave
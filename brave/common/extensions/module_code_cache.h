@@ -0,0 +1,78 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_EXTENSIONS_MODULE_CODE_CACHE_H_
+#define BRAVE_COMMON_EXTENSIONS_MODULE_CODE_CACHE_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/lazy_instance.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+#include "base/synchronization/lock.h"
+#include "v8/include/v8.h"
+
+namespace brave {
+
+// The names of the module system wrapper scope (define, privates, $Array...)
+// that muon modules can use besides the require, module and console of
+// commonjs, in the order their values are passed to the modules.
+extern const char kModuleScopeNames[];
+
+// The V8 code cache of the modules loaded by the muon module system, shared
+// by all the isolates of the process. The first isolate to run a module
+// stores its code cache, and the next ones (each new worker in particular)
+// deserialize the compiled code instead of parsing and compiling the source
+// again.
+class ModuleCodeCache {
+ public:
+  static ModuleCodeCache* GetInstance();
+
+  // Compile |source|, the body of the module |name|, into a function of
+  // (require, module, console, <kModuleScopeNames>) and call it on
+  // |receiver|. The cache entry is created once the module has run, so that
+  // it includes the functions compiled while loading it.
+  v8::MaybeLocal<v8::Value> RunModule(v8::Local<v8::Context> context,
+                                      const std::string& name,
+                                      const base::StringPiece& source,
+                                      v8::Local<v8::Value> receiver,
+                                      int argc,
+                                      v8::Local<v8::Value> argv[]);
+
+ private:
+  friend struct base::LazyInstanceTraitsBase<ModuleCodeCache>;
+
+  struct Entry {
+    Entry();
+    Entry(const Entry& other);
+    ~Entry();
+
+    // The cache is dropped when the source of the module changes.
+    uint32_t source_hash;
+    std::vector<uint8_t> data;
+  };
+
+  ModuleCodeCache();
+  ~ModuleCodeCache();
+
+  // Returns a copy of the cached data, or null.
+  v8::ScriptCompiler::CachedData* Get(const std::string& name,
+                                      uint32_t source_hash);
+  void Put(const std::string& name,
+           uint32_t source_hash,
+           const v8::ScriptCompiler::CachedData& cached_data);
+
+  base::Lock lock_;
+  std::map<std::string, Entry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(ModuleCodeCache);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_EXTENSIONS_MODULE_CODE_CACHE_H_
@@ -2,11 +2,15 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "brave/common/extensions/path_bindings.h"
 
 #include "base/files/file_path.h"
+#include "brave/common/extensions/asar_source_map.h"
+#include "brave/common/extensions/module_code_cache.h"
 #include "extensions/renderer/script_context.h"
 #include "extensions/renderer/source_map.h"
 #include "extensions/renderer/v8_helpers.h"
@@ -16,7 +20,7 @@ namespace brave {
 
 PathBindings::PathBindings(
         extensions::ScriptContext* context,
-        extensions::SourceMap* source_map)
+        AsarSourceMap* source_map)
     : extensions::ObjectBackedNativeHandler(context),
       source_map_(source_map) {}
 
@@ -29,6 +33,8 @@ void PathBindings::AddRoutes() {
                 base::Bind(&PathBindings::DirName, base::Unretained(this)));
   RouteHandlerFunction("require",
                 base::Bind(&PathBindings::Require, base::Unretained(this)));
+  RouteHandlerFunction("runModule",
+                base::Bind(&PathBindings::RunModule, base::Unretained(this)));
   // TODO(bridiver) - implement require.paths
 }
 
@@ -77,4 +83,40 @@ void PathBindings::Require(
     source_map_->Contains(*v8::String::Utf8Value(args[0])));
 }
 
+void PathBindings::RunModule(
+    const v8::FunctionCallbackInfo<v8::Value>& args) {
+  if (args.Length() != 3 || !args[0]->IsString() || !args[2]->IsArray()) {
+    GetIsolate()->ThrowException(v8::String::NewFromUtf8(
+        GetIsolate(), "Invalid arguments to 'runModule'"));
+    return;
+  }
+
+  std::string name(*v8::String::Utf8Value(args[0]));
+  std::shared_ptr<asar::Archive> archive;
+  std::string contents;
+  base::StringPiece source;
+  if (!source_map_->GetModuleSource(name, &archive, &contents, &source)) {
+    GetIsolate()->ThrowException(v8::String::NewFromUtf8(
+        GetIsolate(), ("No source for require(" + name + ")").c_str()));
+    return;
+  }
+
+  v8::Local<v8::Context> v8_context = context()->v8_context();
+  v8::Local<v8::Array> module_args = args[2].As<v8::Array>();
+  std::vector<v8::Local<v8::Value>> argv;
+  for (uint32_t i = 0; i < module_args->Length(); ++i) {
+    v8::Local<v8::Value> arg;
+    if (!module_args->Get(v8_context, i).ToLocal(&arg))
+      return;
+    argv.push_back(arg);
+  }
+
+  // exceptions thrown by the module are rethrown to commonjs
+  v8::Local<v8::Value> result;
+  if (ModuleCodeCache::GetInstance()->RunModule(
+          v8_context, name, source, args[1], argv.size(), argv.data())
+          .ToLocal(&result))
+    args.GetReturnValue().Set(result);
+}
+
 }  // namespace brave
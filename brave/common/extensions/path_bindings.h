@@ -16,10 +16,12 @@
 
 namespace brave {
 
+class AsarSourceMap;
+
 class PathBindings : public extensions::ObjectBackedNativeHandler {
  public:
   PathBindings(extensions::ScriptContext* context,
-      extensions::SourceMap* source_map);
+      AsarSourceMap* source_map);
   ~PathBindings() override;
 
   // ObjectBackedNativeHandler:
@@ -29,8 +31,9 @@ class PathBindings : public extensions::ObjectBackedNativeHandler {
   void Append(const v8::FunctionCallbackInfo<v8::Value>& args);
   void DirName(const v8::FunctionCallbackInfo<v8::Value>& args);
   void Require(const v8::FunctionCallbackInfo<v8::Value>& args);
+  void RunModule(const v8::FunctionCallbackInfo<v8::Value>& args);
 
-  const extensions::SourceMap* source_map_;
+  const AsarSourceMap* source_map_;
 
   DISALLOW_COPY_AND_ASSIGN(PathBindings);
 };
@@ -2,14 +2,16 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <utility>
 
 #include "brave/common/extensions/shared_memory_bindings.h"
 
+#include "atom/common/native_mate_converters/value_converter.h"
+#include "base/bind.h"
 #include "base/memory/shared_memory.h"
 #include "base/pickle.h"
-#include "content/child/child_thread_impl.h"
-#include "content/public/child/child_thread.h"
+#include "base/values.h"
 #include "extensions/renderer/script_context.h"
 #include "native_mate/arguments.h"
 #include "native_mate/converter.h"
@@ -18,34 +20,23 @@
 #include "url/gurl.h"
 #include "v8/include/v8.h"
 
-#include "content/public/renderer/render_thread.h"
-
-using content::ChildThread;
-using content::ChildThreadImpl;
-
 namespace mate {
 
 v8::Local<v8::Value> Converter<base::SharedMemory*>::ToV8(
     v8::Isolate* isolate, base::SharedMemory* val) {
-  if (!val) {
-    return v8::Null(isolate);
-  }
-
-  if (!val->Map(sizeof(base::Pickle::Header)))
+  // segments stay mapped, so the pickle is read in place
+  if (!val || !val->memory() ||
+      val->mapped_size() < sizeof(base::Pickle::Header))
     return v8::Null(isolate);
 
-  // Get the payload size
-  base::Pickle::Header* pickle_header =
-      reinterpret_cast<base::Pickle::Header*>(val->memory());
-
-  // Now map in the rest of the block.
-  int pickle_size =
+  const base::Pickle::Header* pickle_header =
+      reinterpret_cast<const base::Pickle::Header*>(val->memory());
+  size_t pickle_size =
       sizeof(base::Pickle::Header) + pickle_header->payload_size;
-  val->Unmap();
-  if (!val->Map(pickle_size))
+  if (pickle_size > val->mapped_size())
     return v8::Null(isolate);
 
-  base::Pickle pickle(reinterpret_cast<char*>(val->memory()),
+  base::Pickle pickle(reinterpret_cast<const char*>(val->memory()),
                       pickle_size);
 
   base::PickleIterator iter(pickle);
@@ -88,9 +79,10 @@ namespace brave {
 // static
 mate::Handle<SharedMemoryWrapper> SharedMemoryWrapper::CreateFrom(
     v8::Isolate* isolate,
-    const base::SharedMemoryHandle& shared_memory_handle) {
+    scoped_refptr<SharedMemorySegment> segment,
+    const base::Closure& release) {
   return mate::CreateHandle(
-      isolate, new SharedMemoryWrapper(isolate, shared_memory_handle));
+      isolate, new SharedMemoryWrapper(isolate, std::move(segment), release));
 }
 
 // static
@@ -110,55 +102,48 @@ mate::Handle<SharedMemoryWrapper> SharedMemoryWrapper::CreateFrom(
   base::Pickle pickle;
   pickle.WriteInt(buf.second);
   pickle.WriteBytes(buf.first, buf.second);
+  free(buf.first);
 
-  // Create the shared memory object.
-  std::unique_ptr<base::SharedMemory> shared_memory;
-  if (ChildThread::Get()) {
-    shared_memory =
-        content::RenderThread::Get()->HostAllocateSharedMemoryBuffer(
-                                                                 pickle.size());
-  } else {
-    shared_memory.reset(new base::SharedMemory);
-
-    base::SharedMemoryCreateOptions options;
-    options.size = pickle.size();
-    options.share_read_only = true;
-    if (!shared_memory->Create(options)) {
-      free(buf.first);
-      return mate::Handle<SharedMemoryWrapper>();
-    }
-  }
-
-  if (!shared_memory.get() || !shared_memory->Map(pickle.size())) {
-    free(buf.first);
+  // Reuse a mapped segment from the pool when possible.
+  SharedMemoryPool* pool = SharedMemoryPool::GetInstance();
+  scoped_refptr<SharedMemorySegment> segment = pool->Acquire(pickle.size());
+  if (!segment)
     return mate::Handle<SharedMemoryWrapper>();
-  }
 
   // Copy the pickle to shared memory.
-  memcpy(shared_memory->memory(), pickle.data(), pickle.size());
-  free(buf.first);
+  memcpy(segment->shared_memory()->memory(), pickle.data(), pickle.size());
 
-  base::SharedMemoryHandle handle = shared_memory->TakeHandle();
-
-  if (!handle.IsValid()) {
-    return mate::Handle<SharedMemoryWrapper>();
-  }
-
-  return CreateFrom(isolate, handle);
+  return CreateFrom(isolate, segment,
+      base::Bind(&SharedMemoryPool::Release, base::Unretained(pool),
+                 base::RetainedRef(segment)));
 }
 
 SharedMemoryWrapper::SharedMemoryWrapper(v8::Isolate* isolate,
-    const base::SharedMemoryHandle& shared_memory_handle)
-        : shared_memory_(new base::SharedMemory(shared_memory_handle, true)),
+    scoped_refptr<SharedMemorySegment> segment,
+    const base::Closure& release)
+        : segment_(std::move(segment)),
+          release_(release),
+          size_(0),
           isolate_(isolate) {
+  const base::Pickle::Header* pickle_header =
+      reinterpret_cast<const base::Pickle::Header*>(
+          segment_->shared_memory()->memory());
+  size_ = std::min(segment_->size(),
+      sizeof(base::Pickle::Header) + pickle_header->payload_size);
   Init(isolate);
 }
 
 void SharedMemoryWrapper::Close() {
-  shared_memory_.reset();
+  segment_ = nullptr;
+  if (!release_.is_null()) {
+    release_.Run();
+    release_.Reset();
+  }
 }
 
-SharedMemoryWrapper::~SharedMemoryWrapper() {}
+SharedMemoryWrapper::~SharedMemoryWrapper() {
+  Close();
+}
 
 void SharedMemoryWrapper::BuildPrototype(v8::Isolate* isolate,
                                  v8::Local<v8::FunctionTemplate> prototype) {
@@ -176,6 +161,9 @@ SharedMemoryBindings::~SharedMemoryBindings() {}
 void SharedMemoryBindings::AddRoutes() {
   RouteHandlerFunction("Create", base::Bind(&SharedMemoryBindings::Create,
                                             base::Unretained(this)));
+  RouteHandlerFunction("GetStats",
+                       base::Bind(&SharedMemoryBindings::GetStats,
+                                  base::Unretained(this)));
 }
 
 // static
@@ -188,6 +176,8 @@ v8::Local<v8::Object> SharedMemoryBindings::API(
   v8::Local<v8::Object> shared_memory_api = v8::Object::New(context->isolate());
   context->module_system()->SetNativeLazyField(
         shared_memory_api, "create", "muon_shared_memory", "Create");
+  context->module_system()->SetNativeLazyField(
+        shared_memory_api, "getStats", "muon_shared_memory", "GetStats");
   return shared_memory_api;
 }
 
@@ -203,4 +193,10 @@ void SharedMemoryBindings::Create(
       SharedMemoryWrapper::CreateFrom(context()->isolate(), args[0]).ToV8());
 }
 
+void SharedMemoryBindings::GetStats(
+    const v8::FunctionCallbackInfo<v8::Value>& args) {
+  args.GetReturnValue().Set(mate::ConvertToV8(context()->isolate(),
+      *SharedMemoryPool::GetInstance()->GetStats()));
+}
+
 }  // namespace brave
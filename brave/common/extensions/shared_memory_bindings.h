@@ -7,9 +7,11 @@
 
 #include <memory>
 
+#include "base/callback.h"
 #include "base/compiler_specific.h"
 #include "base/macros.h"
-#include "base/memory/shared_memory_handle.h"
+#include "base/memory/ref_counted.h"
+#include "brave/common/extensions/shared_memory_pool.h"
 #include "extensions/renderer/object_backed_native_handler.h"
 #include "native_mate/handle.h"
 #include "native_mate/wrappable.h"
@@ -38,8 +40,13 @@ namespace brave {
 
 class SharedMemoryWrapper : public mate::Wrappable<SharedMemoryWrapper> {
  public:
+  // Wrap a segment, |release| is run once the wrapper is closed or garbage
+  // collected.
   static mate::Handle<SharedMemoryWrapper> CreateFrom(
-    v8::Isolate* isolate, const base::SharedMemoryHandle& shared_memory_handle);
+    v8::Isolate* isolate,
+    scoped_refptr<SharedMemorySegment> segment,
+    const base::Closure& release);
+  // Serialize |val| into a segment of the SharedMemoryPool.
   static mate::Handle<SharedMemoryWrapper> CreateFrom(
     v8::Isolate* isolate, v8::Local<v8::Value> val);
 
@@ -47,13 +54,22 @@ class SharedMemoryWrapper : public mate::Wrappable<SharedMemoryWrapper> {
                       v8::Local<v8::FunctionTemplate> prototype);
 
   void Close();
-  base::SharedMemory* shared_memory() const { return shared_memory_.get(); }
+  base::SharedMemory* shared_memory() const {
+    return segment_ ? segment_->shared_memory() : nullptr;
+  }
+  SharedMemorySegment* segment() const { return segment_.get(); }
+  // The bytes used by the pickled value.
+  size_t size() const { return size_; }
+
  private:
   SharedMemoryWrapper(v8::Isolate* isolate,
-      const base::SharedMemoryHandle& shared_memory_handle);
+      scoped_refptr<SharedMemorySegment> segment,
+      const base::Closure& release);
   ~SharedMemoryWrapper() override;
 
-  std::unique_ptr<base::SharedMemory> shared_memory_;
+  scoped_refptr<SharedMemorySegment> segment_;
+  base::Closure release_;
+  size_t size_;
   v8::Isolate* isolate_;
 
   DISALLOW_COPY_AND_ASSIGN(SharedMemoryWrapper);
@@ -71,6 +87,7 @@ class SharedMemoryBindings : public extensions::ObjectBackedNativeHandler {
 
  private:
   void Create(const v8::FunctionCallbackInfo<v8::Value>& args);
+  void GetStats(const v8::FunctionCallbackInfo<v8::Value>& args);
 
   DISALLOW_COPY_AND_ASSIGN(SharedMemoryBindings);
 };
@@ -0,0 +1,302 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/extensions/shared_memory_pool.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/memory/shared_memory.h"
+#include "base/pickle.h"
+#include "base/values.h"
+#include "content/public/child/child_thread.h"
+#include "content/public/renderer/render_thread.h"
+
+namespace brave {
+
+namespace {
+
+// Segments are allocated in power of two size classes from 64KB.
+const size_t kMinSegmentSize = 64 * 1024;
+// Released segments kept for reuse.
+const size_t kMaxPooledBytes = 32 * 1024 * 1024;
+// Segments tracked while waiting for an acknowledgement.
+const size_t kMaxPendingSegments = 32;
+// Segments of other processes kept mapped.
+const size_t kMaxReceivedSegments = 16;
+
+base::LazyInstance<SharedMemoryPool>::Leaky g_pool = LAZY_INSTANCE_INITIALIZER;
+
+size_t GetSizeClass(size_t size) {
+  size_t size_class = kMinSegmentSize;
+  while (size_class < size)
+    size_class *= 2;
+  return size_class;
+}
+
+}  // namespace
+
+SharedMemorySegment::SharedMemorySegment(
+    uint32_t id,
+    std::unique_ptr<base::SharedMemory> shared_memory)
+    : id_(id),
+      shared_memory_(std::move(shared_memory)) {}
+
+SharedMemorySegment::~SharedMemorySegment() {}
+
+size_t SharedMemorySegment::size() const {
+  return shared_memory_->mapped_size();
+}
+
+SharedMemoryPool::Entry::Entry()
+    : peer(kNoPeer),
+      read_only_shareable(false),
+      in_use(false),
+      pending_peers(0) {}
+
+SharedMemoryPool::Entry::Entry(Entry&& other) = default;
+
+SharedMemoryPool::Entry::~Entry() {}
+
+SharedMemoryPool::SharedMemoryPool()
+    : next_id_(1),
+      received_(kMaxReceivedSegments),
+      pool_hits_(0),
+      pool_misses_(0),
+      bytes_sent_(0),
+      peer_copies_(0),
+      mapping_hits_(0),
+      mapping_misses_(0),
+      bytes_received_(0) {}
+
+SharedMemoryPool::~SharedMemoryPool() {}
+
+// static
+SharedMemoryPool* SharedMemoryPool::GetInstance() {
+  return g_pool.Pointer();
+}
+
+scoped_refptr<SharedMemorySegment> SharedMemoryPool::Acquire(size_t size) {
+  SegmentList dropped;
+  base::AutoLock auto_lock(lock_);
+  Entry* entry = AcquireEntry(size, kNoPeer, &dropped);
+  if (!entry)
+    return nullptr;
+  return entry->segment;
+}
+
+SharedMemoryPool::Entry* SharedMemoryPool::AcquireEntry(size_t size,
+                                                        int peer,
+                                                        SegmentList* dropped) {
+  lock_.AssertAcquired();
+  size_t size_class = GetSizeClass(size);
+  for (auto& it : segments_) {
+    Entry& entry = it.second;
+    if (!entry.in_use && !entry.pending_peers &&
+        (peer == kNoPeer || entry.peer == peer) &&
+        entry.segment->size() == size_class) {
+      ++pool_hits_;
+      entry.in_use = true;
+      return &entry;
+    }
+  }
+
+  ++pool_misses_;
+  bool read_only_shareable = false;
+  std::unique_ptr<base::SharedMemory> shared_memory =
+      CreateSharedMemory(size_class, &read_only_shareable);
+  if (!shared_memory)
+    return nullptr;
+
+  uint32_t id = next_id_++;
+  Entry& entry = segments_[id];
+  entry.segment = new SharedMemorySegment(id, std::move(shared_memory));
+  entry.peer = peer;
+  entry.read_only_shareable = read_only_shareable;
+  entry.in_use = true;
+  Trim(dropped);
+  // the new entry is in use, so it wasn't trimmed
+  return &segments_[id];
+}
+
+void SharedMemoryPool::Release(SharedMemorySegment* segment) {
+  SegmentList dropped;
+  base::AutoLock auto_lock(lock_);
+  auto it = segments_.find(segment->id());
+  if (it == segments_.end())
+    return;
+  it->second.in_use = false;
+  Trim(&dropped);
+}
+
+base::SharedMemoryHandle SharedMemoryPool::Share(SharedMemorySegment* segment,
+                                                 size_t used,
+                                                 int peer,
+                                                 uint32_t* id,
+                                                 uint32_t* size) {
+  DCHECK_NE(peer, kNoPeer);
+  DCHECK_LE(used, segment->size());
+
+  SegmentList dropped;
+  base::AutoLock auto_lock(lock_);
+  auto it = segments_.find(segment->id());
+  Entry* entry = it != segments_.end() && it->second.segment.get() == segment
+                     ? &it->second
+                     : nullptr;
+  if (!entry || (entry->peer != kNoPeer && entry->peer != peer)) {
+    // received or forgotten segments and the segments of other peers are
+    // never sent, only their content
+    entry = AcquireEntry(used, peer, &dropped);
+    if (!entry)
+      return base::SharedMemoryHandle();
+    ++peer_copies_;
+    memcpy(entry->segment->shared_memory()->memory(),
+           segment->shared_memory()->memory(), used);
+    // nothing local holds the copy
+    entry->in_use = false;
+  }
+
+  base::SharedMemory* shared_memory = entry->segment->shared_memory();
+  base::SharedMemoryHandle handle =
+      entry->read_only_shareable ? shared_memory->GetReadOnlyHandle()
+                                 : shared_memory->handle().Duplicate();
+  if (!handle.IsValid())
+    return handle;
+
+  entry->peer = peer;
+  ++entry->pending_peers;
+  bytes_sent_ += used;
+  *id = entry->segment->id();
+  *size = entry->segment->size();
+  return handle;
+}
+
+void SharedMemoryPool::OnPeerReleased(int peer, uint32_t id) {
+  SegmentList dropped;
+  base::AutoLock auto_lock(lock_);
+  auto it = segments_.find(id);
+  // the segment may have been forgotten already, and only its peer can
+  // acknowledge it
+  if (it == segments_.end() || it->second.peer != peer ||
+      !it->second.pending_peers)
+    return;
+  --it->second.pending_peers;
+  Trim(&dropped);
+}
+
+scoped_refptr<SharedMemorySegment> SharedMemoryPool::MapReceived(
+    int peer,
+    uint32_t id,
+    const base::SharedMemoryHandle& handle,
+    size_t size) {
+  scoped_refptr<SharedMemorySegment> segment;
+  base::AutoLock auto_lock(lock_);
+  auto key = std::make_pair(peer, id);
+  auto it = id ? received_.Get(key) : received_.end();
+  if (it != received_.end() && it->second->size() >= size) {
+    ++mapping_hits_;
+    // the existing mapping is reused, so the new handle isn't needed
+    base::SharedMemory::CloseHandle(handle);
+    segment = it->second;
+  } else {
+    ++mapping_misses_;
+    std::unique_ptr<base::SharedMemory> shared_memory(
+        new base::SharedMemory(handle, true));
+    if (size < sizeof(base::Pickle::Header) || !shared_memory->Map(size))
+      return nullptr;
+    segment = new SharedMemorySegment(id, std::move(shared_memory));
+    if (id)
+      received_.Put(key, segment);
+  }
+
+  const base::Pickle::Header* header =
+      reinterpret_cast<const base::Pickle::Header*>(
+          segment->shared_memory()->memory());
+  bytes_received_ += std::min(
+      segment->size(), sizeof(base::Pickle::Header) + header->payload_size);
+  return segment;
+}
+
+std::unique_ptr<base::DictionaryValue> SharedMemoryPool::GetStats() const {
+  base::AutoLock auto_lock(lock_);
+  size_t pooled_bytes = 0;
+  for (const auto& it : segments_)
+    pooled_bytes += it.second.segment->size();
+
+  std::unique_ptr<base::DictionaryValue> stats(new base::DictionaryValue);
+  stats->SetDouble("poolHits", pool_hits_);
+  stats->SetDouble("poolMisses", pool_misses_);
+  stats->SetDouble("pooledBytes", pooled_bytes);
+  stats->SetDouble("bytesSent", bytes_sent_);
+  stats->SetDouble("peerCopies", peer_copies_);
+  stats->SetDouble("mappingHits", mapping_hits_);
+  stats->SetDouble("mappingMisses", mapping_misses_);
+  stats->SetDouble("bytesReceived", bytes_received_);
+  return stats;
+}
+
+std::unique_ptr<base::SharedMemory> SharedMemoryPool::CreateSharedMemory(
+    size_t size, bool* read_only_shareable) {
+  std::unique_ptr<base::SharedMemory> shared_memory;
+  if (content::ChildThread::Get()) {
+    // renderers can't create read only segments, but they only send them to
+    // the browser
+    *read_only_shareable = false;
+    shared_memory =
+        content::RenderThread::Get()->HostAllocateSharedMemoryBuffer(size);
+  } else {
+    *read_only_shareable = true;
+    shared_memory.reset(new base::SharedMemory);
+
+    base::SharedMemoryCreateOptions options;
+    options.size = size;
+    options.share_read_only = true;
+    if (!shared_memory->Create(options))
+      return nullptr;
+  }
+
+  if (!shared_memory || !shared_memory->Map(size))
+    return nullptr;
+  return shared_memory;
+}
+
+void SharedMemoryPool::Trim(SegmentList* dropped) {
+  lock_.AssertAcquired();
+  size_t released_bytes = 0;
+  size_t pending_segments = 0;
+  for (const auto& it : segments_) {
+    if (it.second.in_use)
+      continue;
+    if (it.second.pending_peers)
+      ++pending_segments;
+    else
+      released_bytes += it.second.segment->size();
+  }
+
+  for (auto it = segments_.begin(); it != segments_.end() &&
+       (released_bytes > kMaxPooledBytes ||
+        pending_segments > kMaxPendingSegments);) {
+    const Entry& entry = it->second;
+    if (entry.in_use) {
+      ++it;
+    } else if (!entry.pending_peers && released_bytes > kMaxPooledBytes) {
+      released_bytes -= entry.segment->size();
+      dropped->push_back(entry.segment);
+      it = segments_.erase(it);
+    } else if (entry.pending_peers && pending_segments > kMaxPendingSegments) {
+      // the receivers keep their own mapping, so forgetting the segment only
+      // means that it won't be reused
+      --pending_segments;
+      dropped->push_back(entry.segment);
+      it = segments_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace brave
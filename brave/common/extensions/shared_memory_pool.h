@@ -0,0 +1,167 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_EXTENSIONS_SHARED_MEMORY_POOL_H_
+#define BRAVE_COMMON_EXTENSIONS_SHARED_MEMORY_POOL_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/containers/mru_cache.h"
+#include "base/lazy_instance.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/shared_memory_handle.h"
+#include "base/synchronization/lock.h"
+
+namespace base {
+class DictionaryValue;
+class SharedMemory;
+}
+
+namespace brave {
+
+// A block of shared memory which stays mapped for as long as it is alive.
+// Segments created by the pool have an id, which the receiving side uses to
+// keep its own mapping of the segment between messages.
+class SharedMemorySegment
+    : public base::RefCountedThreadSafe<SharedMemorySegment> {
+ public:
+  SharedMemorySegment(uint32_t id,
+                      std::unique_ptr<base::SharedMemory> shared_memory);
+
+  // 0 for segments which are not pooled.
+  uint32_t id() const { return id_; }
+  base::SharedMemory* shared_memory() const { return shared_memory_.get(); }
+  // The mapped size.
+  size_t size() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<SharedMemorySegment>;
+
+  ~SharedMemorySegment();
+
+  uint32_t id_;
+  std::unique_ptr<base::SharedMemory> shared_memory_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemorySegment);
+};
+
+// The shared memory segments of a process for ipc.sendShared. It can be used
+// from any thread, since the muon.sharedMemory of workers uses it too.
+//
+// A segment is filled by the sending side and mapped once by the receiving
+// process, which keeps the mapping and acknowledges each message when the
+// wrapper it created for it is closed. The sender only reuses a segment once
+// it is released locally and acknowledged by the receiver, so the content is
+// never overwritten while it is being read.
+//
+// Each segment belongs to the first peer it is sent to, and is never sent to
+// another one: the receiver keeps its mapping, so it would see whatever is
+// written to the segment later. Sending to another peer copies the message
+// to a segment of that peer instead.
+class SharedMemoryPool {
+ public:
+  // The peer of a segment which hasn't been sent yet.
+  static const int kNoPeer = -1;
+
+  static SharedMemoryPool* GetInstance();
+
+  // Sending side.
+
+  // Returns a mapped segment of at least |size| bytes, which is reused from
+  // the pool when a released one of the same size class is available.
+  scoped_refptr<SharedMemorySegment> Acquire(size_t size);
+  // The local user of |segment| is done with it.
+  void Release(SharedMemorySegment* segment);
+  // Returns a handle to send the |used| bytes of |segment| to |peer| with,
+  // which is read only when the platform allows it. The id and the size of
+  // the segment actually sent, which is a copy if |segment| belongs to
+  // another peer or isn't from this pool, are set in |id| and |size|. The
+  // receiver must acknowledge it with OnPeerReleased.
+  base::SharedMemoryHandle Share(SharedMemorySegment* segment,
+                                 size_t used,
+                                 int peer,
+                                 uint32_t* id,
+                                 uint32_t* size);
+  void OnPeerReleased(int peer, uint32_t id);
+
+  // Receiving side.
+
+  // Returns the segment |id| of |peer|, reusing the existing mapping if there
+  // is one, or null if |handle| can't be mapped. Segments with a 0 id are
+  // mapped but not cached.
+  scoped_refptr<SharedMemorySegment> MapReceived(
+      int peer,
+      uint32_t id,
+      const base::SharedMemoryHandle& handle,
+      size_t size);
+
+  // Returns { poolHits, poolMisses, pooledBytes, bytesSent, peerCopies,
+  // mappingHits, mappingMisses, bytesReceived }.
+  std::unique_ptr<base::DictionaryValue> GetStats() const;
+
+ private:
+  friend struct base::LazyInstanceTraitsBase<SharedMemoryPool>;
+
+  struct Entry {
+    Entry();
+    Entry(Entry&& other);
+    ~Entry();
+
+    scoped_refptr<SharedMemorySegment> segment;
+    // The peer the segment is sent to, or kNoPeer.
+    int peer;
+    // Created with share_read_only.
+    bool read_only_shareable;
+    bool in_use;
+    // Messages sent with the segment and not acknowledged yet.
+    int pending_peers;
+  };
+
+  SharedMemoryPool();
+  ~SharedMemoryPool();
+
+  typedef std::vector<scoped_refptr<SharedMemorySegment>> SegmentList;
+
+  // Returns a released segment of the size class of |size| which belongs to
+  // |peer|, any released one if |peer| is kNoPeer, or a new segment. The
+  // segments trimmed meanwhile are added to |dropped|.
+  Entry* AcquireEntry(size_t size, int peer, SegmentList* dropped);
+
+  std::unique_ptr<base::SharedMemory> CreateSharedMemory(
+      size_t size, bool* read_only_shareable);
+  // Drop the released segments over kMaxPooledBytes, and forget the oldest
+  // segments which are only waiting for an acknowledgement over
+  // kMaxPendingSegments, in case their receiver is gone. The segments are
+  // added to |dropped|, so that they are unmapped once |lock_| is released.
+  void Trim(SegmentList* dropped);
+
+  // Guards all the members below.
+  mutable base::Lock lock_;
+
+  uint32_t next_id_;
+  // Keyed by id, so the oldest segments come first.
+  std::map<uint32_t, Entry> segments_;
+  base::MRUCache<std::pair<int, uint32_t>,
+                 scoped_refptr<SharedMemorySegment>> received_;
+
+  uint64_t pool_hits_;
+  uint64_t pool_misses_;
+  uint64_t bytes_sent_;
+  uint64_t peer_copies_;
+  uint64_t mapping_hits_;
+  uint64_t mapping_misses_;
+  uint64_t bytes_received_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemoryPool);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_EXTENSIONS_SHARED_MEMORY_POOL_H_
@@ -0,0 +1,334 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "brave/common/workers/worker_message.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "base/lazy_instance.h"
+#include "base/synchronization/lock.h"
+
+namespace brave {
+
+// The memory of a SharedArrayBuffer used by several isolates. Each isolate
+// holds a reference until its SharedArrayBuffer object is collected or the
+// isolate is disposed, and the memory is freed when the last one is released.
+class SharedArrayBufferBacking
+    : public base::RefCountedThreadSafe<SharedArrayBufferBacking> {
+ public:
+  // Returns the backing of |buffer|, externalizing it the first time it is
+  // shared. Returns null for external buffers not shared by a worker message.
+  static scoped_refptr<SharedArrayBufferBacking> From(
+      v8::Isolate* isolate, v8::Local<v8::SharedArrayBuffer> buffer);
+
+  // A new SharedArrayBuffer object for |isolate| with the same memory.
+  v8::Local<v8::SharedArrayBuffer> NewForIsolate(v8::Isolate* isolate);
+
+  // Drop the references of |isolate|, whose weak callbacks won't run once it
+  // is disposed.
+  static void ReleaseIsolate(v8::Isolate* isolate);
+
+  struct Reference {
+    v8::Isolate* isolate;
+    scoped_refptr<SharedArrayBufferBacking> backing;
+    v8::Global<v8::SharedArrayBuffer> handle;
+  };
+
+ private:
+  friend class base::RefCountedThreadSafe<SharedArrayBufferBacking>;
+
+  SharedArrayBufferBacking(void* data, size_t length);
+  ~SharedArrayBufferBacking();
+
+  void AddReference(v8::Isolate* isolate,
+                    v8::Local<v8::SharedArrayBuffer> buffer);
+  // Same as AddReference, with the registry lock already held.
+  void AddReferenceLocked(v8::Isolate* isolate,
+                          v8::Local<v8::SharedArrayBuffer> buffer);
+  static void OnCollected(const v8::WeakCallbackInfo<Reference>& info);
+
+  void* data_;
+  size_t length_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedArrayBufferBacking);
+};
+
+namespace {
+
+// The shared backings by address, so that a buffer received from another
+// isolate can be sent again, and the references held by each isolate.
+struct BackingRegistry {
+  base::Lock lock;
+  std::map<void*, SharedArrayBufferBacking*> backings;
+  std::map<v8::Isolate*, std::set<SharedArrayBufferBacking::Reference*>>
+      references;
+};
+
+base::LazyInstance<BackingRegistry>::Leaky g_backings =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+// static
+scoped_refptr<SharedArrayBufferBacking> SharedArrayBufferBacking::From(
+    v8::Isolate* isolate, v8::Local<v8::SharedArrayBuffer> buffer) {
+  BackingRegistry& registry = g_backings.Get();
+  base::AutoLock auto_lock(registry.lock);
+
+  if (buffer->IsExternal()) {
+    // |buffer| holds a reference while it is alive, so the backing can't be
+    // going away
+    auto it = registry.backings.find(buffer->GetContents().Data());
+    if (it == registry.backings.end())
+      return nullptr;
+    return it->second;
+  }
+
+  v8::SharedArrayBuffer::Contents contents = buffer->Externalize();
+  scoped_refptr<SharedArrayBufferBacking> backing(
+      new SharedArrayBufferBacking(contents.Data(), contents.ByteLength()));
+  registry.backings[contents.Data()] = backing.get();
+  // the sending isolate doesn't own the memory anymore
+  backing->AddReferenceLocked(isolate, buffer);
+  return backing;
+}
+
+SharedArrayBufferBacking::SharedArrayBufferBacking(void* data, size_t length)
+    : data_(data), length_(length) {}
+
+SharedArrayBufferBacking::~SharedArrayBufferBacking() {
+  {
+    BackingRegistry& registry = g_backings.Get();
+    base::AutoLock auto_lock(registry.lock);
+    registry.backings.erase(data_);
+  }
+  free(data_);
+}
+
+v8::Local<v8::SharedArrayBuffer> SharedArrayBufferBacking::NewForIsolate(
+    v8::Isolate* isolate) {
+  v8::Local<v8::SharedArrayBuffer> buffer = v8::SharedArrayBuffer::New(
+      isolate, data_, length_, v8::ArrayBufferCreationMode::kExternalized);
+  AddReference(isolate, buffer);
+  return buffer;
+}
+
+void SharedArrayBufferBacking::AddReference(
+    v8::Isolate* isolate, v8::Local<v8::SharedArrayBuffer> buffer) {
+  base::AutoLock auto_lock(g_backings.Get().lock);
+  AddReferenceLocked(isolate, buffer);
+}
+
+void SharedArrayBufferBacking::AddReferenceLocked(
+    v8::Isolate* isolate, v8::Local<v8::SharedArrayBuffer> buffer) {
+  BackingRegistry& registry = g_backings.Get();
+  registry.lock.AssertAcquired();
+
+  Reference* reference = new Reference;
+  reference->isolate = isolate;
+  reference->backing = this;
+  reference->handle.Reset(isolate, buffer);
+  reference->handle.SetWeak(reference, &OnCollected,
+                            v8::WeakCallbackType::kParameter);
+  registry.references[isolate].insert(reference);
+}
+
+// static
+void SharedArrayBufferBacking::OnCollected(
+    const v8::WeakCallbackInfo<Reference>& info) {
+  Reference* reference = info.GetParameter();
+  {
+    BackingRegistry& registry = g_backings.Get();
+    base::AutoLock auto_lock(registry.lock);
+    auto it = registry.references.find(reference->isolate);
+    if (it != registry.references.end()) {
+      it->second.erase(reference);
+      if (it->second.empty())
+        registry.references.erase(it);
+    }
+  }
+  // the last reference takes the registry lock to unregister the backing
+  delete reference;
+}
+
+// static
+void SharedArrayBufferBacking::ReleaseIsolate(v8::Isolate* isolate) {
+  std::set<Reference*> references;
+  {
+    BackingRegistry& registry = g_backings.Get();
+    base::AutoLock auto_lock(registry.lock);
+    auto it = registry.references.find(isolate);
+    if (it == registry.references.end())
+      return;
+    references.swap(it->second);
+    registry.references.erase(it);
+  }
+  for (Reference* reference : references)
+    delete reference;
+}
+
+class WorkerMessage::SerializerDelegate
+    : public v8::ValueSerializer::Delegate {
+ public:
+  SerializerDelegate(WorkerMessage* message, v8::Isolate* isolate)
+      : message_(message), isolate_(isolate) {}
+
+  void ThrowDataCloneError(v8::Local<v8::String> message) override {
+    isolate_->ThrowException(v8::Exception::Error(message));
+  }
+
+  v8::Maybe<uint32_t> GetSharedArrayBufferId(
+      v8::Isolate* isolate,
+      v8::Local<v8::SharedArrayBuffer> buffer) override {
+    scoped_refptr<SharedArrayBufferBacking> backing =
+        SharedArrayBufferBacking::From(isolate, buffer);
+    if (!backing) {
+      ThrowDataCloneError(v8::String::NewFromUtf8(isolate,
+          "SharedArrayBuffer could not be shared"));
+      return v8::Nothing<uint32_t>();
+    }
+    message_->shared_array_buffers_.push_back(std::move(backing));
+    return v8::Just<uint32_t>(message_->shared_array_buffers_.size() - 1);
+  }
+
+ private:
+  WorkerMessage* message_;
+  v8::Isolate* isolate_;
+
+  DISALLOW_COPY_AND_ASSIGN(SerializerDelegate);
+};
+
+class WorkerMessage::DeserializerDelegate
+    : public v8::ValueDeserializer::Delegate {
+ public:
+  explicit DeserializerDelegate(WorkerMessage* message) : message_(message) {}
+
+  v8::MaybeLocal<v8::SharedArrayBuffer> GetSharedArrayBufferFromId(
+      v8::Isolate* isolate, uint32_t clone_id) override {
+    if (clone_id >= message_->shared_array_buffers_.size())
+      return v8::MaybeLocal<v8::SharedArrayBuffer>();
+    return message_->shared_array_buffers_[clone_id]->NewForIsolate(isolate);
+  }
+
+ private:
+  WorkerMessage* message_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeserializerDelegate);
+};
+
+WorkerMessage::WorkerMessage() : data_(nullptr), size_(0) {}
+
+// static
+void WorkerMessage::ReleaseIsolate(v8::Isolate* isolate) {
+  SharedArrayBufferBacking::ReleaseIsolate(isolate);
+}
+
+WorkerMessage::~WorkerMessage() {
+  for (const auto& contents : array_buffers_)
+    free(contents.data);
+  free(data_);
+}
+
+bool WorkerMessage::Serialize(v8::Local<v8::Context> context,
+                              v8::Local<v8::Value> value,
+                              v8::Local<v8::Value> transfer_list) {
+  v8::Isolate* isolate = context->GetIsolate();
+  std::vector<v8::Local<v8::ArrayBuffer>> transfers;
+  if (!GetTransferList(context, transfer_list, &transfers))
+    return false;
+
+  SerializerDelegate delegate(this, isolate);
+  v8::ValueSerializer serializer(isolate, &delegate);
+  serializer.WriteHeader();
+  for (size_t i = 0; i < transfers.size(); ++i)
+    serializer.TransferArrayBuffer(i, transfers[i]);
+  if (!serializer.WriteValue(context, value).FromMaybe(false))
+    return false;
+
+  std::pair<uint8_t*, size_t> buffer = serializer.Release();
+  data_ = buffer.first;
+  size_ = buffer.second;
+
+  // detach the buffers only once the message is written
+  for (const auto& transfer : transfers) {
+    ArrayBufferContents contents;
+    contents.length = transfer->ByteLength();
+    if (transfer->IsExternal()) {
+      // the memory is owned by someone else, so it has to be copied
+      contents.data = malloc(std::max<size_t>(contents.length, 1));
+      memcpy(contents.data, transfer->GetContents().Data(), contents.length);
+    } else {
+      contents.data = transfer->Externalize().Data();
+    }
+    transfer->Neuter();
+    array_buffers_.push_back(contents);
+  }
+  return true;
+}
+
+v8::MaybeLocal<v8::Value> WorkerMessage::Deserialize(
+    v8::Local<v8::Context> context) {
+  v8::Isolate* isolate = context->GetIsolate();
+  DeserializerDelegate delegate(this);
+  v8::ValueDeserializer deserializer(isolate, data_, size_, &delegate);
+  deserializer.SetSupportsLegacyWireFormat(true);
+  if (!deserializer.ReadHeader(context).FromMaybe(false))
+    return v8::MaybeLocal<v8::Value>();
+
+  // the receiving isolate frees the memory with the same allocator
+  for (size_t i = 0; i < array_buffers_.size(); ++i) {
+    deserializer.TransferArrayBuffer(i, v8::ArrayBuffer::New(
+        isolate, array_buffers_[i].data, array_buffers_[i].length,
+        v8::ArrayBufferCreationMode::kInternalized));
+  }
+  array_buffers_.clear();
+
+  return deserializer.ReadValue(context);
+}
+
+bool WorkerMessage::GetTransferList(
+    v8::Local<v8::Context> context,
+    v8::Local<v8::Value> transfer_list,
+    std::vector<v8::Local<v8::ArrayBuffer>>* out) {
+  v8::Isolate* isolate = context->GetIsolate();
+  if (transfer_list.IsEmpty() || transfer_list->IsUndefined())
+    return true;
+
+  if (!transfer_list->IsArray()) {
+    isolate->ThrowException(v8::Exception::TypeError(v8::String::NewFromUtf8(
+        isolate, "`transferList` must be an array")));
+    return false;
+  }
+
+  v8::Local<v8::Array> array = transfer_list.As<v8::Array>();
+  for (uint32_t i = 0; i < array->Length(); ++i) {
+    v8::Local<v8::Value> item;
+    if (!array->Get(context, i).ToLocal(&item))
+      return false;
+
+    if (!item->IsArrayBuffer()) {
+      isolate->ThrowException(v8::Exception::Error(v8::String::NewFromUtf8(
+          isolate, "Only ArrayBuffers can be transferred")));
+      return false;
+    }
+
+    v8::Local<v8::ArrayBuffer> buffer = item.As<v8::ArrayBuffer>();
+    if (!buffer->IsNeuterable() ||
+        std::find(out->begin(), out->end(), buffer) != out->end()) {
+      isolate->ThrowException(v8::Exception::Error(v8::String::NewFromUtf8(
+          isolate, "ArrayBuffer could not be transferred")));
+      return false;
+    }
+    out->push_back(buffer);
+  }
+  return true;
+}
+
+}  // namespace brave
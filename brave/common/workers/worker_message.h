@@ -0,0 +1,72 @@
+// Copyright (c) 2018 The Brave Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BRAVE_COMMON_WORKERS_WORKER_MESSAGE_H_
+#define BRAVE_COMMON_WORKERS_WORKER_MESSAGE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "v8/include/v8.h"
+
+namespace brave {
+
+class SharedArrayBufferBacking;
+
+// A message posted between the UI thread and a V8WorkerThread, written by
+// v8::ValueSerializer. The ArrayBuffers of the transfer list are detached
+// from the sending isolate and adopted by the receiving one without copying
+// their contents, and SharedArrayBuffers share their memory between isolates.
+//
+// All the isolates use gin's ArrayBufferAllocator, which is what makes it
+// possible to hand the memory of an ArrayBuffer from one to the other.
+class WorkerMessage {
+ public:
+  WorkerMessage();
+  ~WorkerMessage();
+
+  // Serialize |value|, transferring the ArrayBuffers of |transfer_list| (an
+  // array, or undefined). Returns false and throws a DataCloneError if the
+  // value can't be cloned or the list can't be transferred.
+  bool Serialize(v8::Local<v8::Context> context,
+                 v8::Local<v8::Value> value,
+                 v8::Local<v8::Value> transfer_list);
+
+  // Read the message in the isolate of |context|, which takes ownership of
+  // the transferred ArrayBuffers. Can only be called once.
+  v8::MaybeLocal<v8::Value> Deserialize(v8::Local<v8::Context> context);
+
+  // Release the SharedArrayBuffer memory still used by |isolate|. Must be
+  // called before the isolate is disposed, as the SharedArrayBuffers aren't
+  // collected then.
+  static void ReleaseIsolate(v8::Isolate* isolate);
+
+ private:
+  class SerializerDelegate;
+  class DeserializerDelegate;
+
+  struct ArrayBufferContents {
+    void* data;
+    size_t length;
+  };
+
+  bool GetTransferList(v8::Local<v8::Context> context,
+                       v8::Local<v8::Value> transfer_list,
+                       std::vector<v8::Local<v8::ArrayBuffer>>* out);
+
+  uint8_t* data_;
+  size_t size_;
+  // Freed if the message is never read.
+  std::vector<ArrayBufferContents> array_buffers_;
+  std::vector<scoped_refptr<SharedArrayBufferBacking>> shared_array_buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerMessage);
+};
+
+}  // namespace brave
+
+#endif  // BRAVE_COMMON_WORKERS_WORKER_MESSAGE_H_
@@ -48,6 +48,13 @@ using blink::WebView;
 using content::DocumentState;
 using content::NavigationState;
 
+namespace {
+
+// Enough for the distinct resource origins of most pages.
+const size_t kMaxCachedContentSettings = 256;
+
+}  // namespace
+
 ContentSettingsObserver::ContentSettingsObserver(
     content::RenderFrame* render_frame,
     extensions::Dispatcher* extension_dispatcher,
@@ -61,6 +68,8 @@ ContentSettingsObserver::ContentSettingsObserver(
 #endif
       content_settings_manager_(NULL),
       allow_running_insecure_content_(false),
+      cached_content_settings_(kMaxCachedContentSettings),
+      cached_content_settings_generation_(0),
       is_interstitial_page_(false),
       current_request_id_(0),
       should_whitelist_(should_whitelist) {
@@ -95,6 +104,34 @@ void ContentSettingsObserver::SetContentSettingsManager(
   content_settings_manager_ = content_settings_manager;
 }
 
+ContentSetting ContentSettingsObserver::GetContentSetting(
+    const GURL& secondary_url,
+    ContentSettingsManager::ContentType content_type) {
+  if (cached_content_settings_generation_ !=
+      content_settings_manager_->generation()) {
+    cached_content_settings_.Clear();
+    cached_content_settings_generation_ =
+        content_settings_manager_->generation();
+  }
+
+  GURL primary_url =
+      ContentSettingsManager::GetOriginOrURL(render_frame()->GetWebFrame());
+  // patterns only match the path of file URLs, so the decision is the same
+  // for every resource of an http origin
+  ContentSettingKey key(primary_url,
+                        secondary_url.SchemeIsHTTPOrHTTPS() ?
+                            secondary_url.GetOrigin() : secondary_url,
+                        content_type);
+  auto it = cached_content_settings_.Get(key);
+  if (it != cached_content_settings_.end())
+    return it->second;
+
+  ContentSetting setting = content_settings_manager_->GetSetting(
+      primary_url, secondary_url, content_type);
+  cached_content_settings_.Put(key, setting);
+  return setting;
+}
+
 bool ContentSettingsObserver::IsPluginTemporarilyAllowed(
     const std::string& identifier) {
   // If the empty string is in here, it means all plugins are allowed.
@@ -258,6 +295,9 @@ bool ContentSettingsObserver::OnMessageReceived(const IPC::Message& message) {
 void ContentSettingsObserver::DidCommitProvisionalLoad(
     bool is_new_navigation,
     bool is_same_page_navigation) {
+  if (!is_same_page_navigation)
+    cached_content_settings_.Clear();
+
   WebFrame* frame = render_frame()->GetWebFrame();
   if (frame->Parent())
     return;  // Not a top-level navigation.
@@ -284,12 +324,9 @@ bool ContentSettingsObserver::AllowDatabase(const WebString& name,
   GURL secondary_url(
       blink::WebStringToGURL(frame->GetSecurityOrigin().ToString()));
   if (content_settings_manager_->content_settings()) {
-    allow =
-        content_settings_manager_->GetSetting(
-          ContentSettingsManager::GetOriginOrURL(frame),
-          secondary_url,
-          "cookies",
-          allow) != CONTENT_SETTING_BLOCK;
+    allow = GetContentSetting(
+        secondary_url,
+        ContentSettingsManager::CONTENT_TYPE_COOKIES) != CONTENT_SETTING_BLOCK;
   }
 
   if (!allow)
@@ -312,12 +349,9 @@ void ContentSettingsObserver::RequestFileSystemAccessAsync(
   GURL secondary_url(
       blink::WebStringToGURL(frame->GetSecurityOrigin().ToString()));
   if (content_settings_manager_->content_settings()) {
-    allow =
-        content_settings_manager_->GetSetting(
-          ContentSettingsManager::GetOriginOrURL(frame),
-          secondary_url,
-          "cookies",
-          allow) != CONTENT_SETTING_BLOCK;
+    allow = GetContentSetting(
+        secondary_url,
+        ContentSettingsManager::CONTENT_TYPE_COOKIES) != CONTENT_SETTING_BLOCK;
   }
   if (!allow) {
       DidBlockContentType("filesystem", secondary_url.spec());
@@ -335,13 +369,9 @@ bool ContentSettingsObserver::AllowImage(bool enabled_per_settings,
   bool allow = enabled_per_settings;
   GURL secondary_url(image_url);
   if (content_settings_manager_->content_settings()) {
-    allow =
-        content_settings_manager_->GetSetting(
-            ContentSettingsManager::GetOriginOrURL(
-                render_frame()->GetWebFrame()),
-            secondary_url,
-            "images",
-            allow) != CONTENT_SETTING_BLOCK;
+    allow = GetContentSetting(
+        secondary_url,
+        ContentSettingsManager::CONTENT_TYPE_IMAGES) != CONTENT_SETTING_BLOCK;
   }
 
   if (!allow)
@@ -360,12 +390,9 @@ bool ContentSettingsObserver::AllowIndexedDB(const WebString& name,
   GURL secondary_url(
       blink::WebStringToGURL(frame->GetSecurityOrigin().ToString()));
   if (content_settings_manager_->content_settings()) {
-    allow =
-        content_settings_manager_->GetSetting(
-            ContentSettingsManager::GetOriginOrURL(frame),
-            secondary_url,
-            "cookies",
-            allow) != CONTENT_SETTING_BLOCK;
+    allow = GetContentSetting(
+        secondary_url,
+        ContentSettingsManager::CONTENT_TYPE_COOKIES) != CONTENT_SETTING_BLOCK;
   }
 
   if (!allow)
@@ -453,12 +480,10 @@ bool ContentSettingsObserver::AllowScriptFromSource(
   bool allow = enabled_per_settings;
   GURL secondary_url(script_url);
   if (content_settings_manager_->content_settings()) {
-    allow =
-        content_settings_manager_->GetSetting(
-          ContentSettingsManager::GetOriginOrURL(render_frame()->GetWebFrame()),
-          secondary_url,
-          "javascript",
-          allow) != CONTENT_SETTING_BLOCK;
+    allow = GetContentSetting(
+        secondary_url,
+        ContentSettingsManager::CONTENT_TYPE_JAVASCRIPT) !=
+            CONTENT_SETTING_BLOCK;
   }
 
   allow = allow || IsWhitelistedForContentSettings();
@@ -486,12 +511,9 @@ bool ContentSettingsObserver::AllowStorage(bool local) {
 
   bool allow = true;
   if (content_settings_manager_->content_settings()) {
-    allow =
-        content_settings_manager_->GetSetting(
-          ContentSettingsManager::GetOriginOrURL(frame),
-          blink::WebStringToGURL(frame->GetSecurityOrigin().ToString()),
-          "cookies",
-          allow) != CONTENT_SETTING_BLOCK;
+    allow = GetContentSetting(
+        blink::WebStringToGURL(frame->GetSecurityOrigin().ToString()),
+        ContentSettingsManager::CONTENT_TYPE_COOKIES) != CONTENT_SETTING_BLOCK;
   }
 
   cached_storage_permissions_[key] = allow;
@@ -539,13 +561,9 @@ bool ContentSettingsObserver::AllowMutationEvents(bool default_value) {
 
   bool allow = default_value;
   if (content_settings_manager_->content_settings()) {
-    allow =
-        content_settings_manager_->GetSetting(
-            ContentSettingsManager::GetOriginOrURL(
-                render_frame()->GetWebFrame()),
-            GURL(),
-            "mutation",
-            allow) != CONTENT_SETTING_BLOCK;
+    allow = GetContentSetting(
+        GURL(),
+        ContentSettingsManager::CONTENT_TYPE_MUTATION) != CONTENT_SETTING_BLOCK;
   }
 
   if (!allow)
@@ -561,13 +579,10 @@ bool ContentSettingsObserver::AllowRunningInsecureContent(
   bool allow = allowed_per_settings;
   GURL secondary_url(resource_url);
   if (content_settings_manager_->content_settings()) {
-    allow =
-        content_settings_manager_->GetSetting(
-            ContentSettingsManager::GetOriginOrURL(
-                render_frame()->GetWebFrame()),
-            secondary_url,
-            "runInsecureContent",
-            allow) != CONTENT_SETTING_BLOCK;
+    allow = GetContentSetting(
+        secondary_url,
+        ContentSettingsManager::CONTENT_TYPE_RUN_INSECURE_CONTENT) !=
+            CONTENT_SETTING_BLOCK;
   }
 
   if (allow)
@@ -582,12 +597,9 @@ bool ContentSettingsObserver::AllowAutoplay(bool default_value) {
   if (content_settings_manager_->content_settings()) {
     WebFrame* frame = render_frame()->GetWebFrame();
     auto origin = frame->ToWebLocalFrame()->GetDocument().GetSecurityOrigin();
-    allow =
-        content_settings_manager_->GetSetting(
-            ContentSettingsManager::GetOriginOrURL(frame),
-            blink::WebStringToGURL(origin.ToString()),
-            "autoplay",
-            allow) != CONTENT_SETTING_BLOCK;
+    allow = GetContentSetting(
+        blink::WebStringToGURL(origin.ToString()),
+        ContentSettingsManager::CONTENT_TYPE_AUTOPLAY) != CONTENT_SETTING_BLOCK;
   }
 
   if (!allow)
@@ -7,7 +7,10 @@
 
 #include <map>
 #include <set>
+#include <tuple>
 
+#include "atom/renderer/content_settings_manager.h"
+#include "base/containers/mru_cache.h"
 #include "components/content_settings/core/common/content_settings.h"
 #include "components/content_settings/core/common/content_settings_types.h"
 #include "content/public/renderer/render_frame_observer.h"
@@ -27,10 +30,6 @@ namespace extensions {
 class Dispatcher;
 }
 
-namespace atom {
-class ContentSettingsManager;
-}
-
 // Handles blocking content per content settings for each RenderFrame.
 class ContentSettingsObserver
     : public content::RenderFrameObserver,
@@ -109,6 +108,13 @@ class ContentSettingsObserver
 
   void OnLoadBlockedPlugins(const std::string& identifier);
 
+  // Returns the setting of |content_type| for |secondary_url| in this frame.
+  // The decisions are cached per origin until the next navigation or update
+  // of the content settings.
+  ContentSetting GetContentSetting(
+      const GURL& secondary_url,
+      atom::ContentSettingsManager::ContentType content_type);
+
   // Helpers.
   // True if |render_frame()| contains content that is white-listed for content
   // settings.
@@ -140,6 +146,14 @@ class ContentSettingsObserver
   // Caches the result of AllowScript.
   std::map<blink::WebFrame*, bool> cached_script_permissions_;
 
+  // Caches the result of GetContentSetting, for the top frame URL, the
+  // resource origin and the content type.
+  typedef std::tuple<GURL, GURL, atom::ContentSettingsManager::ContentType>
+      ContentSettingKey;
+  base::MRUCache<ContentSettingKey, ContentSetting> cached_content_settings_;
+  // The ContentSettingsManager generation the cached settings are from.
+  uint64_t cached_content_settings_generation_;
+
   std::set<std::string> temporarily_allowed_plugins_;
   bool is_interstitial_page_;
 
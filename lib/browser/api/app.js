@@ -9,6 +9,7 @@ module.exports = app
 const electron = require('electron')
 const {deprecate, Menu} = electron
 const {EventEmitter} = require('events')
+const WorkerPool = require('./worker-pool')
 
 Object.setPrototypeOf(App.prototype, EventEmitter.prototype)
 
@@ -69,11 +70,16 @@ function Worker (module_name) {
 Worker.prototype.start = function (cb) {
   cb && this.once('start', cb)
   this.id = app._startWorker(this.module_name)
+  if (this.id !== -1) {
+    workers.set(this.id, this)
+  }
 }
 
-Worker.prototype.postMessage = function (message) {
+// The ArrayBuffers of |transferList| are moved to the worker without being
+// copied, and can't be used anymore in the main process.
+Worker.prototype.postMessage = function (message, transferList) {
   const evt = {data: message}
-  app._postMessage(this.id, evt)
+  app._postMessage(this.id, evt, transferList)
 }
 
 Worker.prototype.terminate = function () {
@@ -90,39 +96,52 @@ Object.defineProperty(Worker.prototype, 'onerror', {
 
 Object.setPrototypeOf(Worker.prototype, EventEmitter.prototype)
 
-app.createWorker = function (module_name) {
-  const worker = new Worker(module_name)
-
-  // It is always safe to call the worker methods because
-  // WorkerThreadRegistry will return a dummy task runner
-  app.on('worker-start', (e, worker_id) => {
-    if (worker.id === worker_id) {
-      worker.emit('start', {})
-    }
-  })
-  app.on('worker-stop', (e, worker_id) => {
-    if (worker.id === worker_id) {
-      worker.emit('stop', {})
-    }
-  })
-  app.on('worker-post-message', (e, worker_id, message) => {
-    if (worker.id === worker_id) {
-      const event = {data: message}
-      worker.emit('message', event)
-      worker.onmessage && worker.onmessage(event)
-    }
-  })
-  app.on('worker-onerror', (e, worker_id, message, stack) => {
+// The started workers by thread id. The events of all the workers go through
+// the same listeners, so a worker doesn't keep listeners on the app once it
+// has stopped.
+const workers = new Map()
+
+// It is always safe to call the worker methods because
+// WorkerThreadRegistry will return a dummy task runner
+app.on('worker-start', (e, worker_id) => {
+  const worker = workers.get(worker_id)
+  worker && worker.emit('start', {})
+})
+app.on('worker-stop', (e, worker_id) => {
+  const worker = workers.get(worker_id)
+  if (worker) {
+    workers.delete(worker_id)
+    worker.emit('stop', {})
+  }
+})
+app.on('worker-post-message', (e, worker_id, message) => {
+  const worker = workers.get(worker_id)
+  if (worker) {
+    const event = {data: message}
+    worker.emit('message', event)
+    worker.onmessage && worker.onmessage(event)
+  }
+})
+app.on('worker-onerror', (e, worker_id, message, stack) => {
+  const worker = workers.get(worker_id)
+  if (worker) {
     worker.lastError = message
-    if (worker.id === worker_id) {
-      worker.onerror && worker.onerror(message, stack)
-    }
-  })
-  app.on('app-post-message', (e, message) => {
-    worker.postMessage(message)
-  })
+    worker.onerror && worker.onerror(message, stack)
+  }
+})
+app.on('app-post-message', (e, message) => {
+  // pooled workers answer each message they get with the result of a task
+  for (const worker of workers.values()) {
+    !worker.pooled && worker.postMessage(message)
+  }
+})
+
+app.createWorker = function (module_name) {
+  return new Worker(module_name)
+}
 
-  return worker
+app.createWorkerPool = function (module_name, options) {
+  return new WorkerPool(app, module_name, options)
 }
 
 app.allowNTLMCredentialsForAllDomains = function (allow) {
@@ -4,3 +4,21 @@ module.exports = new EventEmitter()
 
 // Do not throw exception when channel name is "error".
 module.exports.on('error', () => {})
+
+// The handlers of ipcRenderer.invoke, by channel.
+const invokeHandlers = new Map()
+
+module.exports.handle = function (channel, handler) {
+  if (invokeHandlers.has(channel)) {
+    throw new Error(`A handler is already registered for '${channel}'`)
+  }
+  invokeHandlers.set(channel, handler)
+}
+
+module.exports.removeHandler = function (channel) {
+  invokeHandlers.delete(channel)
+}
+
+module.exports._getHandler = function (channel) {
+  return invokeHandlers.get(channel)
+}
@@ -182,13 +182,49 @@ WebContents.prototype._init = function () {
   this.on('ipc-message-sync', function (event, [channel, ...args]) {
     Object.defineProperty(event, 'returnValue', {
       set: function (value) {
-        return event.sendReply(JSON.stringify(value))
+        return event.sendReply(value)
       },
       get: function () {}
     })
     ipcMain.emit(channel, event, ...args)
   })
 
+  // Answer ipcRenderer.invoke with the ipcMain handler of the channel. The
+  // pending invocations are kept by sender so they can be cancelled.
+  const pendingInvokes = new WeakMap()
+  this.on('ipc-invoke', function (event, requestId, channel, args) {
+    const sender = event.sender
+    const handler = ipcMain._getHandler(channel)
+    if (!handler) {
+      sender._invokeReply(requestId, false, `No handler registered for '${channel}'`)
+      return
+    }
+
+    let pending = pendingInvokes.get(sender)
+    if (!pending) {
+      pending = new Map()
+      pendingInvokes.set(sender, pending)
+    }
+    pending.set(requestId, event)
+    event.cancelled = false
+
+    new Promise((resolve) => resolve(handler(event, ...args))).then((result) => {
+      if (pending.delete(requestId)) sender._invokeReply(requestId, true, result)
+    }, (error) => {
+      if (pending.delete(requestId)) {
+        sender._invokeReply(requestId, false, error instanceof Error ? error.message : String(error))
+      }
+    })
+  })
+  this.on('ipc-invoke-cancel', function (event, requestId) {
+    const pending = pendingInvokes.get(event.sender)
+    const invokeEvent = pending && pending.get(requestId)
+    if (invokeEvent) {
+      pending.delete(requestId)
+      invokeEvent.cancelled = true
+    }
+  })
+
   // Handle context menu action request from pepper plugin.
   this.on('pepper-context-menu', function (event, params) {
     // Access Menu via electron.Menu to prevent circular require
@@ -266,6 +302,10 @@ module.exports = {
     }
   },
 
+  getAllTabValues (windowId, sinceVersion = 0) {
+    return binding.getAllTabValues(windowId, sinceVersion)
+  },
+
   getFocusedWebContents () {
     let focused = null
     for (let contents of binding.getAllWebContents()) {
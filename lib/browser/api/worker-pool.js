@@ -0,0 +1,287 @@
+'use strict'
+
+const {EventEmitter} = require('events')
+const os = require('os')
+
+// Time without memory pressure after which a pool can grow back to its size.
+const PRESSURE_RECOVERY_DELAY = 30 * 1000
+
+// A pool of workers running the same module. Each task is a message posted to
+// an idle worker, and the task settles with the first message the worker
+// posts back, or fails with the first error it reports. A worker runs one
+// task at a time, so a task never waits behind a slow one while another
+// worker is idle. A worker whose task failed is replaced, since it may still
+// post messages for that task which would be taken for the next one.
+//
+// The pool shrinks on memory pressure, stopping the idle workers first, and
+// spawns workers again on demand once the pressure is gone.
+function WorkerPool (app, moduleName, options = {}) {
+  EventEmitter.call(this)
+
+  this.moduleName = moduleName
+  // leave a core for the main process
+  this.size = Math.max(1, options.size || os.cpus().length - 1)
+  this.minSize = Math.min(this.size, Math.max(1, options.minSize || 1))
+  this.limit = this.size
+  this.lastError = null
+
+  this._app = app
+  this._workers = new Set()
+  this._idle = []
+  this._queue = []
+  this._terminated = false
+  this._nextTaskId = 1
+  this._pressureLevel = null
+  this._recoveryTimer = null
+  this._stats = {
+    completed: 0,
+    failed: 0,
+    totalLatency: 0,
+    totalQueueTime: 0
+  }
+
+  this._onMemoryPressure = this._onMemoryPressure.bind(this)
+  app.on('memory-pressure', this._onMemoryPressure)
+
+  this._fill()
+}
+
+Object.setPrototypeOf(WorkerPool.prototype, EventEmitter.prototype)
+
+// Returns a promise for the message the worker answers |message| with. The
+// ArrayBuffers of |transferList| are moved to the worker when the task is
+// dispatched.
+WorkerPool.prototype.run = function (message, transferList) {
+  if (this._terminated) {
+    return Promise.reject(new Error('The worker pool has been terminated'))
+  }
+
+  return new Promise((resolve, reject) => {
+    this._queue.push({
+      id: this._nextTaskId++,
+      message,
+      transferList,
+      resolve,
+      reject,
+      queuedAt: Date.now(),
+      startedAt: 0
+    })
+    this._drain()
+  })
+}
+
+WorkerPool.prototype.resize = function (size) {
+  this.size = Math.max(1, size)
+  this.minSize = Math.min(this.minSize, this.size)
+  this._updateLimit()
+  this._trim()
+  this._fill()
+}
+
+WorkerPool.prototype.getStats = function () {
+  const stats = this._stats
+  const settled = stats.completed + stats.failed
+  return {
+    size: this.size,
+    limit: this.limit,
+    workers: this._workers.size,
+    idle: this._idle.length,
+    queueDepth: this._queue.length,
+    completed: stats.completed,
+    failed: stats.failed,
+    averageLatency: settled ? stats.totalLatency / settled : 0,
+    averageQueueTime: settled ? stats.totalQueueTime / settled : 0
+  }
+}
+
+WorkerPool.prototype.terminate = function () {
+  if (this._terminated) return
+
+  this._terminated = true
+  clearTimeout(this._recoveryTimer)
+  this._recoveryTimer = null
+  this._app.removeListener('memory-pressure', this._onMemoryPressure)
+
+  this._rejectQueued('The worker pool has been terminated')
+  this._idle = []
+  // the tasks in progress fail when their worker stops
+  for (const worker of this._workers) {
+    worker.terminate()
+  }
+}
+
+WorkerPool.prototype._spawn = function () {
+  const worker = this._app.createWorker(this.moduleName)
+  worker.pooled = true
+  worker.task = null
+  worker.ready = false
+
+  worker.on('start', () => {
+    worker.ready = true
+    if (this._terminated || !this._workers.has(worker)) {
+      worker.terminate()
+    } else if (worker.lastError) {
+      // the module can't be loaded, so a new worker wouldn't do any better
+      this._retire(worker)
+      this._rejectQueued(worker.lastError)
+    } else {
+      this._release(worker)
+    }
+  })
+  worker.on('message', (event) => this._onMessage(worker, event.data))
+  worker.on('stop', () => this._onStop(worker))
+  worker.onerror = (message, stack) => this._onError(worker, message, stack)
+
+  this._workers.add(worker)
+  worker.start()
+  if (worker.id === -1) {
+    this._workers.delete(worker)
+    return false
+  }
+  return true
+}
+
+WorkerPool.prototype._fill = function () {
+  while (!this._terminated && this._workers.size < this.limit) {
+    if (!this._spawn()) break
+  }
+}
+
+// Stop idle workers over the limit. Busy ones stop when their task is done.
+WorkerPool.prototype._trim = function () {
+  while (this._workers.size > this.limit && this._idle.length) {
+    this._retire(this._idle.shift())
+  }
+}
+
+WorkerPool.prototype._retire = function (worker) {
+  this._workers.delete(worker)
+  worker.terminate()
+}
+
+WorkerPool.prototype._release = function (worker) {
+  if (this._workers.size > this.limit) {
+    this._retire(worker)
+  } else {
+    this._idle.push(worker)
+  }
+  this._drain()
+}
+
+WorkerPool.prototype._drain = function () {
+  while (this._queue.length && this._idle.length) {
+    // the most recently used worker is the most likely to be warm
+    const worker = this._idle.pop()
+    const task = this._queue.shift()
+    task.startedAt = Date.now()
+    worker.task = task
+    try {
+      worker.postMessage(task.message, task.transferList)
+    } catch (error) {
+      // the message never reached the worker, so it can take another task
+      this._settle(worker, error)
+      this._idle.push(worker)
+    }
+  }
+
+  // workers stopped by memory pressure come back when they are needed
+  if (this._queue.length > this._pendingStarts()) {
+    this._fill()
+  }
+}
+
+WorkerPool.prototype._pendingStarts = function () {
+  let starting = 0
+  for (const worker of this._workers) {
+    !worker.ready && starting++
+  }
+  return starting
+}
+
+WorkerPool.prototype._settle = function (worker, error, result) {
+  const task = worker.task
+  worker.task = null
+
+  const now = Date.now()
+  const latency = now - task.startedAt
+  const queueTime = task.startedAt - task.queuedAt
+  const stats = this._stats
+  error ? stats.failed++ : stats.completed++
+  stats.totalLatency += latency
+  stats.totalQueueTime += queueTime
+  this.emit('task-done', {id: task.id, latency, queueTime, failed: !!error})
+
+  error ? task.reject(error) : task.resolve(result)
+}
+
+WorkerPool.prototype._onMessage = function (worker, data) {
+  // a worker replaced after a failed task may still answer it
+  if (!this._workers.has(worker)) return
+  if (!worker.task) {
+    this.emit('message', {data})
+    return
+  }
+  this._settle(worker, null, data)
+  this._workers.has(worker) && this._release(worker)
+}
+
+WorkerPool.prototype._onError = function (worker, message, stack) {
+  this.lastError = message
+  if (!worker.task) return
+
+  const error = new Error(message)
+  if (stack) error.stack = stack
+  this._settle(worker, error)
+  if (this._workers.has(worker)) {
+    this._retire(worker)
+    this._drain()
+  }
+}
+
+WorkerPool.prototype._onStop = function (worker) {
+  const idle = this._idle.indexOf(worker)
+  idle !== -1 && this._idle.splice(idle, 1)
+  const retired = !this._workers.delete(worker)
+
+  worker.task && this._settle(worker, new Error('The worker has stopped'))
+  if (this._terminated || retired) return
+
+  if (!worker.ready) {
+    this._rejectQueued(worker.lastError || 'The worker could not be started')
+    return
+  }
+  this._drain()
+}
+
+WorkerPool.prototype._rejectQueued = function (message) {
+  const error = new Error(message)
+  this._queue.splice(0).forEach((task) => task.reject(error))
+}
+
+// The limit depends on the last pressure level only, so repeated events of
+// the same level don't keep shrinking the pool.
+WorkerPool.prototype._updateLimit = function () {
+  if (this._pressureLevel === 'critical') {
+    this.limit = this.minSize
+  } else if (this._pressureLevel === 'moderate') {
+    this.limit = Math.max(this.minSize, Math.ceil(this.size / 2))
+  } else {
+    this.limit = this.size
+  }
+}
+
+WorkerPool.prototype._onMemoryPressure = function (event, level) {
+  this._pressureLevel = level
+  this._updateLimit()
+  this._trim()
+
+  clearTimeout(this._recoveryTimer)
+  this._recoveryTimer = setTimeout(() => {
+    this._recoveryTimer = null
+    this._pressureLevel = null
+    this._updateLimit()
+    this._drain()
+  }, PRESSURE_RECOVERY_DELAY)
+}
+
+module.exports = WorkerPool
@@ -483,6 +483,16 @@
         throw new TypeError('Bad arguments')
       }
       const {encoding} = options
+      if (info.compressed) {
+        logASARAccess(asarPath, filePath, info.offset)
+        // decompressed on the threadpool
+        return archive.readFile(filePath, function (buffer) {
+          if (!buffer) {
+            return notFoundError(asarPath, filePath, callback)
+          }
+          callback(null, encoding ? buffer.toString(encoding) : buffer)
+        })
+      }
       const buffer = new Buffer(info.size)
       const fd = archive.getFd()
       if (!(fd >= 0)) {
@@ -531,13 +541,22 @@
         throw new TypeError('Bad arguments')
       }
       const {encoding} = options
-      const buffer = new Buffer(info.size)
-      const fd = archive.getFd()
-      if (!(fd >= 0)) {
-        notFoundError(asarPath, filePath)
+      let buffer
+      if (info.compressed) {
+        logASARAccess(asarPath, filePath, info.offset)
+        buffer = archive.readFile(filePath)
+        if (!buffer) {
+          notFoundError(asarPath, filePath)
+        }
+      } else {
+        buffer = new Buffer(info.size)
+        const fd = archive.getFd()
+        if (!(fd >= 0)) {
+          notFoundError(asarPath, filePath)
+        }
+        logASARAccess(asarPath, filePath, info.offset)
+        fs.readSync(fd, buffer, 0, info.size, info.offset)
       }
-      logASARAccess(asarPath, filePath, info.offset)
-      fs.readSync(fd, buffer, 0, info.size, info.offset)
       if (encoding) {
         return buffer.toString(encoding)
       } else {
@@ -604,6 +623,11 @@
           encoding: 'utf8'
         })
       }
+      if (info.compressed) {
+        logASARAccess(asarPath, filePath, info.offset)
+        const buffer = archive.readFile(filePath)
+        return buffer ? buffer.toString('utf8') : undefined
+      }
       const buffer = new Buffer(info.size)
       const fd = archive.getFd()
       if (!(fd >= 0)) {
@@ -1,6 +1,6 @@
 const path = requireNative('path')
 
-const commonjs = function (fn, exports, modulePath, __global__) {
+const commonjs = function (exports, modulePath, __global__, scope) {
   // convert module.exports to exports.$set
   const exportsHandler = {
     set: (target, name, value) => {
@@ -65,7 +65,9 @@ const commonjs = function (fn, exports, modulePath, __global__) {
   }
 
   try {
-    fn.apply(__global__, [requireProxy, moduleProxy, console])
+    // compiled from the code cache when another isolate already loaded it
+    path.runModule(modulePath, __global__,
+      [requireProxy, moduleProxy, console].concat(scope))
   } catch (e) {
     if (__global__.onerror) {
       __global__.onerror(e)
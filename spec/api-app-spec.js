@@ -334,4 +334,49 @@ describe('app module', function () {
       assert.equal(typeof app.isAccessibilitySupportEnabled(), 'boolean')
     })
   })
+
+  describe('app.createWorker', function () {
+    let result = null
+
+    before(function (done) {
+      const transfer = remote.require(path.join(__dirname, 'fixtures', 'module', 'worker-transfer.js'))
+      transfer(function (error, value) {
+        result = value
+        done(error)
+      })
+    })
+
+    it('detaches the transferred ArrayBuffers in the sender', function () {
+      assert.equal(result.detached, true)
+      assert.deepEqual(result.transferred, {byteLength: 8, first: 7})
+    })
+
+    it('shares the memory of SharedArrayBuffers with the worker', function () {
+      assert.deepEqual(result.shared[0], {seen: 41, value: 42})
+    })
+
+    it('shares the same memory when a SharedArrayBuffer is posted again', function () {
+      assert.deepEqual(result.shared[1], {seen: 100, previous: 101, value: 101})
+    })
+
+    it('gives worker modules the names of the module system scope', function (done) {
+      const scope = remote.require(path.join(__dirname, 'fixtures', 'module', 'worker-scope.js'))
+      scope(function (error, results) {
+        if (error) return done(error)
+        const expected = {
+          require: 'function',
+          module: 'object',
+          exports: 'object',
+          define: 'function',
+          requireNative: 'function',
+          privates: 'function',
+          $Array: 'object',
+          $Function: 'object'
+        }
+        // the second worker compiles the module from the code cache
+        assert.deepEqual(results, [expected, expected])
+        done()
+      })
+    })
+  })
 })
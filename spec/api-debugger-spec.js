@@ -112,6 +112,94 @@ describe('debugger module', function () {
       w.webContents.debugger.sendCommand('Console.enable')
     })
 
+    it('only emits the filtered events', function (done) {
+      w.webContents.loadURL('file://' + path.join(fixtures, 'pages', 'a.html'))
+      try {
+        w.webContents.debugger.attach()
+      } catch (err) {
+        done('unexpected error : ' + err)
+      }
+      w.webContents.debugger.setEventFilter(['Console.*'], {format: 'json'})
+      w.webContents.debugger.on('message', function (e, method, params) {
+        assert(method.startsWith('Console.'))
+        assert.equal(typeof params, 'string')
+        if (method === 'Console.messageAdded') {
+          assert.equal(JSON.parse(params).message.text, 'a')
+          w.webContents.debugger.detach()
+          done()
+        }
+      })
+      w.webContents.debugger.sendCommand('Console.enable')
+      w.webContents.debugger.sendCommand('Page.enable')
+    })
+
+    it('emits batched events with lazy params', function (done) {
+      w.webContents.loadURL('file://' + path.join(fixtures, 'pages', 'a.html'))
+      try {
+        w.webContents.debugger.attach()
+      } catch (err) {
+        done('unexpected error : ' + err)
+      }
+      w.webContents.debugger.setEventFilter(['Console.messageAdded'], {
+        format: 'lazy',
+        batch: true
+      })
+      w.webContents.debugger.on('messages', function (e, messages) {
+        assert.equal(messages[0].method, 'Console.messageAdded')
+        assert.equal(typeof messages[0].params.json, 'string')
+        assert.equal(messages[0].params.params.message.text, 'a')
+        w.webContents.debugger.detach()
+        done()
+      })
+      w.webContents.debugger.sendCommand('Console.enable')
+    })
+
+    describe('events with braces and quotes in their strings', function () {
+      const texts = ['}', '"', '{"a": "}"}', 'b\\', '\\"}']
+      const expression = `console.log(${texts.map((text) => JSON.stringify(text)).join(', ')})`
+
+      const getValues = function (params) {
+        return params.args.map((arg) => arg.value)
+      }
+
+      it('emits the whole params as json', function (done) {
+        w.webContents.loadURL('about:blank')
+        try {
+          w.webContents.debugger.attach()
+        } catch (err) {
+          done('unexpected error : ' + err)
+        }
+        w.webContents.debugger.setEventFilter(['Runtime.consoleAPICalled'], {format: 'json'})
+        w.webContents.debugger.on('message', function (e, method, params) {
+          assert.equal(method, 'Runtime.consoleAPICalled')
+          assert.deepEqual(getValues(JSON.parse(params)), texts)
+          w.webContents.debugger.detach()
+          done()
+        })
+        w.webContents.debugger.sendCommand('Runtime.enable')
+        w.webContents.debugger.sendCommand('Runtime.evaluate', {expression})
+      })
+
+      it('emits the whole params lazily', function (done) {
+        w.webContents.loadURL('about:blank')
+        try {
+          w.webContents.debugger.attach()
+        } catch (err) {
+          done('unexpected error : ' + err)
+        }
+        w.webContents.debugger.setEventFilter(['Runtime.consoleAPICalled'], {format: 'lazy'})
+        w.webContents.debugger.on('message', function (e, method, params) {
+          assert.equal(method, 'Runtime.consoleAPICalled')
+          assert.deepEqual(getValues(params.params), texts)
+          assert.deepEqual(JSON.parse(params.json), params.params)
+          w.webContents.debugger.detach()
+          done()
+        })
+        w.webContents.debugger.sendCommand('Runtime.enable')
+        w.webContents.debugger.sendCommand('Runtime.evaluate', {expression})
+      })
+    })
+
     it('returns error message when command fails', function (done) {
       w.webContents.loadURL('about:blank')
       try {
@@ -325,6 +325,22 @@ describe('ipc module', function () {
   })
 
   describe('ipc.sender.send', function () {
+    it('reuses event.sender for the messages of a frame', function () {
+      ipcRenderer.sendSync('eval', `(function () {
+        const senders = []
+        const record = (event) => senders.push(event.sender)
+        ipcMain.on('record-sender', record)
+        global.checkSenders = function () {
+          ipcMain.removeListener('record-sender', record)
+          return senders.length === 3 && senders.every((sender) => sender === senders[0])
+        }
+      })()`)
+      ipcRenderer.send('record-sender')
+      ipcRenderer.send('record-sender', 'second')
+      ipcRenderer.send('record-sender', 'third')
+      assert.equal(ipcRenderer.sendSync('eval', 'global.checkSenders()'), true)
+    })
+
     it('should work when sending an object containing id property', function (done) {
       var obj = {
         id: 1,
@@ -340,15 +356,33 @@ describe('ipc module', function () {
     it('can send instances of Date', function (done) {
       const currentDate = new Date()
       ipcRenderer.once('message', function (event, value) {
-        assert.equal(value, currentDate.toISOString())
+        assert.ok(value instanceof Date)
+        assert.equal(value.getTime(), currentDate.getTime())
         done()
       })
       ipcRenderer.send('message', currentDate)
     })
 
+    it('can send typed arrays, Maps and Sets', function (done) {
+      const array = new Float64Array([1.5, 2.5])
+      const map = new Map([['a', 1], ['b', 2]])
+      const set = new Set(['c'])
+      ipcRenderer.once('message', function (event, arrayValue, mapValue, setValue) {
+        assert.ok(arrayValue instanceof Float64Array)
+        assert.deepEqual(Array.from(arrayValue), [1.5, 2.5])
+        assert.ok(mapValue instanceof Map)
+        assert.equal(mapValue.get('b'), 2)
+        assert.ok(setValue instanceof Set)
+        assert.ok(setValue.has('c'))
+        done()
+      })
+      ipcRenderer.send('message', array, map, set)
+    })
+
     it('can send instances of Buffer', function (done) {
       const buffer = Buffer.from('hello')
       ipcRenderer.once('message', function (event, message) {
+        assert.ok(Buffer.isBuffer(message))
         assert.ok(buffer.equals(message))
         done()
       })
@@ -403,7 +437,7 @@ describe('ipc module', function () {
       ipcRenderer.send('message', array, foo, bar, child)
     })
 
-    it('inserts null for cyclic references', function (done) {
+    it('keeps cyclic references', function (done) {
       const array = [5]
       array.push(array)
 
@@ -412,10 +446,10 @@ describe('ipc module', function () {
 
       ipcRenderer.once('message', function (event, arrayValue, childValue) {
         assert.equal(arrayValue[0], 5)
-        assert.equal(arrayValue[1], null)
+        assert.strictEqual(arrayValue[1], arrayValue)
 
         assert.equal(childValue.hello, 'world')
-        assert.equal(childValue.child, null)
+        assert.strictEqual(childValue.child, childValue)
 
         done()
       })
@@ -423,6 +457,57 @@ describe('ipc module', function () {
     })
   })
 
+  describe('ipc.invoke', function () {
+    it('resolves with the result of the handler', function () {
+      const map = new Map([['date', new Date(0)]])
+      return ipcRenderer.invoke('invoke-echo', 'test', map).then(function (result) {
+        assert.equal(result[0], 'test')
+        assert.ok(result[1] instanceof Map)
+        assert.equal(result[1].get('date').getTime(), 0)
+      })
+    })
+
+    it('waits for the promise returned by the handler', function () {
+      return ipcRenderer.invoke('invoke-delay', 10, 'done').then(function (result) {
+        assert.equal(result, 'done')
+      })
+    })
+
+    it('rejects with the error of the handler', function () {
+      return ipcRenderer.invoke('invoke-error', 'failed').then(function () {
+        assert.fail('should have been rejected')
+      }, function (error) {
+        assert.equal(error.message, 'failed')
+      })
+    })
+
+    it('rejects when there is no handler', function () {
+      return ipcRenderer.invoke('invoke-missing').then(function () {
+        assert.fail('should have been rejected')
+      }, function (error) {
+        assert.equal(error.message, "No handler registered for 'invoke-missing'")
+      })
+    })
+
+    it('rejects when it times out', function () {
+      return ipcRenderer.invokeWithTimeout(10, 'invoke-delay', 1000).then(function () {
+        assert.fail('should have been rejected')
+      }, function (error) {
+        assert.equal(error.message, 'Invocation timed out')
+      })
+    })
+
+    it('can be cancelled', function () {
+      const promise = ipcRenderer.invoke('invoke-delay', 1000)
+      promise.cancel()
+      return promise.then(function () {
+        assert.fail('should have been rejected')
+      }, function (error) {
+        assert.equal(error.message, 'Invocation was cancelled')
+      })
+    })
+  })
+
   describe('ipc.sendSync', function () {
     afterEach(function () {
       ipcMain.removeAllListeners('send-sync-message')
@@ -433,6 +518,14 @@ describe('ipc module', function () {
       assert.equal(msg, 'test')
     })
 
+    it('keeps the types of the arguments and of the reply', function () {
+      const map = new Map([['date', new Date(0)]])
+      const reply = ipcRenderer.sendSync('echo', map)
+      assert.ok(reply instanceof Map)
+      assert.ok(reply.get('date') instanceof Date)
+      assert.equal(reply.get('date').getTime(), 0)
+    })
+
     it('does not crash when reply is not sent and browser is destroyed', function (done) {
       this.timeout(10000)
 
@@ -0,0 +1,204 @@
+'use strict'
+
+const assert = require('assert')
+const fs = require('fs')
+const os = require('os')
+const path = require('path')
+const {remote} = require('electron')
+const {closeWindow} = require('./window-helpers')
+const {BrowserWindow} = remote
+
+describe('muon module', () => {
+  const muon = remote.getGlobal('muon')
+
+  describe('sharedMemory', () => {
+    let w1 = null
+    let w2 = null
+
+    afterEach(() => {
+      return Promise.all([w1, w2].filter((w) => w).map((w) => closeWindow(w)))
+        .then(() => { w1 = w2 = null })
+    })
+
+    const loadWindow = () => {
+      const w = new BrowserWindow({show: false})
+      return new Promise((resolve) => {
+        w.webContents.once('did-finish-load', () => resolve(w))
+        w.loadURL('about:blank')
+      })
+    }
+
+    it('reuses released segments', () => {
+      muon.sharedMemory.create({value: 1}).close()
+      const stats = muon.sharedMemory.getStats()
+      const shared = muon.sharedMemory.create({value: 2})
+      assert.equal(muon.sharedMemory.getStats().poolHits, stats.poolHits + 1)
+      shared.close()
+    })
+
+    it('never sends a segment to a second renderer', () => {
+      return Promise.all([loadWindow(), loadWindow()]).then((windows) => {
+        [w1, w2] = windows
+        const shared = muon.sharedMemory.create({value: 'secret'})
+        const stats = muon.sharedMemory.getStats()
+        assert(w1.webContents.sendShared('channel', shared))
+        assert.equal(muon.sharedMemory.getStats().peerCopies, stats.peerCopies)
+        assert(w2.webContents.sendShared('channel', shared))
+        if (w1.webContents.getOSProcessId() !== w2.webContents.getOSProcessId()) {
+          assert.equal(muon.sharedMemory.getStats().peerCopies,
+                       stats.peerCopies + 1)
+        }
+        shared.close()
+      })
+    })
+  })
+
+  describe('crypto.encryptStrings/decryptStrings', () => {
+    it('round trips a batch of strings', (done) => {
+      const plaintexts = ['a', 'hello world', '']
+      muon.crypto.encryptStrings(plaintexts, (ciphertexts, stats) => {
+        assert.equal(ciphertexts.length, plaintexts.length)
+        assert.equal(stats.count, plaintexts.length)
+        assert.equal(stats.failed, 0)
+        muon.crypto.decryptStrings(ciphertexts, (results, stats) => {
+          assert.deepEqual(results, plaintexts)
+          assert.equal(stats.failed, 0)
+          done()
+        })
+      })
+    })
+
+    it('returns null for the items which fail', (done) => {
+      muon.crypto.encryptStrings(['secret'], (ciphertexts) => {
+        // not base64, so it can't be decrypted
+        const inputs = [ciphertexts[0], '%%%', ciphertexts[0]]
+        muon.crypto.decryptStrings(inputs, (results, stats) => {
+          assert.deepEqual(results, ['secret', null, 'secret'])
+          assert.equal(stats.count, 3)
+          assert.equal(stats.failed, 1)
+          done()
+        })
+      })
+    })
+  })
+
+  describe('file journal', () => {
+    let storePath = null
+
+    beforeEach(() => {
+      storePath = path.join(fs.mkdtempSync(path.join(os.tmpdir(), 'muon-journal-')), 'store.json')
+    })
+
+    const reopen = (callback) => {
+      muon.file.closeJournal(storePath, (success) => {
+        assert.equal(success, true)
+        muon.file.openJournal(storePath, (json) => {
+          muon.file.closeJournal(storePath)
+          callback(JSON.parse(json))
+        })
+      })
+    }
+
+    it('writes pretty-printed operations', (done) => {
+      muon.file.openJournal(storePath, (json) => {
+        assert.equal(json, '{}')
+        muon.file.appendJournal(storePath, JSON.stringify([
+          {op: 'add', path: '/window', value: {width: 800, height: 600}}
+        ], null, 2))
+        reopen((document) => {
+          assert.deepEqual(document, {window: {width: 800, height: 600}})
+          done()
+        })
+      })
+    })
+
+    it('rejects paths through an array', (done) => {
+      muon.file.openJournal(storePath, () => {
+        muon.file.appendJournal(storePath, JSON.stringify([
+          {op: 'add', path: '/tabs', value: [{title: 'a'}]}
+        ]))
+        muon.file.appendJournal(storePath, JSON.stringify([
+          {op: 'replace', path: '/tabs/0/title', value: 'b'}
+        ]))
+        muon.file.flushJournal(storePath, (success) => {
+          assert.equal(success, false)
+          reopen((document) => {
+            assert.deepEqual(document, {tabs: [{title: 'a'}]})
+            done()
+          })
+        })
+      })
+    })
+
+    it('ignores a journal which was already folded into the snapshot', (done) => {
+      muon.file.openJournal(storePath, () => {
+        muon.file.appendJournal(storePath, JSON.stringify([
+          {op: 'add', path: '/z', value: 1}
+        ]))
+        muon.file.appendJournal(storePath, JSON.stringify([
+          {op: 'add', path: '/a/b', value: 1},
+          {op: 'add', path: '/z', value: 2}
+        ]))
+        muon.file.appendJournal(storePath, JSON.stringify([
+          {op: 'replace', path: '/a', value: 5}
+        ]))
+        muon.file.flushJournal(storePath, (success) => {
+          assert.equal(success, true)
+          const journal = fs.readFileSync(storePath + '.journal')
+          // leave the journal behind as if the process died while compacting
+          reopen((document) => {
+            assert.deepEqual(document, {a: 5, z: 2})
+            fs.writeFileSync(storePath + '.journal', journal)
+            muon.file.openJournal(storePath, (json) => {
+              muon.file.closeJournal(storePath)
+              assert.deepEqual(JSON.parse(json), {a: 5, z: 2})
+              done()
+            })
+          })
+        })
+      })
+    })
+
+    it('skips records which do not apply and drops an incomplete one', (done) => {
+      muon.file.openJournal(storePath, () => {
+        muon.file.appendJournal(storePath, JSON.stringify([
+          {op: 'add', path: '/tabs', value: [{title: 'a'}]}
+        ]))
+        muon.file.flushJournal(storePath, () => {
+          const journal = fs.readFileSync(storePath + '.journal', 'utf8')
+          muon.file.closeJournal(storePath, () => {
+            // the journal of the empty store, with a record through an
+            // array, a valid one and one cut short
+            fs.unlinkSync(storePath)
+            fs.writeFileSync(storePath + '.journal', journal +
+              '[{"op":"replace","path":"/tabs/0/title","value":"b"}]\n' +
+              '[{"op":"add","path":"/b","value":1}]\n' +
+              '[{"op":"add","path":"/c"')
+            muon.file.openJournal(storePath, (json) => {
+              assert.deepEqual(JSON.parse(json), {tabs: [{title: 'a'}], b: 1})
+              muon.file.appendJournal(storePath, JSON.stringify([
+                {op: 'add', path: '/c', value: 2}
+              ]))
+              reopen((document) => {
+                assert.deepEqual(document, {tabs: [{title: 'a'}], b: 1, c: 2})
+                done()
+              })
+            })
+          })
+        })
+      })
+    })
+
+    it('throws for invalid operations', (done) => {
+      muon.file.openJournal(storePath, () => {
+        assert.throws(() => {
+          muon.file.appendJournal(storePath, '[{"op": "add", "path": "/a"')
+        })
+        assert.throws(() => {
+          muon.file.appendJournal(storePath, '[{"op": "move", "path": "/a"}]')
+        })
+        muon.file.closeJournal(storePath, () => done())
+      })
+    })
+  })
+})
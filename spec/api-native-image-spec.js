@@ -59,4 +59,56 @@ describe('nativeImage module', () => {
       assert.equal(image.getSize().width, 256)
     })
   })
+
+  describe('async encoding', () => {
+    const imagePath = path.join(__dirname, 'fixtures', 'assets', 'logo.png')
+
+    it('encodes the same PNG and data URL as the sync methods', (done) => {
+      const image = nativeImage.createFromPath(imagePath)
+      image.toPNGAsync((buffer) => {
+        assert(buffer.equals(image.toPNG()))
+        image.toDataURLAsync((dataURL) => {
+          assert.equal(dataURL, image.toDataURL())
+          done()
+        })
+      })
+    })
+
+    it('encodes JPEG', (done) => {
+      const image = nativeImage.createFromPath(imagePath)
+      image.toJPEGAsync(80, (buffer) => {
+        const decoded = nativeImage.createFromBuffer(buffer)
+        assert.deepEqual(decoded.getSize(), image.getSize())
+        done()
+      })
+    })
+
+    it('encodes the pixels as they were when called after getBitmap', (done) => {
+      const image = nativeImage.createFromPath(imagePath)
+      const expected = image.toPNG()
+      const bitmap = image.getBitmap()
+      image.toPNGAsync((buffer) => {
+        assert(buffer.equals(expected))
+        done()
+      })
+      bitmap.fill(0)
+    })
+
+    it('does not hand out the PNG of the image', (done) => {
+      const image = nativeImage.createFromPath(imagePath)
+      const expected = image.toPNG()
+      image.toPNGAsync((buffer) => {
+        buffer.fill(0)
+        assert(image.toPNG().equals(expected))
+        done()
+      })
+    })
+
+    it('returns empty buffers for empty images', (done) => {
+      nativeImage.createEmpty().toPNGAsync((buffer) => {
+        assert.equal(buffer.length, 0)
+        done()
+      })
+    })
+  })
 })
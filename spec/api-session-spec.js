@@ -402,4 +402,195 @@ describe('session module', function () {
       })
     })
   })
+
+  describe('content_settings pref', function () {
+    const partition = 'content-settings-spec'
+    const pageURL = 'file://' + path.join(fixtures, 'pages', 'content-settings.html')
+    const blockJavascript = {
+      javascript: [{setting: 'block', primaryPattern: '*', secondaryPattern: ''}]
+    }
+    let ses = null
+    let w2 = null
+    let server = null
+    let serverPort = null
+
+    before(function (done) {
+      ses = session.fromPartition(partition)
+      ses.userPrefs.registerDictionaryPref('content_settings', {}, false)
+      server = http.createServer(function (req, res) {
+        if (req.url.startsWith('/script.js')) {
+          res.setHeader('Content-Type', 'application/javascript')
+          res.end('window.scriptRuns = (window.scriptRuns || 0) + 1')
+          return
+        }
+        res.setHeader('Content-Type', 'text/html')
+        fs.createReadStream(path.join(fixtures, 'pages', 'content-settings.html')).pipe(res)
+      })
+      server.listen(0, '127.0.0.1', function () {
+        serverPort = server.address().port
+        done()
+      })
+    })
+
+    after(function () {
+      server.close()
+    })
+
+    afterEach(function () {
+      ses.userPrefs.setDictionaryPref('content_settings', {})
+      if (w2) return closeWindow(w2).then(function () { w2 = null })
+    })
+
+    const loadTitle = function (win, url) {
+      return new Promise(function (resolve) {
+        win.webContents.once('did-finish-load', function () {
+          resolve(win.webContents.getTitle())
+        })
+        win.loadURL(url || pageURL)
+      })
+    }
+
+    const createWindow = function () {
+      return new BrowserWindow({show: false, webPreferences: {partition}})
+    }
+
+    it('sends each change to the running renderers', function () {
+      const win = createWindow()
+      return loadTitle(win).then(function (title) {
+        assert.equal(title, 'allowed')
+        ses.userPrefs.setDictionaryPref('content_settings', blockJavascript)
+        return loadTitle(win)
+      }).then(function (title) {
+        assert.equal(title, 'blocked')
+        ses.userPrefs.setDictionaryPref('content_settings', {})
+        return loadTitle(win)
+      }).then(function (title) {
+        assert.equal(title, 'allowed')
+        return closeWindow(win)
+      })
+    })
+
+    const serverURL = function (host) {
+      return 'http://' + host + ':' + serverPort + '/'
+    }
+
+    // The file page, a page of 127.0.0.1 and one of localhost.
+    const loadTitles = function (win) {
+      return loadTitle(win).then(function (fileTitle) {
+        return loadTitle(win, serverURL('127.0.0.1')).then(function (ipTitle) {
+          return loadTitle(win, serverURL('localhost')).then(function (hostTitle) {
+            return [fileTitle, ipTitle, hostTitle]
+          })
+        })
+      })
+    }
+
+    const javascriptRules = {
+      'no rule': [],
+      'a wildcard rule': [
+        {setting: 'block', primaryPattern: '*', secondaryPattern: ''}
+      ],
+      'a host rule': [
+        {setting: 'block', primaryPattern: '[*.]127.0.0.1', secondaryPattern: ''}
+      ],
+      'a host rule after a wildcard rule': [
+        {setting: 'block', primaryPattern: '*', secondaryPattern: ''},
+        {setting: 'allow', primaryPattern: '127.0.0.1', secondaryPattern: ''}
+      ],
+      'a wildcard rule after a host rule': [
+        {setting: 'allow', primaryPattern: '[*.]127.0.0.1', secondaryPattern: ''},
+        {setting: 'block', primaryPattern: '*', secondaryPattern: ''}
+      ],
+      'a default setting and invalid rules': [
+        {setting: 'block', primaryPattern: 'http://[', secondaryPattern: ''},
+        {setting: 'default', primaryPattern: 'localhost', secondaryPattern: ''},
+        {primaryPattern: '*'}
+      ]
+    }
+    // The decisions of ContentSettingsPattern::Matches() with the last
+    // matching rule winning, as before the rules were precompiled.
+    const expectedTitles = {
+      'no rule': ['allowed', 'allowed', 'allowed'],
+      'a wildcard rule': ['blocked', 'blocked', 'blocked'],
+      'a host rule': ['allowed', 'blocked', 'allowed'],
+      'a host rule after a wildcard rule': ['blocked', 'allowed', 'blocked'],
+      'a wildcard rule after a host rule': ['blocked', 'blocked', 'blocked'],
+      'a default setting and invalid rules': ['allowed', 'allowed', 'allowed']
+    }
+
+    Object.keys(javascriptRules).forEach(function (name) {
+      it('decides like the content settings patterns for ' + name, function () {
+        ses.userPrefs.setDictionaryPref('content_settings', {javascript: javascriptRules[name]})
+        w2 = createWindow()
+        return loadTitles(w2).then(function (titles) {
+          assert.deepEqual(titles, expectedTitles[name])
+        })
+      })
+    })
+
+    it('uses the new setting for a resource whose decision was cached', function () {
+      // the decisions are cached per frame by the origin of the resource, so
+      // each script of the page has the same key
+      const loadScript = function (win, id) {
+        return new Promise(function (resolve) {
+          win.webContents.once('page-title-updated', function (event, title) {
+            resolve(title)
+          })
+          win.webContents.executeJavaScript(`
+            (function () {
+              var script = document.createElement('script')
+              var timeout = setTimeout(function () {
+                document.title = 'failed ${id}'
+              }, 2000)
+              script.onload = function () {
+                clearTimeout(timeout)
+                document.title = 'loaded ${id}'
+              }
+              script.onerror = function () {
+                clearTimeout(timeout)
+                document.title = 'failed ${id}'
+              }
+              script.src = '${serverURL('127.0.0.1')}script.js?${id}'
+              document.body.appendChild(script)
+            })()
+          `)
+        })
+      }
+
+      w2 = createWindow()
+      return loadTitle(w2).then(function () {
+        return loadScript(w2, 1)
+      }).then(function (title) {
+        assert.equal(title, 'loaded 1')
+        ses.userPrefs.setDictionaryPref('content_settings', {
+          javascript: [{setting: 'block', primaryPattern: '*', secondaryPattern: '[*.]127.0.0.1'}]
+        })
+        return loadScript(w2, 2)
+      }).then(function (title) {
+        assert.equal(title, 'failed 2')
+        ses.userPrefs.setDictionaryPref('content_settings', {})
+        return loadScript(w2, 3)
+      }).then(function (title) {
+        assert.equal(title, 'loaded 3')
+      })
+    })
+
+    it('keeps running renderers in sync when new renderers start', function () {
+      const win = createWindow()
+      return loadTitle(win).then(function () {
+        ses.userPrefs.setDictionaryPref('content_settings', blockJavascript)
+        // a new renderer gets a snapshot of the current settings
+        w2 = createWindow()
+        return loadTitle(w2)
+      }).then(function (title) {
+        assert.equal(title, 'blocked')
+        // and the next delta still applies to the first one
+        ses.userPrefs.setDictionaryPref('content_settings', {})
+        return Promise.all([loadTitle(win), loadTitle(w2)])
+      }).then(function (titles) {
+        assert.deepEqual(titles, ['allowed', 'allowed'])
+        return closeWindow(win)
+      })
+    })
+  })
 })
@@ -85,6 +85,38 @@ describe('webRequest module', function () {
       })
     })
 
+    it('can filter URLs with many patterns', function (done) {
+      var urls = []
+      for (var i = 0; i < 1000; i++) {
+        urls.push('*://*.example' + i + '.com/*')
+        urls.push('http://127.0.0.1/other' + i + '/*')
+      }
+      urls.push(defaultURL + 'filter/*')
+      ses.webRequest.onBeforeRequest({urls: urls}, function (details, callback) {
+        callback({
+          cancel: true
+        })
+      })
+      $.ajax({
+        url: defaultURL + 'nofilter/test',
+        success: function (data) {
+          assert.equal(data, '/nofilter/test')
+          $.ajax({
+            url: defaultURL + 'filter/test',
+            success: function () {
+              done('unexpected success')
+            },
+            error: function () {
+              done()
+            }
+          })
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+
     it('receives details object', function (done) {
       ses.webRequest.onBeforeRequest(function (details, callback) {
         assert.equal(typeof details.id, 'number')
@@ -431,6 +463,39 @@ describe('webRequest module', function () {
         }
       })
     })
+
+    it('only fills the selected fields', function (done) {
+      ses.webRequest.onCompleted({fields: ['url', 'statusCode']}, function (details) {
+        assert.deepEqual(Object.keys(details).sort(), ['statusCode', 'url'])
+        assert.equal(details.url, defaultURL + 'fields')
+        assert.equal(details.statusCode, 200)
+        done()
+      })
+      $.ajax({
+        url: defaultURL + 'fields',
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+
+    it('delivers events in batches', function (done) {
+      var filter = {
+        urls: [defaultURL + 'batch/*'],
+        fields: ['url'],
+        batchSize: 2,
+        batchInterval: 10000
+      }
+      ses.webRequest.onCompleted(filter, function (detailsList) {
+        assert(Array.isArray(detailsList))
+        assert.deepEqual(detailsList.map(function (details) {
+          return details.url
+        }).sort(), [defaultURL + 'batch/1', defaultURL + 'batch/2'])
+        done()
+      })
+      $.ajax({url: defaultURL + 'batch/1'})
+      $.ajax({url: defaultURL + 'batch/2'})
+    })
   })
 
   describe('webRequest.onErrorOccurred', function () {
@@ -457,4 +522,171 @@ describe('webRequest module', function () {
       })
     })
   })
+
+  describe('webRequest.setRequestFilter', function () {
+    afterEach(function (done) {
+      ses.webRequest.onBeforeRequest(null)
+      ses.webRequest.setRequestFilter(null, function () {
+        done()
+      })
+    })
+
+    var expectRequests = function (blocked, allowed, done) {
+      $.ajax({
+        url: defaultURL + allowed,
+        success: function (data) {
+          assert.equal(data, '/' + allowed)
+          $.ajax({
+            url: defaultURL + blocked,
+            success: function () {
+              done('unexpected success')
+            },
+            error: function () {
+              done()
+            }
+          })
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    }
+
+    it('blocks the requests matching the rules', function (done) {
+      var rules = [
+        '! comment',
+        '||127.0.0.1^*/blocked/',
+        '@@/blocked/allowed$xmlhttprequest'
+      ].join('\n')
+      ses.webRequest.setRequestFilter(rules, function (success) {
+        assert.equal(success, true)
+        expectRequests('blocked/test', 'blocked/allowed', done)
+      })
+    })
+
+    it('ignores the element hiding and popup options', function (done) {
+      var rules = [
+        '/blocked^$xmlhttprequest,popup',
+        '@@||127.0.0.1^$elemhide',
+        '@@||127.0.0.1^$generichide',
+        '/notblocked^$popup'
+      ].join('\n')
+      ses.webRequest.setRequestFilter(rules, function (success) {
+        assert.equal(success, true)
+        expectRequests('blocked', 'notblocked', done)
+      })
+    })
+
+    var expectAllowed = function (path, done) {
+      $.ajax({
+        url: defaultURL + path,
+        success: function (data) {
+          assert.equal(data, '/' + path)
+          done()
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    }
+
+    it('allows every request of a page with a document exception', function (done) {
+      var rules = [
+        '/blocked^$important',
+        '@@|' + window.location.protocol + '$document'
+      ].join('\n')
+      ses.webRequest.setRequestFilter(rules, function (success) {
+        assert.equal(success, true)
+        expectAllowed('blocked', done)
+      })
+    })
+
+    it('skips the generic rules for a page with a genericblock exception', function (done) {
+      var rules = [
+        '/blocked^',
+        '@@|' + window.location.protocol + '$genericblock'
+      ].join('\n')
+      ses.webRequest.setRequestFilter(rules, function (success) {
+        assert.equal(success, true)
+        expectAllowed('blocked', done)
+      })
+    })
+
+    it('loads serialized rules', function (done) {
+      ses.webRequest.serializeRequestFilter('/blocked^$xmlhttprequest', function (rules) {
+        assert(Buffer.isBuffer(rules))
+        ses.webRequest.setRequestFilter(rules, function (success) {
+          assert.equal(success, true)
+          expectRequests('blocked', 'notblocked', done)
+        })
+      })
+    })
+
+    it('removes the filter set just before', function (done) {
+      ses.webRequest.setRequestFilter('/blocked')
+      ses.webRequest.setRequestFilter(null, function (success) {
+        assert.equal(success, true)
+        $.ajax({
+          url: defaultURL + 'blocked',
+          success: function (data) {
+            assert.equal(data, '/blocked')
+            done()
+          },
+          error: function (xhr, errorType) {
+            done(errorType)
+          }
+        })
+      })
+    })
+
+    it('rejects invalid serialized rules', function (done) {
+      ses.webRequest.setRequestFilter(Buffer.from('invalid'), function (success) {
+        assert.equal(success, false)
+        done()
+      })
+    })
+
+    it('does not run the listener for blocked requests', function (done) {
+      ses.webRequest.onBeforeRequest(function (details, callback) {
+        assert.equal(details.url, defaultURL + 'allowed')
+        callback({})
+      })
+      ses.webRequest.setRequestFilter('/blocked', function () {
+        expectRequests('blocked', 'allowed', done)
+      })
+    })
+  })
+
+  describe('webRequest.getStats', function () {
+    afterEach(function () {
+      ses.webRequest.onBeforeRequest(null)
+    })
+
+    it('measures the listeners', function (done) {
+      ses.webRequest.resetStats()
+      ses.webRequest.onBeforeRequest(function (details, callback) {
+        callback({})
+      })
+      $.ajax({
+        url: defaultURL + 'stats',
+        success: function () {
+          ses.webRequest.getStats(function (stats) {
+            var stages = stats.onBeforeRequest
+            assert.equal(stages.dispatch.count, 1)
+            assert.equal(stages.listener.count, 1)
+            assert.equal(stages.return.count, 1)
+            assert.equal(stages.total.count, 1)
+            assert(stages.total.max >= stages.total.average)
+            // the extension handlers decide right away without listeners
+            assert.equal(stages.extensions.count, 1)
+            assert.equal(stats.onBeforeSendHeaders.extensions.count, 1)
+            done()
+          })
+        },
+        error: function (xhr, errorType) {
+          done(errorType)
+        }
+      })
+    })
+  })
 })
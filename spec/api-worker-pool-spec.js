@@ -0,0 +1,157 @@
+const assert = require('assert')
+const path = require('path')
+const {EventEmitter} = require('events')
+
+const WorkerPool = require(path.join(process.resourcesPath, 'electron.asar', 'browser', 'api', 'worker-pool.js'))
+
+// Stands in for app and the workers it creates, so the tests control when
+// the workers start, answer and fail.
+class FakeWorker extends EventEmitter {
+  constructor (app) {
+    super()
+    this.app = app
+    this.id = -1
+    this.lastError = null
+    this.onerror = null
+    this.posted = []
+    this.stopped = false
+  }
+
+  start () {
+    this.id = this.app.nextId++
+    setImmediate(() => this.emit('start', {}))
+  }
+
+  postMessage (message) {
+    this.posted.push(message)
+  }
+
+  terminate () {
+    if (this.stopped) return
+    this.stopped = true
+    setImmediate(() => this.emit('stop', {}))
+  }
+
+  reply (data) {
+    this.emit('message', {data})
+  }
+
+  fail (message) {
+    this.onerror(message)
+  }
+}
+
+class FakeApp extends EventEmitter {
+  constructor () {
+    super()
+    this.nextId = 1
+    this.workers = []
+  }
+
+  createWorker () {
+    const worker = new FakeWorker(this)
+    this.workers.push(worker)
+    return worker
+  }
+}
+
+const nextTick = function () {
+  return new Promise((resolve) => setImmediate(resolve))
+}
+
+describe('WorkerPool', function () {
+  let app = null
+  let pool = null
+
+  beforeEach(function () {
+    app = new FakeApp()
+  })
+
+  afterEach(function () {
+    pool && pool.terminate()
+    pool = null
+  })
+
+  it('posts each task to an idle worker', function () {
+    pool = new WorkerPool(app, 'module', {size: 2})
+    const results = [pool.run('a'), pool.run('b'), pool.run('c')]
+    return nextTick().then(() => {
+      const [first, second] = app.workers
+      assert.equal(app.workers.length, 2)
+      assert.deepEqual(first.posted, ['a'])
+      assert.deepEqual(second.posted, ['b'])
+      assert.equal(pool.getStats().queueDepth, 1)
+
+      first.reply('A')
+      assert.deepEqual(first.posted, ['a', 'c'])
+      first.reply('C')
+      second.reply('B')
+      return Promise.all(results)
+    }).then((values) => {
+      assert.deepEqual(values, ['A', 'B', 'C'])
+      const stats = pool.getStats()
+      assert.equal(stats.completed, 3)
+      assert.equal(stats.idle, 2)
+    })
+  })
+
+  it('replaces a worker whose task failed', function () {
+    pool = new WorkerPool(app, 'module', {size: 1})
+    const failed = pool.run('a').then(() => assert.fail('resolved'), (error) => error.message)
+    const next = pool.run('b')
+    const ids = []
+    pool.on('task-done', (event) => ids.push(event.id))
+    return nextTick().then(() => {
+      const [first] = app.workers
+      first.fail('boom')
+      // a late answer to the failed task isn't taken for the next one
+      first.reply('late')
+      assert.equal(app.workers.length, 2)
+      return nextTick()
+    }).then(() => {
+      const second = app.workers[1]
+      assert.deepEqual(second.posted, ['b'])
+      second.reply('B')
+      return Promise.all([failed, next])
+    }).then(([error, value]) => {
+      assert.equal(error, 'boom')
+      assert.equal(value, 'B')
+      assert.equal(ids.length, 2)
+      assert.notEqual(ids[0], ids[1])
+      assert.equal(pool.getStats().failed, 1)
+    })
+  })
+
+  it('shrinks once per memory pressure level', function () {
+    pool = new WorkerPool(app, 'module', {size: 4, minSize: 1})
+    return nextTick().then(() => {
+      assert.equal(pool.getStats().idle, 4)
+
+      app.emit('memory-pressure', {}, 'moderate')
+      app.emit('memory-pressure', {}, 'moderate')
+      assert.equal(pool.getStats().limit, 2)
+      assert.equal(pool.getStats().workers, 2)
+
+      app.emit('memory-pressure', {}, 'critical')
+      app.emit('memory-pressure', {}, 'critical')
+      assert.equal(pool.getStats().limit, 1)
+      assert.equal(pool.getStats().workers, 1)
+
+      app.emit('memory-pressure', {}, 'moderate')
+      assert.equal(pool.getStats().limit, 2)
+
+      pool.resize(8)
+      assert.equal(pool.getStats().limit, 4)
+    })
+  })
+
+  it('stops listening to memory pressure once terminated', function () {
+    pool = new WorkerPool(app, 'module', {size: 1})
+    assert.equal(app.listenerCount('memory-pressure'), 1)
+    pool.terminate()
+    assert.equal(app.listenerCount('memory-pressure'), 0)
+    return pool.run('a').then(() => assert.fail('resolved'), (error) => {
+      assert.equal(error.message, 'The worker pool has been terminated')
+    })
+  })
+})
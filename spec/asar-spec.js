@@ -117,6 +117,19 @@ describe('asar package', function () {
         })
       })
 
+      it('reads a compressed file', function (done) {
+        var p = path.join(fixtures, 'asar', 'compressed.asar', 'file1')
+        var returned = false
+        fs.readFile(p, 'utf8', function (err, content) {
+          assert.equal(err, null)
+          assert(returned, 'the callback ran before readFile returned')
+          assert.equal(content, 'compressed\n'.repeat(64))
+          assert.equal(content, fs.readFileSync(p, 'utf8'))
+          done()
+        })
+        returned = true
+      })
+
       it('throws ENOENT error when can not find file', function (done) {
         var p = path.join(fixtures, 'asar', 'a.asar', 'not-exist')
         fs.readFile(p, function (err) {
@@ -496,6 +509,163 @@ describe('asar package', function () {
         }
         assert.throws(throws, /ENOENT/)
       })
+
+      it('extracts a file only once', function () {
+        var asarPath = path.join(fixtures, 'asar', 'a.asar')
+        var asar = process.binding('atom_common_asar')
+        fs.closeSync(fs.openSync(path.join(asarPath, 'file2'), 'r'))
+        var metrics = asar.getArchiveMetrics(asarPath)
+        fs.closeSync(fs.openSync(path.join(asarPath, 'file2'), 'r'))
+        var newMetrics = asar.getArchiveMetrics(asarPath)
+        assert.ok(metrics.extractions + metrics.extractionCacheHits > 0)
+        assert.equal(newMetrics.extractions, metrics.extractions)
+        assert.equal(newMetrics.extractionCacheHits,
+                     metrics.extractionCacheHits)
+      })
+
+      it('reuses the files extracted by an earlier launch', function (done) {
+        var originalFs = require('original-fs')
+        var os = require('os')
+        var dir = originalFs.mkdtempSync(path.join(os.tmpdir(), 'asar-extract-'))
+        var asarPath = path.join(dir, 'a.asar')
+        originalFs.writeFileSync(asarPath, originalFs.readFileSync(path.join(fixtures, 'asar', 'a.asar')))
+
+        var extract = function (callback) {
+          var child = ChildProcess.fork(path.join(fixtures, 'module', 'asar-extract.js'), [asarPath])
+          child.once('message', callback)
+        }
+        extract(function (first) {
+          assert.equal(first.extractions, 1)
+          extract(function (second) {
+            assert.equal(second.extractions, 0)
+            assert.equal(second.extractionCacheHits, 1)
+            assert.equal(second.contents, first.contents)
+            done()
+          })
+        })
+      })
+    })
+
+    describe('archive registry', function () {
+      var asar = process.binding('atom_common_asar')
+      var originalFs = require('original-fs')
+      var os = require('os')
+      var archives = []
+
+      before(function () {
+        // more archives than the registry keeps open
+        var dir = originalFs.mkdtempSync(path.join(os.tmpdir(), 'asar-registry-'))
+        var data = originalFs.readFileSync(path.join(fixtures, 'asar', 'a.asar'))
+        for (var i = 0; i < 40; i++) {
+          archives.push(path.join(dir, 'a' + i + '.asar'))
+          originalFs.writeFileSync(archives[i], data)
+        }
+      })
+
+      it('reads from archives released by the registry', function () {
+        archives.forEach(function (archive) {
+          assert.equal(fs.readFileSync(path.join(archive, 'file1')).toString().trim(), 'file1')
+        })
+        assert.equal(fs.readFileSync(path.join(archives[0], 'file1')).toString().trim(), 'file1')
+      })
+
+      it('reuses a released archive which is still in use', function () {
+        var archive = asar.createArchive(archives[0])
+        archives.slice(1).forEach(function (other) {
+          asar.createArchive(other).destroy()
+        })
+        var reopened = asar.createArchive(archives[0])
+        assert.equal(reopened.getFd(), archive.getFd())
+        reopened.destroy()
+        archive.destroy()
+      })
+
+      it('reports the metrics of open archives only', function () {
+        var archive = path.join(path.dirname(archives[0]), 'metrics.asar')
+        originalFs.writeFileSync(archive, originalFs.readFileSync(archives[0]))
+        assert.equal(asar.getArchiveMetrics(archive), false)
+        assert.equal(asar.getArchiveMetrics(archive), false)
+        assert.equal(fs.readFileSync(path.join(archive, 'file1')).toString().trim(), 'file1')
+        assert.equal(typeof asar.getArchiveMetrics(archive), 'object')
+      })
+    })
+
+    describe('corrupt archives', function () {
+      var originalFs = require('original-fs')
+      var os = require('os')
+      var dir = null
+
+      // Writes an archive with |header| as its header, followed by |data|.
+      var writeArchive = function (name, header, data) {
+        var json = Buffer.from(JSON.stringify(header))
+        var padding = (4 - json.length % 4) % 4
+        var prefix = Buffer.alloc(16)
+        prefix.writeUInt32LE(4, 0)
+        prefix.writeUInt32LE(8 + json.length + padding, 4)
+        prefix.writeUInt32LE(4 + json.length + padding, 8)
+        prefix.writeUInt32LE(json.length, 12)
+        var archive = path.join(dir, name)
+        originalFs.writeFileSync(archive, Buffer.concat([prefix, json, Buffer.alloc(padding), data]))
+        return archive
+      }
+
+      before(function () {
+        dir = originalFs.mkdtempSync(path.join(os.tmpdir(), 'asar-corrupt-'))
+      })
+
+      it('rejects an archive with a truncated header', function () {
+        var data = originalFs.readFileSync(path.join(fixtures, 'asar', 'a.asar'))
+        var archive = path.join(dir, 'truncated.asar')
+        originalFs.writeFileSync(archive, data.slice(0, 32))
+        assert.throws(function () {
+          fs.readFileSync(path.join(archive, 'file1'))
+        }, /Invalid package/)
+      })
+
+      it('fails reads of an archive truncated while it is open', function () {
+        var data = originalFs.readFileSync(path.join(fixtures, 'asar', 'a.asar'))
+        var archive = path.join(dir, 'truncated-in-place.asar')
+        originalFs.writeFileSync(archive, data)
+        assert.equal(fs.readFileSync(path.join(archive, 'file1')).toString().trim(), 'file1')
+        originalFs.truncateSync(archive, 32)
+        assert.throws(function () {
+          fs.readFileSync(path.join(archive, 'file2'))
+        })
+      })
+
+      it('does not find files with an invalid size or offset', function () {
+        var archive = writeArchive('invalid.asar', {
+          files: {
+            file1: {size: 6, offset: '0'},
+            overflow: {size: 6, offset: '18446744073709551615'},
+            negative: {size: -1, offset: '0'}
+          }
+        }, Buffer.from('file1\n'))
+        assert.equal(fs.readFileSync(path.join(archive, 'file1')).toString(), 'file1\n')
+        assert.throws(function () {
+          fs.readFileSync(path.join(archive, 'overflow'))
+        }, /ENOENT/)
+        assert.throws(function () {
+          fs.readFileSync(path.join(archive, 'negative'))
+        }, /ENOENT/)
+      })
+
+      it('fails requests for files past the end of the archive', function (done) {
+        var archive = writeArchive('short.asar', {
+          files: {
+            file1: {size: 6, offset: '1000'}
+          }
+        }, Buffer.from('file1\n'))
+        $.ajax({
+          url: 'file://' + path.join(archive, 'file1'),
+          success: function () {
+            done(new Error('Unexpected success'))
+          },
+          error: function () {
+            done()
+          }
+        })
+      })
     })
 
     describe('fs.open', function () {
@@ -790,6 +960,39 @@ describe('asar package', function () {
       })
     })
 
+    it('serves small files of a mapped archive with a single read', function (done) {
+      var asarPath = path.resolve(fixtures, 'asar', 'a.asar')
+      var asar = remote.process.binding('atom_common_asar')
+      $.get('file://' + path.join(asarPath, 'file1'), function () {
+        var metrics = asar.getArchiveMetrics(asarPath)
+        $.get('file://' + path.join(asarPath, 'file2'), function (data) {
+          assert.equal(data.trim(), 'file2')
+          var newMetrics = asar.getArchiveMetrics(asarPath)
+          assert.equal(newMetrics.reads, metrics.reads + 1)
+          assert.equal(newMetrics.mappedReads, metrics.mappedReads + 1)
+          done()
+        })
+      })
+    })
+
+    it('fails the request when the archive is truncated', function (done) {
+      var originalFs = require('original-fs')
+      var os = require('os')
+      var dir = originalFs.mkdtempSync(path.join(os.tmpdir(), 'asar-truncated-'))
+      var asarPath = path.join(dir, 'video.asar')
+      var data = originalFs.readFileSync(path.join(fixtures, 'asar', 'video.asar'))
+      originalFs.writeFileSync(asarPath, data.slice(0, data.length / 2))
+      $.ajax({
+        url: 'file://' + path.join(asarPath, 'video.mp4'),
+        success: function () {
+          done(new Error('Unexpected success'))
+        },
+        error: function () {
+          done()
+        }
+      })
+    })
+
     it('gets 404 when file is not found', function (done) {
       var p = path.resolve(fixtures, 'asar', 'a.asar', 'no-exist')
       $.ajax({
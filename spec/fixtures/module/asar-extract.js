@@ -0,0 +1,13 @@
+const fs = require('fs')
+const path = require('path')
+
+const asarPath = process.argv[2]
+const fd = fs.openSync(path.join(asarPath, 'file2'), 'r')
+const contents = fs.readFileSync(fd).toString()
+fs.closeSync(fd)
+const metrics = process.binding('atom_common_asar').getArchiveMetrics(asarPath)
+process.send({
+  extractions: metrics.extractions,
+  extractionCacheHits: metrics.extractionCacheHits,
+  contents: contents
+}, () => process.disconnect())
@@ -0,0 +1,15 @@
+// Reads the tab value from the webContents listeners of the main process,
+// which run before the tab helper observes the same change.
+module.exports = function (contents) {
+  const values = []
+  const record = function (event) {
+    const value = contents.tabValue()
+    values.push({event, url: value.url, title: value.title, status: value.status})
+  }
+  contents.on('did-navigate', () => record('did-navigate'))
+  contents.on('page-title-updated', () => record('page-title-updated'))
+  contents.on('did-stop-loading', () => record('did-stop-loading'))
+  return {
+    values: () => values
+  }
+}
@@ -0,0 +1,12 @@
+const path = require('path')
+
+// Worker modules are looked up from the source root, which contains both
+// the executable and the specs.
+module.exports = function (name) {
+  const fixture = path.join(__dirname, '..', 'workers', name)
+  let root = path.dirname(process.execPath)
+  while (path.relative(root, fixture).startsWith('..')) {
+    root = path.dirname(root)
+  }
+  return path.relative(root, fixture).split(path.sep).join('/')
+}
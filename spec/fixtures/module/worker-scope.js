@@ -0,0 +1,32 @@
+const {app} = require('electron')
+const getModuleName = require('./worker-module-name')
+
+const runWorker = function (callback) {
+  const worker = app.createWorker(getModuleName('scope-worker'))
+  worker.once('start', () => {
+    if (worker.lastError) {
+      worker.terminate()
+      callback(worker.lastError)
+      return
+    }
+
+    worker.once('message', (event) => {
+      worker.terminate()
+      callback(null, event.data)
+    })
+    worker.postMessage('scope')
+  })
+  worker.start()
+}
+
+// Loads the same module in two workers, the second one compiling it from
+// the code cache of the first.
+module.exports = function (callback) {
+  runWorker((error, first) => {
+    if (error) return callback(error)
+    runWorker((error, second) => {
+      if (error) return callback(error)
+      callback(null, [first, second])
+    })
+  })
+}
@@ -0,0 +1,44 @@
+const {app} = require('electron')
+const getModuleName = require('./worker-module-name')
+
+// Posts a transferred ArrayBuffer, and then the same SharedArrayBuffer twice,
+// to a worker from the main process, where the buffers are created.
+module.exports = function (callback) {
+  const worker = app.createWorker(getModuleName('transfer-worker'))
+  worker.once('start', () => {
+    if (worker.lastError) {
+      worker.terminate()
+      callback(worker.lastError)
+      return
+    }
+
+    const buffer = new ArrayBuffer(8)
+    new Uint8Array(buffer)[0] = 7
+    worker.postMessage({buffer}, [buffer])
+    const detached = buffer.byteLength === 0
+
+    worker.once('message', (event) => {
+      const transferred = event.data
+      const shared = new SharedArrayBuffer(4)
+      const view = new Int32Array(shared)
+      view[0] = 41
+      worker.postMessage({shared})
+      worker.once('message', (event) => {
+        const first = {seen: event.data.seen, value: view[0]}
+        // the same buffer is shared again rather than copied
+        view[0] = 100
+        worker.postMessage({shared})
+        worker.once('message', (event) => {
+          const second = {
+            seen: event.data.seen,
+            previous: event.data.previous,
+            value: view[0]
+          }
+          worker.terminate()
+          callback(null, {detached, transferred, shared: [first, second]})
+        })
+      })
+    })
+  })
+  worker.start()
+}
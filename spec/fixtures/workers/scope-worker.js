@@ -0,0 +1,13 @@
+// Reports the names of the module system scope this module can see.
+self.onmessage = function () {
+  self.postMessage({
+    require: typeof require,
+    module: typeof module,
+    exports: typeof exports,
+    define: typeof define,
+    requireNative: typeof requireNative,
+    privates: typeof privates,
+    $Array: typeof $Array,
+    $Function: typeof $Function
+  })
+}
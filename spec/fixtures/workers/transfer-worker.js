@@ -0,0 +1,22 @@
+let previous = null
+
+self.onmessage = function (event) {
+  const data = event.data
+  if (data.buffer) {
+    self.postMessage({
+      byteLength: data.buffer.byteLength,
+      first: new Uint8Array(data.buffer)[0]
+    })
+  } else if (data.shared) {
+    // the view of an earlier message sees the same memory when the buffer is
+    // posted again
+    const view = new Int32Array(data.shared)
+    const seen = view[0]
+    view[0] = seen + 1
+    self.postMessage({
+      seen,
+      previous: previous ? previous[0] : null
+    })
+    previous = view
+  }
+}
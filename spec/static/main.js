@@ -70,6 +70,20 @@ ipcMain.on('echo', function (event, msg) {
   event.returnValue = msg
 })
 
+ipcMain.handle('invoke-echo', function (event, ...args) {
+  return args
+})
+
+ipcMain.handle('invoke-delay', function (event, ms, value) {
+  return new Promise(function (resolve) {
+    setTimeout(function () { resolve(value) }, ms)
+  })
+})
+
+ipcMain.handle('invoke-error', function (event, message) {
+  throw new Error(message)
+})
+
 const coverage = new Coverage({
   outputPath: path.join(__dirname, '..', '..', 'out', 'coverage')
 })
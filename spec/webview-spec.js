@@ -886,6 +886,56 @@ describe('<webview> tag', function () {
     })
   })
 
+  describe('<webview>.getWebContents().tabValue', function () {
+    const {webContents} = require('electron').remote
+    const tabValueRecorder = require('electron').remote.require(path.join(fixtures, 'module', 'tab-value-recorder.js'))
+    const pageUrl = 'file://' + path.join(fixtures, 'pages', 'tab-value.html')
+
+    it('is up to date in the listeners of navigation and title changes', function (done) {
+      let recorder = null
+      webview.addEventListener('did-attach', function () {
+        recorder = tabValueRecorder(webview.getWebContents())
+      })
+      webview.addEventListener('did-stop-loading', function onStop () {
+        if (webview.getURL() !== pageUrl) return
+        webview.removeEventListener('did-stop-loading', onStop)
+        webview.addEventListener('page-title-updated', function () {
+          const values = recorder.values()
+          assert.deepEqual(values.find((value) => value.event === 'did-navigate').url, pageUrl)
+          assert.deepEqual(values.filter((value) => value.event === 'page-title-updated')
+            .map((value) => value.title), ['tab value', 'changed'])
+          assert.equal(values.filter((value) => value.event === 'did-stop-loading').pop().status, 'complete')
+          done()
+        })
+        webview.executeJavaScript("document.title = 'changed'")
+      })
+      webview.src = pageUrl
+      document.body.appendChild(webview)
+    })
+
+    it('is listed by getAllTabValues when it changes', function (done) {
+      webview.addEventListener('did-finish-load', function onLoad () {
+        webview.removeEventListener('did-finish-load', onLoad)
+        const contents = webview.getWebContents()
+        const {id, windowId} = contents.tabValue()
+        const all = webContents.getAllTabValues(windowId)
+        assert.equal(all.full, false)
+        assert(all.tabs.some((tab) => tab.id === id))
+        assert.deepEqual(webContents.getAllTabValues(windowId, all.version).tabs, [])
+
+        webview.addEventListener('page-title-updated', function () {
+          const changes = webContents.getAllTabValues(windowId, all.version)
+          assert(changes.version > all.version)
+          assert.deepEqual(changes.tabs.map((tab) => [tab.id, tab.title]), [[id, 'changed']])
+          done()
+        })
+        webview.executeJavaScript("document.title = 'changed'")
+      })
+      webview.src = pageUrl
+      document.body.appendChild(webview)
+    })
+  })
+
   describe('did-get-response-details event', function () {
     it('emits for the page and its resources', function (done) {
       // expected {fileName: resourceType} pairs
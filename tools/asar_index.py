@@ -0,0 +1,151 @@
+#!/usr/bin/env python
+
+# Generates the precompiled header index of an asar archive, which is loaded
+# by asar::Archive instead of parsing the JSON header. The layout must match
+# Archive::LoadIndex in atom/common/asar/archive.cc.
+
+import hashlib
+import json
+import re
+import struct
+import sys
+
+INDEX_MAGIC = b'ASARIDX3'
+INDEX_EXTENSION = '.index'
+
+ENTRY_DIRECTORY = 1 << 0
+ENTRY_LINK = 1 << 1
+ENTRY_UNPACKED = 1 << 2
+ENTRY_EXECUTABLE = 1 << 3
+ENTRY_INVALID = 1 << 4
+ENTRY_DEFLATE = 1 << 5
+ENTRY_BROTLI = 1 << 6
+
+COMPRESSION_FLAGS = {
+  'deflate': ENTRY_DEFLATE,
+  'brotli': ENTRY_BROTLI,
+}
+
+INT_MAX = 2 ** 31 - 1
+UINT64_MAX = 2 ** 64 - 1
+OFFSET_RE = re.compile(r'^\+?[0-9]+$')
+
+
+def main():
+  archive = sys.argv[1]
+  with open(archive, 'rb') as f:
+    size_pickle = f.read(8)
+    header_size = struct.unpack('<I', size_pickle[4:8])[0]
+    header_pickle = f.read(header_size)
+
+  string_size = struct.unpack('<I', header_pickle[4:8])[0]
+  header = json.loads(header_pickle[8:8 + string_size].decode('utf-8'))
+
+  entries, names = build_index(header, 8 + header_size)
+
+  with open(archive + INDEX_EXTENSION, 'wb') as f:
+    f.write(INDEX_MAGIC)
+    f.write(struct.pack('<I', 8 + header_size))
+    f.write(hashlib.sha1(header_pickle).digest())
+    f.write(struct.pack('<II', len(entries), len(names)))
+    for entry in entries:
+      f.write(struct.pack('<IIIIQIII4x', *entry))
+    f.write(names)
+
+
+def build_index(root, header_size):
+  # Mirrors Archive::BuildIndex: entries are laid out breadth first so the
+  # children of a directory are adjacent and sorted by their UTF-8 names.
+  names = bytearray()
+  interned = {}
+
+  def intern(name):
+    if name not in interned:
+      interned[name] = len(names)
+      names.extend(name)
+    return interned[name]
+
+  nodes = [root]
+  entries = [[0, 0, 0, 0, 0, 0, 0, 0]]
+  i = 0
+  while i < len(nodes):
+    node = nodes[i]
+    entry = entries[i]
+    link = node.get('link')
+    files = node.get('files')
+    if is_string(link):
+      link = link.encode('utf-8')
+      entry[2] |= ENTRY_LINK
+      entry[5] = intern(link)
+      entry[6] = len(link)
+    elif isinstance(files, dict):
+      children = sorted((name.encode('utf-8'), child)
+                        for name, child in files.items()
+                        if isinstance(child, dict))
+      entry[2] |= ENTRY_DIRECTORY
+      entry[5] = len(entries)
+      entry[6] = len(children)
+      for name, child in children:
+        entries.append([intern(name), len(name), 0, 0, 0, 0, 0, 0])
+        nodes.append(child)
+    elif not read_file_node(node, header_size, entry):
+      entry[2] |= ENTRY_INVALID
+    i += 1
+
+  return entries, bytes(names)
+
+
+def read_file_node(node, header_size, entry):
+  size = node.get('size')
+  if not is_integer(size) or not 0 <= size <= INT_MAX:
+    return False
+  entry[3] = size
+
+  if node.get('unpacked') is True:
+    entry[2] |= ENTRY_UNPACKED
+    return True
+
+  offset = node.get('offset')
+  if not is_string(offset) or not OFFSET_RE.match(offset):
+    return False
+  offset = int(offset)
+  if offset > UINT64_MAX - header_size:
+    return False
+  entry[4] = offset + header_size
+
+  if node.get('executable') is True:
+    entry[2] |= ENTRY_EXECUTABLE
+
+  compression = node.get('compression')
+  if is_string(compression):
+    if compression not in COMPRESSION_FLAGS:
+      return False
+    entry[2] |= COMPRESSION_FLAGS[compression]
+
+    compressed_size = node.get('compressedSize')
+    if (not is_integer(compressed_size) or
+        not 0 <= compressed_size <= INT_MAX):
+      return False
+    entry[7] = compressed_size
+
+  return True
+
+
+def is_string(value):
+  try:
+    return isinstance(value, basestring)
+  except NameError:
+    return isinstance(value, str)
+
+
+def is_integer(value):
+  if isinstance(value, bool):
+    return False
+  try:
+    return isinstance(value, (int, long))
+  except NameError:
+    return isinstance(value, int)
+
+
+if __name__ == '__main__':
+  sys.exit(main())
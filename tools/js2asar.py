@@ -24,6 +24,7 @@ def main():
 
   copy_files(folder_name, source_files, output_dir)
   call_asar(archive, os.path.join(output_dir, folder_name))
+  call_asar_index(archive)
   shutil.rmtree(output_dir)
 
 
@@ -48,6 +49,11 @@ def call_asar(archive, output_dir):
   subprocess.check_call([asar, 'pack', output_dir, archive])
 
 
+def call_asar_index(archive):
+  asar_index = os.path.join(SOURCE_ROOT, 'tools', 'asar_index.py')
+  subprocess.check_call([sys.executable, asar_index, archive])
+
+
 def safe_mkdir(path):
   try:
     os.makedirs(path)